@@ -26,8 +26,10 @@
 
 #include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
+#include <memory>
 
 namespace mlir {
 
@@ -35,6 +37,7 @@ class AffineApplyOp;
 class AffineForOp;
 class AffineValueMap;
 class FlatAffineConstraints;
+class Function;
 class Operation;
 class Value;
 
@@ -107,12 +110,82 @@ bool checkMemrefAccessDependence(
     llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
     bool allowRAR = false);
 
+/// A function analysis that memoizes the dependence checks between the memory
+/// accesses of a function. The access function and the iteration domain of
+/// each access are computed once, and the result of the check between two
+/// accesses is cached for every loop depth, so that the repeated queries of the
+/// loop transformations on the same pairs of accesses are cheap.
+///
+/// The cached results of an access become stale when it, or a loop surrounding
+/// it, is erased or moved, or when the bounds of such a loop change. A pass
+/// that transforms the function while using the analysis must then call
+/// 'invalidate' on the outermost operation it changed. Across passes, the
+/// analysis is dropped unless the pass preserves it.
+class DependenceAnalysis {
+public:
+  explicit DependenceAnalysis(Function *function);
+  DependenceAnalysis(DependenceAnalysis &&);
+  DependenceAnalysis &operator=(DependenceAnalysis &&);
+  ~DependenceAnalysis();
+
+  /// Checks for a dependence from the memory access 'srcOp' to the memory
+  /// access 'dstOp' at 'loopDepth', with the semantics of
+  /// checkMemrefAccessDependence.
+  bool checkDependence(
+      Operation *srcOp, Operation *dstOp, unsigned loopDepth,
+      llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+      bool allowRAR = false);
+
+  /// Drops the cached results of 'op' and of the operations nested in it.
+  void invalidate(Operation *op);
+
+  /// Returns the number of queries answered from the cache, and the number of
+  /// queries that ran a dependence check.
+  unsigned getNumHits() const { return numHits; }
+  unsigned getNumMisses() const { return numMisses; }
+
+  /// Returns an estimate of the memory used by the cached results.
+  size_t getMemoryUsage() const;
+
+private:
+  /// The access function and the iteration domain of an access.
+  struct AccessInfo;
+
+  /// The cached result of the check between two accesses at a loop depth.
+  struct DepthResult {
+    enum class Kind { Unknown, NoDependence, Dependence };
+    Kind kind = Kind::Unknown;
+    /// Whether 'components' were computed for a dependence.
+    bool hasComponents = false;
+    llvm::SmallVector<DependenceComponent, 2> components;
+  };
+
+  /// The cached results of the checks between two accesses, indexed by
+  /// 'allowRAR' and the loop depth.
+  struct PairResults {
+    llvm::SmallVector<DepthResult, 4> byDepth[2];
+  };
+
+  /// Returns the access function and the iteration domain of 'op', computing
+  /// them if needed.
+  AccessInfo &getAccessInfo(Operation *op);
+
+  llvm::DenseMap<Operation *, std::unique_ptr<AccessInfo>> accessInfos;
+
+  /// The cached results, indexed by the source and the destination access.
+  llvm::DenseMap<Operation *, llvm::DenseMap<Operation *, PairResults>> results;
+
+  unsigned numHits = 0, numMisses = 0;
+};
+
 /// Returns in 'depCompsVec', dependence components for dependences between all
 /// load and store ops in loop nest rooted at 'forOp', at loop depths in range
-/// [1, maxLoopDepth].
+/// [1, maxLoopDepth]. The checks are memoized in 'dependenceAnalysis' if
+/// provided.
 void getDependenceComponents(
     AffineForOp forOp, unsigned maxLoopDepth,
-    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec);
+    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec,
+    DependenceAnalysis *dependenceAnalysis = nullptr);
 
 } // end namespace mlir
 
@@ -218,7 +218,17 @@ private:
 /// coefficient (r, c) lives at the location numReservedCols * r + c in the
 /// buffer. The extra space between getNumCols() and numReservedCols exists to
 /// prevent frequent movement of data when adding columns, especially at the
-/// end.
+/// end: numReservedCols grows geometrically, so that adding identifiers one at
+/// a time moves each coefficient an amortized constant number of times.
+///
+/// The row operations (the combinations of Gaussian and Fourier-Motzkin
+/// elimination) never silently wrap around. The multipliers that scale two
+/// rows to a common coefficient are derived from the GCD of the coefficients
+/// rather than from their LCM, so they fit in 64 bits. When the coefficients
+/// of a combined row may not, the row is computed with arbitrary precision and
+/// normalized by its GCD. If it still doesn't fit, the constraint is dropped,
+/// which over-approximates the set: emptiness checks and projections remain
+/// conservative.
 ///
 /// The identifiers x_0, x_1, ... appear in the order: dimensional identifiers,
 /// symbolic identifiers, and local identifiers.  The local identifiers
@@ -236,6 +246,17 @@ class FlatAffineConstraints {
 public:
   enum IdKind { Dimension, Symbol, Local };
 
+  /// The algorithm used to decide emptiness and to compute projections.
+  enum class Engine {
+    /// Fourier-Motzkin elimination, which is fast on small systems but may
+    /// blow up and is not integer exact.
+    FourierMotzkin,
+    /// An exact rational Simplex, with branch and bound to decide integer
+    /// emptiness, and with redundant constraints removed after each step of a
+    /// projection. See Simplex.h.
+    Simplex
+  };
+
   /// Constructs a constraint system reserving memory for the specified number
   /// of constraints and identifiers..
   FlatAffineConstraints(unsigned numReservedInequalities,
@@ -315,7 +336,9 @@ public:
   // constraints.
   // Returns true if the GCD test fails for any equality, or if any invalid
   // constraints are discovered on any row. Returns false otherwise.
-  bool isEmpty() const;
+  // With the Simplex engine, the integer emptiness is decided exactly by branch
+  // and bound, falling back to elimination if the search is inconclusive.
+  bool isEmpty(Engine engine = Engine::FourierMotzkin) const;
 
   // Runs the GCD test on all equality constraints. Returns 'true' if this test
   // fails on any equality. Returns 'false' otherwise.
@@ -488,7 +511,10 @@ public:
   /// that still exist. This method may not always be integer exact.
   // TODO(bondhugula): deal with integer exactness when necessary - can return a
   // value to mark exactness for example.
-  void projectOut(unsigned pos, unsigned num);
+  /// With the Simplex engine, the constraints made redundant by each
+  /// elimination are removed, which keeps Fourier-Motzkin from blowing up.
+  void projectOut(unsigned pos, unsigned num,
+                  Engine engine = Engine::FourierMotzkin);
   inline void projectOut(unsigned pos) { return projectOut(pos, 1); }
 
   /// Projects out the identifier that is associate with Value *.
@@ -655,8 +681,10 @@ public:
   void removeTrivialRedundancy();
 
   /// A more expensive check to detect redundant inequalities thatn
-  /// removeTrivialRedundancy.
-  void removeRedundantInequalities();
+  /// removeTrivialRedundancy. With the Simplex engine, all inequalities implied
+  /// by the other constraints over the rationals are removed, using a single
+  /// tableau instead of an emptiness check per inequality.
+  void removeRedundantInequalities(Engine engine = Engine::FourierMotzkin);
 
   // Removes all equalities and inequalities.
   void clearConstraints();
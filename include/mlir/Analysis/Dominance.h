@@ -19,6 +19,7 @@
 #define MLIR_ANALYSIS_DOMINANCE_H
 
 #include "mlir/IR/FunctionGraphTraits.h"
+#include "llvm/Support/CFGUpdate.h"
 #include "llvm/Support/GenericDomTree.h"
 
 extern template class llvm::DominatorTreeBase<mlir::Block, false>;
@@ -28,6 +29,10 @@ namespace mlir {
 using DominanceInfoNode = llvm::DomTreeNodeBase<Block>;
 class Function;
 
+/// An insertion or deletion of a CFG edge, used to incrementally update the
+/// dominance information.
+using DominanceUpdate = llvm::cfg::Update<Block *>;
+
 namespace detail {
 template <bool IsPostDom> class DominanceInfoBase {
   using base = llvm::DominatorTreeBase<Block, IsPostDom>;
@@ -40,22 +45,41 @@ public:
   DominanceInfoBase(const DominanceInfoBase &) = delete;
   DominanceInfoBase &operator=(const DominanceInfoBase &) = delete;
 
-  /// Recalculate the dominance info for the provided function.
+  /// Recalculate the dominance info for the provided function. The dominance
+  /// of each region is computed lazily, when it is first queried.
   void recalculate(Function *function);
 
+  /// Incrementally update the dominance info for a batch of CFG edge
+  /// insertions and deletions, which must already be reflected in the CFG. The
+  /// edges may belong to different regions. The dominance of a region that
+  /// wasn't computed yet is left to be computed when it is first queried.
+  void applyUpdates(ArrayRef<DominanceUpdate> updates);
+
+  /// Drop the dominance info of the regions held by the given operation, and
+  /// by the operations nested within them, before the operation is erased.
+  void notifyOperationErased(Operation *op);
+
   /// Get the root dominance node of the given region.
   DominanceInfoNode *getRootNode(Region *region) {
-    assert(dominanceInfos.count(region) != 0);
-    return dominanceInfos[region]->getRootNode();
+    return getDominanceInfo(region)->getRootNode();
   }
 
+  /// Returns an estimate of the memory used by the dominator trees, allowing
+  /// the analysis manager to bound the memory of the analyses it retains.
+  size_t getMemoryUsage() const;
+
 protected:
   using super = DominanceInfoBase<IsPostDom>;
 
+  /// Returns the dominator tree of the provided region, computing it if it
+  /// isn't known yet.
+  base *getDominanceInfo(Region *region);
+
   /// Return true if the specified block A properly dominates block B.
   bool properlyDominates(Block *a, Block *b);
 
-  /// A mapping of regions to their base dominator tree.
+  /// A mapping of regions to their base dominator tree, for the regions that
+  /// were queried.
   llvm::DenseMap<Region *, std::unique_ptr<base>> dominanceInfos;
 };
 } // end namespace detail
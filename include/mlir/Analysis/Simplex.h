@@ -0,0 +1,238 @@
+//===- Simplex.h - MLIR Simplex Class ---------------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// An exact Simplex solver for systems of affine constraints, used to decide
+// the emptiness of FlatAffineConstraints and to detect redundant constraints.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_SIMPLEX_H
+#define MLIR_ANALYSIS_SIMPLEX_H
+
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace mlir {
+
+class FlatAffineConstraints;
+
+/// A Simplex tableau over the rationals, for a system of affine inequalities
+/// and equalities in a fixed number of variables. Constraints use the layout of
+/// FlatAffineConstraints: the coefficients of the variables followed by the
+/// constant term, i.e., {a_0, ..., a_{n-1}, c} stands for
+/// a_0 * x_0 + ... + a_{n-1} * x_{n-1} + c >= 0 (or == 0).
+///
+/// The tableau keeps every variable and constraint as an "unknown", which is
+/// either a column, with a sample value of zero, or a row, expressed as an
+/// affine function of the column unknowns. Each row is stored as integers with
+/// a common, positive denominator, so all computations are exact. The sample
+/// point is kept feasible: the sample value of every constraint is
+/// non-negative, unless the system was found to be empty. Pivots are selected
+/// using Bland's rule, which guarantees termination.
+///
+/// The integers of the tableau can grow large. If an operation overflows, the
+/// tableau is marked as such and the queries return conservative results.
+///
+/// Constraints can be removed in LIFO order by rolling back to a snapshot. This
+/// is used to compute optima and to branch and bound on integer values without
+/// copying the tableau.
+class Simplex {
+public:
+  enum class Direction { Up, Down };
+
+  /// A rational number 'num / den', with a positive denominator.
+  struct Fraction {
+    int64_t num, den;
+  };
+
+  /// The default bound on the number of branches explored by isIntegerEmpty.
+  static constexpr unsigned kDefaultMaxBranches = 1024;
+
+  /// Construct a Simplex for 'numVars' unconstrained variables.
+  explicit Simplex(unsigned numVars);
+
+  /// Construct a Simplex for the identifiers and constraints of 'constraints'.
+  explicit Simplex(const FlatAffineConstraints &constraints);
+
+  unsigned getNumVariables() const { return vars.size(); }
+  unsigned getNumConstraints() const { return cons.size(); }
+
+  /// Add the inequality 'coeffs >= 0'.
+  void addInequality(ArrayRef<int64_t> coeffs);
+
+  /// Add the equality 'coeffs == 0', as a pair of inequalities.
+  void addEquality(ArrayRef<int64_t> coeffs);
+
+  /// Returns true if the constraints have no rational solution.
+  bool isEmpty() const { return empty; }
+
+  /// Returns true if an arithmetic overflow occurred. The results of the
+  /// queries are then conservative.
+  bool hasOverflowed() const { return overflowed; }
+
+  /// Returns the maximum (Direction::Up) or minimum (Direction::Down) of the
+  /// affine expression 'coeffs' over the rational points of the system, or None
+  /// if the system is empty, the expression is unbounded, or an overflow
+  /// occurred.
+  Optional<Fraction> computeOptimum(Direction direction,
+                                    ArrayRef<int64_t> coeffs);
+
+  /// Search for an integer point of the system by branch and bound. Returns
+  /// true if there is none, and false if one is found, in which case it is
+  /// stored in 'sample' if provided. Returns None if the search explored more
+  /// than 'maxBranches' branches, which can happen for unbounded systems, or if
+  /// an overflow occurred.
+  Optional<bool> isIntegerEmpty(unsigned maxBranches = kDefaultMaxBranches,
+                                SmallVectorImpl<int64_t> *sample = nullptr);
+
+  /// Detect the constraints in [offset, offset + count) that are implied by the
+  /// remaining constraints, considering the constraints in order. A redundant
+  /// constraint no longer restricts the tableau; this isn't undone by rollback.
+  void detectRedundant(unsigned offset, unsigned count);
+
+  /// Returns true if the given constraint was found to be redundant.
+  bool isMarkedRedundant(unsigned constraintIndex) const {
+    return cons[constraintIndex].redundant;
+  }
+
+  /// Returns a snapshot of the current state, to roll back to.
+  unsigned getSnapshot() const { return undoLog.size(); }
+
+  /// Undo the changes made since the given snapshot was taken.
+  void rollback(unsigned snapshot);
+
+  void print(raw_ostream &os) const;
+  void dump() const;
+
+private:
+  enum class Orientation { Row, Column };
+
+  /// A variable or constraint of the tableau.
+  struct Unknown {
+    Unknown(Orientation orientation, bool restricted, unsigned pos)
+        : orientation(orientation), restricted(restricted), pos(pos) {}
+
+    /// Whether the unknown is a row or column of the tableau.
+    Orientation orientation;
+    /// Whether the unknown must be non-negative.
+    bool restricted;
+    /// Whether the constraint was found to be redundant.
+    bool redundant = false;
+    /// The row or column of the unknown.
+    unsigned pos;
+  };
+
+  struct Pivot {
+    unsigned row, column;
+  };
+
+  /// The changes recorded for rollback.
+  enum class UndoLogEntry { RemoveLastConstraint, UnmarkEmpty };
+
+  int64_t &at(unsigned row, unsigned column) {
+    return tableau[row * numColumns + column];
+  }
+  int64_t at(unsigned row, unsigned column) const {
+    return tableau[row * numColumns + column];
+  }
+
+  /// Unknowns are indexed by their position in 'cons', or by the complement of
+  /// their position in 'vars'.
+  Unknown &unknownFromIndex(int index) {
+    return index >= 0 ? cons[index] : vars[~index];
+  }
+  const Unknown &unknownFromIndex(int index) const {
+    return index >= 0 ? cons[index] : vars[~index];
+  }
+
+  /// Add a row for the affine expression 'coeffs' as a new, unrestricted
+  /// constraint. Returns the index of the constraint.
+  unsigned addRow(ArrayRef<int64_t> coeffs);
+
+  /// Divide the given row by the GCD of its elements.
+  void normalizeRow(unsigned row);
+
+  /// Swap the row unknown at 'row' with the column unknown at 'column', and
+  /// update the tableau accordingly.
+  void pivot(unsigned row, unsigned column);
+  void pivot(Pivot pivot) { this->pivot(pivot.row, pivot.column); }
+  void swapRows(unsigned lhs, unsigned rhs);
+
+  /// Find a pivot that changes the sample value of 'row' in the given
+  /// direction, without making any other restricted row negative. If the move
+  /// isn't bounded by another row, the returned pivot row is 'row' itself.
+  /// Returns None if the sample value of 'row' can't change in this direction.
+  Optional<Pivot> findPivot(unsigned row, Direction direction);
+
+  /// Find the row that bounds a move of the column unknown at 'column' in the
+  /// given direction first, skipping 'skipRow'.
+  Optional<unsigned> findPivotRow(Optional<unsigned> skipRow,
+                                  Direction direction, unsigned column);
+
+  /// Pivot until the sample value of the given row unknown is non-negative.
+  /// Fails if it can't be made non-negative.
+  LogicalResult restoreRow(Unknown &u);
+
+  /// Pivot the row 'row' to its optimum in the given direction, and return its
+  /// sample value. Returns None if it is unbounded.
+  Optional<Fraction> computeRowOptimum(Direction direction, unsigned row);
+
+  /// Pivot the given column unknown into a row.
+  void moveToRow(Unknown &u);
+
+  void markEmpty();
+  void undo(UndoLogEntry entry);
+
+  /// Branch and bound below the current tableau, with the semantics of
+  /// isIntegerEmpty.
+  Optional<bool> findIntegerSample(unsigned &remainingBranches,
+                                   SmallVectorImpl<int64_t> &sample);
+
+  /// Arithmetic that records overflows.
+  int64_t add(int64_t lhs, int64_t rhs);
+  int64_t sub(int64_t lhs, int64_t rhs);
+  int64_t mul(int64_t lhs, int64_t rhs);
+  int64_t negate(int64_t value);
+
+  /// The number of rows and columns of the tableau. Column 0 holds the
+  /// denominator of each row and column 1 its constant term.
+  unsigned numRows = 0, numColumns;
+
+  /// The tableau, in row-major order.
+  SmallVector<int64_t, 64> tableau;
+
+  /// The index of the unknown of each row and column.
+  SmallVector<int, 8> rowUnknown, colUnknown;
+
+  /// The variables and constraints of the system.
+  SmallVector<Unknown, 8> vars, cons;
+
+  SmallVector<UndoLogEntry, 8> undoLog;
+
+  /// Set when the system is known to have no rational solution.
+  bool empty = false;
+
+  /// Set when an arithmetic overflow occurred.
+  bool overflowed = false;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_SIMPLEX_H
@@ -216,6 +216,10 @@ struct MemRefRegion {
   FlatAffineConstraints cst;
 };
 
+/// Returns the size in bytes of an element of the memref, as laid out in memory
+/// once lowered to the LLVM IR dialect.
+unsigned getMemRefEltSizeInBytes(MemRefType memRefType);
+
 /// Returns the size of memref data in bytes if it's statically shaped, None
 /// otherwise.
 Optional<uint64_t> getMemRefSizeInBytes(MemRefType memRefType);
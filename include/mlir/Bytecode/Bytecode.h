@@ -0,0 +1,64 @@
+//===- Bytecode.h - MLIR Bytecode Reader and Writer -------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file declares the entry points for reading and writing modules in the
+// MLIR bytecode format, a compact binary alternative to the textual form.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODE_H
+#define MLIR_BYTECODE_BYTECODE_H
+
+#include <memory>
+
+namespace llvm {
+class MemoryBuffer;
+class raw_ostream;
+class StringRef;
+} // end namespace llvm
+
+namespace mlir {
+class MLIRContext;
+class Module;
+
+/// Write the given module to 'os' in the bytecode format.
+void writeBytecode(Module *module, llvm::raw_ostream &os);
+
+/// Returns true if the given buffer starts with the bytecode magic number.
+bool isBytecode(llvm::StringRef buffer);
+
+/// This reads a module from the given bytecode buffer.  If the buffer is
+/// invalid, the error message is emitted through the error handler registered
+/// in the context, and a null pointer is returned.
+///
+/// If 'lazy' is set, the function bodies are only materialized when they are
+/// first accessed.  In this case the buffer must outlive the module, and the
+/// module is not verified when it is read.  A malformed function body is only
+/// reported when it is materialized, in which case Function::materialize
+/// returns failure and the body is left empty.
+Module *readBytecode(llvm::StringRef buffer, MLIRContext *context,
+                     bool lazy = false);
+
+/// This reads a module from the given bytecode buffer, the ownership of which
+/// is transferred to the context.  The raw data of dense elements attributes
+/// is then referred to in place rather than copied into the context.
+Module *readBytecode(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                     MLIRContext *context, bool lazy = false);
+
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODE_H
@@ -26,6 +26,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Error.h"
 
+#include <array>
 #include <functional>
 #include <memory>
 
@@ -37,12 +38,36 @@ class Module;
 namespace mlir {
 
 class Module;
+class OnDiskObjectCache;
 class PassManager;
 
 namespace impl {
 class OrcJIT;
 } // end namespace impl
 
+/// A packed-argument function of an ExecutionEngine bound to a list of
+/// arguments.  Calling it neither looks up the function nor packs the
+/// arguments again.  The arguments are bound by address: their values are read
+/// at each call, so a memref descriptor may be updated between calls, e.g. to
+/// point to new data.  The invocation must not outlive its engine or its
+/// arguments.
+class PackedInvocation {
+public:
+  PackedInvocation(void (*fptr)(void **), ArrayRef<void *> args)
+      : fptr(fptr), packedArgs(args.begin(), args.end()) {}
+
+  /// Calls the function with the bound arguments.
+  void operator()() { fptr(packedArgs.data()); }
+
+  /// Rebinds the argument at position `index` to `arg`.
+  void setArgument(unsigned index, void *arg) { packedArgs[index] = arg; }
+  ArrayRef<void *> getArguments() const { return packedArgs; }
+
+private:
+  void (*fptr)(void **);
+  SmallVector<void *, 8> packedArgs;
+};
+
 /// JIT-backed execution engine for MLIR modules.  Assumes the module can be
 /// converted to LLVM IR.  For each function, creates a wrapper function with
 /// the fixed interface
@@ -60,17 +85,33 @@ public:
   /// Creates an execution engine for the given module.  If `pm` is provided,
   /// runs it on the MLIR module.  If `transformer` is
   /// provided, it will be called on the LLVM module during JIT-compilation and
-  /// can be used, e.g., for reporting or optimization.
+  /// can be used, e.g., for reporting or optimization.  If `cache` is
+  /// provided, the compiled object is looked up in it first, and added to it
+  /// otherwise; on a hit, neither `transformer` nor code generation run.
+  ///
+  /// If `numCompileThreads` is not zero, the module is translated concurrently
+  /// into that many LLVM modules, each in its own context, which are then
+  /// transformed and compiled concurrently on that many threads; functions in
+  /// different modules are then not inlined into each other.  If
+  /// `lazyCompilation` is set, the LLVM module is split into one partition per
+  /// function, and a partition is only compiled when one of its functions is
+  /// first looked up, directly or through the functions that call it.
   static llvm::Expected<std::unique_ptr<ExecutionEngine>>
   create(Module *m, PassManager *pm,
-         std::function<llvm::Error(llvm::Module *)> transformer = {});
+         std::function<llvm::Error(llvm::Module *)> transformer = {},
+         OnDiskObjectCache *cache = nullptr, unsigned numCompileThreads = 0,
+         bool lazyCompilation = false);
 
   /// Creates an execution engine for the given module.  If `transformer` is
   /// provided, it will be called on the LLVM module during JIT-compilation and
-  /// can be used, e.g., for reporting or optimization.
+  /// can be used, e.g., for reporting or optimization.  If `cache` is provided,
+  /// compiled objects are reused from and added to it.  `numCompileThreads`
+  /// and `lazyCompilation` are as above.
   static llvm::Expected<std::unique_ptr<ExecutionEngine>>
   create(Module *m,
-         std::function<llvm::Error(llvm::Module *)> transformer = {});
+         std::function<llvm::Error(llvm::Module *)> transformer = {},
+         OnDiskObjectCache *cache = nullptr, unsigned numCompileThreads = 0,
+         bool lazyCompilation = false);
 
   /// Looks up a packed-argument function with the given name and returns a
   /// pointer to it.  Propagates errors in case of failure.
@@ -87,6 +128,20 @@ public:
   /// the templated `invoke`.
   llvm::Error invoke(StringRef name, MutableArrayRef<void *> args);
 
+  /// Looks up the function with the given name and binds it to the list of
+  /// arguments, for repeated invocations.  The arguments are accepted by
+  /// lvalue-reference as in `invoke`.
+  template <typename... Args>
+  llvm::Expected<PackedInvocation> bind(StringRef name, Args &... args);
+
+  /// Looks up the function with the given name and binds it to a list of
+  /// opaque pointers to the arguments, followed by a pointer to the result.
+  /// This is the arity-agnostic equivalent of the templated `bind`; it has its
+  /// own name as an lvalue list of pointers would otherwise be bound by `bind`
+  /// as a single argument.
+  llvm::Expected<PackedInvocation> bindPacked(StringRef name,
+                                              ArrayRef<void *> args);
+
   /// Set the target triple on the module. This is implicitly done when creating
   /// the engine.
   static bool setupTargetTriple(llvm::Module *llvmModule);
@@ -106,12 +161,22 @@ llvm::Error ExecutionEngine::invoke(StringRef name, Args &... args) {
     return expectedFPtr.takeError();
   auto fptr = *expectedFPtr;
 
-  llvm::SmallVector<void *, 8> packedArgs{static_cast<void *>(&args)...};
+  std::array<void *, sizeof...(Args)> packedArgs{
+      {static_cast<void *>(&args)...}};
   (*fptr)(packedArgs.data());
 
   return llvm::Error::success();
 }
 
+template <typename... Args>
+llvm::Expected<PackedInvocation> ExecutionEngine::bind(StringRef name,
+                                                       Args &... args) {
+  std::array<void *, sizeof...(Args)> packedArgs{
+      {static_cast<void *>(&args)...}};
+  return bindPacked(name,
+                    ArrayRef<void *>(packedArgs.data(), packedArgs.size()));
+}
+
 } // end namespace mlir
 
 #endif // MLIR_EXECUTIONENGINE_EXECUTIONENGINE_H_
@@ -23,8 +23,12 @@
 #ifndef MLIR_EXECUTIONENGINE_MEMREFUTILS_H_
 #define MLIR_EXECUTIONENGINE_MEMREFUTILS_H_
 
+#include "mlir/IR/StandardTypes.h"
 #include "mlir/Support/LLVM.h"
 
+#include <cstdint>
+#include <memory>
+
 namespace llvm {
 template <typename T> class Expected;
 }
@@ -33,21 +37,80 @@ namespace mlir {
 
 class Function;
 
+/// Memref descriptor class compatible with the ABI of functions emitted by MLIR
+/// to LLVM IR conversion for memrefs with element type `T` and
+/// `NumDynamicDims` dynamic dimensions: a pointer to the data followed by the
+/// sizes of the dynamic dimensions, in order.  The sizes have the `index` type,
+/// which is assumed to be 64 bits wide.  A pointer to a descriptor can be
+/// passed to the packed interface functions of the ExecutionEngine.
+template <typename T, unsigned NumDynamicDims = 0> struct MemRefDescriptor {
+  T *data;
+  int64_t dynamicSizes[NumDynamicDims];
+};
+
+/// Statically-shaped memrefs are lowered to a bare pointer to their data.
+template <typename T> struct MemRefDescriptor<T, 0> { T *data; };
+
 /// Simple memref descriptor class compatible with the ABI of functions emitted
 /// by MLIR to LLVM IR conversion for statically-shaped memrefs of float type.
-struct StaticFloatMemRef {
-  float *data;
+using StaticFloatMemRef = MemRefDescriptor<float>;
+
+/// A memref allocated on the host for use as an argument of the functions
+/// compiled by the ExecutionEngine.  Owns both its descriptor and its data,
+/// which is aligned and laid out in row-major order.  Any integer, float or
+/// index element type is supported.
+class OwningMemRef {
+public:
+  /// Allocates a memref of `type`, whose dynamic dimensions have the sizes
+  /// `dynamicSizes`, with its data aligned on `alignment` bytes.  The data is
+  /// not initialized.
+  static llvm::Expected<std::unique_ptr<OwningMemRef>>
+  create(MemRefType type, ArrayRef<int64_t> dynamicSizes = {},
+         unsigned alignment = 64);
+  ~OwningMemRef();
+
+  /// Returns a type-erased pointer to the descriptor, to pass to the packed
+  /// interface functions of the ExecutionEngine.
+  void *getDescriptor() { return descriptor.get(); }
+
+  /// Returns the data of the memref, interpreted as elements of type `T`.
+  template <typename T> T *getData() { return static_cast<T *>(getRawData()); }
+  void *getRawData() { return *reinterpret_cast<void **>(descriptor.get()); }
+
+  MemRefType getType() const { return type; }
+  /// Returns the sizes of all the dimensions of the memref.
+  ArrayRef<int64_t> getShape() const { return shape; }
+  /// Returns the distance, in elements, between two consecutive indices of
+  /// each dimension.
+  ArrayRef<int64_t> getStrides() const { return strides; }
+  int64_t getNumElements() const { return numElements; }
+  unsigned getElementSizeInBytes() const { return elementSize; }
+
+private:
+  OwningMemRef(MemRefType type, ArrayRef<int64_t> shape, unsigned elementSize);
+
+  MemRefType type;
+  SmallVector<int64_t, 4> shape;
+  SmallVector<int64_t, 4> strides;
+  int64_t numElements;
+  unsigned elementSize;
+  /// The unaligned pointer returned by the allocation of the data.
+  void *allocatedData = nullptr;
+  /// The storage of the descriptor, i.e. the aligned data pointer followed by
+  /// the dynamic sizes.
+  std::unique_ptr<int64_t[]> descriptor;
 };
 
 /// Given an MLIR function that takes only statically-shaped memrefs with
-/// element type f32, allocate the memref descriptor and the data storage for
-/// each of the arguments, initialize the storage with `initialValue`, and
-/// return a list of type-erased descriptor pointers.
+/// integer, float or index elements, allocate the memref descriptor and the
+/// data storage for each of the arguments, initialize the storage with
+/// `initialValue` converted to the element type, and return a list of
+/// type-erased descriptor pointers.
 llvm::Expected<SmallVector<void *, 8>>
 allocateMemRefArguments(Function *func, float initialValue = 0.0);
 
-/// Free a list of type-erased descriptors to statically-shaped memrefs with
-/// element type f32.
+/// Free a list of type-erased descriptors to memrefs allocated by
+/// `allocateMemRefArguments`.
 void freeMemRefArguments(ArrayRef<void *> args);
 
 } // namespace mlir
@@ -0,0 +1,89 @@
+//===- ObjectCache.h - MLIR JIT object cache --------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file declares an on-disk cache of the object files compiled by the MLIR
+// execution engine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_EXECUTIONENGINE_OBJECTCACHE_H_
+#define MLIR_EXECUTIONENGINE_OBJECTCACHE_H_
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace mlir {
+
+/// An on-disk cache of the object files compiled by the ExecutionEngine, which
+/// persists across processes. An object is keyed by a hash of the LLVM module
+/// before it is optimized, of the target it is compiled for, and of the
+/// compilation options of the cache. A hit thus skips both the optimization
+/// and the code generation of the module.
+///
+/// The key of a module is stored as its module identifier by `assignKey`,
+/// which the ExecutionEngine calls on the modules it compiles.
+class OnDiskObjectCache : public llvm::ObjectCache {
+public:
+  /// Creates a cache storing objects in 'directory'. 'compileOptions' must
+  /// identify the optimizations applied to the modules, e.g. the IR transformer
+  /// passed to the ExecutionEngine, since they aren't part of the modules.
+  OnDiskObjectCache(StringRef directory, StringRef compileOptions);
+
+  /// Computes the key of 'module' when compiled for 'target', and sets it as
+  /// the identifier of the module.
+  void assignKey(llvm::Module &module, StringRef target) const;
+
+  /// Loads the object cached for 'module' and returns true if there is one.
+  /// The loaded object is returned by the next call to 'getObject' for the
+  /// module, even if it is removed from the disk in the meantime, so that the
+  /// caller may rely on the hit, e.g. to skip the optimization of the module.
+  bool loadObject(const llvm::Module &module);
+
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef object) override;
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *module) override;
+
+  /// Returns the number of modules whose object was found in the cache.
+  unsigned getNumHits() const { return numHits; }
+  /// Returns the number of modules that had to be compiled.
+  unsigned getNumMisses() const { return numMisses; }
+
+private:
+  /// Returns the path of the object file of 'module' in the cache.
+  std::string getObjectPath(const llvm::Module &module) const;
+
+  std::string directory;
+  std::string compileOptions;
+
+  /// The objects loaded by 'loadObject' and not yet returned by 'getObject',
+  /// by key. The modules are compiled concurrently, hence the mutex.
+  llvm::StringMap<SmallVector<std::unique_ptr<llvm::MemoryBuffer>, 1>>
+      loadedObjects;
+  std::mutex loadedObjectsMutex;
+  std::atomic<unsigned> numHits{0}, numMisses{0};
+};
+
+} // end namespace mlir
+
+#endif // MLIR_EXECUTIONENGINE_OBJECTCACHE_H_
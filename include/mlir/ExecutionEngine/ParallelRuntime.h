@@ -0,0 +1,48 @@
+//===- ParallelRuntime.h - Runtime of parallel loops ------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file declares the runtime library that executes the parallel loops
+// outlined by the loop parallelization pass on a thread pool. It is linked
+// into the functions compiled by the ExecutionEngine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_EXECUTIONENGINE_PARALLELRUNTIME_H_
+#define MLIR_EXECUTIONENGINE_PARALLELRUNTIME_H_
+
+#include <cstdint>
+
+extern "C" {
+
+/// Executes the iterations of the loop from 'lowerBound' to 'upperBound' with
+/// the given 'step' in parallel, by calling 'body' on chunks of 'chunkSize'
+/// iterations. 'body' is passed 'context' and the lower and upper bounds of
+/// the chunk. If 'chunkSize' is zero, the iterations are divided evenly among
+/// the threads.
+///
+/// If 'dynamicSchedule' is zero, the chunks are assigned to the threads
+/// round-robin ahead of time; otherwise, each thread takes the next chunk when
+/// it is done with the previous one. A parallel loop executed from within a
+/// parallel loop runs sequentially on the calling thread.
+void mlirParallelFor(void (*body)(void *context, int64_t lowerBound,
+                                  int64_t upperBound),
+                     void *context, int64_t lowerBound, int64_t upperBound,
+                     int64_t step, int64_t chunkSize, int64_t dynamicSchedule);
+
+} // end extern "C"
+
+#endif // MLIR_EXECUTIONENGINE_PARALLELRUNTIME_H_
@@ -378,6 +378,14 @@ public:
   /// width specified by the element type.
   static DenseElementsAttr get(VectorOrTensorType type, ArrayRef<char> data);
 
+  /// Constructs a dense elements attribute that refers to the given raw data in
+  /// place, instead of copying it into the context.  The data must be aligned
+  /// to, and its size a multiple of, APInt::APINT_WORD_SIZE.  It must remain
+  /// valid for the lifetime of the context, e.g. by being part of a buffer
+  /// handed over to MLIRContext::retainBuffer.
+  static DenseElementsAttr getFromExternalData(VectorOrTensorType type,
+                                               ArrayRef<char> data);
+
   // Constructs a dense elements attribute from an array of element values. Each
   // element attribute value is expected to be an element of 'type'.
   static DenseElementsAttr get(VectorOrTensorType type,
@@ -394,6 +402,9 @@ public:
 
   ArrayRef<char> getRawData() const;
 
+  /// Returns true if the raw data is owned outside of the context.
+  bool hasExternalData() const;
+
   /// Writes value to the bit position `bitPos` in array `rawData`. 'rawData' is
   /// expected to be a 64-bit aligned storage address.
   static void writeBits(char *rawData, size_t bitPos, APInt value);
@@ -32,10 +32,12 @@ namespace mlir {
 class DiagnosticEngine;
 class Identifier;
 struct LogicalResult;
+class MLIRContext;
 class Type;
 
 namespace detail {
 struct DiagnosticEngineImpl;
+struct ParallelDiagnosticHandlerImpl;
 } // end namespace detail
 
 /// Defines the different supported severity of a diagnostic.
@@ -355,6 +357,35 @@ private:
   /// The internal implementation of the DiagnosticEngine.
   std::unique_ptr<detail::DiagnosticEngineImpl> impl;
 };
+
+//===----------------------------------------------------------------------===//
+// ParallelDiagnosticHandler
+//===----------------------------------------------------------------------===//
+
+/// This class is a utility diagnostic handler for use when multi-threading some
+/// part of the compiler where diagnostics may be emitted. This handler ensures
+/// a deterministic ordering to the emitted diagnostics that mirrors that of a
+/// single-threaded compilation.
+///
+/// While in scope, this handler captures the diagnostics emitted to the given
+/// context. Each thread must set the order id of the work item it is currently
+/// processing, e.g. the position of a function within its module, and the
+/// captured diagnostics are stably sorted by this id and emitted to the
+/// previous handler of the context when this handler is destroyed.
+class ParallelDiagnosticHandler {
+public:
+  ParallelDiagnosticHandler(MLIRContext *ctx);
+  ~ParallelDiagnosticHandler();
+
+  /// Set the order id for the current thread. This is required to be set by
+  /// each thread that will be emitting diagnostics to this handler. The orderID
+  /// corresponds to the order in which diagnostics would be emitted when
+  /// executing synchronously.
+  void setOrderIDForThread(size_t orderID);
+
+private:
+  std::unique_ptr<detail::ParallelDiagnosticHandlerImpl> impl;
+};
 } // namespace mlir
 
 #endif
@@ -68,6 +68,9 @@ public:
   ///  - the arguments attributes may need an update: if the new type has less
   ///    parameters we drop the extra attributes, if there are more parameters
   ///    they won't have any attributes.
+  /// The attributes referring to this function report its current type, so it
+  /// must not be changed while other threads may query them, e.g. from the
+  /// passes running on other functions.
   void setType(FunctionType newType) {
     type = newType;
     argAttrs.resize(type.getNumInputs());
@@ -83,34 +86,66 @@ public:
   /// Unlink this function from its module and delete it.
   void erase();
 
-  /// Returns true if this function is external, i.e. it has no body.
-  bool isExternal() { return empty(); }
+  /// Returns true if this function is external, i.e. it has no body.  A
+  /// function whose body failed to materialize isn't external.
+  bool isExternal() {
+    return !bodyMaterializer && !bodyMaterializationFailed && body.empty();
+  }
 
   //===--------------------------------------------------------------------===//
   // Body Handling
   //===--------------------------------------------------------------------===//
 
-  Region &getBody() { return body; }
+  /// The body of a function may be loaded lazily, e.g. when reading bytecode.
+  /// In this case, a materializer is attached to the function and invoked the
+  /// first time the body is accessed.  A materializer that fails reports the
+  /// error through the context.  Accessing the body of the function afterwards
+  /// is a fatal error: clients that can recover check the result of
+  /// materialize() first.
+  using BodyMaterializerFn = std::function<LogicalResult(Function *)>;
+  void setBodyMaterializer(BodyMaterializerFn materializer) {
+    bodyMaterializer = std::move(materializer);
+  }
+
+  /// Returns true if the body of this function has yet to be materialized.
+  bool isMaterializable() { return static_cast<bool>(bodyMaterializer); }
+
+  /// Materialize the body of this function if it is loaded lazily.  Returns
+  /// failure if the body could not be materialized, now or earlier.
+  LogicalResult materialize() {
+    if (!bodyMaterializer)
+      return failure(bodyMaterializationFailed);
+    auto materializer = std::move(bodyMaterializer);
+    bodyMaterializer = nullptr;
+    bodyMaterializationFailed = failed(materializer(this));
+    return failure(bodyMaterializationFailed);
+  }
+
+  Region &getBody() {
+    if (failed(materialize()))
+      reportBodyMaterializationFailure();
+    return body;
+  }
 
   /// This is the list of blocks in the function.
   using RegionType = Region::RegionType;
-  RegionType &getBlocks() { return body.getBlocks(); }
+  RegionType &getBlocks() { return getBody().getBlocks(); }
 
   // Iteration over the block in the function.
   using iterator = RegionType::iterator;
   using reverse_iterator = RegionType::reverse_iterator;
 
-  iterator begin() { return body.begin(); }
-  iterator end() { return body.end(); }
-  reverse_iterator rbegin() { return body.rbegin(); }
-  reverse_iterator rend() { return body.rend(); }
+  iterator begin() { return getBody().begin(); }
+  iterator end() { return getBody().end(); }
+  reverse_iterator rbegin() { return getBody().rbegin(); }
+  reverse_iterator rend() { return getBody().rend(); }
 
-  bool empty() { return body.empty(); }
-  void push_back(Block *block) { body.push_back(block); }
-  void push_front(Block *block) { body.push_front(block); }
+  bool empty() { return getBody().empty(); }
+  void push_back(Block *block) { getBody().push_back(block); }
+  void push_front(Block *block) { getBody().push_front(block); }
 
-  Block &back() { return body.back(); }
-  Block &front() { return body.front(); }
+  Block &back() { return getBody().back(); }
+  Block &front() { return getBody().front(); }
 
   //===--------------------------------------------------------------------===//
   // Operation Walkers
@@ -303,6 +338,15 @@ private:
   /// The body of the function.
   Region body;
 
+  /// The materializer of the body, if it is loaded lazily.
+  BodyMaterializerFn bodyMaterializer;
+
+  /// Whether the materializer of the body failed.
+  bool bodyMaterializationFailed = false;
+
+  /// Abort on an access to a body that failed to materialize.
+  void reportBodyMaterializationFailure();
+
   void operator=(Function &) = delete;
   friend struct llvm::ilist_traits<Function>;
 };
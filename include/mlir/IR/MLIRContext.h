@@ -23,6 +23,10 @@
 #include <memory>
 #include <vector>
 
+namespace llvm {
+class MemoryBuffer;
+} // end namespace llvm
+
 namespace mlir {
 class AbstractOperation;
 class DiagnosticEngine;
@@ -31,6 +35,7 @@ class InFlightDiagnostic;
 class Location;
 class MLIRContextImpl;
 class StorageUniquer;
+class WorkStealingThreadPool;
 
 /// MLIRContext is the top-level object for a collection of MLIR modules.  It
 /// holds immortal uniqued objects like types, and the tables used to unique
@@ -84,6 +89,15 @@ public:
   /// instances. This should not be used directly.
   StorageUniquer &getAttributeUniquer();
 
+  /// Transfer the ownership of the given buffer to the context, which keeps it
+  /// alive until the context is destroyed.  This allows attributes to refer to
+  /// data within the buffer in place, e.g. to a memory mapped file.
+  void retainBuffer(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+  /// Returns the thread pool used to process IR in parallel, e.g. to run the
+  /// function passes of a pass manager.
+  WorkStealingThreadPool &getThreadPool();
+
 private:
   const std::unique_ptr<MLIRContextImpl> impl;
 
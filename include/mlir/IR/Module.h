@@ -24,6 +24,8 @@
 
 #include "mlir/IR/Function.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/ilist.h"
 
 namespace mlir {
@@ -59,6 +61,26 @@ public:
   /// name exists.  Function names never include the @ on them.
   Function *getNamedFunction(Identifier name);
 
+  /// A listener notified of the functions removed from a module, e.g. to drop
+  /// the state kept for them.
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /// Notify that the given function is being removed from the module, either
+    /// to be erased or to be moved to another module.
+    virtual void notifyFunctionRemoved(Function *function) = 0;
+  };
+
+  /// Register a listener of this module. The listener must be removed before
+  /// it is destroyed.
+  void addListener(Listener *listener) { listeners.push_back(listener); }
+
+  /// Remove a listener previously registered with 'addListener'.
+  void removeListener(Listener *listener) {
+    listeners.erase(llvm::find(listeners, listener));
+  }
+
   /// Perform (potentially expensive) checks of invariants, used to detect
   /// compiler bugs.  On error, this reports the error through the MLIRContext
   /// and returns failure.
@@ -83,6 +105,9 @@ private:
   /// This is used when name conflicts are detected.
   unsigned uniquingCounter = 0;
 
+  /// The listeners notified of the functions removed from this module.
+  SmallVector<Listener *, 1> listeners;
+
   /// This is the actual list of functions the module contains.
   FunctionListType functions;
 };
@@ -469,6 +469,22 @@ private:
   /// or derived from.
   Location location;
 
+  /// The order index of an operation that was inserted since the order of its
+  /// block was computed.
+  static constexpr unsigned kInvalidOrderIdx = -1;
+
+  /// The gap left between the order indices of consecutive operations, so that
+  /// inserted operations can usually be given an index without renumbering.
+  static constexpr unsigned kOrderStride = 5;
+
+  /// Returns true if this operation has a valid order index.
+  bool hasValidOrder() { return orderIndex != kInvalidOrderIdx; }
+
+  /// Assign an order index to this operation, from the indices of its
+  /// neighbors, if it doesn't have a valid one. Renumbers the parent block if
+  /// there is no index left between its neighbors.
+  void updateOrderIfNecessary();
+
   /// Relative order of this operation in its parent block. Used for
   /// O(1) local dominance checks between operations.
   mutable unsigned orderIndex = 0;
@@ -98,8 +98,9 @@ public:
   PatternBenefit getBenefit() const { return benefit; }
 
   /// Return the root node that this pattern matches.  Patterns that can
-  /// match multiple root types are instantiated once per root.
-  OperationName getRootKind() const { return rootKind; }
+  /// match multiple root types are instantiated once per root.  Returns None
+  /// if this pattern may be applied to any operation.
+  Optional<OperationName> getRootKind() const { return rootKind; }
 
   //===--------------------------------------------------------------------===//
   // Implementation hooks for patterns to implement.
@@ -127,12 +128,21 @@ public:
   }
 
 protected:
+  /// This class acts as a special tag that makes the desire to match "any"
+  /// operation type explicit.  This helps to avoid unnecessary usages of this
+  /// feature, and ensures that the user is making a conscious decision.
+  struct MatchAnyOpTypeTag {};
+
   /// Patterns must specify the root operation name they match against, and can
   /// also specify the benefit of the pattern matching.
   Pattern(StringRef rootName, PatternBenefit benefit, MLIRContext *context);
 
+  /// Construct a pattern that may match any operation type.  Such patterns are
+  /// tried on every operation, so they should be used sparingly.
+  Pattern(PatternBenefit benefit, MatchAnyOpTypeTag);
+
 private:
-  const OperationName rootKind;
+  const Optional<OperationName> rootKind;
   const PatternBenefit benefit;
 
   virtual void anchor();
@@ -190,6 +200,10 @@ protected:
   RewritePattern(StringRef rootName, PatternBenefit benefit,
                  MLIRContext *context)
       : Pattern(rootName, benefit, context) {}
+
+  /// Construct a rewrite pattern that may match any operation type.
+  RewritePattern(PatternBenefit benefit, MatchAnyOpTypeTag tag)
+      : Pattern(benefit, tag) {}
 };
 
 //===----------------------------------------------------------------------===//
@@ -324,6 +338,12 @@ using OwningRewritePatternList = std::vector<std::unique_ptr<RewritePattern>>;
 /// patterns, providing an API for finding and applying, the best match against
 /// a given node.
 ///
+/// The patterns are indexed by the name of the operation they are rooted on
+/// when the matcher is constructed, so that matching an operation only
+/// considers the patterns that may apply to it instead of scanning the full
+/// list.  Within each bucket the patterns are kept sorted by decreasing
+/// benefit.
+///
 class RewritePatternMatcher {
 public:
   /// Create a RewritePatternMatcher with the specified set of patterns and
@@ -339,10 +359,22 @@ private:
   RewritePatternMatcher(const RewritePatternMatcher &) = delete;
   void operator=(const RewritePatternMatcher &) = delete;
 
+  /// The list of patterns sorted by decreasing benefit.
+  using PatternListT = SmallVector<RewritePattern *, 2>;
+
   /// The group of patterns that are matched for optimization through this
   /// matcher.
   OwningRewritePatternList patterns;
 
+  /// The patterns that may be applied to a specific operation, keyed by the
+  /// name of the root operation. Each list also contains the patterns that
+  /// match any operation, merged in benefit order.
+  DenseMap<OperationName, PatternListT> opPatterns;
+
+  /// The patterns that may be applied to any operation. These are the only
+  /// patterns considered for operations without an entry in `opPatterns`.
+  PatternListT anyOpPatterns;
+
   /// The rewriter used when applying matched patterns.
   PatternRewriter &rewriter;
 };
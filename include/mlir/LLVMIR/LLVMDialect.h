@@ -33,6 +33,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 class Type;
@@ -72,6 +73,12 @@ public:
   llvm::LLVMContext &getLLVMContext() { return llvmContext; }
   llvm::Module &getLLVMModule() { return module; }
 
+  /// Returns the mutex serializing the accesses to the state shared by the
+  /// conversions to this dialect when they run on multiple threads: the LLVM
+  /// context, in which LLVM types are constructed, and the declarations of the
+  /// functions added to the module being converted.
+  llvm::sys::SmartMutex<true> &getMutex() { return mutex; }
+
   /// Parse a type registered to this dialect.
   Type parseType(StringRef tyData, Location loc) const override;
 
@@ -86,6 +93,7 @@ public:
 private:
   llvm::LLVMContext llvmContext;
   llvm::Module module;
+  llvm::sys::SmartMutex<true> mutex;
 };
 
 } // end namespace LLVM
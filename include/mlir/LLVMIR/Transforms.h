@@ -45,6 +45,12 @@ namespace LLVM {
 /// a new dummy block for LLVM PHI nodes to tell the sources apart.
 void ensureDistinctSuccessors(Module *m);
 
+/// Lower the calls to the functions outlined by the loop parallelization pass,
+/// which are tagged with the schedule of the loop, to calls to the parallel
+/// loop runtime of the ExecutionEngine.  The module must have been converted
+/// to the LLVM IR dialect.
+void lowerParallelCalls(Module *m);
+
 /// Converts a type in either MLIR standard or builtin type into LLVMIR dialect
 /// type.
 Type convertToLLVMDialectType(Type t, llvm::Module &llvmModule);
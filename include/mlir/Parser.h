@@ -29,8 +29,10 @@ class StringRef;
 } // end namespace llvm
 
 namespace mlir {
+class Attribute;
 class Module;
 class MLIRContext;
+class Type;
 
 /// This parses the file specified by the indicated SourceMgr and returns an
 /// MLIR module if it was valid.  If not, the error message is emitted through
@@ -47,6 +49,17 @@ Module *parseSourceFile(llvm::StringRef filename, MLIRContext *context);
 /// context, and a null pointer is returned.
 Module *parseSourceString(llvm::StringRef moduleStr, MLIRContext *context);
 
+/// This parses a single type from the given string, which must not contain
+/// anything else.  If the type is invalid, the error message is emitted through
+/// the error handler registered in the context, and a null type is returned.
+Type parseType(llvm::StringRef typeStr, MLIRContext *context);
+
+/// This parses a single attribute from the given string, which must not
+/// contain anything else.  If the attribute is invalid, the error message is
+/// emitted through the error handler registered in the context, and a null
+/// attribute is returned.
+Attribute parseAttribute(llvm::StringRef attrStr, MLIRContext *context);
+
 } // end namespace mlir
 
 #endif // MLIR_PARSER_H
@@ -24,6 +24,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/TypeName.h"
+#include <limits>
 
 namespace mlir {
 /// A special type used by analyses to provide an address that identifies a
@@ -84,17 +85,54 @@ private:
 /// The abstract polymorphic base class representing an analysis.
 struct AnalysisConcept {
   virtual ~AnalysisConcept() = default;
+
+  /// An estimate of the memory used by the analysis, in bytes.
+  size_t memoryUsage = 0;
 };
 
 /// A derived analysis model used to hold a specific analysis object.
 template <typename AnalysisT> struct AnalysisModel : public AnalysisConcept {
   template <typename... Args>
   explicit AnalysisModel(Args &&... args)
-      : analysis(std::forward<Args>(args)...) {}
+      : analysis(std::forward<Args>(args)...) {
+    memoryUsage = estimateMemoryUsage(analysis, 0);
+  }
+
+  /// Returns an estimate of the memory used by the analysis. Analyses that hold
+  /// data out of line may account for it by providing a method:
+  ///   'size_t getMemoryUsage() const'
+  template <typename T>
+  static auto estimateMemoryUsage(const T &analysis, int)
+      -> decltype(analysis.getMemoryUsage()) {
+    return analysis.getMemoryUsage();
+  }
+  template <typename T>
+  static size_t estimateMemoryUsage(const T &analysis, long) {
+    return sizeof(T);
+  }
 
   AnalysisT analysis;
 };
 
+/// Statistics on the use of cached analyses.
+struct AnalysisCacheStatistics {
+  AnalysisCacheStatistics &operator+=(const AnalysisCacheStatistics &other) {
+    numHits += other.numHits;
+    numMisses += other.numMisses;
+    numEvictions += other.numEvictions;
+    return *this;
+  }
+
+  /// The number of analysis queries served from the cache.
+  unsigned numHits = 0;
+
+  /// The number of analysis queries that required computing the analysis.
+  unsigned numMisses = 0;
+
+  /// The number of analyses evicted to stay within the retention budget.
+  unsigned numEvictions = 0;
+};
+
 /// This class represents a cache of analyses for a single IR unit. All
 /// computation, caching, and invalidation of analyses takes place here.
 template <typename IRUnitT> class AnalysisMap {
@@ -124,6 +162,7 @@ public:
     // If we don't have a cached analysis for this function, compute it directly
     // and add it to the cache.
     if (wasInserted) {
+      ++statistics.numMisses;
       if (pi)
         pi->runBeforeAnalysis(getAnalysisName<AnalysisT>(), id, ir);
 
@@ -131,6 +170,8 @@ public:
 
       if (pi)
         pi->runAfterAnalysis(getAnalysisName<AnalysisT>(), id, ir);
+    } else {
+      ++statistics.numHits;
     }
     return static_cast<AnalysisModel<AnalysisT> &>(*it->second).analysis;
   }
@@ -151,6 +192,12 @@ public:
   /// Clear any held analyses.
   void clear() { analyses.clear(); }
 
+  /// Returns true if no analyses are held.
+  bool empty() const { return analyses.empty(); }
+
+  /// Returns the number of held analyses.
+  unsigned size() const { return analyses.size(); }
+
   /// Invalidate any cached analyses based upon the given set of preserved
   /// analyses.
   void invalidate(const detail::PreservedAnalyses &pa) {
@@ -162,9 +209,25 @@ public:
     }
   }
 
+  /// Returns an estimate of the memory used by the held analyses.
+  size_t getMemoryUsage() const {
+    size_t memoryUsage = 0;
+    for (auto &it : analyses)
+      memoryUsage += it.second->memoryUsage;
+    return memoryUsage;
+  }
+
+  /// Returns the statistics on the queries of this map.
+  const AnalysisCacheStatistics &getStatistics() const { return statistics; }
+
+  /// The time at which this map was last used, as counted by the owning
+  /// analysis manager.
+  uint64_t lastUse = 0;
+
 private:
   IRUnitT *ir;
   ConceptMap analyses;
+  AnalysisCacheStatistics statistics;
 };
 
 } // namespace detail
@@ -226,10 +289,17 @@ private:
 };
 
 /// An analysis manager for a specific module instance.
-class ModuleAnalysisManager {
+///
+/// The analyses of the functions are retained across pass pipelines until they
+/// are invalidated, i.e. until a pass doesn't mark them as preserved. The
+/// memory used by the retained function analyses may be bounded by a retention
+/// budget: when it is exceeded, the analyses of the least recently used
+/// functions are evicted. The analyses of a function are dropped when it is
+/// removed from the module.
+class ModuleAnalysisManager : private Module::Listener {
 public:
-  ModuleAnalysisManager(Module *module, PassInstrumentor *passInstrumentor)
-      : moduleAnalyses(module), passInstrumentor(passInstrumentor) {}
+  ModuleAnalysisManager(Module *module, PassInstrumentor *passInstrumentor);
+  ~ModuleAnalysisManager() override;
   ModuleAnalysisManager(const ModuleAnalysisManager &) = delete;
   ModuleAnalysisManager &operator=(const ModuleAnalysisManager &) = delete;
 
@@ -247,7 +317,7 @@ public:
     auto it = functionAnalyses.find(function);
     if (it == functionAnalyses.end())
       return llvm::None;
-    return it->second.getCachedAnalysis<AnalysisT>();
+    return it->second->getCachedAnalysis<AnalysisT>();
   }
 
   /// Query for the analysis for the module. The analysis is computed if it does
@@ -268,13 +338,47 @@ public:
   /// Invalidate any non preserved analyses.
   void invalidate(const detail::PreservedAnalyses &pa);
 
+  /// Clear the analyses of the module, but not those of its functions.
+  void clearModuleAnalyses() { moduleAnalyses.clear(); }
+
+  /// Set the retention budget, i.e. an estimate of the maximum memory in bytes
+  /// used by the analyses of the functions, when they are not in use.
+  void setRetentionBudget(size_t budget) { retentionBudget = budget; }
+
+  /// Evict the analyses of the least recently used functions until the
+  /// retention budget is met. This must not be called while function analysis
+  /// managers created by 'slice' are in use.
+  void enforceRetentionBudget();
+
+  /// Returns the statistics on the use of the analyses of this manager.
+  detail::AnalysisCacheStatistics getCacheStatistics() const;
+
   /// Returns a pass instrumentation object for the current module. This value
   /// may be null.
   PassInstrumentor *getPassInstrumentor() const { return passInstrumentor; }
 
 private:
-  /// The cached analyses for functions within the current module.
-  llvm::DenseMap<Function *, detail::AnalysisMap<Function>> functionAnalyses;
+  /// Erase the analysis maps of all of the functions.
+  void clearFunctionAnalyses();
+
+  /// Erase the analysis map of a function removed from the module, so that it
+  /// isn't used for another function allocated at the same address.
+  void notifyFunctionRemoved(Function *function) override;
+
+  /// The cached analyses for functions within the current module. The maps are
+  /// allocated separately, so that the slices referring to them remain valid
+  /// when the analyses of other functions are added.
+  llvm::DenseMap<Function *, std::unique_ptr<detail::AnalysisMap<Function>>>
+      functionAnalyses;
+
+  /// A counter used to order the uses of the function analysis maps.
+  uint64_t useCounter = 0;
+
+  /// The retention budget for the function analyses.
+  size_t retentionBudget = std::numeric_limits<size_t>::max();
+
+  /// The statistics of the function analysis maps that were erased.
+  detail::AnalysisCacheStatistics erasedStatistics;
 
   /// The analyses for the owning module.
   detail::AnalysisMap<Module> moduleAnalyses;
@@ -79,6 +79,19 @@ public:
   /// executor if necessary.
   void addPass(FunctionPassBase *pass);
 
+  //===--------------------------------------------------------------------===//
+  // Analysis Management
+  //===--------------------------------------------------------------------===//
+
+  /// Set the retention budget for function analyses, i.e. an estimate of the
+  /// maximum memory in bytes used by the function analyses that are kept
+  /// between pass pipelines. When the budget is exceeded, the analyses of the
+  /// least recently used functions are evicted. The budget is unlimited by
+  /// default.
+  void setAnalysisRetentionBudget(size_t budget) {
+    analysisRetentionBudget = budget;
+  }
+
   //===--------------------------------------------------------------------===//
   // Instrumentations
   //===--------------------------------------------------------------------===//
@@ -119,6 +132,9 @@ private:
   /// Flag that specifies if pass timing is enabled.
   bool passTiming : 1;
 
+  /// The retention budget for function analyses.
+  size_t analysisRetentionBudget;
+
   /// A manager for pass instrumentations.
   std::unique_ptr<PassInstrumentor> instrumentor;
 };
@@ -60,7 +60,14 @@ struct StorageUniquerImpl;
 ///        'void cleanup()'
 ///      that is called when erasing a storage instance. This should cleanup any
 ///      fields of the storage as necessary and not attempt to free the memory
-///      of the storage itself.
+///      of the storage itself. The fields it writes must be atomic if they are
+///      read by the equality function: a lock-free lookup may compare against
+///      the instance while it is being erased.
+///
+/// The uniquer is thread-safe. Instances are partitioned by hash value into
+/// independently locked shards, and repeated lookups of recently accessed
+/// instances are served without taking a lock. As such, a storage instance
+/// must not be mutated after construction, other than by its cleanup method.
 class StorageUniquer {
 public:
   StorageUniquer();
@@ -0,0 +1,100 @@
+//===- WorkStealingThreadPool.h - Work stealing thread pool -----*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines a thread pool that executes batches of independent tasks,
+// balancing the load between its threads by work stealing.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_SUPPORT_WORKSTEALINGTHREADPOOL_H
+#define MLIR_SUPPORT_WORKSTEALINGTHREADPOOL_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace mlir {
+namespace detail {
+struct WorkStealingThreadPoolImpl;
+} // namespace detail
+
+/// A thread pool that executes batches of independent tasks. The tasks of a
+/// batch are dealt out in order to per-thread queues, and each thread executes
+/// the tasks of its own queue from the front. A thread that runs out of work
+/// steals a task from the back of the queue of another thread. When the tasks
+/// of a batch are ordered by decreasing cost, the most expensive tasks are thus
+/// started first, and the cheap tasks at the end of the batch fill in the gaps
+/// between the threads.
+///
+/// The thread that submits a batch executes tasks as thread 0, so the pool only
+/// creates 'getNumThreads() - 1' worker threads. These are created lazily, the
+/// first time a batch is executed in parallel.
+class WorkStealingThreadPool {
+public:
+  /// Statistics on the work performed by a single thread of the pool.
+  struct ThreadStatistics {
+    /// The time spent executing tasks.
+    std::chrono::nanoseconds busyTime = std::chrono::nanoseconds(0);
+
+    /// The number of tasks executed.
+    uint64_t numTasks = 0;
+
+    /// The number of tasks that were stolen from another thread.
+    uint64_t numStolenTasks = 0;
+  };
+
+  /// Create a pool with the given number of threads, including the submitting
+  /// thread. If 'numThreads' is zero, the hardware concurrency is used.
+  explicit WorkStealingThreadPool(unsigned numThreads = 0);
+  ~WorkStealingThreadPool();
+
+  /// Returns the number of threads of this pool.
+  unsigned getNumThreads() const;
+
+  /// Set the number of threads of this pool. If 'numThreads' is zero, the
+  /// hardware concurrency is used. This waits for any batch being executed to
+  /// complete, and thus must not be called from within a task.
+  void setNumThreads(unsigned numThreads);
+
+  /// Execute 'callback' for each task index in [0, numTasks), and wait for all
+  /// of the tasks to complete. The callback is invoked with the index of the
+  /// executing thread, in [0, getNumThreads()), and the index of the task.
+  ///
+  /// Only one batch is executed at a time: batches submitted concurrently by
+  /// different threads wait for the pool to be available.  A batch submitted
+  /// from within a task of this pool is executed sequentially on the calling
+  /// thread, with the thread index of the enclosing task.  Per-thread state
+  /// keyed by the thread index is thus never used by two threads at once, but
+  /// may be used by a nested batch while the enclosing task is using it.  A
+  /// task must not wait for another thread that submits a batch to this pool.
+  void parallelFor(size_t numTasks,
+                   llvm::function_ref<void(unsigned threadIndex,
+                                           size_t taskIndex)>
+                       callback);
+
+  /// Returns the statistics accumulated by each thread of the pool.
+  std::vector<ThreadStatistics> getStatistics() const;
+
+private:
+  std::unique_ptr<detail::WorkStealingThreadPoolImpl> impl;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_SUPPORT_WORKSTEALINGTHREADPOOL_H
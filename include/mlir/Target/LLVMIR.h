@@ -23,6 +23,7 @@
 #define MLIR_TARGET_LLVMIR_H
 
 #include <memory>
+#include <vector>
 
 // Forward-declare LLVM classses.
 namespace llvm {
@@ -40,6 +41,24 @@ class Module;
 /// the MLIR module), and return `nullptr`.
 std::unique_ptr<llvm::Module> translateModuleToLLVMIR(Module &m);
 
+/// An LLVM IR module together with the LLVM context it is created in.  The
+/// module is destroyed before its context.
+struct LLVMIRShard {
+  std::unique_ptr<llvm::LLVMContext> context;
+  std::unique_ptr<llvm::Module> module;
+};
+
+/// Convert the given MLIR module into at most `numShards` LLVM IR modules, each
+/// in its own LLVM context, which are translated concurrently on the thread
+/// pool of the MLIR context.  The functions defined in the module are split
+/// into contiguous ranges of similar size, one per shard.  Every shard contains
+/// the globals and the external function declarations of the module, as well
+/// as declarations of the functions of other shards that it refers to, so that
+/// the shards can be compiled independently and linked together.  In case of
+/// error, report it to the MLIR context and return an empty vector.
+std::vector<LLVMIRShard> translateModuleToLLVMIRShards(Module &m,
+                                                       unsigned numShards);
+
 } // namespace mlir
 
 #endif // MLIR_TARGET_LLVMIR_H
@@ -26,7 +26,9 @@
 #include "mlir/IR/Block.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Value.h"
+#include "mlir/Target/LLVMIR.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
@@ -39,6 +41,7 @@ class Module;
 class Operation;
 
 namespace LLVM {
+class LLVMType;
 
 // Implementation class for module translation.  Holds a reference to the module
 // being translated, and the mappings between the original and the translated
@@ -59,6 +62,24 @@ public:
     return std::move(translator.llvmModule);
   }
 
+  // Translate the given MLIR module into at most `numShards` LLVM IR modules,
+  // each in its own LLVM context, concurrently.  See
+  // translateModuleToLLVMIRShards for how the functions are distributed.
+  template <typename T = ModuleTranslation>
+  static std::vector<LLVMIRShard> translateModuleToShards(Module &m,
+                                                          unsigned numShards) {
+    return translateShards(
+        m, numShards,
+        [&m](std::unique_ptr<llvm::Module> llvmModule,
+             ArrayRef<Function *> functions) -> std::unique_ptr<llvm::Module> {
+          T translator(m);
+          translator.llvmModule = std::move(llvmModule);
+          if (translator.convertShard(functions))
+            return nullptr;
+          return std::move(translator.llvmModule);
+        });
+  }
+
 protected:
   // Translate the given MLIR module expressed in MLIR LLVM IR dialect into an
   // LLVM IR module.  The MLIR LLVM IR dialect holds a pointer to an
@@ -69,9 +90,21 @@ protected:
   virtual bool convertOperation(Operation &op, llvm::IRBuilder<> &builder);
   static std::unique_ptr<llvm::Module> prepareLLVMModule(Module &m);
 
+  // Get the LLVM IR type corresponding to `type` in the context of the LLVM IR
+  // module being built, which differs from the context of the LLVM dialect
+  // when translating to shards.
+  llvm::Type *convertType(LLVMType type);
+
 private:
+  using ShardTranslator = llvm::function_ref<std::unique_ptr<llvm::Module>(
+      std::unique_ptr<llvm::Module>, ArrayRef<Function *>)>;
+  static std::vector<LLVMIRShard>
+  translateShards(Module &m, unsigned numShards,
+                  ShardTranslator translateShard);
 
+  bool declareFunctions();
   bool convertFunctions();
+  bool convertShard(ArrayRef<Function *> functions);
   bool convertOneFunction(Function &func);
   void connectPHINodes(Function &func);
   bool convertBlock(Block &bb, bool ignoreArguments);
@@ -81,6 +114,9 @@ private:
 
   llvm::Constant *getLLVMConstant(llvm::Type *llvmType, Attribute attr,
                                   Location loc);
+  llvm::Type *translateType(llvm::Type *type);
+  llvm::FunctionType *convertFunctionType(FunctionType type, Location loc,
+                                          bool isVarArgs);
 
   // Original and translated module.
   Module &mlirModule;
@@ -90,6 +126,10 @@ private:
   llvm::DenseMap<Function *, llvm::Function *> functionMapping;
   llvm::DenseMap<Value *, llvm::Value *> valueMapping;
   llvm::DenseMap<Block *, llvm::BasicBlock *> blockMapping;
+
+  // Mapping from the LLVM IR types of the LLVM dialect to the types of the
+  // context of `llvmModule`, if it differs.
+  llvm::DenseMap<llvm::Type *, llvm::Type *> typeMapping;
 };
 
 } // namespace LLVM
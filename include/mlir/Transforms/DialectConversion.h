@@ -130,6 +130,23 @@ template <typename Arg> struct ConversionListBuilder<Arg> {
   }
 };
 
+/// The ways in which DialectConversion converts functions.
+enum class ConversionMode {
+  /// Build a converted copy of each function, and replace the original
+  /// functions with their copies once all of them are converted.
+  Clone,
+  /// Rewrite each function in place. This avoids holding two copies of the
+  /// module in memory, but patterns must only create operations at the
+  /// insertion point of the builder they are given.
+  InPlace,
+  /// Rewrite the functions in place, as in the InPlace mode, converting the
+  /// bodies of different functions concurrently on the thread pool of the
+  /// context.  The patterns and the type conversion hooks must thus be safe to
+  /// call from multiple threads.  The functions are converted independently:
+  /// patterns must not depend on the body or the type of other functions.
+  ParallelInPlace,
+};
+
 /// Base class for dialect conversion interface.  Specific converters must
 /// derive this class and implement the pure virtual functions.
 ///
@@ -143,17 +160,42 @@ template <typename Arg> struct ConversionListBuilder<Arg> {
 //    its arguments converted using `convertType`.
 //    c. Traverse blocks in DFS-preorder of successors starting from the entry
 //    block (if any), and convert individual operations as follows.  Pattern
-//    match against the list of conversions.  On the first match, call
-//    `rewriteTerminator` for terminator operations with successors and
-//    `rewrite` for other operations, and advance to the next iteration.  If no
-//    match is found, replicate the operation as is.  Note that if two patterns
-//    match the same operation, it is undefined which of them will be applied.
+//    match against the conversions whose root is the operation, in order of
+//    decreasing benefit.  On the first match, call `rewriteTerminator` for
+//    terminator operations with successors and `rewrite` for other
+//    operations, and advance to the next iteration.  If no match is found,
+//    replicate the operation as is.  Note that if two patterns with the same
+//    benefit match the same operation, it is undefined which of them will be
+//    applied.
 /// 3. Update all attributes of function type to point to the new functions.
 /// 4. Replace old functions with new functions in the module.
 /// If any error happend during the conversion, the pass fails as soon as
 /// possible.
 ///
-/// If the conversion fails, the module is not modified.
+/// In this mode, ConversionMode::Clone, the functions of the module are not
+/// modified if the conversion fails.
+///
+/// In the in-place mode, each function is instead rewritten as follows.
+/// 1. Add block arguments of the converted types next to the original ones.
+/// 2. Traverse the blocks as above.  The operations created by the patterns
+///    are inserted before the operation they replace, which is kept along
+///    with its operands, so that patterns still see the original IR.
+///    Operations without a match are left in place.
+/// 3. Once the whole function is converted, replace the uses of the original
+///    operations and block arguments, erase them, and update the function
+///    type.
+/// The rollback is per function: if the conversion of a function fails, the
+/// operations and arguments created for it are erased, which restores it.
+/// Functions converted before it remain converted, so the module may be
+/// partially converted when the conversion fails.
+///
+/// In the parallel in-place mode, the bodies of the functions are converted
+/// concurrently, and the function types are only updated once all of them are
+/// converted.  The conversion doesn't stop at the first function that fails
+/// to convert: all the other functions are converted.  Each function that
+/// fails is restored as in the in-place mode, while the others remain
+/// converted.  Diagnostics are emitted in the order of the functions in the
+/// module.
 class DialectConversion {
   friend class impl::FunctionConversion;
 
@@ -162,7 +204,7 @@ public:
 
   /// Run the converter on the provided module.
   LLVM_NODISCARD
-  LogicalResult convert(Module *m);
+  LogicalResult convert(Module *m, ConversionMode mode = ConversionMode::Clone);
 
 protected:
   /// Derived classes must implement this hook to produce a set of conversion
@@ -99,6 +99,37 @@ FunctionPassBase *createLowerAffinePass();
 /// Creates a pass to perform tiling on loop nests.
 FunctionPassBase *createLoopTilingPass(uint64_t cacheSizeBytes);
 
+/// Describes a level of the data cache hierarchy to tile for.
+struct CacheLevelInfo {
+  /// The capacity of the cache in bytes.
+  uint64_t sizeBytes;
+  /// The size of a cache line in bytes.
+  unsigned lineSizeBytes;
+  /// The number of ways of the cache; 1 for a direct-mapped cache.
+  unsigned associativity;
+};
+
+/// Creates a pass to perform multi-level tiling on loop nests: each loop nest
+/// is tiled once per level of 'cacheLevels', which are ordered from the
+/// innermost (L1) level outwards.
+FunctionPassBase *createLoopTilingPass(ArrayRef<CacheLevelInfo> cacheLevels);
+
+/// How the chunks of iterations of a parallel loop are assigned to threads.
+enum class ParallelSchedule {
+  /// Round-robin, ahead of time.
+  Static,
+  /// To the next idle thread, as the threads complete their chunks.
+  Dynamic
+};
+
+/// Creates a pass that outlines the bodies of the outermost parallel loops
+/// into functions executed on chunks of iterations by the parallel loop
+/// runtime of the ExecutionEngine. A chunk has 'chunkSize' iterations or, if
+/// 'chunkSize' is zero, enough iterations to execute 'grainSize' operations.
+ModulePassBase *createLoopParallelizationPass(ParallelSchedule schedule,
+                                              unsigned chunkSize,
+                                              uint64_t grainSize);
+
 /// Promotes all accessed memref regions to the specified faster memory space
 /// while generating DMAs to move data.
 FunctionPassBase *createDmaGenerationPass(
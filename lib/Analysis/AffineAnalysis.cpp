@@ -32,6 +32,8 @@
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -41,6 +43,18 @@ using namespace mlir;
 
 using llvm::dbgs;
 
+static llvm::cl::opt<bool> clSimplexDependence(
+    "affine-dependence-simplex",
+    llvm::cl::desc("Use the Simplex engine instead of Fourier-Motzkin "
+                   "elimination to check memref access dependences"),
+    llvm::cl::init(false));
+
+/// Returns the engine used to solve the dependence constraint systems.
+static FlatAffineConstraints::Engine getDependenceEngine() {
+  return clSimplexDependence ? FlatAffineConstraints::Engine::Simplex
+                             : FlatAffineConstraints::Engine::FourierMotzkin;
+}
+
 /// Returns the sequence of AffineApplyOp Operations operation in
 /// 'affineApplyOps', which are reachable via a search starting from 'operands',
 /// and ending at operands which are not defined by AffineApplyOps.
@@ -661,7 +675,8 @@ static void computeDirectionVector(
   }
 
   // Eliminate all variables other than the direction variables just added.
-  dependenceDomain->projectOut(numCommonLoops, numIdsToEliminate);
+  dependenceDomain->projectOut(numCommonLoops, numIdsToEliminate,
+                               getDependenceEngine());
 
   // Scan each common loop variable column and set direction vectors based
   // on eliminated constraint system.
@@ -691,6 +706,72 @@ void MemRefAccess::getAccessMap(AffineValueMap *accessMap) const {
   accessMap->reset(map, operands);
 }
 
+// Checks for a dependence between 'srcAccess' and 'dstAccess' as
+// checkMemrefAccessDependence does, given their access functions and iteration
+// domains.
+static bool checkAccessDependence(
+    const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
+    const AffineValueMap &srcAccessMap, const AffineValueMap &dstAccessMap,
+    const FlatAffineConstraints &srcDomain,
+    const FlatAffineConstraints &dstDomain, unsigned loopDepth,
+    FlatAffineConstraints *dependenceConstraints,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // Return 'false' if loopDepth > numCommonLoops and if the ancestor operation
+  // operation of 'srcAccess' does not properly dominate the ancestor
+  // operation of 'dstAccess' in the same common operation block.
+  // Note: this check is skipped if 'allowRAR' is true, because because RAR
+  // deps can exist irrespective of lexicographic ordering b/w src and dst.
+  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
+  assert(loopDepth <= numCommonLoops + 1);
+  if (!allowRAR && loopDepth > numCommonLoops &&
+      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
+                                           numCommonLoops)) {
+    return false;
+  }
+  // Build dim and symbol position maps for each access from access operand
+  // Value to position in merged contstraint system.
+  ValuePositionMap valuePosMap;
+  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
+                                dstAccessMap, &valuePosMap,
+                                dependenceConstraints);
+
+  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
+                            valuePosMap, dependenceConstraints);
+
+  assert(valuePosMap.getNumDims() ==
+         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
+
+  // Create memref access constraint by equating src/dst access functions.
+  // Note that this check is conservative, and will fail in the future when
+  // local variables for mod/div exprs are supported.
+  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
+                                        dependenceConstraints)))
+    return true;
+
+  // Add 'src' happens before 'dst' ordering constraints.
+  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
+                         dependenceConstraints);
+  // Add src and dst domain constraints.
+  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
+                       dependenceConstraints);
+
+  // Return false if the solution space is empty: no dependence.
+  if (dependenceConstraints->isEmpty(getDependenceEngine())) {
+    return false;
+  }
+
+  // Compute dependence direction vector and return true.
+  if (dependenceComponents != nullptr) {
+    computeDirectionVector(srcDomain, dstDomain, loopDepth,
+                           dependenceConstraints, dependenceComponents);
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
+  LLVM_DEBUG(dependenceConstraints->dump());
+  return true;
+}
+
 // Builds a flat affine constraint system to check if there exists a dependence
 // between memref accesses 'srcAccess' and 'dstAccess'.
 // Returns 'false' if the accesses can be definitively shown not to access the
@@ -812,66 +893,18 @@ bool mlir::checkMemrefAccessDependence(
   if (failed(getInstIndexSet(dstAccess.opInst, &dstDomain)))
     return false;
 
-  // Return 'false' if loopDepth > numCommonLoops and if the ancestor operation
-  // operation of 'srcAccess' does not properly dominate the ancestor
-  // operation of 'dstAccess' in the same common operation block.
-  // Note: this check is skipped if 'allowRAR' is true, because because RAR
-  // deps can exist irrespective of lexicographic ordering b/w src and dst.
-  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
-  assert(loopDepth <= numCommonLoops + 1);
-  if (!allowRAR && loopDepth > numCommonLoops &&
-      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
-                                           numCommonLoops)) {
-    return false;
-  }
-  // Build dim and symbol position maps for each access from access operand
-  // Value to position in merged contstraint system.
-  ValuePositionMap valuePosMap;
-  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
-                                dstAccessMap, &valuePosMap,
-                                dependenceConstraints);
-
-  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
-                            valuePosMap, dependenceConstraints);
-
-  assert(valuePosMap.getNumDims() ==
-         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
-
-  // Create memref access constraint by equating src/dst access functions.
-  // Note that this check is conservative, and will fail in the future when
-  // local variables for mod/div exprs are supported.
-  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
-                                        dependenceConstraints)))
-    return true;
-
-  // Add 'src' happens before 'dst' ordering constraints.
-  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
-                         dependenceConstraints);
-  // Add src and dst domain constraints.
-  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
-                       dependenceConstraints);
-
-  // Return false if the solution space is empty: no dependence.
-  if (dependenceConstraints->isEmpty()) {
-    return false;
-  }
-
-  // Compute dependence direction vector and return true.
-  if (dependenceComponents != nullptr) {
-    computeDirectionVector(srcDomain, dstDomain, loopDepth,
-                           dependenceConstraints, dependenceComponents);
-  }
-
-  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
-  LLVM_DEBUG(dependenceConstraints->dump());
-  return true;
+  return checkAccessDependence(srcAccess, dstAccess, srcAccessMap,
+                               dstAccessMap, srcDomain, dstDomain, loopDepth,
+                               dependenceConstraints, dependenceComponents,
+                               allowRAR);
 }
 
 /// Gathers dependence components for dependences between all ops in loop nest
 /// rooted at 'forOp' at loop depths in range [1, maxLoopDepth].
 void mlir::getDependenceComponents(
     AffineForOp forOp, unsigned maxLoopDepth,
-    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec) {
+    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec,
+    DependenceAnalysis *dependenceAnalysis) {
   // Collect all load and store ops in loop nest rooted at 'forOp'.
   SmallVector<Operation *, 8> loadAndStoreOpInsts;
   forOp.getOperation()->walk([&](Operation *opInst) {
@@ -888,10 +921,14 @@ void mlir::getDependenceComponents(
         auto *dstOpInst = loadAndStoreOpInsts[j];
         MemRefAccess dstAccess(dstOpInst);
 
-        FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> depComps;
-        // TODO(andydavis,bondhugula) Explore whether it would be profitable
-        // to pre-compute and store deps instead of repeatedly checking.
+        if (dependenceAnalysis) {
+          if (dependenceAnalysis->checkDependence(srcOpInst, dstOpInst, d,
+                                                  &depComps))
+            depCompsVec->push_back(depComps);
+          continue;
+        }
+        FlatAffineConstraints dependenceConstraints;
         if (checkMemrefAccessDependence(srcAccess, dstAccess, d,
                                         &dependenceConstraints, &depComps)) {
           depCompsVec->push_back(depComps);
@@ -900,3 +937,111 @@ void mlir::getDependenceComponents(
     }
   }
 }
+
+//===----------------------------------------------------------------------===//
+// DependenceAnalysis
+//===----------------------------------------------------------------------===//
+
+struct DependenceAnalysis::AccessInfo {
+  explicit AccessInfo(Operation *op) : access(op) {
+    access.getAccessMap(&accessMap);
+    hasDomain = succeeded(getInstIndexSet(op, &domain));
+  }
+
+  MemRefAccess access;
+  AffineValueMap accessMap;
+  FlatAffineConstraints domain;
+  /// False if the iteration domain isn't supported, in which case there is no
+  /// dependence, as for checkMemrefAccessDependence.
+  bool hasDomain;
+};
+
+// The accesses are analyzed lazily, as most passes only query a few of them.
+DependenceAnalysis::DependenceAnalysis(Function *function) {}
+DependenceAnalysis::DependenceAnalysis(DependenceAnalysis &&) = default;
+DependenceAnalysis &DependenceAnalysis::
+operator=(DependenceAnalysis &&) = default;
+DependenceAnalysis::~DependenceAnalysis() = default;
+
+DependenceAnalysis::AccessInfo &
+DependenceAnalysis::getAccessInfo(Operation *op) {
+  auto &info = accessInfos[op];
+  if (!info)
+    info = llvm::make_unique<AccessInfo>(op);
+  return *info;
+}
+
+bool DependenceAnalysis::checkDependence(
+    Operation *srcOp, Operation *dstOp, unsigned loopDepth,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // The cheap checks of checkMemrefAccessDependence don't need the cache.
+  MemRefAccess srcAccess(srcOp), dstAccess(dstOp);
+  if (srcAccess.memref != dstAccess.memref)
+    return false;
+  if (!allowRAR && !srcOp->isa<StoreOp>() && !dstOp->isa<StoreOp>())
+    return false;
+
+  auto &byDepth = results[srcOp][dstOp].byDepth[allowRAR];
+  if (byDepth.size() <= loopDepth)
+    byDepth.resize(loopDepth + 1);
+  DepthResult &result = byDepth[loopDepth];
+  bool needsComponents = dependenceComponents != nullptr;
+  if (result.kind == DepthResult::Kind::NoDependence ||
+      (result.kind == DepthResult::Kind::Dependence &&
+       (result.hasComponents || !needsComponents))) {
+    ++numHits;
+    if (result.kind == DepthResult::Kind::NoDependence)
+      return false;
+    if (needsComponents)
+      *dependenceComponents = result.components;
+    return true;
+  }
+
+  ++numMisses;
+  AccessInfo &srcInfo = getAccessInfo(srcOp);
+  AccessInfo &dstInfo = getAccessInfo(dstOp);
+  bool hasDependence = false;
+  result.components.clear();
+  if (srcInfo.hasDomain && dstInfo.hasDomain) {
+    FlatAffineConstraints dependenceConstraints;
+    hasDependence = checkAccessDependence(
+        srcInfo.access, dstInfo.access, srcInfo.accessMap, dstInfo.accessMap,
+        srcInfo.domain, dstInfo.domain, loopDepth, &dependenceConstraints,
+        needsComponents ? &result.components : nullptr, allowRAR);
+  }
+  result.kind = hasDependence ? DepthResult::Kind::Dependence
+                              : DepthResult::Kind::NoDependence;
+  result.hasComponents = hasDependence && needsComponents;
+  if (hasDependence && needsComponents)
+    *dependenceComponents = result.components;
+  return hasDependence;
+}
+
+void DependenceAnalysis::invalidate(Operation *op) {
+  SmallPtrSet<Operation *, 8> staleOps;
+  op->walk([&](Operation *nestedOp) {
+    if (nestedOp->isa<LoadOp>() || nestedOp->isa<StoreOp>())
+      staleOps.insert(nestedOp);
+  });
+  if (staleOps.empty())
+    return;
+  for (Operation *staleOp : staleOps) {
+    accessInfos.erase(staleOp);
+    results.erase(staleOp);
+  }
+  for (auto &srcResults : results)
+    for (Operation *staleOp : staleOps)
+      srcResults.second.erase(staleOp);
+}
+
+size_t DependenceAnalysis::getMemoryUsage() const {
+  size_t size = accessInfos.getMemorySize() + results.getMemorySize();
+  for (auto &info : accessInfos)
+    size += sizeof(AccessInfo) +
+            info.second->domain.getNumConstraints() *
+                info.second->domain.getNumCols() * sizeof(int64_t);
+  for (auto &srcResults : results)
+    size += srcResults.second.getMemorySize();
+  return size;
+}
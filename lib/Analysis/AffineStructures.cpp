@@ -21,6 +21,7 @@
 
 #include "mlir/Analysis/AffineStructures.h"
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Simplex.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/IntegerSet.h"
@@ -30,6 +31,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "affine-structures"
@@ -421,12 +423,16 @@ void FlatAffineConstraints::addId(IdKind kind, unsigned pos, Value *id) {
   }
 
   unsigned oldNumReservedCols = numReservedCols;
+  unsigned oldNumCols = getNumCols();
+  unsigned numEqualities = getNumEqualities();
+  unsigned numInequalities = getNumInequalities();
 
-  // Check if a resize is necessary.
-  if (getNumCols() + 1 > numReservedCols) {
-    equalities.resize(getNumEqualities() * (getNumCols() + 1));
-    inequalities.resize(getNumInequalities() * (getNumCols() + 1));
-    numReservedCols++;
+  // Check if a resize is necessary. The reserved columns grow geometrically, so
+  // that adding identifiers one at a time doesn't move every row each time.
+  if (oldNumCols + 1 > numReservedCols) {
+    numReservedCols = std::max(2 * numReservedCols, oldNumCols + 1);
+    equalities.resize(numEqualities * numReservedCols);
+    inequalities.resize(numInequalities * numReservedCols);
   }
 
   int absolutePos;
@@ -442,35 +448,23 @@ void FlatAffineConstraints::addId(IdKind kind, unsigned pos, Value *id) {
   }
   numIds++;
 
-  // Note that getNumCols() now will already return the new size, which will be
-  // at least one.
-  int numInequalities = static_cast<int>(getNumInequalities());
-  int numEqualities = static_cast<int>(getNumEqualities());
-  int numCols = static_cast<int>(getNumCols());
-  for (int r = numInequalities - 1; r >= 0; r--) {
-    for (int c = numCols - 2; c >= 0; c--) {
-      if (c < absolutePos)
-        atIneq(r, c) = inequalities[r * oldNumReservedCols + c];
-      else
-        atIneq(r, c + 1) = inequalities[r * oldNumReservedCols + c];
+  // Move the rows to their new position, if the reserved columns grew, and
+  // insert a zero column at 'absolutePos'. Rows only move to the right, so
+  // they are processed from the last one.
+  auto insertColumn = [&](SmallVectorImpl<int64_t> &buffer, unsigned numRows) {
+    int64_t *data = buffer.data();
+    for (unsigned r = numRows; r-- > 0;) {
+      int64_t *src = data + r * oldNumReservedCols;
+      int64_t *dest = data + r * numReservedCols;
+      std::copy_backward(src + absolutePos, src + oldNumCols,
+                         dest + oldNumCols + 1);
+      if (dest != src)
+        std::copy_backward(src, src + absolutePos, dest + absolutePos);
+      dest[absolutePos] = 0;
     }
-    atIneq(r, absolutePos) = 0;
-  }
-
-  for (int r = numEqualities - 1; r >= 0; r--) {
-    for (int c = numCols - 2; c >= 0; c--) {
-      // All values in column absolutePositions < absolutePos have the same
-      // coordinates in the 2-d view of the coefficient buffer.
-      if (c < absolutePos)
-        atEq(r, c) = equalities[r * oldNumReservedCols + c];
-      else
-        // Those at absolutePosition >= absolutePos, get a shifted
-        // absolutePosition.
-        atEq(r, c + 1) = equalities[r * oldNumReservedCols + c];
-    }
-    // Initialize added dimension to zero.
-    atEq(r, absolutePos) = 0;
-  }
+  };
+  insertColumn(inequalities, numInequalities);
+  insertColumn(equalities, numEqualities);
 
   // If an 'id' is provided, insert it; otherwise use None.
   if (id) {
@@ -786,6 +780,112 @@ LogicalResult FlatAffineConstraints::addAffineForOpDomain(AffineForOp forOp) {
                               /*eq=*/false, /*lower=*/false);
 }
 
+// Returns the absolute value of 'v', which is representable even for the
+// smallest int64_t.
+static inline uint64_t absValue(int64_t v) {
+  return v < 0 ? -static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+}
+
+// Returns the GCD of the absolute values of the elements of 'row', or zero if
+// they are all zero. Most rows have a GCD of one, which is detected early.
+static uint64_t getGCD(ArrayRef<int64_t> row) {
+  uint64_t gcd = 0;
+  for (int64_t v : row) {
+    gcd = llvm::GreatestCommonDivisor64(gcd, absValue(v));
+    if (gcd == 1)
+      break;
+  }
+  return gcd;
+}
+
+// Sets 'aMul' and 'bMul' to the multipliers lcm(a, b) / |a| and lcm(a, b) / |b|
+// that scale 'a' and 'b' to the same magnitude, i.e., |b| / gcd(a, b) and
+// |a| / gcd(a, b), without forming the LCM, which may overflow. Returns failure
+// if a multiplier doesn't fit in int64_t, which only happens when the other
+// value is the smallest int64_t.
+static LogicalResult getLcmMultipliers(int64_t a, int64_t b, int64_t &aMul,
+                                       int64_t &bMul) {
+  assert(a != 0 && b != 0 && "expected non-zero values");
+  uint64_t gcd = llvm::GreatestCommonDivisor64(absValue(a), absValue(b));
+  uint64_t aScale = absValue(b) / gcd, bScale = absValue(a) / gcd;
+  if (aScale > static_cast<uint64_t>(INT64_MAX) ||
+      bScale > static_cast<uint64_t>(INT64_MAX))
+    return failure();
+  aMul = aScale;
+  bMul = bScale;
+  return success();
+}
+
+// Divides every element of 'row' by 'divisor', which divides all of them.
+static void divideRow(MutableArrayRef<int64_t> row, uint64_t divisor) {
+  int64_t d = static_cast<int64_t>(divisor);
+  int64_t *data = row.data();
+  for (unsigned j = 0, e = row.size(); j < e; ++j)
+    data[j] /= d;
+}
+
+// Sets 'dest' to 'lhsMul * lhs + rhsMul * rhs', and adds 'constAddend' to its
+// last element, i.e., its constant term. The rows have the same size, and
+// 'dest' may alias 'lhs' or 'rhs'.
+//
+// The magnitudes of the operands are first bounded to check that the result
+// can't overflow, in which case it is computed by a branch-free loop that the
+// compiler vectorizes. Otherwise, the row is computed with arbitrary precision
+// and divided by the GCD of its elements, which doesn't change the constraint
+// it represents. Returns failure if the result still doesn't fit in int64_t,
+// in which case 'dest' is left unchanged.
+static LogicalResult combineRows(MutableArrayRef<int64_t> dest,
+                                 ArrayRef<int64_t> lhs, int64_t lhsMul,
+                                 ArrayRef<int64_t> rhs, int64_t rhsMul,
+                                 int64_t constAddend = 0) {
+  unsigned numCols = dest.size();
+  assert(lhs.size() == numCols && rhs.size() == numCols && numCols > 0);
+  const int64_t *lhsData = lhs.data(), *rhsData = rhs.data();
+  int64_t *destData = dest.data();
+
+  uint64_t lhsMax = 0, rhsMax = 0;
+  for (unsigned j = 0; j < numCols; ++j) {
+    lhsMax = std::max(lhsMax, absValue(lhsData[j]));
+    rhsMax = std::max(rhsMax, absValue(rhsData[j]));
+  }
+  // The saturated bound is larger than any int64_t on overflow.
+  uint64_t bound =
+      llvm::SaturatingAdd(llvm::SaturatingMultiply(lhsMax, absValue(lhsMul)),
+                          llvm::SaturatingMultiply(rhsMax, absValue(rhsMul)));
+  bound = llvm::SaturatingAdd(bound, absValue(constAddend));
+  if (bound <= static_cast<uint64_t>(INT64_MAX)) {
+    for (unsigned j = 0; j < numCols; ++j)
+      destData[j] = lhsMul * lhsData[j] + rhsMul * rhsData[j];
+    destData[numCols - 1] += constAddend;
+    return success();
+  }
+
+  // The product of two int64_t and the sum of two such products fit in 128
+  // bits and a sign bit.
+  const unsigned kNumBits = 129;
+  auto wide = [&](int64_t v) { return APInt(kNumBits, v, /*isSigned=*/true); };
+  SmallVector<APInt, 8> result;
+  result.reserve(numCols);
+  APInt gcd(kNumBits, 0);
+  for (unsigned j = 0; j < numCols; ++j) {
+    APInt v = wide(lhsMul) * wide(lhsData[j]) + wide(rhsMul) * wide(rhsData[j]);
+    if (j == numCols - 1)
+      v += wide(constAddend);
+    gcd = llvm::APIntOps::GreatestCommonDivisor(gcd, v.abs());
+    result.push_back(std::move(v));
+  }
+  for (APInt &v : result) {
+    if (gcd.ugt(1))
+      v = v.sdiv(gcd);
+    if (!v.isSignedIntN(64))
+      return failure();
+  }
+  LLVM_DEBUG(llvm::dbgs() << "Row combination recovered from an overflow\n");
+  for (unsigned j = 0; j < numCols; ++j)
+    destData[j] = result[j].getSExtValue();
+  return success();
+}
+
 // Searches for a constraint with a non-zero coefficient at 'colIdx' in
 // equality (isEq=true) or inequality (isEq=false) constraints.
 // Returns true and sets row found in search in 'rowIdx'.
@@ -812,21 +912,12 @@ findConstraintWithNonZeroAt(const FlatAffineConstraints &constraints,
 template <bool isEq>
 static void normalizeConstraintByGCD(FlatAffineConstraints *constraints,
                                      unsigned rowIdx) {
-  auto at = [&](unsigned colIdx) -> int64_t {
-    return isEq ? constraints->atEq(rowIdx, colIdx)
-                : constraints->atIneq(rowIdx, colIdx);
-  };
-  uint64_t gcd = std::abs(at(0));
-  for (unsigned j = 1, e = constraints->getNumCols(); j < e; ++j) {
-    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(at(j)));
-  }
-  if (gcd > 0 && gcd != 1) {
-    for (unsigned j = 0, e = constraints->getNumCols(); j < e; ++j) {
-      int64_t v = at(j) / static_cast<int64_t>(gcd);
-      isEq ? constraints->atEq(rowIdx, j) = v
-           : constraints->atIneq(rowIdx, j) = v;
-    }
-  }
+  int64_t *row = isEq ? &constraints->atEq(rowIdx, 0)
+                      : &constraints->atIneq(rowIdx, 0);
+  unsigned numCols = constraints->getNumCols();
+  uint64_t gcd = getGCD(ArrayRef<int64_t>(row, numCols));
+  if (gcd > 1)
+    divideRow(MutableArrayRef<int64_t>(row, numCols), gcd);
 }
 
 void FlatAffineConstraints::normalizeConstraintsByGCD() {
@@ -888,8 +979,8 @@ bool FlatAffineConstraints::hasInvalidConstraint() const {
 }
 
 // Eliminate identifier from constraint at 'rowIdx' based on coefficient at
-// pivotRow, pivotCol. Columns in range [elimColStart, pivotCol) will not be
-// updated as they have already been eliminated.
+// pivotRow, pivotCol. Columns in range [elimColStart, pivotCol) have already
+// been eliminated, and are zero in both constraints.
 static void eliminateFromConstraint(FlatAffineConstraints *constraints,
                                     unsigned rowIdx, unsigned pivotRow,
                                     unsigned pivotCol, unsigned elimColStart,
@@ -905,20 +996,25 @@ static void eliminateFromConstraint(FlatAffineConstraints *constraints,
   if (leadCoeff == 0)
     return;
   int64_t pivotCoeff = constraints->atEq(pivotRow, pivotCol);
-  int64_t sign = (leadCoeff * pivotCoeff > 0) ? -1 : 1;
-  int64_t lcm = mlir::lcm(pivotCoeff, leadCoeff);
-  int64_t pivotMultiplier = sign * (lcm / std::abs(pivotCoeff));
-  int64_t rowMultiplier = lcm / std::abs(leadCoeff);
+  int64_t pivotMultiplier = 0, rowMultiplier = 0;
+  LogicalResult multipliersFit = getLcmMultipliers(pivotCoeff, leadCoeff,
+                                                   pivotMultiplier,
+                                                   rowMultiplier);
+  if ((leadCoeff > 0) == (pivotCoeff > 0))
+    pivotMultiplier = -pivotMultiplier;
 
   unsigned numCols = constraints->getNumCols();
-  for (unsigned j = 0; j < numCols; ++j) {
-    // Skip updating column 'j' if it was just eliminated.
-    if (j >= elimColStart && j < pivotCol)
-      continue;
-    int64_t v = pivotMultiplier * constraints->atEq(pivotRow, j) +
-                rowMultiplier * at(rowIdx, j);
-    isEq ? constraints->atEq(rowIdx, j) = v
-         : constraints->atIneq(rowIdx, j) = v;
+  MutableArrayRef<int64_t> row(isEq ? &constraints->atEq(rowIdx, 0)
+                                    : &constraints->atIneq(rowIdx, 0),
+                               numCols);
+  if (failed(multipliersFit) ||
+      failed(combineRows(row, constraints->getEquality(pivotRow),
+                         pivotMultiplier, row, rowMultiplier))) {
+    // Drop the constraint, over-approximating the set.
+    LLVM_DEBUG(llvm::dbgs() << "Overflow in Gaussian elimination, dropping "
+                            << (isEq ? "equality " : "inequality ") << rowIdx
+                            << "\n");
+    std::fill(row.begin(), row.end(), 0);
   }
 }
 
@@ -935,15 +1031,10 @@ static void shiftColumnsToLeft(FlatAffineConstraints *constraints,
   unsigned numCols = constraints->getNumCols();
   unsigned numRows = isEq ? constraints->getNumEqualities()
                           : constraints->getNumInequalities();
-  unsigned numToEliminate = colLimit - colStart;
   for (unsigned r = 0, e = numRows; r < e; ++r) {
-    for (unsigned c = colLimit; c < numCols; ++c) {
-      if (isEq) {
-        constraints->atEq(r, c - numToEliminate) = constraints->atEq(r, c);
-      } else {
-        constraints->atIneq(r, c - numToEliminate) = constraints->atIneq(r, c);
-      }
-    }
+    int64_t *row =
+        isEq ? &constraints->atEq(r, 0) : &constraints->atIneq(r, 0);
+    std::copy(row + colLimit, row + numCols, row + colStart);
   }
 }
 
@@ -1028,10 +1119,21 @@ static unsigned getBestIdToEliminate(const FlatAffineConstraints &cst,
 // using the GCD test (on all equality constraints) and checking for trivially
 // invalid constraints. Returns 'true' if the constraint system is found to be
 // empty; false otherwise.
-bool FlatAffineConstraints::isEmpty() const {
+bool FlatAffineConstraints::isEmpty(Engine engine) const {
   if (isEmptyByGCDTest() || hasInvalidConstraint())
     return true;
 
+  if (engine == Engine::Simplex) {
+    // Tightening the inequalities cuts off rational points, which saves
+    // branches.
+    FlatAffineConstraints tmpCst(*this);
+    tmpCst.GCDTightenInequalities();
+    Simplex simplex(tmpCst);
+    if (Optional<bool> result = simplex.isIntegerEmpty())
+      return *result;
+    LLVM_DEBUG(llvm::dbgs() << "Simplex inconclusive, falling back to FM\n");
+  }
+
   // First, eliminate as many identifiers as possible using Gaussian
   // elimination.
   FlatAffineConstraints tmpCst(*this);
@@ -1111,16 +1213,13 @@ bool FlatAffineConstraints::isEmptyByGCDTest() const {
 void FlatAffineConstraints::GCDTightenInequalities() {
   unsigned numCols = getNumCols();
   for (unsigned i = 0, e = getNumInequalities(); i < e; ++i) {
-    uint64_t gcd = std::abs(atIneq(i, 0));
-    for (unsigned j = 1; j < numCols - 1; ++j) {
-      gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(atIneq(i, j)));
-    }
-    if (gcd > 0 && gcd != 1) {
-      int64_t gcdI = static_cast<int64_t>(gcd);
+    MutableArrayRef<int64_t> coeffs(&atIneq(i, 0), numCols - 1);
+    uint64_t gcd = getGCD(coeffs);
+    if (gcd > 1) {
       // Tighten the constant term and normalize the constraint by the GCD.
+      int64_t gcdI = static_cast<int64_t>(gcd);
       atIneq(i, numCols - 1) = mlir::floorDiv(atIneq(i, numCols - 1), gcdI);
-      for (unsigned j = 0, e = numCols - 1; j < e; ++j)
-        atIneq(i, j) /= gcdI;
+      divideRow(coeffs, gcd);
     }
   }
 }
@@ -1376,26 +1475,39 @@ static inline void negateInequality(FlatAffineConstraints *cst, unsigned r) {
 }
 
 // A more complex check to eliminate redundant inequalities. Uses FourierMotzkin
-// to check if a constraint is redundant.
-void FlatAffineConstraints::removeRedundantInequalities() {
+// or the Simplex to check if a constraint is redundant.
+void FlatAffineConstraints::removeRedundantInequalities(Engine engine) {
   SmallVector<bool, 32> redun(getNumInequalities(), false);
-  // To check if an inequality is redundant, we replace the inequality by its
-  // complement (for eg., i - 1 >= 0 by i <= 0), and check if the resulting
-  // system is empty. If it is, the inequality is redundant.
-  FlatAffineConstraints tmpCst(*this);
-  for (unsigned r = 0, e = getNumInequalities(); r < e; r++) {
-    // Change the inequality to its complement.
-    negateInequality(&tmpCst, r);
-    tmpCst.atIneq(r, tmpCst.getNumCols() - 1)--;
-    if (tmpCst.isEmpty()) {
-      redun[r] = true;
-      // Zero fill the redundant inequality.
-      fillInequality(this, r, /*val=*/0);
-      fillInequality(&tmpCst, r, /*val=*/0);
-    } else {
-      // Reverse the change (to avoid recreating tmpCst each time).
-      tmpCst.atIneq(r, tmpCst.getNumCols() - 1)++;
+  if (engine == Engine::Simplex) {
+    // The Simplex adds each equality as a pair of inequalities, before the
+    // inequalities. An empty system has no meaningful redundancy, and the
+    // results aren't reliable after an overflow; leave the system as is then.
+    Simplex simplex(*this);
+    unsigned offset = 2 * getNumEqualities();
+    simplex.detectRedundant(offset, getNumInequalities());
+    if (simplex.isEmpty() || simplex.hasOverflowed())
+      return;
+    for (unsigned r = 0, e = getNumInequalities(); r < e; r++)
+      redun[r] = simplex.isMarkedRedundant(offset + r);
+  } else {
+    // To check if an inequality is redundant, we replace the inequality by its
+    // complement (for eg., i - 1 >= 0 by i <= 0), and check if the resulting
+    // system is empty. If it is, the inequality is redundant.
+    FlatAffineConstraints tmpCst(*this);
+    for (unsigned r = 0, e = getNumInequalities(); r < e; r++) {
+      // Change the inequality to its complement.
       negateInequality(&tmpCst, r);
+      tmpCst.atIneq(r, tmpCst.getNumCols() - 1)--;
+      if (tmpCst.isEmpty()) {
+        redun[r] = true;
+        // Zero fill the redundant inequality.
+        fillInequality(this, r, /*val=*/0);
+        fillInequality(&tmpCst, r, /*val=*/0);
+      } else {
+        // Reverse the change (to avoid recreating tmpCst each time).
+        tmpCst.atIneq(r, tmpCst.getNumCols() - 1)++;
+        negateInequality(&tmpCst, r);
+      }
     }
   }
 
@@ -2468,7 +2580,7 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
   assert(newFac.getIds().size() == newFac.getNumIds());
 
   // This will be used to check if the elimination was integer exact.
-  unsigned lcmProducts = 1;
+  bool allLcmsAreOne = true;
 
   // Let x be the variable we are eliminating.
   // For each lower bound, lb <= c_l*x, and each upper bound c_u*x <= ub, (note
@@ -2482,37 +2594,58 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
   // integer exact.
   for (auto ubPos : ubIndices) {
     for (auto lbPos : lbIndices) {
-      SmallVector<int64_t, 4> ineq;
-      ineq.reserve(newFac.getNumCols());
+      SmallVector<int64_t, 8> ineq(getNumCols());
       int64_t lbCoeff = atIneq(lbPos, pos);
       // Note that in the comments above, ubCoeff is the negation of the
       // coefficient in the canonical form as the view taken here is that of the
-      // term being moved to the other size of '>='.
-      int64_t ubCoeff = -atIneq(ubPos, pos);
-      // TODO(bondhugula): refactor this loop to avoid all branches inside.
-      for (unsigned l = 0, e = getNumCols(); l < e; l++) {
-        if (l == pos)
-          continue;
-        assert(lbCoeff >= 1 && ubCoeff >= 1 && "bounds wrongly identified");
-        int64_t lcm = mlir::lcm(lbCoeff, ubCoeff);
-        ineq.push_back(atIneq(ubPos, l) * (lcm / ubCoeff) +
-                       atIneq(lbPos, l) * (lcm / lbCoeff));
-        lcmProducts *= lcm;
-      }
-      if (darkShadow) {
-        // The dark shadow is a convex subset of the exact integer shadow. If
-        // there is a point here, it proves the existence of a solution.
-        ineq[ineq.size() - 1] += lbCoeff * ubCoeff - lbCoeff - ubCoeff + 1;
+      // term being moved to the other size of '>='. It is kept negated here, as
+      // the negation of the smallest int64_t overflows.
+      int64_t negUbCoeff = atIneq(ubPos, pos);
+      assert(lbCoeff >= 1 && negUbCoeff <= -1 && "bounds wrongly identified");
+      allLcmsAreOne &= lbCoeff == 1 && negUbCoeff == -1;
+      // The multipliers lcm(c_l, c_u)/c_u and lcm(c_l, c_u)/c_l of the upper
+      // and lower bounds.
+      int64_t ubMultiplier = 0, lbMultiplier = 0;
+      LogicalResult fits =
+          getLcmMultipliers(negUbCoeff, lbCoeff, ubMultiplier, lbMultiplier);
+      // The dark shadow is a convex subset of the exact integer shadow. If
+      // there is a point here, it proves the existence of a solution. Its
+      // term, c_l * c_u - c_l - c_u + 1, is (c_l - 1) * (c_u - 1).
+      int64_t darkShadowTerm = 0;
+      if (darkShadow && succeeded(fits) &&
+          llvm::MulOverflow(lbCoeff - 1, -(negUbCoeff + 1), darkShadowTerm))
+        fits = failure();
+      // The combination cancels the coefficient of the eliminated variable,
+      // whose column is then dropped.
+      if (failed(fits) ||
+          failed(combineRows(ineq, getInequality(ubPos), ubMultiplier,
+                             getInequality(lbPos), lbMultiplier,
+                             darkShadowTerm))) {
+        LLVM_DEBUG(llvm::dbgs() << "Overflow in FM, dropping the combination "
+                                << "of inequalities " << lbPos << " and "
+                                << ubPos << "\n");
+        allLcmsAreOne = false;
+        // Dropping the constraint over-approximates the projection. As the
+        // dark shadow must remain a subset of the integer shadow, it is made
+        // empty instead, so that it proves nothing.
+        if (darkShadow) {
+          SmallVector<int64_t, 8> infeasible(getNumCols() - 1, 0);
+          infeasible.back() = -1;
+          newFac.addInequality(infeasible);
+        }
+        continue;
       }
+      assert(ineq[pos] == 0 && "variable not eliminated");
+      ineq.erase(ineq.begin() + pos);
       // TODO: we need to have a way to add inequalities in-place in
       // FlatAffineConstraints instead of creating and copying over.
       newFac.addInequality(ineq);
     }
   }
 
-  LLVM_DEBUG(llvm::dbgs() << "FM isResultIntegerExact: " << (lcmProducts == 1)
+  LLVM_DEBUG(llvm::dbgs() << "FM isResultIntegerExact: " << allLcmsAreOne
                           << "\n");
-  if (lcmProducts == 1 && isResultIntegerExact)
+  if (allLcmsAreOne && isResultIntegerExact)
     *isResultIntegerExact = 1;
 
   // Copy over the constraints not involving this variable.
@@ -2527,7 +2660,7 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
     newFac.addInequality(ineq);
   }
 
-  assert(newFac.getNumConstraints() ==
+  assert(newFac.getNumConstraints() <=
          lbIndices.size() * ubIndices.size() + nbIndices.size());
 
   // Copy over the equalities.
@@ -2555,7 +2688,8 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "affine-structures"
 
-void FlatAffineConstraints::projectOut(unsigned pos, unsigned num) {
+void FlatAffineConstraints::projectOut(unsigned pos, unsigned num,
+                                       Engine engine) {
   if (num == 0)
     return;
 
@@ -2581,6 +2715,11 @@ void FlatAffineConstraints::projectOut(unsigned pos, unsigned num) {
     unsigned numToEliminate = num - numGaussianEliminated - i;
     FourierMotzkinEliminate(
         getBestIdToEliminate(*this, pos, pos + numToEliminate));
+    // Each elimination produces the pairwise combinations of the lower and
+    // upper bounds, most of which are typically redundant. Removing them keeps
+    // the next eliminations from blowing up.
+    if (engine == Engine::Simplex)
+      removeRedundantInequalities(Engine::Simplex);
   }
 
   // Fast/trivial simplifications.
@@ -22,6 +22,7 @@
 
 #include "mlir/Analysis/Dominance.h"
 #include "mlir/IR/Operation.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/Support/GenericDomTreeConstruction.h"
 using namespace mlir;
 using namespace mlir::detail;
@@ -37,27 +38,68 @@ template class llvm::DomTreeNodeBase<Block>;
 /// Recalculate the dominance info for the provided function.
 template <bool IsPostDom>
 void DominanceInfoBase<IsPostDom>::recalculate(Function *function) {
+  // The dominator trees are built on demand: most regions of a function hold a
+  // single block, for which the dominance follows from the operation order,
+  // and walking the whole function to build them all would make this analysis
+  // linear in the size of the function for each use.
   dominanceInfos.clear();
+}
+
+template <bool IsPostDom>
+typename DominanceInfoBase<IsPostDom>::base *
+DominanceInfoBase<IsPostDom>::getDominanceInfo(Region *region) {
+  auto &regionDominance = dominanceInfos[region];
+  if (!regionDominance) {
+    regionDominance = llvm::make_unique<base>();
+    regionDominance->recalculate(*region);
+  }
+  return regionDominance.get();
+}
+
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::applyUpdates(
+    ArrayRef<DominanceUpdate> updates) {
+  // Group the updates by region, as each region has its own dominator tree.
+  llvm::MapVector<Region *, SmallVector<DominanceUpdate, 4>> regionUpdates;
+  for (auto &update : updates) {
+    assert(update.getFrom()->getParent() == update.getTo()->getParent() &&
+           "CFG edge crosses a region boundary");
+    regionUpdates[update.getFrom()->getParent()].push_back(update);
+  }
 
-  // Build the top level function dominance.
-  auto functionDominance = llvm::make_unique<base>();
-  functionDominance->recalculate(function->getBody());
-  dominanceInfos.try_emplace(&function->getBody(),
-                             std::move(functionDominance));
-
-  /// Build the dominance for each of the operation regions.
-  function->walk([&](Operation *op) {
-    for (auto &region : op->getRegions()) {
-      // Don't compute dominance if the region is empty.
-      if (region.empty())
-        continue;
-      auto opDominance = llvm::make_unique<base>();
-      opDominance->recalculate(region);
-      dominanceInfos.try_emplace(&region, std::move(opDominance));
-    }
+  for (auto &it : regionUpdates) {
+    // If the dominance of this region isn't known, it is computed from the
+    // updated CFG when first queried.
+    auto baseInfoIt = dominanceInfos.find(it.first);
+    if (baseInfoIt == dominanceInfos.end())
+      continue;
+    baseInfoIt->second->applyUpdates(it.second);
+  }
+}
+
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::notifyOperationErased(Operation *op) {
+  // The regions are keyed by address, so a region allocated later at the same
+  // address must not find the tree of an erased one.
+  op->walk([&](Operation *nestedOp) {
+    for (auto &region : nestedOp->getRegions())
+      dominanceInfos.erase(&region);
   });
 }
 
+/// Returns an estimate of the memory used by the dominator trees.
+template <bool IsPostDom>
+size_t DominanceInfoBase<IsPostDom>::getMemoryUsage() const {
+  // Each tree holds a node per block, along with an entry in its node map.
+  size_t memoryUsage = sizeof(*this) + dominanceInfos.getMemorySize();
+  for (auto &it : dominanceInfos) {
+    size_t numBlocks = it.first->getBlocks().size();
+    memoryUsage += sizeof(base) + numBlocks * (sizeof(DominanceInfoNode) +
+                                               2 * sizeof(void *));
+  }
+  return memoryUsage;
+}
+
 /// Return true if the specified block A properly dominates block B.
 template <bool IsPostDom>
 bool DominanceInfoBase<IsPostDom>::properlyDominates(Block *a, Block *b) {
@@ -88,9 +130,7 @@ bool DominanceInfoBase<IsPostDom>::properlyDominates(Block *a, Block *b) {
   }
 
   // Otherwise, use the standard dominance functionality.
-  auto baseInfoIt = dominanceInfos.find(regionA);
-  assert(baseInfoIt != dominanceInfos.end() && "region info not found");
-  return baseInfoIt->second->properlyDominates(a, b);
+  return getDominanceInfo(regionA)->properlyDominates(a, b);
 }
 
 template class mlir::detail::DominanceInfoBase</*IsPostDom=*/true>;
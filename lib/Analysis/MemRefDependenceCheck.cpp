@@ -79,22 +79,19 @@ getDirectionVectorStr(bool ret, unsigned numCommonLoops, unsigned loopNestDepth,
 // "source" access and all subsequent "destination" accesses in
 // 'loadsAndStores'. Emits the result of the dependence check as a note with
 // the source access.
-static void checkDependences(ArrayRef<Operation *> loadsAndStores) {
+static void checkDependences(ArrayRef<Operation *> loadsAndStores,
+                             DependenceAnalysis &dependenceAnalysis) {
   for (unsigned i = 0, e = loadsAndStores.size(); i < e; ++i) {
     auto *srcOpInst = loadsAndStores[i];
-    MemRefAccess srcAccess(srcOpInst);
     for (unsigned j = 0; j < e; ++j) {
       auto *dstOpInst = loadsAndStores[j];
-      MemRefAccess dstAccess(dstOpInst);
 
       unsigned numCommonLoops =
           getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
       for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> dependenceComponents;
-        bool ret = checkMemrefAccessDependence(srcAccess, dstAccess, d,
-                                               &dependenceConstraints,
-                                               &dependenceComponents);
+        bool ret = dependenceAnalysis.checkDependence(srcOpInst, dstOpInst, d,
+                                                      &dependenceComponents);
         // TODO(andydavis) Print dependence type (i.e. RAW, etc) and print
         // distance vectors as: ([2, 3], [0, 10]). Also, shorten distance
         // vectors from ([1, 1], [3, 3]) to (1, 3).
@@ -118,7 +115,10 @@ void MemRefDependenceCheck::runOnFunction() {
       loadsAndStores.push_back(op);
   });
 
-  checkDependences(loadsAndStores);
+  checkDependences(loadsAndStores, getAnalysis<DependenceAnalysis>());
+
+  // Only remarks are emitted, the IR is left untouched.
+  markAllAnalysesPreserved();
 }
 
 static PassRegistration<MemRefDependenceCheck>
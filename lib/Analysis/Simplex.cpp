@@ -0,0 +1,521 @@
+//===- Simplex.cpp - MLIR Simplex Class -----------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Simplex.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Support/MathExtras.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <limits>
+
+#define DEBUG_TYPE "simplex"
+
+using namespace mlir;
+
+constexpr unsigned Simplex::kDefaultMaxBranches;
+
+/// Returns true if 'value' moves in the given direction, i.e., is positive for
+/// Direction::Up and negative for Direction::Down.
+static bool signMatchesDirection(int64_t value, Simplex::Direction direction) {
+  assert(value != 0 && "value has no sign");
+  return direction == Simplex::Direction::Up ? value > 0 : value < 0;
+}
+
+static Simplex::Direction flippedDirection(Simplex::Direction direction) {
+  return direction == Simplex::Direction::Up ? Simplex::Direction::Down
+                                             : Simplex::Direction::Up;
+}
+
+Simplex::Simplex(unsigned numVars) : numColumns(numVars + 2) {
+  // Columns 0 and 1 hold the denominator and the constant term, so they have
+  // no unknown.
+  colUnknown.push_back(std::numeric_limits<int>::max());
+  colUnknown.push_back(std::numeric_limits<int>::max());
+  for (unsigned i = 0; i < numVars; ++i) {
+    vars.emplace_back(Orientation::Column, /*restricted=*/false,
+                      /*pos=*/numColumns - numVars + i);
+    colUnknown.push_back(~i);
+  }
+}
+
+Simplex::Simplex(const FlatAffineConstraints &constraints)
+    : Simplex(constraints.getNumIds()) {
+  for (unsigned i = 0, e = constraints.getNumEqualities(); i < e; ++i)
+    addEquality(constraints.getEquality(i));
+  for (unsigned i = 0, e = constraints.getNumInequalities(); i < e; ++i)
+    addInequality(constraints.getInequality(i));
+}
+
+int64_t Simplex::add(int64_t lhs, int64_t rhs) {
+  int64_t result;
+  if (llvm::AddOverflow(lhs, rhs, result))
+    overflowed = true;
+  return result;
+}
+
+int64_t Simplex::sub(int64_t lhs, int64_t rhs) {
+  int64_t result;
+  if (llvm::SubOverflow(lhs, rhs, result))
+    overflowed = true;
+  return result;
+}
+
+int64_t Simplex::mul(int64_t lhs, int64_t rhs) {
+  int64_t result;
+  if (llvm::MulOverflow(lhs, rhs, result))
+    overflowed = true;
+  return result;
+}
+
+int64_t Simplex::negate(int64_t value) { return sub(0, value); }
+
+/// Returns the magnitude of 'value'. Unlike std::abs, this is defined for the
+/// most negative value.
+static uint64_t getMagnitude(int64_t value) {
+  return value < 0 ? -static_cast<uint64_t>(value) : value;
+}
+
+unsigned Simplex::addRow(ArrayRef<int64_t> coeffs) {
+  assert(coeffs.size() == vars.size() + 1 &&
+         "incorrect number of coefficients");
+
+  unsigned row = numRows++;
+  tableau.resize(numRows * numColumns, 0);
+  rowUnknown.push_back(cons.size());
+  cons.emplace_back(Orientation::Row, /*restricted=*/false, row);
+
+  // Express the new row in terms of the column unknowns. A variable that is a
+  // row itself contributes its own row, which may have another denominator.
+  at(row, 0) = 1;
+  at(row, 1) = coeffs.back();
+  for (unsigned i = 0, e = vars.size(); i < e; ++i) {
+    int64_t coeff = coeffs[i];
+    if (coeff == 0)
+      continue;
+
+    const Unknown &var = vars[i];
+    if (var.orientation == Orientation::Column) {
+      at(row, var.pos) = add(at(row, var.pos), mul(coeff, at(row, 0)));
+      continue;
+    }
+
+    int64_t rowDen = at(row, 0), varDen = at(var.pos, 0);
+    int64_t gcd = llvm::GreatestCommonDivisor64(rowDen, varDen);
+    int64_t den = mul(rowDen / gcd, varDen);
+    int64_t rowScale = varDen / gcd, varScale = mul(coeff, rowDen / gcd);
+    at(row, 0) = den;
+    for (unsigned col = 1; col < numColumns; ++col)
+      at(row, col) = add(mul(at(row, col), rowScale),
+                         mul(varScale, at(var.pos, col)));
+  }
+  normalizeRow(row);
+
+  undoLog.push_back(UndoLogEntry::RemoveLastConstraint);
+  return cons.size() - 1;
+}
+
+void Simplex::normalizeRow(unsigned row) {
+  uint64_t gcd = 0;
+  for (unsigned col = 0; col < numColumns && gcd != 1; ++col)
+    gcd = llvm::GreatestCommonDivisor64(gcd, getMagnitude(at(row, col)));
+  // The denominator is positive, so the gcd fits in an int64_t.
+  if (gcd == 0 || gcd == 1)
+    return;
+  for (unsigned col = 0; col < numColumns; ++col)
+    at(row, col) /= static_cast<int64_t>(gcd);
+}
+
+void Simplex::addInequality(ArrayRef<int64_t> coeffs) {
+  unsigned index = addRow(coeffs);
+  Unknown &u = cons[index];
+  u.restricted = true;
+  if (empty)
+    return;
+  // Once the tableau has overflowed, a failure to restore the row says nothing
+  // about the emptiness of the system.
+  if (failed(restoreRow(u)) && !overflowed)
+    markEmpty();
+}
+
+void Simplex::addEquality(ArrayRef<int64_t> coeffs) {
+  addInequality(coeffs);
+  SmallVector<int64_t, 8> negated;
+  negated.reserve(coeffs.size());
+  for (int64_t coeff : coeffs)
+    negated.push_back(negate(coeff));
+  addInequality(negated);
+}
+
+void Simplex::markEmpty() {
+  if (empty)
+    return;
+  undoLog.push_back(UndoLogEntry::UnmarkEmpty);
+  empty = true;
+}
+
+void Simplex::swapRows(unsigned lhs, unsigned rhs) {
+  if (lhs == rhs)
+    return;
+  for (unsigned col = 0; col < numColumns; ++col)
+    std::swap(at(lhs, col), at(rhs, col));
+  std::swap(rowUnknown[lhs], rowUnknown[rhs]);
+  unknownFromIndex(rowUnknown[lhs]).pos = lhs;
+  unknownFromIndex(rowUnknown[rhs]).pos = rhs;
+}
+
+// If the pivot row is R = (a + b * C + sum_j c_j * X_j) / d, with C the pivot
+// column unknown, then C = (-a + d * R - sum_j c_j * X_j) / b. The pivot row
+// becomes this expression of C, and C is substituted by it in the other rows.
+void Simplex::pivot(unsigned pivotRow, unsigned pivotCol) {
+  assert(pivotCol >= 2 && "refusing to pivot on the constant columns");
+  assert(at(pivotRow, pivotCol) != 0 && "pivot element is zero");
+
+  // Swap the unknowns.
+  std::swap(rowUnknown[pivotRow], colUnknown[pivotCol]);
+  Unknown &rowU = unknownFromIndex(rowUnknown[pivotRow]);
+  Unknown &colU = unknownFromIndex(colUnknown[pivotCol]);
+  rowU.orientation = Orientation::Row;
+  rowU.pos = pivotRow;
+  colU.orientation = Orientation::Column;
+  colU.pos = pivotCol;
+
+  // Rewrite the pivot row, keeping its denominator positive.
+  std::swap(at(pivotRow, 0), at(pivotRow, pivotCol));
+  if (at(pivotRow, 0) < 0) {
+    at(pivotRow, 0) = negate(at(pivotRow, 0));
+    at(pivotRow, pivotCol) = negate(at(pivotRow, pivotCol));
+  } else {
+    for (unsigned col = 1; col < numColumns; ++col)
+      if (col != pivotCol)
+        at(pivotRow, col) = negate(at(pivotRow, col));
+  }
+  normalizeRow(pivotRow);
+
+  // Substitute the pivot column unknown in the other rows.
+  for (unsigned row = 0; row < numRows; ++row) {
+    int64_t coeff = at(row, pivotCol);
+    if (row == pivotRow || coeff == 0)
+      continue;
+    at(row, 0) = mul(at(row, 0), at(pivotRow, 0));
+    for (unsigned col = 1; col < numColumns; ++col) {
+      if (col == pivotCol)
+        continue;
+      at(row, col) = add(mul(at(row, col), at(pivotRow, 0)),
+                         mul(coeff, at(pivotRow, col)));
+    }
+    at(row, pivotCol) = mul(coeff, at(pivotRow, pivotCol));
+    normalizeRow(row);
+  }
+}
+
+Optional<Simplex::Pivot> Simplex::findPivot(unsigned row,
+                                            Direction direction) {
+  // Pick the first column, in the order of the unknowns (Bland's rule), whose
+  // unknown can move so as to change the row in the given direction. A
+  // restricted column unknown has a sample value of zero and can only grow.
+  Optional<unsigned> column;
+  for (unsigned col = 2; col < numColumns; ++col) {
+    int64_t elem = at(row, col);
+    if (elem == 0)
+      continue;
+    if (unknownFromIndex(colUnknown[col]).restricted &&
+        !signMatchesDirection(elem, direction))
+      continue;
+    if (!column || colUnknown[col] < colUnknown[*column])
+      column = col;
+  }
+  if (!column)
+    return llvm::None;
+
+  Direction columnDirection = at(row, *column) < 0
+                                  ? flippedDirection(direction)
+                                  : direction;
+  Optional<unsigned> pivotRow = findPivotRow(row, columnDirection, *column);
+  return Pivot{pivotRow.getValueOr(row), *column};
+}
+
+Optional<unsigned> Simplex::findPivotRow(Optional<unsigned> skipRow,
+                                         Direction direction,
+                                         unsigned column) {
+  // Among the restricted rows that decrease as the column unknown moves in the
+  // given direction, find the one that reaches zero first. A row (a + b * C)/d
+  // reaches zero after a move of |a / b|, so the rows are compared by a / |b|,
+  // breaking ties by the order of the unknowns.
+  Optional<unsigned> result;
+  int64_t resultElem = 0, resultConst = 0;
+  for (unsigned row = 0; row < numRows; ++row) {
+    if (skipRow && row == *skipRow)
+      continue;
+    int64_t elem = at(row, column);
+    if (elem == 0 || !unknownFromIndex(rowUnknown[row]).restricted)
+      continue;
+    if (signMatchesDirection(elem, direction))
+      continue;
+    int64_t constTerm = at(row, 1);
+
+    if (!result) {
+      result = row;
+      resultElem = elem;
+      resultConst = constTerm;
+      continue;
+    }
+
+    // Compare constTerm / |elem| with resultConst / |resultElem|.
+    int64_t diff = sub(mul(resultConst, elem), mul(constTerm, resultElem));
+    bool better = diff == 0 ? rowUnknown[row] < rowUnknown[*result]
+                            : (direction == Direction::Up ? diff < 0 : diff > 0);
+    if (better) {
+      result = row;
+      resultElem = elem;
+      resultConst = constTerm;
+    }
+  }
+  return result;
+}
+
+LogicalResult Simplex::restoreRow(Unknown &u) {
+  assert(u.orientation == Orientation::Row && "expected a row unknown");
+  while (at(u.pos, 1) < 0 && !overflowed) {
+    Optional<Pivot> maybePivot = findPivot(u.pos, Direction::Up);
+    if (!maybePivot)
+      break;
+    pivot(*maybePivot);
+    if (u.orientation == Orientation::Column)
+      return success();
+  }
+  return success(u.orientation == Orientation::Column || at(u.pos, 1) >= 0);
+}
+
+Optional<Simplex::Fraction> Simplex::computeRowOptimum(Direction direction,
+                                                       unsigned row) {
+  while (!overflowed) {
+    Optional<Pivot> maybePivot = findPivot(row, direction);
+    if (!maybePivot)
+      return Fraction{at(row, 1), at(row, 0)};
+    // The row itself bounds the move, so it is unbounded in this direction.
+    if (maybePivot->row == row)
+      return llvm::None;
+    pivot(*maybePivot);
+  }
+  return llvm::None;
+}
+
+Optional<Simplex::Fraction>
+Simplex::computeOptimum(Direction direction, ArrayRef<int64_t> coeffs) {
+  if (empty || overflowed)
+    return llvm::None;
+
+  unsigned snapshot = getSnapshot();
+  unsigned index = addRow(coeffs);
+  Optional<Fraction> optimum = computeRowOptimum(direction, cons[index].pos);
+  rollback(snapshot);
+  if (overflowed)
+    return llvm::None;
+  return optimum;
+}
+
+void Simplex::moveToRow(Unknown &u) {
+  assert(u.orientation == Orientation::Column && "expected a column unknown");
+  unsigned column = u.pos;
+
+  // Look for a pivot row that keeps the sample point feasible, in either
+  // direction. If the column is unbounded in both directions, any row with a
+  // non-zero coefficient will do.
+  Optional<unsigned> row = findPivotRow(llvm::None, Direction::Up, column);
+  if (!row)
+    row = findPivotRow(llvm::None, Direction::Down, column);
+  for (unsigned r = 0; !row && r < numRows; ++r)
+    if (at(r, column) != 0)
+      row = r;
+  assert(row && "the variables must depend on every column unknown");
+  pivot(*row, column);
+}
+
+void Simplex::undo(UndoLogEntry entry) {
+  switch (entry) {
+  case UndoLogEntry::UnmarkEmpty:
+    empty = false;
+    return;
+  case UndoLogEntry::RemoveLastConstraint: {
+    Unknown &u = cons.back();
+    if (u.orientation == Orientation::Column)
+      moveToRow(u);
+    swapRows(u.pos, numRows - 1);
+    --numRows;
+    tableau.resize(numRows * numColumns);
+    rowUnknown.pop_back();
+    cons.pop_back();
+    return;
+  }
+  }
+}
+
+void Simplex::rollback(unsigned snapshot) {
+  while (undoLog.size() > snapshot) {
+    undo(undoLog.back());
+    undoLog.pop_back();
+  }
+}
+
+Optional<bool> Simplex::isIntegerEmpty(unsigned maxBranches,
+                                       SmallVectorImpl<int64_t> *sample) {
+  if (overflowed)
+    return llvm::None;
+  if (empty)
+    return true;
+
+  SmallVector<int64_t, 8> point;
+  unsigned remainingBranches = maxBranches;
+  Optional<bool> found = findIntegerSample(remainingBranches, point);
+  if (overflowed || !found) {
+    LLVM_DEBUG(llvm::dbgs() << "Simplex: integer emptiness inconclusive\n");
+    return llvm::None;
+  }
+  if (*found && sample)
+    sample->assign(point.begin(), point.end());
+  return !*found;
+}
+
+Optional<bool>
+Simplex::findIntegerSample(unsigned &remainingBranches,
+                           SmallVectorImpl<int64_t> &sample) {
+  if (overflowed)
+    return llvm::None;
+  if (empty)
+    return false;
+
+  // Look for a variable with a fractional sample value. Column unknowns have a
+  // sample value of zero.
+  Optional<unsigned> branchVar;
+  for (unsigned i = 0, e = vars.size(); i < e && !branchVar; ++i) {
+    const Unknown &var = vars[i];
+    if (var.orientation == Orientation::Row &&
+        at(var.pos, 1) % at(var.pos, 0) != 0)
+      branchVar = i;
+  }
+
+  // If there is none, the sample point is an integer point.
+  if (!branchVar) {
+    sample.clear();
+    for (const Unknown &var : vars)
+      sample.push_back(var.orientation == Orientation::Column
+                           ? 0
+                           : at(var.pos, 1) / at(var.pos, 0));
+    return true;
+  }
+
+  if (remainingBranches == 0)
+    return llvm::None;
+  --remainingBranches;
+
+  // Branch on 'x <= floor(v)' and 'x >= ceil(v)', v being the sample value of
+  // the variable.
+  const Unknown &var = vars[*branchVar];
+  int64_t num = at(var.pos, 1), den = at(var.pos, 0);
+  SmallVector<int64_t, 8> bound(vars.size() + 1, 0);
+  bool inconclusive = false;
+  for (Direction direction : {Direction::Down, Direction::Up}) {
+    if (direction == Direction::Down) {
+      bound[*branchVar] = -1;
+      bound.back() = floorDiv(num, den);
+    } else {
+      bound[*branchVar] = 1;
+      bound.back() = -ceilDiv(num, den);
+    }
+
+    unsigned snapshot = getSnapshot();
+    addInequality(bound);
+    Optional<bool> found = findIntegerSample(remainingBranches, sample);
+    rollback(snapshot);
+    if (found && *found)
+      return true;
+    inconclusive |= !found;
+  }
+  if (inconclusive)
+    return llvm::None;
+  return false;
+}
+
+void Simplex::detectRedundant(unsigned offset, unsigned count) {
+  assert(offset + count <= cons.size() && "invalid range of constraints");
+  if (empty || overflowed)
+    return;
+
+  for (unsigned i = offset, e = offset + count; i < e; ++i) {
+    Unknown &u = cons[i];
+    if (!u.restricted)
+      continue;
+
+    // A column unknown has a sample value of zero. If nothing stops it from
+    // decreasing further, the constraint isn't implied by the others.
+    if (u.orientation == Orientation::Column) {
+      Optional<unsigned> row = findPivotRow(llvm::None, Direction::Down, u.pos);
+      if (!row)
+        continue;
+      pivot(*row, u.pos);
+    }
+
+    // The constraint is redundant if its minimum over the other constraints is
+    // non-negative. As the row is skipped by findPivotRow while minimizing it,
+    // it may temporarily become negative.
+    Optional<Fraction> minimum = computeRowOptimum(Direction::Down, u.pos);
+    if (overflowed)
+      return;
+    if (!minimum || minimum->num < 0) {
+      LogicalResult restored = restoreRow(u);
+      if (overflowed)
+        return;
+      if (failed(restored))
+        llvm_unreachable("could not restore a feasible constraint");
+      continue;
+    }
+
+    // Stop restricting the unknown, which removes the constraint from the
+    // system. It remains non-negative at every feasible point.
+    u.restricted = false;
+    u.redundant = true;
+  }
+}
+
+void Simplex::print(raw_ostream &os) const {
+  os << "Simplex: " << vars.size() << " variables, " << cons.size()
+     << " constraints" << (empty ? ", empty" : "")
+     << (overflowed ? ", overflowed" : "") << "\n";
+  auto printUnknown = [&](int index) {
+    if (index >= 0)
+      os << "c" << index;
+    else
+      os << "x" << ~index;
+  };
+  os << "columns:";
+  for (unsigned col = 2; col < numColumns; ++col) {
+    os << " ";
+    printUnknown(colUnknown[col]);
+  }
+  os << "\n";
+  for (unsigned row = 0; row < numRows; ++row) {
+    printUnknown(rowUnknown[row]);
+    os << (unknownFromIndex(rowUnknown[row]).restricted ? " >= 0" : "")
+       << " :";
+    for (unsigned col = 0; col < numColumns; ++col)
+      os << " " << at(row, col);
+    os << "\n";
+  }
+}
+
+void Simplex::dump() const { print(llvm::errs()); }
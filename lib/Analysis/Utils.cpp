@@ -29,6 +29,7 @@
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "analysis-utils"
@@ -304,18 +305,23 @@ LogicalResult MemRefRegion::compute(Operation *op, unsigned loopDepth,
 }
 
 //  TODO(mlir-team): improve/complete this when we have target data.
-static unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
-  auto elementType = memRefType.getElementType();
+unsigned mlir::getMemRefEltSizeInBytes(MemRefType memRefType) {
+  // The sizes are those of the lowering to the LLVM IR dialect: the index type
+  // is 64 bits wide, and LLVM stores integers in the smallest power-of-two
+  // number of bytes that holds them.
+  auto getSizeInBytes = [](Type type) -> unsigned {
+    if (type.isIndex())
+      return 8;
+    if (auto intType = type.dyn_cast<IntegerType>())
+      return llvm::PowerOf2Ceil(llvm::divideCeil(intType.getWidth(), 8));
+    return llvm::divideCeil(type.getIntOrFloatBitWidth(), 8);
+  };
 
-  unsigned sizeInBits;
-  if (elementType.isIntOrFloat()) {
-    sizeInBits = elementType.getIntOrFloatBitWidth();
-  } else {
-    auto vectorType = elementType.cast<VectorType>();
-    sizeInBits =
-        vectorType.getElementTypeBitWidth() * vectorType.getNumElements();
-  }
-  return llvm::divideCeil(sizeInBits, 8);
+  auto elementType = memRefType.getElementType();
+  if (auto vectorType = elementType.dyn_cast<VectorType>())
+    return getSizeInBytes(vectorType.getElementType()) *
+           vectorType.getNumElements();
+  return getSizeInBytes(elementType);
 }
 
 // Returns the size of the region.
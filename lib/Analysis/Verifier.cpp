@@ -181,6 +181,10 @@ LogicalResult FuncVerifier::verify() {
     }
   }
 
+  // A body that failed to materialize was already reported.
+  if (failed(fn.materialize()))
+    return failure();
+
   // External functions have nothing more to check.
   if (fn.isExternal())
     return success();
@@ -0,0 +1,120 @@
+//===- BytecodeFormat.h - MLIR Bytecode Format Definitions ------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines the constants shared by the bytecode reader and writer.
+//
+// A bytecode file is laid out as follows, where every integer is encoded as an
+// unsigned LEB128 varint unless stated otherwise:
+//
+//   file ::= magic version endianness
+//            string-table type-table function-decls
+//            attribute-table location-table function-defs
+//
+// Each table is a count followed by its entries, and entries are referred to
+// by their index in the table.  Entries of the type, attribute and location
+// tables only refer to entries that precede them.  Functions are declared
+// before the attribute table, so that function attributes can refer to them,
+// and defined at the end of the file.  Each function body is prefixed with its
+// size in bytes, allowing it to be skipped and materialized lazily.
+//
+// Within a function body, the values are numbered in the order in which they
+// are defined: the arguments of all of the blocks of a region come first,
+// followed by the results of each operation, before its nested regions.  A use
+// of a value that is not yet defined is followed by the index of its type.
+//
+// The raw data of dense elements attributes is stored as is, padded to whole
+// APInt words and aligned to kDataAlignment bytes relative to the start of the
+// file, so that it can be used in place when the file is memory mapped.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_LIB_BYTECODE_BYTECODEFORMAT_H
+#define MLIR_LIB_BYTECODE_BYTECODEFORMAT_H
+
+#include <cstdint>
+
+namespace mlir {
+namespace bytecode {
+
+/// The magic number at the start of every bytecode file.
+static const char kMagic[] = {'M', 'L', 'I', 'R', 'B', 'C'};
+
+/// The current version of the format.
+static const uint64_t kVersion = 0;
+
+/// The alignment of raw data within the file.
+static const unsigned kDataAlignment = 64;
+
+/// The byte order of raw data, which is stored in the host byte order.
+enum class Endianness : uint8_t { Little, Big };
+
+/// The encodings of type table entries.  Types without a dedicated encoding
+/// are stored in their textual form.
+enum class TypeCode : uint8_t {
+  Text,
+  Integer,
+  Index,
+  BF16,
+  F16,
+  F32,
+  F64,
+  None,
+  Function,
+  Vector,
+  RankedTensor,
+  UnrankedTensor,
+  MemRef,
+  Complex,
+  Tuple,
+};
+
+/// The encodings of attribute table entries.  Attributes without a dedicated
+/// encoding are stored in their textual form.
+enum class AttrCode : uint8_t {
+  Text,
+  Unit,
+  Bool,
+  Integer,
+  Float,
+  String,
+  Type,
+  Array,
+  Function,
+  DenseElements,
+  SplatElements,
+  SparseElements,
+};
+
+/// The encodings of location table entries.
+enum class LocCode : uint8_t {
+  Unknown,
+  FileLineCol,
+  Name,
+  CallSite,
+  Fused,
+};
+
+/// The flags attached to each operation.
+enum OpFlags : uint64_t {
+  /// The operation has a resizable operand list.
+  ResizableOperandList = 0x1,
+};
+
+} // end namespace bytecode
+} // end namespace mlir
+
+#endif // MLIR_LIB_BYTECODE_BYTECODEFORMAT_H
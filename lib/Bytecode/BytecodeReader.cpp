@@ -0,0 +1,949 @@
+//===- BytecodeReader.cpp - MLIR Bytecode Reader --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the reader for the MLIR bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BytecodeFormat.h"
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+namespace {
+/// The tables of a bytecode file.  They are filled in when the module is read,
+/// and are immutable afterwards, such that they can be shared by the lazy
+/// materializers of the function bodies.
+struct BytecodeTables {
+  explicit BytecodeTables(MLIRContext *context) : context(context) {}
+
+  MLIRContext *context;
+  std::vector<StringRef> strings;
+  std::vector<Type> types;
+  std::vector<Attribute> attrs;
+  std::vector<Location> locs;
+  std::vector<Function *> functions;
+};
+
+/// This class decodes the primitive entities of a bytecode buffer.
+class Decoder {
+public:
+  Decoder(const BytecodeTables &tables, StringRef buffer)
+      : tables(tables), context(tables.context), buffer(buffer) {}
+
+  MLIRContext *getContext() const { return context; }
+
+  /// Returns true if the whole buffer has been decoded.
+  bool atEnd() const { return pos == buffer.size(); }
+
+  /// Emit an error about the buffer being malformed, and return failure.
+  LogicalResult emitError(const Twine &message) {
+    return context->emitError(UnknownLoc::get(context),
+                              "malformed bytecode: " + message);
+  }
+
+  LogicalResult parseByte(uint8_t &result);
+  LogicalResult parseBytes(size_t size, StringRef &result);
+  LogicalResult parseVarInt(uint64_t &result);
+  LogicalResult parseSignedVarInt(int64_t &result);
+
+  /// Parse the number of entries of a list.  Every entry is encoded on at least
+  /// one byte, which bounds the count by the size of the remaining buffer.
+  LogicalResult parseCount(uint64_t &result);
+
+  /// Parse an arbitrary precision integer of the given bit width.
+  LogicalResult parseAPInt(unsigned bitWidth, APInt &result);
+
+  /// Skip the padding emitted before aligned data.
+  LogicalResult skipPadding();
+
+  /// Parse a reference to an entry of one of the tables.
+  LogicalResult parseString(StringRef &result) {
+    return parseEntry(tables.strings, result, "string");
+  }
+  LogicalResult parseType(Type &result) {
+    return parseEntry(tables.types, result, "type");
+  }
+  LogicalResult parseAttr(Attribute &result) {
+    return parseEntry(tables.attrs, result, "attribute");
+  }
+  LogicalResult parseLoc(Location &result) {
+    return parseEntry(tables.locs, result, "location");
+  }
+  LogicalResult parseFunction(Function *&result) {
+    return parseEntry(tables.functions, result, "function");
+  }
+
+  /// Parse a list of type references.
+  LogicalResult parseTypeList(SmallVectorImpl<Type> &result);
+
+  /// Parse a list of named attributes.
+  LogicalResult parseAttrList(SmallVectorImpl<NamedAttribute> &result);
+
+private:
+  template <typename T>
+  LogicalResult parseEntry(const std::vector<T> &table, T &result,
+                           StringRef kind) {
+    uint64_t index;
+    if (failed(parseVarInt(index)))
+      return failure();
+    if (index >= table.size())
+      return emitError("invalid " + kind + " index " + Twine(index));
+    result = table[index];
+    return success();
+  }
+
+  const BytecodeTables &tables;
+  MLIRContext *context;
+  StringRef buffer;
+  size_t pos = 0;
+};
+} // end anonymous namespace
+
+LogicalResult Decoder::parseByte(uint8_t &result) {
+  if (atEnd())
+    return emitError("unexpected end of buffer");
+  result = buffer[pos++];
+  return success();
+}
+
+LogicalResult Decoder::parseBytes(size_t size, StringRef &result) {
+  if (size > buffer.size() - pos)
+    return emitError("unexpected end of buffer");
+  result = buffer.substr(pos, size);
+  pos += size;
+  return success();
+}
+
+LogicalResult Decoder::parseVarInt(uint64_t &result) {
+  result = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    uint8_t byte;
+    if (failed(parseByte(byte)))
+      return failure();
+    if (shift > 63 || (shift == 63 && (byte & 0x7e)))
+      return emitError("varint overflows 64 bits");
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return success();
+  }
+}
+
+LogicalResult Decoder::parseSignedVarInt(int64_t &result) {
+  uint64_t value;
+  if (failed(parseVarInt(value)))
+    return failure();
+  // Undo the zigzag encoding.
+  result = static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+  return success();
+}
+
+LogicalResult Decoder::parseCount(uint64_t &result) {
+  if (failed(parseVarInt(result)))
+    return failure();
+  if (result > buffer.size() - pos)
+    return emitError("list size " + Twine(result) + " exceeds the buffer");
+  return success();
+}
+
+LogicalResult Decoder::parseAPInt(unsigned bitWidth, APInt &result) {
+  uint64_t numWords;
+  if (failed(parseVarInt(numWords)))
+    return failure();
+  if (numWords != APInt::getNumWords(bitWidth))
+    return emitError("integer value does not match its bit width");
+
+  SmallVector<uint64_t, 2> words(numWords);
+  for (auto &word : words)
+    if (failed(parseVarInt(word)))
+      return failure();
+  result = APInt(bitWidth, words);
+  return success();
+}
+
+LogicalResult Decoder::skipPadding() {
+  uint8_t padding;
+  StringRef bytes;
+  if (failed(parseByte(padding)) || failed(parseBytes(padding, bytes)))
+    return failure();
+  return success();
+}
+
+LogicalResult Decoder::parseTypeList(SmallVectorImpl<Type> &result) {
+  uint64_t numTypes;
+  if (failed(parseCount(numTypes)))
+    return failure();
+  result.resize(numTypes);
+  for (auto &type : result)
+    if (failed(parseType(type)))
+      return failure();
+  return success();
+}
+
+LogicalResult Decoder::parseAttrList(SmallVectorImpl<NamedAttribute> &result) {
+  uint64_t numAttrs;
+  if (failed(parseCount(numAttrs)))
+    return failure();
+  for (uint64_t i = 0; i != numAttrs; ++i) {
+    StringRef name;
+    Attribute attr;
+    if (failed(parseString(name)) || failed(parseAttr(attr)))
+      return failure();
+    result.emplace_back(Identifier::get(name, context), attr);
+  }
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Function bodies
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// This class reads the body of a single function.
+class FunctionBodyReader {
+public:
+  explicit FunctionBodyReader(Decoder &decoder) : decoder(decoder) {}
+  ~FunctionBodyReader();
+
+  /// Read the body of the given function, which spans the whole buffer of the
+  /// decoder.
+  LogicalResult parseBody(Function *function);
+
+private:
+  LogicalResult parseRegion(Region &region);
+  LogicalResult parseOperation(Block *block, ArrayRef<Block *> blocks);
+  LogicalResult parseValueUse(Value *&result);
+
+  /// Define the next value, resolving any forward reference to it.
+  LogicalResult defineValue(Value *value);
+
+  Decoder &decoder;
+
+  /// The values defined so far, indexed by their id.
+  std::vector<Value *> values;
+
+  /// The placeholders of the values that are used before being defined.
+  llvm::DenseMap<uint64_t, Operation *> forwardRefs;
+};
+} // end anonymous namespace
+
+FunctionBodyReader::~FunctionBodyReader() {
+  // Clean up the placeholders left behind by malformed bodies.
+  for (auto &forwardRef : forwardRefs) {
+    forwardRef.second->getResult(0)->dropAllUses();
+    forwardRef.second->destroy();
+  }
+}
+
+LogicalResult FunctionBodyReader::parseBody(Function *function) {
+  if (failed(parseRegion(function->getBody())))
+    return failure();
+  if (!forwardRefs.empty())
+    return decoder.emitError("use of undefined value in function '" +
+                             function->getName().strref() + "'");
+  if (!decoder.atEnd())
+    return decoder.emitError("unexpected data after the body of function '" +
+                             function->getName().strref() + "'");
+  return success();
+}
+
+LogicalResult FunctionBodyReader::parseRegion(Region &region) {
+  // The blocks, and their arguments, are all defined before the operations.
+  uint64_t numBlocks;
+  if (failed(decoder.parseCount(numBlocks)))
+    return failure();
+  SmallVector<Block *, 4> blocks;
+  for (uint64_t i = 0; i != numBlocks; ++i) {
+    auto *block = new Block();
+    region.push_back(block);
+    blocks.push_back(block);
+
+    SmallVector<Type, 4> argTypes;
+    if (failed(decoder.parseTypeList(argTypes)))
+      return failure();
+    for (Type type : argTypes)
+      if (failed(defineValue(block->addArgument(type))))
+        return failure();
+  }
+
+  for (auto *block : blocks) {
+    uint64_t numOps;
+    if (failed(decoder.parseCount(numOps)))
+      return failure();
+    for (uint64_t i = 0; i != numOps; ++i)
+      if (failed(parseOperation(block, blocks)))
+        return failure();
+  }
+  return success();
+}
+
+LogicalResult FunctionBodyReader::parseOperation(Block *block,
+                                                 ArrayRef<Block *> blocks) {
+  MLIRContext *context = decoder.getContext();
+  StringRef name;
+  Location loc = UnknownLoc::get(context);
+  uint64_t flags;
+  SmallVector<Type, 4> resultTypes;
+  if (failed(decoder.parseString(name)) || failed(decoder.parseLoc(loc)) ||
+      failed(decoder.parseVarInt(flags)) ||
+      failed(decoder.parseTypeList(resultTypes)))
+    return failure();
+
+  // Parse the operands, followed by the successors.  The operands of each
+  // successor are preceded by a null sentinel, as expected by
+  // 'Operation::create'.
+  SmallVector<Value *, 8> operands;
+  uint64_t numOperands;
+  if (failed(decoder.parseCount(numOperands)))
+    return failure();
+  for (uint64_t i = 0; i != numOperands; ++i) {
+    Value *operand;
+    if (failed(parseValueUse(operand)))
+      return failure();
+    operands.push_back(operand);
+  }
+
+  SmallVector<Block *, 2> successors;
+  uint64_t numSuccessors;
+  if (failed(decoder.parseCount(numSuccessors)))
+    return failure();
+  for (uint64_t i = 0; i != numSuccessors; ++i) {
+    uint64_t blockIndex, numSuccessorOperands;
+    if (failed(decoder.parseVarInt(blockIndex)) ||
+        failed(decoder.parseCount(numSuccessorOperands)))
+      return failure();
+    if (blockIndex >= blocks.size())
+      return decoder.emitError("invalid successor index " + Twine(blockIndex));
+    successors.push_back(blocks[blockIndex]);
+
+    operands.push_back(nullptr);
+    for (uint64_t j = 0; j != numSuccessorOperands; ++j) {
+      Value *operand;
+      if (failed(parseValueUse(operand)))
+        return failure();
+      operands.push_back(operand);
+    }
+  }
+
+  SmallVector<NamedAttribute, 4> attrs;
+  uint64_t numRegions;
+  if (failed(decoder.parseAttrList(attrs)) ||
+      failed(decoder.parseCount(numRegions)))
+    return failure();
+
+  auto *op = Operation::create(loc, OperationName(name, context), operands,
+                               resultTypes, attrs, successors, numRegions,
+                               flags & ResizableOperandList, context);
+  block->push_back(op);
+
+  // The results are defined before the nested regions.
+  for (auto *result : op->getResults())
+    if (failed(defineValue(result)))
+      return failure();
+  for (auto &region : op->getRegions())
+    if (failed(parseRegion(region)))
+      return failure();
+  return success();
+}
+
+LogicalResult FunctionBodyReader::parseValueUse(Value *&result) {
+  uint64_t id;
+  if (failed(decoder.parseVarInt(id)))
+    return failure();
+  if (id < values.size()) {
+    result = values[id];
+    return success();
+  }
+
+  // This is a forward reference, which is followed by the type of the value.
+  // It is represented by a placeholder until the value is defined.
+  Type type;
+  if (failed(decoder.parseType(type)))
+    return failure();
+  auto &placeholder = forwardRefs[id];
+  if (!placeholder) {
+    MLIRContext *context = decoder.getContext();
+    placeholder = Operation::create(
+        UnknownLoc::get(context), OperationName("placeholder", context),
+        /*operands=*/{}, type, /*attributes=*/llvm::None,
+        /*successors=*/{}, /*numRegions=*/0,
+        /*resizableOperandList=*/false, context);
+  } else if (placeholder->getResult(0)->getType() != type) {
+    return decoder.emitError("forward reference to value " + Twine(id) +
+                             " used with different types");
+  }
+  result = placeholder->getResult(0);
+  return success();
+}
+
+LogicalResult FunctionBodyReader::defineValue(Value *value) {
+  uint64_t id = values.size();
+  values.push_back(value);
+
+  auto it = forwardRefs.find(id);
+  if (it == forwardRefs.end())
+    return success();
+
+  Operation *placeholder = it->second;
+  forwardRefs.erase(it);
+  Value *placeholderValue = placeholder->getResult(0);
+  if (placeholderValue->getType() != value->getType()) {
+    placeholderValue->dropAllUses();
+    placeholder->destroy();
+    return decoder.emitError("forward reference to value " + Twine(id) +
+                             " does not match the type of its definition");
+  }
+  placeholderValue->replaceAllUsesWith(value);
+  placeholder->destroy();
+  return success();
+}
+
+/// Read the given function body, clearing the partially read body on failure.
+static LogicalResult readFunctionBody(const BytecodeTables &tables,
+                                      Function *function, StringRef body) {
+  Decoder decoder(tables, body);
+  if (succeeded(FunctionBodyReader(decoder).parseBody(function)))
+    return success();
+
+  for (auto &block : *function)
+    block.dropAllReferences();
+  function->getBlocks().clear();
+  return failure();
+}
+
+//===----------------------------------------------------------------------===//
+// Modules
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// This class reads a module from a bytecode buffer.
+class BytecodeReader {
+public:
+  BytecodeReader(StringRef buffer, MLIRContext *context, bool lazy,
+                 bool externalData)
+      : tables(std::make_shared<BytecodeTables>(context)),
+        decoder(*tables, buffer), context(context), lazy(lazy),
+        externalData(externalData) {}
+
+  /// Read the module, returning null on failure.
+  Module *read();
+
+private:
+  LogicalResult parseHeader();
+  LogicalResult parseStringTable();
+  LogicalResult parseTypeTable();
+  LogicalResult parseFunctionDecls(Module *module);
+  LogicalResult parseAttrTable();
+  LogicalResult parseLocTable();
+  LogicalResult parseFunctionDefs();
+
+  Type parseTypeEntry();
+  Attribute parseAttrEntry();
+  LogicalResult parseLocEntry(Location &result);
+
+  std::shared_ptr<BytecodeTables> tables;
+  Decoder decoder;
+  MLIRContext *context;
+  bool lazy;
+
+  /// Whether the buffer outlives the context, in which case the raw data of
+  /// dense elements attributes is referred to in place.
+  bool externalData;
+};
+} // end anonymous namespace
+
+Module *BytecodeReader::read() {
+  std::unique_ptr<Module> module(new Module(context));
+  if (failed(parseHeader()) || failed(parseStringTable()) ||
+      failed(parseTypeTable()) || failed(parseFunctionDecls(module.get())) ||
+      failed(parseAttrTable()) || failed(parseLocTable()) ||
+      failed(parseFunctionDefs()))
+    return nullptr;
+  if (!decoder.atEnd()) {
+    decoder.emitError("unexpected data after the last function");
+    return nullptr;
+  }
+
+  // The bodies of a lazily loaded module are verified by their materializers,
+  // as verifying the module would materialize all of them.
+  if (!lazy && failed(module->verify()))
+    return nullptr;
+  return module.release();
+}
+
+LogicalResult BytecodeReader::parseHeader() {
+  StringRef magic;
+  if (failed(decoder.parseBytes(sizeof(kMagic), magic)))
+    return failure();
+  if (magic != StringRef(kMagic, sizeof(kMagic)))
+    return decoder.emitError("invalid magic number");
+
+  uint64_t version;
+  if (failed(decoder.parseVarInt(version)))
+    return failure();
+  if (version != kVersion)
+    return decoder.emitError("unsupported version " + Twine(version));
+
+  uint8_t endianness;
+  if (failed(decoder.parseByte(endianness)))
+    return failure();
+  auto hostEndianness =
+      llvm::sys::IsBigEndianHost ? Endianness::Big : Endianness::Little;
+  if (endianness != static_cast<uint8_t>(hostEndianness))
+    return decoder.emitError("byte order does not match the host");
+  return success();
+}
+
+LogicalResult BytecodeReader::parseStringTable() {
+  uint64_t numStrings;
+  if (failed(decoder.parseCount(numStrings)))
+    return failure();
+  tables->strings.reserve(numStrings);
+  for (uint64_t i = 0; i != numStrings; ++i) {
+    uint64_t size;
+    StringRef str;
+    if (failed(decoder.parseVarInt(size)) ||
+        failed(decoder.parseBytes(size, str)))
+      return failure();
+    tables->strings.push_back(str);
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::parseTypeTable() {
+  uint64_t numTypes;
+  if (failed(decoder.parseCount(numTypes)))
+    return failure();
+  tables->types.reserve(numTypes);
+  for (uint64_t i = 0; i != numTypes; ++i) {
+    Type type = parseTypeEntry();
+    if (!type)
+      return failure();
+    tables->types.push_back(type);
+  }
+  return success();
+}
+
+Type BytecodeReader::parseTypeEntry() {
+  auto loc = UnknownLoc::get(context);
+  auto parseShape = [&](SmallVectorImpl<int64_t> &shape) {
+    uint64_t rank;
+    if (failed(decoder.parseCount(rank)))
+      return failure();
+    shape.resize(rank);
+    for (auto &dim : shape)
+      if (failed(decoder.parseSignedVarInt(dim)))
+        return failure();
+    return success();
+  };
+
+  uint8_t code;
+  if (failed(decoder.parseByte(code)))
+    return {};
+  switch (static_cast<TypeCode>(code)) {
+  case TypeCode::Text: {
+    StringRef text;
+    if (failed(decoder.parseString(text)))
+      return {};
+    return mlir::parseType(text, context);
+  }
+  case TypeCode::Integer: {
+    uint64_t width;
+    if (failed(decoder.parseVarInt(width)))
+      return {};
+    if (width > IntegerType::kMaxWidth)
+      return (decoder.emitError("invalid integer width " + Twine(width)),
+              Type());
+    return IntegerType::getChecked(width, context, loc);
+  }
+  case TypeCode::Index:
+    return IndexType::get(context);
+  case TypeCode::BF16:
+    return FloatType::getBF16(context);
+  case TypeCode::F16:
+    return FloatType::getF16(context);
+  case TypeCode::F32:
+    return FloatType::getF32(context);
+  case TypeCode::F64:
+    return FloatType::getF64(context);
+  case TypeCode::None:
+    return NoneType::get(context);
+  case TypeCode::Function: {
+    SmallVector<Type, 4> inputs, results;
+    if (failed(decoder.parseTypeList(inputs)) ||
+        failed(decoder.parseTypeList(results)))
+      return {};
+    return FunctionType::get(inputs, results, context);
+  }
+  case TypeCode::Vector:
+  case TypeCode::RankedTensor: {
+    SmallVector<int64_t, 4> shape;
+    Type elementType;
+    if (failed(parseShape(shape)) || failed(decoder.parseType(elementType)))
+      return {};
+    if (static_cast<TypeCode>(code) == TypeCode::Vector)
+      return VectorType::getChecked(shape, elementType, loc);
+    return RankedTensorType::getChecked(shape, elementType, loc);
+  }
+  case TypeCode::UnrankedTensor: {
+    Type elementType;
+    if (failed(decoder.parseType(elementType)))
+      return {};
+    return UnrankedTensorType::getChecked(elementType, loc);
+  }
+  case TypeCode::MemRef: {
+    SmallVector<int64_t, 4> shape;
+    Type elementType;
+    uint64_t numMaps, memorySpace;
+    if (failed(parseShape(shape)) || failed(decoder.parseType(elementType)) ||
+        failed(decoder.parseCount(numMaps)))
+      return {};
+    SmallVector<AffineMap, 2> maps;
+    for (uint64_t i = 0; i != numMaps; ++i) {
+      StringRef text;
+      if (failed(decoder.parseString(text)))
+        return {};
+      auto mapAttr =
+          mlir::parseAttribute(text, context).dyn_cast_or_null<AffineMapAttr>();
+      if (!mapAttr)
+        return (decoder.emitError("invalid memref layout map"), Type());
+      maps.push_back(mapAttr.getValue());
+    }
+    if (failed(decoder.parseVarInt(memorySpace)))
+      return {};
+    return MemRefType::getChecked(shape, elementType, maps, memorySpace, loc);
+  }
+  case TypeCode::Complex: {
+    Type elementType;
+    if (failed(decoder.parseType(elementType)))
+      return {};
+    return ComplexType::getChecked(elementType, loc);
+  }
+  case TypeCode::Tuple: {
+    SmallVector<Type, 4> elementTypes;
+    if (failed(decoder.parseTypeList(elementTypes)))
+      return {};
+    return TupleType::get(elementTypes, context);
+  }
+  }
+  return (decoder.emitError("invalid type code " + Twine(code)), Type());
+}
+
+LogicalResult BytecodeReader::parseFunctionDecls(Module *module) {
+  uint64_t numFunctions;
+  if (failed(decoder.parseCount(numFunctions)))
+    return failure();
+  tables->functions.reserve(numFunctions);
+  for (uint64_t i = 0; i != numFunctions; ++i) {
+    StringRef name;
+    Type type;
+    if (failed(decoder.parseString(name)) || failed(decoder.parseType(type)))
+      return failure();
+    auto fnType = type.dyn_cast<FunctionType>();
+    if (!fnType)
+      return decoder.emitError("invalid type of function '" + name + "'");
+
+    auto *function = new Function(UnknownLoc::get(context), name, fnType);
+    module->getFunctions().push_back(function);
+    if (function->getName() != name)
+      return decoder.emitError("redefinition of function '" + name + "'");
+    tables->functions.push_back(function);
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::parseAttrTable() {
+  uint64_t numAttrs;
+  if (failed(decoder.parseCount(numAttrs)) || failed(decoder.skipPadding()))
+    return failure();
+  tables->attrs.reserve(numAttrs);
+  for (uint64_t i = 0; i != numAttrs; ++i) {
+    Attribute attr = parseAttrEntry();
+    if (!attr)
+      return failure();
+    tables->attrs.push_back(attr);
+  }
+  return success();
+}
+
+Attribute BytecodeReader::parseAttrEntry() {
+  uint8_t code;
+  if (failed(decoder.parseByte(code)))
+    return {};
+  switch (static_cast<AttrCode>(code)) {
+  case AttrCode::Text: {
+    StringRef text;
+    if (failed(decoder.parseString(text)))
+      return {};
+    return mlir::parseAttribute(text, context);
+  }
+  case AttrCode::Unit:
+    return UnitAttr::get(context);
+  case AttrCode::Bool: {
+    uint8_t value;
+    if (failed(decoder.parseByte(value)))
+      return {};
+    return BoolAttr::get(value, context);
+  }
+  case AttrCode::Integer: {
+    Type type;
+    APInt value;
+    if (failed(decoder.parseType(type)))
+      return {};
+    if (!type.isIntOrIndex())
+      return (decoder.emitError("invalid integer attribute type"), Attribute());
+    unsigned width = type.isIndex() ? 64 : type.getIntOrFloatBitWidth();
+    if (failed(decoder.parseAPInt(width, value)))
+      return {};
+    return IntegerAttr::get(type, value);
+  }
+  case AttrCode::Float: {
+    Type type;
+    APInt value;
+    if (failed(decoder.parseType(type)))
+      return {};
+    auto floatType = type.dyn_cast<FloatType>();
+    if (!floatType)
+      return (decoder.emitError("invalid float attribute type"), Attribute());
+    auto &semantics = floatType.getFloatSemantics();
+    if (failed(decoder.parseAPInt(APFloat::semanticsSizeInBits(semantics),
+                                  value)))
+      return {};
+    return FloatAttr::get(type, APFloat(semantics, value));
+  }
+  case AttrCode::String: {
+    StringRef value;
+    if (failed(decoder.parseString(value)))
+      return {};
+    return StringAttr::get(value, context);
+  }
+  case AttrCode::Type: {
+    Type type;
+    if (failed(decoder.parseType(type)))
+      return {};
+    return TypeAttr::get(type, context);
+  }
+  case AttrCode::Array: {
+    uint64_t numElements;
+    if (failed(decoder.parseCount(numElements)))
+      return {};
+    SmallVector<Attribute, 4> elements(numElements);
+    for (auto &element : elements)
+      if (failed(decoder.parseAttr(element)))
+        return {};
+    return ArrayAttr::get(elements, context);
+  }
+  case AttrCode::Function: {
+    Function *function;
+    if (failed(decoder.parseFunction(function)))
+      return {};
+    return FunctionAttr::get(function, context);
+  }
+  case AttrCode::DenseElements: {
+    Type type;
+    uint64_t size;
+    StringRef data;
+    if (failed(decoder.parseType(type)) || failed(decoder.parseVarInt(size)) ||
+        failed(decoder.skipPadding()) || failed(decoder.parseBytes(size, data)))
+      return {};
+    auto shapedType = type.dyn_cast<VectorOrTensorType>();
+    if (!shapedType || !shapedType.hasStaticShape() ||
+        !shapedType.getElementType().isIntOrFloat())
+      return (decoder.emitError("invalid dense elements type"), Attribute());
+    if (static_cast<uint64_t>(shapedType.getSizeInBits()) > size * 8)
+      return (decoder.emitError("dense elements data is too small"),
+              Attribute());
+    auto address = reinterpret_cast<uintptr_t>(data.data());
+    if (externalData && address % APInt::APINT_WORD_SIZE == 0 &&
+        size % APInt::APINT_WORD_SIZE == 0)
+      return DenseElementsAttr::getFromExternalData(
+          shapedType, {data.data(), data.size()});
+    return DenseElementsAttr::get(shapedType, {data.data(), data.size()});
+  }
+  case AttrCode::SplatElements: {
+    Type type;
+    Attribute value;
+    if (failed(decoder.parseType(type)) || failed(decoder.parseAttr(value)))
+      return {};
+    auto shapedType = type.dyn_cast<VectorOrTensorType>();
+    if (!shapedType)
+      return (decoder.emitError("invalid splat elements type"), Attribute());
+    return SplatElementsAttr::get(shapedType, value);
+  }
+  case AttrCode::SparseElements: {
+    Type type;
+    Attribute indices, values;
+    if (failed(decoder.parseType(type)) || failed(decoder.parseAttr(indices)) ||
+        failed(decoder.parseAttr(values)))
+      return {};
+    auto shapedType = type.dyn_cast<VectorOrTensorType>();
+    if (!shapedType || !indices.isa<DenseIntElementsAttr>() ||
+        !values.isa<DenseElementsAttr>())
+      return (decoder.emitError("invalid sparse elements attribute"),
+              Attribute());
+    return SparseElementsAttr::get(shapedType,
+                                   indices.cast<DenseIntElementsAttr>(),
+                                   values.cast<DenseElementsAttr>());
+  }
+  }
+  return (decoder.emitError("invalid attribute code " + Twine(code)),
+          Attribute());
+}
+
+LogicalResult BytecodeReader::parseLocTable() {
+  uint64_t numLocs;
+  if (failed(decoder.parseCount(numLocs)))
+    return failure();
+  tables->locs.reserve(numLocs);
+  for (uint64_t i = 0; i != numLocs; ++i) {
+    Location loc = UnknownLoc::get(context);
+    if (failed(parseLocEntry(loc)))
+      return failure();
+    tables->locs.push_back(loc);
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::parseLocEntry(Location &result) {
+  uint8_t code;
+  if (failed(decoder.parseByte(code)))
+    return failure();
+  switch (static_cast<LocCode>(code)) {
+  case LocCode::Unknown:
+    result = UnknownLoc::get(context);
+    return success();
+  case LocCode::FileLineCol: {
+    StringRef filename;
+    uint64_t line, column;
+    if (failed(decoder.parseString(filename)) ||
+        failed(decoder.parseVarInt(line)) ||
+        failed(decoder.parseVarInt(column)))
+      return failure();
+    result = FileLineColLoc::get(UniquedFilename::get(filename, context), line,
+                                 column, context);
+    return success();
+  }
+  case LocCode::Name: {
+    StringRef name;
+    if (failed(decoder.parseString(name)))
+      return failure();
+    result = NameLoc::get(Identifier::get(name, context), context);
+    return success();
+  }
+  case LocCode::CallSite: {
+    Location callee = result, caller = result;
+    if (failed(decoder.parseLoc(callee)) || failed(decoder.parseLoc(caller)))
+      return failure();
+    result = CallSiteLoc::get(callee, caller, context);
+    return success();
+  }
+  case LocCode::Fused: {
+    uint64_t numLocs, metadataID;
+    if (failed(decoder.parseCount(numLocs)))
+      return failure();
+    SmallVector<Location, 4> locs(numLocs, result);
+    for (auto &loc : locs)
+      if (failed(decoder.parseLoc(loc)))
+        return failure();
+
+    // The metadata is optional, it is encoded as its index plus one.
+    if (failed(decoder.parseVarInt(metadataID)))
+      return failure();
+    Attribute metadata;
+    if (metadataID != 0) {
+      if (metadataID > tables->attrs.size())
+        return decoder.emitError("invalid attribute index " +
+                                 Twine(metadataID - 1));
+      metadata = tables->attrs[metadataID - 1];
+    }
+    result = FusedLoc::get(locs, metadata, context);
+    return success();
+  }
+  }
+  return decoder.emitError("invalid location code " + Twine(code));
+}
+
+LogicalResult BytecodeReader::parseFunctionDefs() {
+  for (auto *function : tables->functions) {
+    Location loc = UnknownLoc::get(context);
+    SmallVector<NamedAttribute, 4> attrs;
+    if (failed(decoder.parseLoc(loc)) || failed(decoder.parseAttrList(attrs)))
+      return failure();
+    function->setLoc(loc);
+    function->setAttrs(attrs);
+    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
+      SmallVector<NamedAttribute, 4> argAttrs;
+      if (failed(decoder.parseAttrList(argAttrs)))
+        return failure();
+      function->setArgAttrs(i, argAttrs);
+    }
+
+    // An empty body denotes an external function.
+    uint64_t bodySize;
+    StringRef body;
+    if (failed(decoder.parseVarInt(bodySize)) ||
+        failed(decoder.parseBytes(bodySize, body)))
+      return failure();
+    if (body.empty())
+      continue;
+
+    if (lazy) {
+      // The materializer keeps the tables alive until the body is read.  The
+      // body is verified as soon as it is read, like the bodies of the modules
+      // that are not loaded lazily.
+      auto bodyTables = tables;
+      function->setBodyMaterializer(
+          [bodyTables, body](Function *function) -> LogicalResult {
+            if (failed(readFunctionBody(*bodyTables, function, body)))
+              return function->emitError(
+                  "could not materialize the body of function @" +
+                  function->getName().strref());
+            return function->verify();
+          });
+      continue;
+    }
+    if (failed(readFunctionBody(*tables, function, body)))
+      return failure();
+  }
+  return success();
+}
+
+bool mlir::isBytecode(StringRef buffer) {
+  return buffer.startswith(StringRef(kMagic, sizeof(kMagic)));
+}
+
+Module *mlir::readBytecode(StringRef buffer, MLIRContext *context, bool lazy) {
+  return BytecodeReader(buffer, context, lazy, /*externalData=*/false).read();
+}
+
+Module *mlir::readBytecode(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                           MLIRContext *context, bool lazy) {
+  StringRef data = buffer->getBuffer();
+  context->retainBuffer(std::move(buffer));
+  return BytecodeReader(data, context, lazy, /*externalData=*/true).read();
+}
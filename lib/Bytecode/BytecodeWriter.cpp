@@ -0,0 +1,637 @@
+//===- BytecodeWriter.cpp - MLIR Bytecode Writer --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the writer for the MLIR bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BytecodeFormat.h"
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+namespace {
+/// This class is a buffer that bytecode is encoded into.
+class EncodingBuffer {
+public:
+  void emitByte(uint8_t byte) { buffer.push_back(byte); }
+
+  void emitBytes(ArrayRef<char> bytes) {
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+  }
+  void emitBytes(StringRef bytes) {
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+  }
+
+  /// Emit an unsigned LEB128 varint.
+  void emitVarInt(uint64_t value) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      if (value)
+        byte |= 0x80;
+      emitByte(byte);
+    } while (value);
+  }
+
+  /// Emit a signed varint, using a zigzag encoding so that small negative
+  /// values remain small.
+  void emitSignedVarInt(int64_t value) {
+    emitVarInt((static_cast<uint64_t>(value) << 1) ^
+               static_cast<uint64_t>(value >> 63));
+  }
+
+  /// Emit the given arbitrary precision integer as its list of words.
+  void emitAPInt(const APInt &value) {
+    emitVarInt(value.getNumWords());
+    for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+      emitVarInt(value.getRawData()[i]);
+  }
+
+  /// Emit padding such that the next byte is aligned to 'alignment', relative
+  /// to the start of the buffer.  The padding is prefixed by its size, which is
+  /// always encoded on a single byte.
+  void emitPadding(unsigned alignment) {
+    static_assert(kDataAlignment < 0x80, "padding size must fit in one byte");
+    unsigned padding = alignment - (size() + 1) % alignment;
+    if (padding == alignment)
+      padding = 0;
+    emitByte(padding);
+    emitZeros(padding);
+  }
+
+  void emitZeros(size_t count) { buffer.resize(buffer.size() + count); }
+
+  size_t size() const { return buffer.size(); }
+  ArrayRef<char> getData() const { return buffer; }
+
+private:
+  std::vector<char> buffer;
+};
+
+/// This class holds the state of the module being written: the uniqued tables
+/// of strings, types, attributes and locations.
+class BytecodeWriter {
+public:
+  explicit BytecodeWriter(Module *module);
+
+  /// Write the module to the given stream.
+  void write(raw_ostream &os);
+
+private:
+  /// Return the index of the given entity within its table, inserting it if
+  /// necessary.
+  unsigned getStringID(StringRef str);
+  unsigned getTypeID(Type type);
+  unsigned getAttrID(Attribute attr);
+  unsigned getLocID(Location loc);
+
+  /// Encode the entry of the given entity within its table.
+  void encodeType(Type type, EncodingBuffer &enc);
+  void encodeAttr(Attribute attr, EncodingBuffer &enc);
+  void encodeLoc(Location loc, EncodingBuffer &enc);
+
+  /// Encode a list of named attributes.
+  void encodeAttrList(ArrayRef<NamedAttribute> attrs, EncodingBuffer &enc);
+
+  /// Encode the definition of a function, i.e. its location, attributes and
+  /// body.
+  void encodeFunction(Function &function, EncodingBuffer &enc);
+
+  /// Number the values of the given region, in the order in which they are
+  /// defined within the bytecode.
+  void numberValues(Region &region);
+
+  /// Encode the body of a region.
+  void encodeRegion(Region &region, EncodingBuffer &enc);
+  void encodeOperation(Operation &op, EncodingBuffer &enc);
+  void encodeValueUse(Value *value, EncodingBuffer &enc);
+
+  /// The module being written.
+  Module *module;
+
+  /// The uniqued tables, and their encoded entries.
+  llvm::StringMap<unsigned> strings;
+  std::vector<StringRef> stringTable;
+  DenseMap<Type, unsigned> types;
+  EncodingBuffer typeTable;
+  DenseMap<Attribute, unsigned> attrs;
+  EncodingBuffer attrTable;
+  DenseMap<Location, unsigned> locs;
+  EncodingBuffer locTable;
+
+  /// The index of each function of the module.
+  DenseMap<Function *, unsigned> functionIDs;
+
+  /// The numbering of the values and blocks of the function being encoded.
+  DenseMap<Value *, unsigned> valueIDs;
+  DenseMap<Block *, unsigned> blockIDs;
+  unsigned nextValueID = 0;
+
+  /// The number of values defined so far while encoding the current function.
+  /// A use of a value with an id greater than this is a forward reference.
+  unsigned numDefinedValues = 0;
+};
+} // end anonymous namespace
+
+BytecodeWriter::BytecodeWriter(Module *module) : module(module) {
+  for (auto &function : *module)
+    functionIDs.try_emplace(&function, functionIDs.size());
+}
+
+unsigned BytecodeWriter::getStringID(StringRef str) {
+  auto it = strings.try_emplace(str, stringTable.size());
+  if (it.second)
+    stringTable.push_back(it.first->getKey());
+  return it.first->second;
+}
+
+unsigned BytecodeWriter::getTypeID(Type type) {
+  auto it = types.find(type);
+  if (it != types.end())
+    return it->second;
+
+  // Encode the type first, so that the types it refers to precede it in the
+  // table.
+  encodeType(type, typeTable);
+  unsigned id = types.size();
+  types[type] = id;
+  return id;
+}
+
+unsigned BytecodeWriter::getAttrID(Attribute attr) {
+  auto it = attrs.find(attr);
+  if (it != attrs.end())
+    return it->second;
+
+  encodeAttr(attr, attrTable);
+  unsigned id = attrs.size();
+  attrs[attr] = id;
+  return id;
+}
+
+unsigned BytecodeWriter::getLocID(Location loc) {
+  auto it = locs.find(loc);
+  if (it != locs.end())
+    return it->second;
+
+  encodeLoc(loc, locTable);
+  unsigned id = locs.size();
+  locs[loc] = id;
+  return id;
+}
+
+void BytecodeWriter::encodeType(Type type, EncodingBuffer &enc) {
+  // Compute the ids of the nested types before the entry of this type is
+  // started, as they are encoded in the same table.
+  auto getTypeIDs = [&](ArrayRef<Type> typeList) {
+    SmallVector<unsigned, 4> ids;
+    for (Type elementType : typeList)
+      ids.push_back(getTypeID(elementType));
+    return ids;
+  };
+  auto emitIDs = [&](ArrayRef<unsigned> ids) {
+    enc.emitVarInt(ids.size());
+    for (unsigned id : ids)
+      enc.emitVarInt(id);
+  };
+  auto emitShape = [&](ArrayRef<int64_t> shape) {
+    enc.emitVarInt(shape.size());
+    for (int64_t dim : shape)
+      enc.emitSignedVarInt(dim);
+  };
+
+  switch (type.getKind()) {
+  case StandardTypes::Integer:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Integer));
+    enc.emitVarInt(type.cast<IntegerType>().getWidth());
+    return;
+  case StandardTypes::Index:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Index));
+    return;
+  case StandardTypes::BF16:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::BF16));
+    return;
+  case StandardTypes::F16:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::F16));
+    return;
+  case StandardTypes::F32:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::F32));
+    return;
+  case StandardTypes::F64:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::F64));
+    return;
+  case StandardTypes::None:
+    enc.emitByte(static_cast<uint8_t>(TypeCode::None));
+    return;
+  case Type::Kind::Function: {
+    auto fnType = type.cast<FunctionType>();
+    auto inputs = getTypeIDs(fnType.getInputs());
+    auto results = getTypeIDs(fnType.getResults());
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Function));
+    emitIDs(inputs);
+    emitIDs(results);
+    return;
+  }
+  case StandardTypes::Vector:
+  case StandardTypes::RankedTensor: {
+    auto shapedType = type.cast<VectorOrTensorType>();
+    unsigned eltType = getTypeID(shapedType.getElementType());
+    enc.emitByte(static_cast<uint8_t>(type.isa<VectorType>()
+                                          ? TypeCode::Vector
+                                          : TypeCode::RankedTensor));
+    emitShape(shapedType.getShape());
+    enc.emitVarInt(eltType);
+    return;
+  }
+  case StandardTypes::UnrankedTensor: {
+    unsigned eltType =
+        getTypeID(type.cast<UnrankedTensorType>().getElementType());
+    enc.emitByte(static_cast<uint8_t>(TypeCode::UnrankedTensor));
+    enc.emitVarInt(eltType);
+    return;
+  }
+  case StandardTypes::MemRef: {
+    auto memrefType = type.cast<MemRefType>();
+    unsigned eltType = getTypeID(memrefType.getElementType());
+    // The layout maps are stored in their textual form, as the attribute
+    // table follows the type table.
+    SmallVector<unsigned, 2> maps;
+    for (AffineMap map : memrefType.getAffineMaps()) {
+      std::string text;
+      llvm::raw_string_ostream os(text);
+      map.print(os);
+      maps.push_back(getStringID(os.str()));
+    }
+    enc.emitByte(static_cast<uint8_t>(TypeCode::MemRef));
+    emitShape(memrefType.getShape());
+    enc.emitVarInt(eltType);
+    emitIDs(maps);
+    enc.emitVarInt(memrefType.getMemorySpace());
+    return;
+  }
+  case StandardTypes::Complex: {
+    unsigned eltType = getTypeID(type.cast<ComplexType>().getElementType());
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Complex));
+    enc.emitVarInt(eltType);
+    return;
+  }
+  case StandardTypes::Tuple: {
+    auto elements = getTypeIDs(type.cast<TupleType>().getTypes());
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Tuple));
+    emitIDs(elements);
+    return;
+  }
+  default: {
+    // Any other type, e.g. a dialect type, is stored in its textual form.
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    type.print(os);
+    unsigned textID = getStringID(os.str());
+    enc.emitByte(static_cast<uint8_t>(TypeCode::Text));
+    enc.emitVarInt(textID);
+    return;
+  }
+  }
+}
+
+void BytecodeWriter::encodeAttr(Attribute attr, EncodingBuffer &enc) {
+  switch (attr.getKind()) {
+  case Attribute::Kind::Unit:
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Unit));
+    return;
+  case Attribute::Kind::Bool:
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Bool));
+    enc.emitByte(attr.cast<BoolAttr>().getValue());
+    return;
+  case Attribute::Kind::Integer: {
+    unsigned type = getTypeID(attr.getType());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Integer));
+    enc.emitVarInt(type);
+    enc.emitAPInt(attr.cast<IntegerAttr>().getValue());
+    return;
+  }
+  case Attribute::Kind::Float: {
+    // Floats are stored as their bit pattern, which avoids any rounding.
+    unsigned type = getTypeID(attr.getType());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Float));
+    enc.emitVarInt(type);
+    enc.emitAPInt(attr.cast<FloatAttr>().getValue().bitcastToAPInt());
+    return;
+  }
+  case Attribute::Kind::String: {
+    unsigned str = getStringID(attr.cast<StringAttr>().getValue());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::String));
+    enc.emitVarInt(str);
+    return;
+  }
+  case Attribute::Kind::Type: {
+    unsigned type = getTypeID(attr.cast<TypeAttr>().getValue());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Type));
+    enc.emitVarInt(type);
+    return;
+  }
+  case Attribute::Kind::Array: {
+    SmallVector<unsigned, 4> elements;
+    for (Attribute elt : attr.cast<ArrayAttr>())
+      elements.push_back(getAttrID(elt));
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Array));
+    enc.emitVarInt(elements.size());
+    for (unsigned elt : elements)
+      enc.emitVarInt(elt);
+    return;
+  }
+  case Attribute::Kind::Function: {
+    auto it = functionIDs.find(attr.cast<FunctionAttr>().getValue());
+    assert(it != functionIDs.end() &&
+           "function attribute refers to a function outside of the module");
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Function));
+    enc.emitVarInt(it->second);
+    return;
+  }
+  case Attribute::Kind::DenseIntElements:
+  case Attribute::Kind::DenseFPElements: {
+    auto denseAttr = attr.cast<DenseElementsAttr>();
+    unsigned type = getTypeID(denseAttr.getType());
+    ArrayRef<char> data = denseAttr.getRawData();
+    // The data is padded to a whole number of APInt words, so that the reader
+    // can refer to it in place.
+    size_t size = llvm::alignTo(data.size(), APInt::APINT_WORD_SIZE);
+    enc.emitByte(static_cast<uint8_t>(AttrCode::DenseElements));
+    enc.emitVarInt(type);
+    enc.emitVarInt(size);
+    enc.emitPadding(kDataAlignment);
+    enc.emitBytes(data);
+    enc.emitZeros(size - data.size());
+    return;
+  }
+  case Attribute::Kind::SplatElements: {
+    auto splatAttr = attr.cast<SplatElementsAttr>();
+    unsigned type = getTypeID(splatAttr.getType());
+    unsigned value = getAttrID(splatAttr.getValue());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::SplatElements));
+    enc.emitVarInt(type);
+    enc.emitVarInt(value);
+    return;
+  }
+  case Attribute::Kind::SparseElements: {
+    auto sparseAttr = attr.cast<SparseElementsAttr>();
+    unsigned type = getTypeID(sparseAttr.getType());
+    unsigned indices = getAttrID(sparseAttr.getIndices());
+    unsigned values = getAttrID(sparseAttr.getValues());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::SparseElements));
+    enc.emitVarInt(type);
+    enc.emitVarInt(indices);
+    enc.emitVarInt(values);
+    return;
+  }
+  default: {
+    // Any other attribute, e.g. an affine map, is stored in its textual form.
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    attr.print(os);
+    unsigned textID = getStringID(os.str());
+    enc.emitByte(static_cast<uint8_t>(AttrCode::Text));
+    enc.emitVarInt(textID);
+    return;
+  }
+  }
+}
+
+void BytecodeWriter::encodeLoc(Location loc, EncodingBuffer &enc) {
+  switch (loc.getKind()) {
+  case Location::Kind::Unknown:
+    enc.emitByte(static_cast<uint8_t>(LocCode::Unknown));
+    return;
+  case Location::Kind::FileLineCol: {
+    auto fileLoc = loc.cast<FileLineColLoc>();
+    unsigned filename = getStringID(fileLoc.getFilename());
+    enc.emitByte(static_cast<uint8_t>(LocCode::FileLineCol));
+    enc.emitVarInt(filename);
+    enc.emitVarInt(fileLoc.getLine());
+    enc.emitVarInt(fileLoc.getColumn());
+    return;
+  }
+  case Location::Kind::Name: {
+    unsigned name = getStringID(loc.cast<NameLoc>().getName());
+    enc.emitByte(static_cast<uint8_t>(LocCode::Name));
+    enc.emitVarInt(name);
+    return;
+  }
+  case Location::Kind::CallSite: {
+    auto callLoc = loc.cast<CallSiteLoc>();
+    unsigned callee = getLocID(callLoc.getCallee());
+    unsigned caller = getLocID(callLoc.getCaller());
+    enc.emitByte(static_cast<uint8_t>(LocCode::CallSite));
+    enc.emitVarInt(callee);
+    enc.emitVarInt(caller);
+    return;
+  }
+  case Location::Kind::FusedLocation: {
+    auto fusedLoc = loc.cast<FusedLoc>();
+    SmallVector<unsigned, 4> fusedLocs;
+    for (Location subLoc : fusedLoc.getLocations())
+      fusedLocs.push_back(getLocID(subLoc));
+
+    // The metadata is optional, it is encoded as its index plus one.
+    Attribute metadata = fusedLoc.getMetadata();
+    unsigned metadataID = metadata ? getAttrID(metadata) + 1 : 0;
+    enc.emitByte(static_cast<uint8_t>(LocCode::Fused));
+    enc.emitVarInt(fusedLocs.size());
+    for (unsigned subLoc : fusedLocs)
+      enc.emitVarInt(subLoc);
+    enc.emitVarInt(metadataID);
+    return;
+  }
+  }
+}
+
+void BytecodeWriter::encodeAttrList(ArrayRef<NamedAttribute> attrs,
+                                    EncodingBuffer &enc) {
+  enc.emitVarInt(attrs.size());
+  for (auto &namedAttr : attrs) {
+    enc.emitVarInt(getStringID(namedAttr.first));
+    enc.emitVarInt(getAttrID(namedAttr.second));
+  }
+}
+
+void BytecodeWriter::encodeFunction(Function &function, EncodingBuffer &enc) {
+  enc.emitVarInt(getLocID(function.getLoc()));
+  encodeAttrList(function.getAttrs(), enc);
+  for (unsigned i = 0, e = function.getNumArguments(); i != e; ++i)
+    encodeAttrList(function.getArgAttrs(i), enc);
+
+  // External functions have an empty body.
+  if (function.isExternal()) {
+    enc.emitVarInt(0);
+    return;
+  }
+
+  // Encode the body separately, as it is prefixed with its size.
+  valueIDs.clear();
+  blockIDs.clear();
+  nextValueID = numDefinedValues = 0;
+  numberValues(function.getBody());
+
+  EncodingBuffer body;
+  encodeRegion(function.getBody(), body);
+  enc.emitVarInt(body.size());
+  enc.emitBytes(body.getData());
+}
+
+void BytecodeWriter::numberValues(Region &region) {
+  // This must follow the order in which 'encodeRegion' defines the values.
+  for (auto &block : region) {
+    blockIDs.try_emplace(&block, blockIDs.size());
+    for (auto *arg : block.getArguments())
+      valueIDs[arg] = nextValueID++;
+  }
+  for (auto &block : region) {
+    for (auto &op : block) {
+      for (auto *result : op.getResults())
+        valueIDs[result] = nextValueID++;
+      for (auto &nestedRegion : op.getRegions())
+        numberValues(nestedRegion);
+    }
+  }
+}
+
+void BytecodeWriter::encodeRegion(Region &region, EncodingBuffer &enc) {
+  // Encode the block arguments of the whole region first, so that the blocks
+  // are all defined before any successor refers to them.
+  enc.emitVarInt(std::distance(region.begin(), region.end()));
+  for (auto &block : region) {
+    enc.emitVarInt(block.getNumArguments());
+    for (auto *arg : block.getArguments())
+      enc.emitVarInt(getTypeID(arg->getType()));
+    numDefinedValues += block.getNumArguments();
+  }
+
+  for (auto &block : region) {
+    enc.emitVarInt(block.getOperations().size());
+    for (auto &op : block)
+      encodeOperation(op, enc);
+  }
+}
+
+void BytecodeWriter::encodeOperation(Operation &op, EncodingBuffer &enc) {
+  enc.emitVarInt(getStringID(op.getName().getStringRef()));
+  enc.emitVarInt(getLocID(op.getLoc()));
+  enc.emitVarInt(op.hasResizableOperandsList() ? ResizableOperandList : 0);
+
+  // Encode the results.
+  enc.emitVarInt(op.getNumResults());
+  for (auto *result : op.getResults())
+    enc.emitVarInt(getTypeID(result->getType()));
+
+  // Encode the operands, followed by the successors and their operands.
+  auto operands = op.getNumSuccessors() ? op.getNonSuccessorOperands()
+                                        : op.getOperands();
+  enc.emitVarInt(std::distance(operands.begin(), operands.end()));
+  for (auto *operand : operands)
+    encodeValueUse(operand, enc);
+
+  // Successors are referred to by their index within the parent region, the
+  // blocks of which are numbered consecutively.
+  enc.emitVarInt(op.getNumSuccessors());
+  Region *parent = op.getBlock()->getParent();
+  unsigned firstBlockID = blockIDs[&parent->front()];
+  for (unsigned i = 0, e = op.getNumSuccessors(); i != e; ++i) {
+    enc.emitVarInt(blockIDs[op.getSuccessor(i)] - firstBlockID);
+    enc.emitVarInt(op.getNumSuccessorOperands(i));
+    for (auto *operand : op.getSuccessorOperands(i))
+      encodeValueUse(operand, enc);
+  }
+
+  encodeAttrList(op.getAttrs(), enc);
+
+  // The results are defined before the nested regions.
+  numDefinedValues += op.getNumResults();
+  enc.emitVarInt(op.getNumRegions());
+  for (auto &region : op.getRegions())
+    encodeRegion(region, enc);
+}
+
+void BytecodeWriter::encodeValueUse(Value *value, EncodingBuffer &enc) {
+  auto it = valueIDs.find(value);
+  assert(it != valueIDs.end() && "use of a value defined outside of function");
+  enc.emitVarInt(it->second);
+
+  // Forward references are followed by their type.
+  if (it->second >= numDefinedValues)
+    enc.emitVarInt(getTypeID(value->getType()));
+}
+
+void BytecodeWriter::write(raw_ostream &os) {
+  // Encode the functions first, which populates the tables.
+  EncodingBuffer functionDecls;
+  functionDecls.emitVarInt(functionIDs.size());
+  for (auto &function : *module) {
+    functionDecls.emitVarInt(getStringID(function.getName()));
+    functionDecls.emitVarInt(getTypeID(function.getType()));
+  }
+  EncodingBuffer functionDefs;
+  for (auto &function : *module)
+    encodeFunction(function, functionDefs);
+
+  EncodingBuffer file;
+  file.emitBytes(StringRef(kMagic, sizeof(kMagic)));
+  file.emitVarInt(kVersion);
+  file.emitByte(static_cast<uint8_t>(llvm::sys::IsBigEndianHost
+                                         ? Endianness::Big
+                                         : Endianness::Little));
+
+  file.emitVarInt(stringTable.size());
+  for (StringRef str : stringTable) {
+    file.emitVarInt(str.size());
+    file.emitBytes(str);
+  }
+
+  file.emitVarInt(types.size());
+  file.emitBytes(typeTable.getData());
+
+  file.emitBytes(functionDecls.getData());
+
+  // The attribute table is aligned, such that the raw data it contains is
+  // aligned relative to the start of the file.
+  file.emitVarInt(attrs.size());
+  file.emitPadding(kDataAlignment);
+  file.emitBytes(attrTable.getData());
+
+  file.emitVarInt(locs.size());
+  file.emitBytes(locTable.getData());
+
+  file.emitBytes(functionDefs.getData());
+
+  ArrayRef<char> data = file.getData();
+  os.write(data.data(), data.size());
+}
+
+void mlir::writeBytecode(Module *module, raw_ostream &os) {
+  BytecodeWriter(module).write(os);
+}
@@ -20,6 +20,8 @@
 //
 //===----------------------------------------------------------------------===//
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/ObjectCache.h"
+#include "mlir/ExecutionEngine/ParallelRuntime.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Module.h"
 #include "mlir/LLVMIR/Transforms.h"
@@ -28,6 +30,8 @@
 #include "mlir/Target/LLVMIR.h"
 #include "mlir/Transforms/Passes.h"
 
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
@@ -38,6 +42,8 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 
 using namespace mlir;
 using llvm::Error;
@@ -84,26 +90,51 @@ public:
   // using the data layout provided as `dataLayout`.
   // Setup the object layer to use our custom memory manager in order to resolve
   // calls to library functions present in the process.
+  // If `cache` is provided, the compiled objects are looked up in it. If
+  // `numCompileThreads` is not zero, modules are transformed and compiled on a
+  // pool of that many threads.
   OrcJIT(llvm::orc::JITTargetMachineBuilder machineBuilder,
-         llvm::DataLayout layout, IRTransformer transform)
-      : irTransformer(transform),
+         llvm::DataLayout layout, IRTransformer transform,
+         OnDiskObjectCache *cache, unsigned numCompileThreads)
+      : irTransformer(transform), objectCache(cache),
+        targetDescription(machineBuilder.getTargetTriple().str() + ";" +
+                          machineBuilder.getFeatures().getString()),
         objectLayer(
             session,
             [this]() { return llvm::make_unique<MemoryManager>(session); }),
-        compileLayer(
-            session, objectLayer,
-            llvm::orc::ConcurrentIRCompiler(std::move(machineBuilder))),
+        compileLayer(session, objectLayer,
+                     llvm::orc::ConcurrentIRCompiler(std::move(machineBuilder),
+                                                     cache)),
         transformLayer(session, compileLayer, makeIRTransformFunction()),
         dataLayout(layout), mangler(session, this->dataLayout),
         threadSafeCtx(llvm::make_unique<llvm::LLVMContext>()) {
     session.getMainJITDylib().setGenerator(
         cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
             layout.getGlobalPrefix())));
+    // The runtime of parallel loops is linked into the engine, rather than
+    // looked up in the process, whose symbols may not be exported.
+    cantFail(session.getMainJITDylib().define(llvm::orc::absoluteSymbols(
+        {{mangler("mlirParallelFor"),
+          llvm::JITEvaluatedSymbol(
+              llvm::pointerToJITTargetAddress(&mlirParallelFor),
+              llvm::JITSymbolFlags::Exported)}})));
+    if (numCompileThreads == 0)
+      return;
+    compileThreads = llvm::make_unique<llvm::ThreadPool>(numCompileThreads);
+    session.setDispatchMaterialization(
+        [this](llvm::orc::JITDylib &dylib,
+               std::unique_ptr<llvm::orc::MaterializationUnit> unit) {
+          auto sharedUnit =
+              std::shared_ptr<llvm::orc::MaterializationUnit>(std::move(unit));
+          compileThreads->async(
+              [sharedUnit, &dylib]() { sharedUnit->doMaterialize(dylib); });
+        });
   }
 
   // Create a JIT engine for the current host.
   static Expected<std::unique_ptr<OrcJIT>>
-  createDefault(IRTransformer transformer) {
+  createDefault(IRTransformer transformer, OnDiskObjectCache *cache,
+                unsigned numCompileThreads) {
     auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
     if (!machineBuilder)
       return machineBuilder.takeError();
@@ -113,16 +144,93 @@ public:
       return dataLayout.takeError();
 
     return llvm::make_unique<OrcJIT>(std::move(*machineBuilder),
-                                     std::move(*dataLayout), transformer);
+                                     std::move(*dataLayout), transformer,
+                                     cache, numCompileThreads);
   }
 
   // Add an LLVM module to the main library managed by the JIT engine.
   Error addModule(std::unique_ptr<llvm::Module> M) {
+    if (objectCache)
+      objectCache->assignKey(*M, targetDescription);
     return transformLayer.add(
         session.getMainJITDylib(),
         llvm::orc::ThreadSafeModule(std::move(M), threadSafeCtx));
   }
 
+  // Add LLVM modules, each in its own context, to the main library managed by
+  // the JIT engine, so that they can be transformed and compiled concurrently.
+  // Unless `lazy` is set, compile all the modules before returning; otherwise,
+  // a module is compiled when one of its symbols is first looked up.
+  Error addModulesWithContexts(std::vector<LLVMIRShard> modules, bool lazy) {
+    llvm::orc::SymbolNameSet symbols;
+    for (auto &shard : modules) {
+      for (auto &func : shard.module->functions())
+        if (!func.isDeclaration())
+          symbols.insert(mangler(func.getName()));
+      if (objectCache)
+        objectCache->assignKey(*shard.module, targetDescription);
+      if (auto err = transformLayer.add(
+              session.getMainJITDylib(),
+              llvm::orc::ThreadSafeModule(
+                  std::move(shard.module),
+                  llvm::orc::ThreadSafeContext(std::move(shard.context)))))
+        return err;
+    }
+    if (lazy)
+      return Error::success();
+
+    // Looking up all the functions at once materializes the modules
+    // concurrently.
+    auto expectedSymbols = session.lookup(
+        llvm::orc::JITDylibSearchList({{&session.getMainJITDylib(), true}}),
+        symbols);
+    if (!expectedSymbols)
+      return expectedSymbols.takeError();
+    return Error::success();
+  }
+
+  // Split an LLVM module into one partition per function, as SplitModule does,
+  // and add each partition to the main library managed by the JIT engine, with
+  // its own context, as addModulesWithContexts does.
+  Error addModuleSplitPerFunction(std::unique_ptr<llvm::Module> M, bool lazy) {
+    unsigned numPartitions = 0;
+    for (auto &func : M->functions())
+      if (!func.isDeclaration())
+        ++numPartitions;
+    if (numPartitions == 0)
+      return addModule(std::move(M));
+
+    // Partitions are serialized to move them to their own context.
+    std::vector<llvm::SmallString<0>> partitions;
+    llvm::SplitModule(std::move(M), numPartitions,
+                      [&](std::unique_ptr<llvm::Module> partition) {
+                        bool isEmpty = true;
+                        for (auto &func : partition->functions())
+                          if (!func.isDeclaration())
+                            isEmpty = false;
+                        for (auto &global : partition->globals())
+                          if (!global.isDeclaration())
+                            isEmpty = false;
+                        if (isEmpty)
+                          return;
+                        partitions.emplace_back();
+                        llvm::raw_svector_ostream os(partitions.back());
+                        llvm::WriteBitcodeToFile(*partition, os);
+                      });
+
+    std::vector<LLVMIRShard> modules(partitions.size());
+    for (unsigned i = 0, e = partitions.size(); i < e; ++i) {
+      modules[i].context = llvm::make_unique<llvm::LLVMContext>();
+      auto expectedModule = llvm::parseBitcodeFile(
+          llvm::MemoryBufferRef(partitions[i], "partition"),
+          *modules[i].context);
+      if (!expectedModule)
+        return expectedModule.takeError();
+      modules[i].module = std::move(*expectedModule);
+    }
+    return addModulesWithContexts(std::move(modules), lazy);
+  }
+
   // Lookup a symbol in the main library managed by the JIT engine.
   Expected<llvm::JITEvaluatedSymbol> lookup(StringRef Name) {
     return session.lookup({&session.getMainJITDylib()}, mangler(Name.str()));
@@ -130,8 +238,12 @@ public:
 
 private:
   // Wrap the `irTransformer` into a function that can be called by the
-  // IRTranformLayer.  If `irTransformer` is not set up, return the module as is
-  // without errors.
+  // IRTranformLayer.  If `irTransformer` is not set up, or if the object of the
+  // module is cached, return the module as is without errors.  The cached
+  // object is loaded here, so that the module is compiled from it even if it
+  // is removed from the cache in the meantime: an untransformed module is thus
+  // never compiled, nor written to the cache under the key of the transformed
+  // one.
   llvm::orc::IRTransformLayer::TransformFunction makeIRTransformFunction() {
     return [this](llvm::orc::ThreadSafeModule module,
                   const llvm::orc::MaterializationResponsibility &resp)
@@ -139,6 +251,8 @@ private:
       (void)resp;
       if (!irTransformer)
         return std::move(module);
+      if (objectCache && objectCache->loadObject(*module.getModule()))
+        return std::move(module);
       if (Error err = irTransformer(module.getModule()))
         return std::move(err);
       return std::move(module);
@@ -146,6 +260,9 @@ private:
   }
 
   IRTransformer irTransformer;
+  OnDiskObjectCache *objectCache;
+  // The target the modules are compiled for, as part of their cache key.
+  std::string targetDescription;
   llvm::orc::ExecutionSession session;
   llvm::orc::RTDyldObjectLinkingLayer objectLayer;
   llvm::orc::IRCompileLayer compileLayer;
@@ -153,6 +270,9 @@ private:
   llvm::DataLayout dataLayout;
   llvm::orc::MangleAndInterner mangler;
   llvm::orc::ThreadSafeContext threadSafeCtx;
+  // The pool of threads compiling the modules, if any. It must be destroyed
+  // first, since its tasks refer to the other members.
+  std::unique_ptr<llvm::ThreadPool> compileThreads;
 };
 } // end namespace impl
 } // namespace mlir
@@ -275,15 +395,35 @@ ExecutionEngine::~ExecutionEngine() = default;
 
 Expected<std::unique_ptr<ExecutionEngine>> ExecutionEngine::create(
     Module *m, PassManager *pm,
-    std::function<llvm::Error(llvm::Module *)> transformer) {
+    std::function<llvm::Error(llvm::Module *)> transformer,
+    OnDiskObjectCache *cache, unsigned numCompileThreads,
+    bool lazyCompilation) {
   auto engine = llvm::make_unique<ExecutionEngine>();
-  auto expectedJIT = impl::OrcJIT::createDefault(transformer);
+  auto expectedJIT =
+      impl::OrcJIT::createDefault(transformer, cache, numCompileThreads);
   if (!expectedJIT)
     return expectedJIT.takeError();
 
   if (pm && failed(pm->run(m)))
     return make_string_error("passes failed");
 
+  // Without lazy compilation, the functions are translated concurrently into
+  // one module per compile thread, which are compiled as they are.
+  if (numCompileThreads != 0 && !lazyCompilation) {
+    auto shards = translateModuleToLLVMIRShards(*m, numCompileThreads);
+    if (shards.empty())
+      return make_string_error("could not convert to LLVM IR");
+    for (auto &shard : shards) {
+      setupTargetTriple(shard.module.get());
+      packFunctionArguments(shard.module.get());
+    }
+    if (auto err = (*expectedJIT)->addModulesWithContexts(std::move(shards),
+                                                           /*lazy=*/false))
+      return std::move(err);
+    engine->jit = std::move(*expectedJIT);
+    return std::move(engine);
+  }
+
   auto llvmModule = translateModuleToLLVMIR(*m);
   if (!llvmModule)
     return make_string_error("could not convert to LLVM IR");
@@ -293,19 +433,27 @@ Expected<std::unique_ptr<ExecutionEngine>> ExecutionEngine::create(
   setupTargetTriple(llvmModule.get());
   packFunctionArguments(llvmModule.get());
 
-  if (auto err = (*expectedJIT)->addModule(std::move(llvmModule)))
+  if (!lazyCompilation) {
+    if (auto err = (*expectedJIT)->addModule(std::move(llvmModule)))
+      return std::move(err);
+  } else if (auto err = (*expectedJIT)->addModuleSplitPerFunction(
+                 std::move(llvmModule), /*lazy=*/true)) {
     return std::move(err);
+  }
   engine->jit = std::move(*expectedJIT);
 
   return std::move(engine);
 }
 
 Expected<std::unique_ptr<ExecutionEngine>> ExecutionEngine::create(
-    Module *m, std::function<llvm::Error(llvm::Module *)> transformer) {
+    Module *m, std::function<llvm::Error(llvm::Module *)> transformer,
+    OnDiskObjectCache *cache, unsigned numCompileThreads,
+    bool lazyCompilation) {
   // Construct and run the default MLIR pipeline.
   PassManager manager;
   getDefaultPasses(manager, {});
-  return create(m, &manager, transformer);
+  return create(m, &manager, transformer, cache, numCompileThreads,
+                lazyCompilation);
 }
 
 Expected<void (*)(void **)> ExecutionEngine::lookup(StringRef name) const {
@@ -330,3 +478,11 @@ llvm::Error ExecutionEngine::invoke(StringRef name,
 
   return llvm::Error::success();
 }
+
+Expected<PackedInvocation> ExecutionEngine::bindPacked(StringRef name,
+                                                       ArrayRef<void *> args) {
+  auto expectedFPtr = lookup(name);
+  if (!expectedFPtr)
+    return expectedFPtr.takeError();
+  return PackedInvocation(*expectedFPtr, args);
+}
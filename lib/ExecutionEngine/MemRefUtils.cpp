@@ -21,48 +21,146 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/StandardTypes.h"
 #include "mlir/Support/LLVM.h"
 
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <numeric>
 
 using namespace mlir;
 
+static_assert(sizeof(void *) == sizeof(int64_t),
+              "memref descriptors assume 64-bit pointers");
+
 static inline llvm::Error make_string_error(const llvm::Twine &message) {
   return llvm::make_error<llvm::StringError>(message.str(),
                                              llvm::inconvertibleErrorCode());
 }
 
-static llvm::Expected<StaticFloatMemRef *>
-allocMemRefDescriptor(Type type, bool allocateData = true,
-                      float initialValue = 0.0) {
+// Checks that memrefs of the given type can be passed to the functions
+// compiled by the ExecutionEngine, and returns the size of their elements.
+static llvm::Expected<unsigned> checkMemRefType(Type type) {
   auto memRefType = type.dyn_cast<MemRefType>();
   if (!memRefType)
     return make_string_error("non-memref argument not supported");
-  if (memRefType.getNumDynamicDims() != 0)
-    return make_string_error("memref with dynamic shapes not supported");
-
-  auto elementType = memRefType.getElementType();
-  if (!elementType.isF32())
+  if (!memRefType.getAffineMaps().empty() ||
+      memRefType.getMemorySpace() != 0)
     return make_string_error(
-        "memref with element other than f32 not supported");
+        "memref with layout maps or memory spaces not supported");
+  // BF16 isn't supported by the lowering to LLVM IR.
+  auto elementType = memRefType.getElementType();
+  if (!elementType.isIntOrIndexOrFloat() || elementType.isBF16())
+    return make_string_error("memref with element other than integer, float "
+                             "or index not supported");
+  return getMemRefEltSizeInBytes(memRefType);
+}
 
-  auto *descriptor =
-      reinterpret_cast<StaticFloatMemRef *>(malloc(sizeof(StaticFloatMemRef)));
-  if (!allocateData) {
-    descriptor->data = nullptr;
-    return descriptor;
+template <typename T> static void fill(void *data, int64_t count, T value) {
+  std::fill_n(static_cast<T *>(data), count, value);
+}
+
+// Stores `value` converted to the element type of `memRefType` into `count`
+// elements at `data`.
+static void fillElements(void *data, MemRefType memRefType, int64_t count,
+                         float value) {
+  auto type = memRefType.getElementType();
+  switch (getMemRefEltSizeInBytes(memRefType)) {
+  case 1:
+    return fill(data, count, static_cast<int8_t>(value));
+  case 2:
+    // There is no host type for f16: leave its elements zeroed.
+    if (type.isF16())
+      return fill(data, count, static_cast<int16_t>(0));
+    return fill(data, count, static_cast<int16_t>(value));
+  case 4:
+    if (type.isF32())
+      return fill(data, count, value);
+    return fill(data, count, static_cast<int32_t>(value));
+  case 8:
+    if (type.isF64())
+      return fill(data, count, static_cast<double>(value));
+    return fill(data, count, static_cast<int64_t>(value));
+  default:
+    // Wider integers are zeroed.
+    memset(data, 0, count * getMemRefEltSizeInBytes(memRefType));
   }
+}
+
+OwningMemRef::OwningMemRef(MemRefType type, ArrayRef<int64_t> shape,
+                           unsigned elementSize)
+    : type(type), shape(shape.begin(), shape.end()), strides(shape.size()),
+      numElements(1), elementSize(elementSize),
+      descriptor(new int64_t[type.getNumDynamicDims() + 1]) {
+  for (int i = shape.size() - 1; i >= 0; --i) {
+    strides[i] = numElements;
+    numElements *= shape[i];
+  }
+}
+
+OwningMemRef::~OwningMemRef() { free(allocatedData); }
+
+llvm::Expected<std::unique_ptr<OwningMemRef>>
+OwningMemRef::create(MemRefType type, ArrayRef<int64_t> dynamicSizes,
+                     unsigned alignment) {
+  auto elementSize = checkMemRefType(type);
+  if (!elementSize)
+    return elementSize.takeError();
+  if (dynamicSizes.size() != type.getNumDynamicDims())
+    return make_string_error("expected one size per dynamic dimension");
+  if (!llvm::isPowerOf2_32(alignment))
+    return make_string_error("alignment must be a power of two");
+
+  SmallVector<int64_t, 4> shape;
+  shape.reserve(type.getRank());
+  auto dynamicSize = dynamicSizes.begin();
+  for (int64_t size : type.getShape())
+    shape.push_back(size < 0 ? *dynamicSize++ : size);
+
+  std::unique_ptr<OwningMemRef> memRef(
+      new OwningMemRef(type, shape, *elementSize));
+  // Over-allocate to align the data manually: aligned_alloc requires the size
+  // to be a multiple of the alignment.
+  int64_t numBytes = memRef->numElements * *elementSize;
+  memRef->allocatedData = malloc(numBytes + alignment - 1);
+  if (!memRef->allocatedData)
+    return make_string_error("could not allocate memref data");
+  uintptr_t aligned = llvm::alignTo(
+      reinterpret_cast<uintptr_t>(memRef->allocatedData), alignment);
+  memRef->descriptor[0] = static_cast<int64_t>(aligned);
+  std::copy(dynamicSizes.begin(), dynamicSizes.end(),
+            memRef->descriptor.get() + 1);
+  return std::move(memRef);
+}
+
+// Allocates the descriptor of a memref of `type`, which is assumed to be
+// statically shaped if `allocateData` is set.
+static llvm::Expected<void *> allocMemRefDescriptor(Type type,
+                                                    bool allocateData = true,
+                                                    float initialValue = 0.0) {
+  auto elementSize = checkMemRefType(type);
+  if (!elementSize)
+    return elementSize.takeError();
+  auto memRefType = type.cast<MemRefType>();
+  unsigned numDynamicDims = memRefType.getNumDynamicDims();
+  if (allocateData && numDynamicDims != 0)
+    return make_string_error("memref with dynamic shapes not supported");
+
+  auto *descriptor = reinterpret_cast<void **>(
+      calloc(numDynamicDims + 1, sizeof(int64_t)));
+  if (!allocateData)
+    return descriptor;
 
   auto shape = memRefType.getShape();
   int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
                                  std::multiplies<int64_t>());
-  descriptor->data = reinterpret_cast<float *>(malloc(sizeof(float) * size));
-  for (int64_t i = 0; i < size; ++i) {
-    descriptor->data[i] = initialValue;
-  }
+  descriptor[0] = malloc(*elementSize * size);
+  fillElements(descriptor[0], memRefType, size, initialValue);
   return descriptor;
 }
 
@@ -97,7 +195,7 @@ mlir::allocateMemRefArguments(Function *func, float initialValue) {
 void mlir::freeMemRefArguments(ArrayRef<void *> args) {
   llvm::DenseSet<void *> dataPointers;
   for (void *arg : args) {
-    float *dataPtr = reinterpret_cast<StaticFloatMemRef *>(arg)->data;
+    void *dataPtr = *reinterpret_cast<void **>(arg);
     if (dataPointers.count(dataPtr) == 0) {
       free(dataPtr);
       dataPointers.insert(dataPtr);
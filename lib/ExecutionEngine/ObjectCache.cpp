@@ -0,0 +1,126 @@
+//===- ObjectCache.cpp - MLIR JIT object cache ----------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements an on-disk cache of the object files compiled by the
+// MLIR execution engine.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/ExecutionEngine/ObjectCache.h"
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+OnDiskObjectCache::OnDiskObjectCache(StringRef directory,
+                                     StringRef compileOptions)
+    : directory(directory), compileOptions(compileOptions) {}
+
+void OnDiskObjectCache::assignKey(llvm::Module &module,
+                                  StringRef target) const {
+  // The module identifier is printed with the module: clear it so that it
+  // doesn't affect the key.
+  module.setModuleIdentifier("");
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  module.print(os, /*AAW=*/nullptr);
+
+  llvm::MD5 hasher;
+  hasher.update(os.str());
+  hasher.update(target);
+  hasher.update(compileOptions);
+  llvm::MD5::MD5Result result;
+  hasher.final(result);
+  module.setModuleIdentifier(result.digest());
+}
+
+std::string
+OnDiskObjectCache::getObjectPath(const llvm::Module &module) const {
+  llvm::SmallString<128> path(directory);
+  llvm::sys::path::append(path, module.getModuleIdentifier() + ".o");
+  return path.str().str();
+}
+
+bool OnDiskObjectCache::loadObject(const llvm::Module &module) {
+  auto buffer = llvm::MemoryBuffer::getFile(getObjectPath(module),
+                                            /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return false;
+  std::lock_guard<std::mutex> lock(loadedObjectsMutex);
+  loadedObjects[module.getModuleIdentifier()].push_back(std::move(*buffer));
+  return true;
+}
+
+void OnDiskObjectCache::notifyObjectCompiled(const llvm::Module *module,
+                                             llvm::MemoryBufferRef object) {
+  // Failures to write to the cache aren't errors: the object is simply
+  // compiled again next time.
+  if (llvm::sys::fs::create_directories(directory))
+    return;
+
+  // Write to a temporary file first, and rename it, so that other processes
+  // using the cache never see a partially written object.
+  llvm::SmallString<128> tempPath(directory);
+  llvm::sys::path::append(tempPath, "tmp-%%%%%%%%.o");
+  int fd;
+  if (llvm::sys::fs::createUniqueFile(tempPath, fd, tempPath))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << object.getBuffer();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(tempPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(tempPath, getObjectPath(*module)))
+    llvm::sys::fs::remove(tempPath);
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+OnDiskObjectCache::getObject(const llvm::Module *module) {
+  // Return the object loaded for the module, if any.
+  {
+    std::lock_guard<std::mutex> lock(loadedObjectsMutex);
+    auto it = loadedObjects.find(module->getModuleIdentifier());
+    if (it != loadedObjects.end()) {
+      auto object = std::move(it->second.back());
+      it->second.pop_back();
+      if (it->second.empty())
+        loadedObjects.erase(it);
+      ++numHits;
+      return object;
+    }
+  }
+
+  auto buffer = llvm::MemoryBuffer::getFile(getObjectPath(*module),
+                                            /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    ++numMisses;
+    return nullptr;
+  }
+  ++numHits;
+  return std::move(*buffer);
+}
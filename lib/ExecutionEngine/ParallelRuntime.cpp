@@ -0,0 +1,78 @@
+//===- ParallelRuntime.cpp - Runtime of parallel loops --------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the runtime library that executes the parallel loops
+// outlined by the loop parallelization pass.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/ExecutionEngine/ParallelRuntime.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace mlir;
+
+// Returns the thread pool shared by all the parallel loops.
+static WorkStealingThreadPool &getThreadPool() {
+  static WorkStealingThreadPool threadPool;
+  return threadPool;
+}
+
+void mlirParallelFor(void (*body)(void *, int64_t, int64_t), void *context,
+                     int64_t lowerBound, int64_t upperBound, int64_t step,
+                     int64_t chunkSize, int64_t dynamicSchedule) {
+  if (upperBound <= lowerBound)
+    return;
+  int64_t numIterations = (upperBound - lowerBound + step - 1) / step;
+  auto &threadPool = getThreadPool();
+  int64_t numThreads = threadPool.getNumThreads();
+  if (chunkSize <= 0)
+    chunkSize = (numIterations + numThreads - 1) / numThreads;
+  int64_t numChunks = (numIterations + chunkSize - 1) / chunkSize;
+
+  auto runChunk = [&](int64_t chunk) {
+    int64_t chunkLowerBound = lowerBound + chunk * chunkSize * step;
+    int64_t chunkUpperBound =
+        std::min(upperBound, chunkLowerBound + chunkSize * step);
+    body(context, chunkLowerBound, chunkUpperBound);
+  };
+
+  // The pool itself runs the tasks sequentially when called from within a
+  // parallel loop.
+  int64_t numTasks = std::min(numThreads, numChunks);
+  if (numTasks == 1) {
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+      runChunk(chunk);
+    return;
+  }
+
+  if (dynamicSchedule) {
+    std::atomic<int64_t> nextChunk(0);
+    threadPool.parallelFor(numTasks, [&](unsigned, size_t) {
+      for (int64_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+        runChunk(chunk);
+    });
+    return;
+  }
+
+  threadPool.parallelFor(numTasks, [&](unsigned, size_t task) {
+    for (int64_t chunk = task; chunk < numChunks; chunk += numTasks)
+      runChunk(chunk);
+  });
+}
@@ -35,12 +35,14 @@
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/Regex.h"
 using namespace mlir;
 
@@ -77,6 +79,16 @@ static llvm::cl::opt<bool>
                        llvm::cl::desc("Print the generic op form"),
                        llvm::cl::init(false), llvm::cl::Hidden);
 
+static llvm::cl::opt<unsigned> elideElementsAttrIfLarger(
+    "mlir-elide-elementsattrs-if-larger",
+    llvm::cl::desc("Elide the values of dense elements attributes with more "
+                   "elements than the given number"));
+
+static llvm::cl::opt<unsigned> printElementsAttrWithHexIfLarger(
+    "mlir-print-elementsattrs-with-hex-if-larger",
+    llvm::cl::desc("Print dense elements attributes with more elements than "
+                   "the given number as a hex string"));
+
 namespace {
 class ModuleState {
 public:
@@ -327,6 +339,7 @@ protected:
   void printTrailingLocation(Location loc);
   void printLocationInternal(Location loc, bool pretty = false);
   void printDenseElementsAttr(DenseElementsAttr attr);
+  void printDenseElementsAttrAsHex(DenseElementsAttr attr);
 
   /// This enum is used to represent the binding stength of the enclosing
   /// context that an AffineExprStorage is being printed in, so we can
@@ -493,7 +506,10 @@ void ModulePrinter::print(Module *module) {
 }
 
 /// Print a floating point value in a way that the parser will be able to
-/// round-trip losslessly.
+/// round-trip losslessly. The value is always formatted with APFloat: its
+/// 6-digit form (e.g. "1.000000e+00") is what textual IR contains, and its
+/// rounding does not match the one of printf-like formatters, so a faster
+/// formatter would change the printed output.
 static void printFloatValue(const APFloat &apValue, raw_ostream &os) {
   // We would like to output the FP constant value in exponential notation,
   // but we cannot do this if doing so will lose precision.  Check here to
@@ -512,7 +528,8 @@ static void printFloatValue(const APFloat &apValue, raw_ostream &os) {
             ((strValue[0] == '-' || strValue[0] == '+') &&
              (strValue[1] >= '0' && strValue[1] <= '9'))) &&
            "[-+]?[0-9] regex does not match!");
-    // Reparse stringized version!
+    // Reparse stringized version! APFloat is used rather than the C library,
+    // whose parsing depends on the locale.
     if (APFloat(apValue.getSemantics(), strValue).bitwiseIsEqual(apValue)) {
       os << strValue;
       return;
@@ -620,7 +637,15 @@ void ModulePrinter::printAttributeOptionalType(Attribute attr,
     os << "dense<";
     printType(eltsAttr.getType());
     os << ", ";
-    printDenseElementsAttr(eltsAttr);
+    auto numElements = eltsAttr.size();
+    if (elideElementsAttrIfLarger.getNumOccurrences() &&
+        numElements > elideElementsAttrIfLarger)
+      os << "\"...\"";
+    else if (printElementsAttrWithHexIfLarger.getNumOccurrences() &&
+             numElements > printElementsAttrWithHexIfLarger)
+      printDenseElementsAttrAsHex(eltsAttr);
+    else
+      printDenseElementsAttr(eltsAttr);
     os << '>';
     break;
   }
@@ -647,25 +672,28 @@ void ModulePrinter::printAttributeOptionalType(Attribute attr,
   }
 }
 
-void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
-  auto type = attr.getType();
-  auto shape = type.getShape();
-  auto rank = type.getRank();
-
-  SmallVector<Attribute, 16> elements;
-  attr.getValues(elements);
+/// Prints the elements of a dense elements attribute of the given shape with
+/// 'printElement', walking them with 'elementIt'.
+template <typename ElementIt, typename PrintElementFn>
+static void printDenseElements(raw_ostream &os, ArrayRef<int64_t> shape,
+                               ElementIt elementIt,
+                               PrintElementFn printElement) {
+  auto rank = shape.size();
 
   // Special case for 0-d tensors;
   if (rank == 0) {
-    printAttribute(elements[0]);
+    printElement(*elementIt);
     return;
   }
 
   // Special case for degenerate tensors.
-  if (elements.empty()) {
-    for (int i = 0; i < rank; ++i)
+  int64_t numElements = 1;
+  for (auto dim : shape)
+    numElements *= dim;
+  if (numElements == 0) {
+    for (unsigned i = 0; i < rank; ++i)
       os << '[';
-    for (int i = 0; i < rank; ++i)
+    for (unsigned i = 0; i < rank; ++i)
       os << ']';
     return;
   }
@@ -693,19 +721,74 @@ void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
       }
   };
 
-  for (unsigned idx = 0, e = elements.size(); idx != e; ++idx) {
+  for (int64_t idx = 0; idx != numElements; ++idx, ++elementIt) {
     if (idx != 0)
       os << ", ";
     while (openBrackets++ < rank)
       os << '[';
     openBrackets = rank;
-    printAttribute(elements[idx]);
+    printElement(*elementIt);
     bumpCounter();
   }
   while (openBrackets-- > 0)
     os << ']';
 }
 
+void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
+  // Print the elements as they are decoded from the raw data of the attribute,
+  // instead of constructing an attribute for each of them.
+  auto type = attr.getType();
+  if (auto intAttr = attr.dyn_cast<DenseIntElementsAttr>()) {
+    // Print all integer attributes as signed unless i1.
+    bool isSigned = type.getElementType().getIntOrFloatBitWidth() != 1;
+    printDenseElements(os, type.getShape(), intAttr.begin(),
+                       [&](const APInt &value) {
+                         if (value.getBitWidth() > 64)
+                           value.print(os, isSigned);
+                         else if (isSigned)
+                           os << value.getSExtValue();
+                         else
+                           os << value.getZExtValue();
+                       });
+    return;
+  }
+  // Formatting a float is expensive, and large constants often repeat the same
+  // value, so reuse the string of the previous element when the bits match.
+  Optional<APFloat> lastValue;
+  SmallString<16> lastStr;
+  printDenseElements(os, type.getShape(),
+                     attr.cast<DenseFPElementsAttr>().begin(),
+                     [&](const APFloat &value) {
+                       if (!lastValue || !lastValue->bitwiseIsEqual(value)) {
+                         lastValue = value;
+                         lastStr.clear();
+                         llvm::raw_svector_ostream strOS(lastStr);
+                         printFloatValue(value, strOS);
+                       }
+                       os << lastStr;
+                     });
+}
+
+void ModulePrinter::printDenseElementsAttrAsHex(DenseElementsAttr attr) {
+  // Print the packed elements, without the padding of the raw data, in the
+  // little-endian form accepted by the parser.
+  auto elementType = attr.getType().getElementType();
+  // FIXME(b/121118307): using 64 bits for BF16 because it is currently stored
+  // with double semantics.
+  size_t bitWidth =
+      elementType.isBF16() ? 64 : elementType.getIntOrFloatBitWidth();
+  size_t numBytes = llvm::divideCeil(bitWidth * attr.size(), 8);
+  // The raw data is stored as 64-bit words in host order: on big-endian hosts,
+  // the bytes of each word are stored in reverse order.
+  ArrayRef<char> data = attr.getRawData();
+  os << "\"0x";
+  for (size_t i = 0; i != numBytes; ++i) {
+    char c = data[llvm::sys::IsBigEndianHost ? i ^ 7 : i];
+    os << llvm::hexdigit((c >> 4) & 0xF) << llvm::hexdigit(c & 0xF);
+  }
+  os << '"';
+}
+
 static bool isDialectTypeSimpleEnoughForPrettyForm(StringRef typeName) {
   // The type name must start with an identifier.
   if (typeName.empty() || !isalpha(typeName.front()))
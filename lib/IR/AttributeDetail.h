@@ -33,6 +33,7 @@
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/Support/TrailingObjects.h"
+#include <atomic>
 
 namespace mlir {
 namespace detail {
@@ -262,7 +263,7 @@ struct FunctionAttributeStorage : public AttributeStorage {
         value(value) {}
 
   /// Key equality function.
-  bool operator==(const KeyTy &key) const { return key == value; }
+  bool operator==(const KeyTy &key) const { return key == getValue(); }
 
   /// Construct a new storage instance.
   static FunctionAttributeStorage *
@@ -275,10 +276,15 @@ struct FunctionAttributeStorage : public AttributeStorage {
   void cleanup() {
     // Null out the function reference in the attribute to avoid dangling
     // pointers.
-    value = nullptr;
+    value.store(nullptr, std::memory_order_relaxed);
   }
 
-  Function *value;
+  Function *getValue() const { return value.load(std::memory_order_relaxed); }
+
+  /// The referenced function, or null once it is deleted. This is atomic since
+  /// a lock-free lookup of the uniquer may compare against this instance while
+  /// the function is deleted on another thread.
+  std::atomic<Function *> value;
 };
 
 /// An attribute representing a reference to a vector or tensor constant,
@@ -306,22 +312,57 @@ struct SplatElementsAttributeStorage : public AttributeStorage {
 
 /// An attribute representing a reference to a dense vector or tensor object.
 struct DenseElementsAttributeStorage : public AttributeStorage {
-  using KeyTy = std::pair<Type, ArrayRef<char>>;
+  struct KeyTy {
+    KeyTy(Type type, ArrayRef<char> data, bool isExternal = false)
+        : type(type), data(data), isExternal(isExternal) {}
+
+    Type type;
+    ArrayRef<char> data;
+
+    /// If the data is external, it is referred to in place instead of being
+    /// copied into the context.
+    bool isExternal;
+  };
 
-  DenseElementsAttributeStorage(Type ty, ArrayRef<char> data)
-      : AttributeStorage(ty), data(data) {}
+  DenseElementsAttributeStorage(Type ty, ArrayRef<char> data, bool isExternal)
+      : AttributeStorage(ty), data(data), isExternal(isExternal) {}
 
   /// Key equality and hash functions.
   bool operator==(const KeyTy &key) const {
-    return key == KeyTy(getType(), data);
+    if (key.type != getType() || key.data.size() != data.size())
+      return false;
+    // Avoid comparing large external buffers with themselves.
+    return key.data.data() == data.data() || key.data == data;
+  }
+  static unsigned hashKey(const KeyTy &key) {
+    return llvm::hash_combine(key.type, getDigest(key.data));
+  }
+
+  /// Returns a digest of the given data.  The data of large attributes is
+  /// sampled, such that uniquing them doesn't scan the whole of it.
+  static llvm::hash_code getDigest(ArrayRef<char> data) {
+    const size_t kDigestSize = 4096, kChunkSize = 64;
+    if (data.size() <= kDigestSize)
+      return llvm::hash_value(data);
+
+    // Hash the size along with evenly spaced chunks of the data, including the
+    // first and the last ones.
+    const size_t numChunks = kDigestSize / kChunkSize;
+    const size_t stride = (data.size() - kChunkSize) / (numChunks - 1);
+    llvm::hash_code digest = llvm::hash_value(data.size());
+    for (size_t i = 0; i != numChunks; ++i)
+      digest = llvm::hash_combine(
+          digest, llvm::hash_value(data.slice(i * stride, kChunkSize)));
+    return digest;
   }
 
   /// Construct a new storage instance.
   static DenseElementsAttributeStorage *
-  construct(AttributeStorageAllocator &allocator, KeyTy key) {
-    // If the data buffer is non-empty, we copy it into the allocator.
-    ArrayRef<char> data = key.second;
-    if (!data.empty()) {
+  construct(AttributeStorageAllocator &allocator, const KeyTy &key) {
+    // If the data buffer is non-empty and not external, we copy it into the
+    // allocator.
+    ArrayRef<char> data = key.data;
+    if (!data.empty() && !key.isExternal) {
       // Rounding up the allocate size to multiples of APINT_WORD_SIZE, so
       // the `readBits` will not fail when it accesses multiples of
       // APINT_WORD_SIZE each time.
@@ -332,10 +373,13 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
       data = {rawCopy, data.size()};
     }
     return new (allocator.allocate<DenseElementsAttributeStorage>())
-        DenseElementsAttributeStorage(key.first, data);
+        DenseElementsAttributeStorage(key.type, data, key.isExternal);
   }
 
   ArrayRef<char> data;
+
+  /// Whether the data is owned outside of the context.
+  bool isExternal;
 };
 
 /// An attribute representing a reference to a tensor constant with opaque
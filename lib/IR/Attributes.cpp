@@ -65,7 +65,11 @@ Attribute::Kind Attribute::getKind() const {
 }
 
 /// Return the type of this attribute.
-Type Attribute::getType() const { return attr->getType(); }
+Type Attribute::getType() const {
+  if (auto fnAttr = dyn_cast<FunctionAttr>())
+    return fnAttr.getType();
+  return attr->getType();
+}
 
 bool Attribute::isOrContainsFunction() const {
   return attr->isOrContainsFunctionCache();
@@ -286,11 +290,16 @@ void FunctionAttr::dropFunctionReference(Function *value) {
 }
 
 Function *FunctionAttr::getValue() const {
-  return static_cast<ImplType *>(attr)->value;
+  return static_cast<ImplType *>(attr)->getValue();
 }
 
+/// The type of the attribute is the current type of the function, which may
+/// change after the attribute is created.  The type the function had when the
+/// attribute was created is only used once the function is deleted.
 FunctionType FunctionAttr::getType() const {
-  return Attribute::getType().cast<FunctionType>();
+  if (auto *function = getValue())
+    return function->getType();
+  return attr->getType().cast<FunctionType>();
 }
 
 //===----------------------------------------------------------------------===//
@@ -360,8 +369,11 @@ APInt DenseElementsAttr::RawElementIterator::operator*() const {
 // DenseElementsAttr
 //===----------------------------------------------------------------------===//
 
-DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
-                                         ArrayRef<char> data) {
+/// Returns a dense elements attribute of the given type and raw data, which is
+/// either copied into the context or referred to in place if it is external.
+static DenseElementsAttr getDenseElementsAttr(VectorOrTensorType type,
+                                              ArrayRef<char> data,
+                                              bool isExternal) {
   assert((type.getSizeInBits() <= data.size() * APInt::APINT_WORD_SIZE) &&
          "Input data bit size should be larger than that type requires");
 
@@ -380,7 +392,24 @@ DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
     llvm_unreachable("unexpected element type");
   }
   return AttributeUniquer::get<DenseElementsAttr>(type.getContext(), kind, type,
-                                                  data);
+                                                  data, isExternal);
+}
+
+DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
+                                         ArrayRef<char> data) {
+  return getDenseElementsAttr(type, data, /*isExternal=*/false);
+}
+
+DenseElementsAttr
+DenseElementsAttr::getFromExternalData(VectorOrTensorType type,
+                                       ArrayRef<char> data) {
+  auto address = reinterpret_cast<uintptr_t>(data.data());
+  (void)address;
+  assert(address % APInt::APINT_WORD_SIZE == 0 &&
+         "external data must be aligned to the APInt word size");
+  assert(data.size() % APInt::APINT_WORD_SIZE == 0 &&
+         "external data must be padded to the APInt word size");
+  return getDenseElementsAttr(type, data, /*isExternal=*/true);
 }
 
 DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
@@ -502,6 +531,10 @@ ArrayRef<char> DenseElementsAttr::getRawData() const {
   return static_cast<ImplType *>(attr)->data;
 }
 
+bool DenseElementsAttr::hasExternalData() const {
+  return static_cast<ImplType *>(attr)->isExternal;
+}
+
 // Constructs a dense elements attribute from an array of raw APInt values.
 // Each APInt value is expected to have the same bitwidth as the element type
 // of 'type'.
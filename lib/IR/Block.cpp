@@ -119,8 +119,10 @@ bool Block::verifyInstOrder() {
   Operation *prev = nullptr;
   for (auto &i : *this) {
     // The previous operation must have a smaller order index than the next as
-    // it appears earlier in the list.
-    if (prev && prev->orderIndex >= i.orderIndex)
+    // it appears earlier in the list. Operations inserted since the order was
+    // computed don't have an index yet.
+    if (prev && prev->hasValidOrder() && i.hasValidOrder() &&
+        prev->orderIndex >= i.orderIndex)
       return true;
     prev = &i;
   }
@@ -131,11 +133,11 @@ bool Block::verifyInstOrder() {
 void Block::recomputeInstOrder() {
   parentValidInstOrderPair.setInt(true);
 
-  // TODO(riverriddle) Have non-congruent indices to reduce the number of times
-  // an insert invalidates the list.
+  // Leave a gap between the indices, so that inserted operations can usually
+  // be numbered without invalidating the list.
   unsigned orderIndex = 0;
   for (auto &op : *this)
-    op.orderIndex = orderIndex++;
+    op.orderIndex = (orderIndex += Operation::kOrderStride);
 }
 
 Block *PredecessorIterator::operator*() const {
@@ -170,7 +172,7 @@ auto Block::addArguments(ArrayRef<Type> types)
   return {arguments.data() + initialSize, arguments.data() + arguments.size()};
 }
 
-void Block::eraseArgument(unsigned index) {
+void Block::eraseArgument(unsigned index, bool updatePredTerms) {
   assert(index < arguments.size());
 
   // Delete the argument.
@@ -178,6 +180,8 @@ void Block::eraseArgument(unsigned index) {
   arguments.erase(arguments.begin() + index);
 
   // Erase this argument from each of the predecessor's terminator.
+  if (!updatePredTerms)
+    return;
   for (auto predIt = pred_begin(), predE = pred_end(); predIt != predE;
        ++predIt) {
     auto *predTerminator = (*predIt)->getTerminator();
@@ -256,9 +260,9 @@ void Block::walk(Block::iterator begin, Block::iterator end,
 /// invalidated.
 Block *Block::splitBlock(iterator splitBefore) {
   // Start by creating a new basic block, and insert it immediate after this
-  // one in the containing function.
+  // one in the containing region.
   auto newBB = new Block();
-  getFunction()->getBlocks().insert(++Function::iterator(this), newBB);
+  getParent()->getBlocks().insert(++Region::iterator(this), newBB);
 
   // Move all of the operations from the split point to the end of the function
   // into the new block.
@@ -18,9 +18,13 @@
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Identifier.h"
 #include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Types.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
@@ -214,3 +218,139 @@ void DiagnosticEngine::emit(const Diagnostic &diag) {
   for (auto &note : diag.getNotes())
     impl->emit(note.getLocation(), note.str(), note.getSeverity());
 }
+
+//===----------------------------------------------------------------------===//
+// ParallelDiagnosticHandler
+//===----------------------------------------------------------------------===//
+
+namespace mlir {
+namespace detail {
+struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
+  struct ThreadDiagnostic {
+    ThreadDiagnostic(size_t id, Location loc, StringRef msg,
+                     DiagnosticSeverity kind)
+        : id(id), loc(loc), msg(msg), kind(kind) {}
+    bool operator<(const ThreadDiagnostic &rhs) const { return id < rhs.id; }
+
+    /// The id for this diagnostic, this is used for ordering.
+    /// Note: This id corresponds to the ordered position of the current element
+    ///       being processed by a given thread.
+    size_t id;
+
+    /// Information for the diagnostic.
+    Location loc;
+    std::string msg;
+    DiagnosticSeverity kind;
+  };
+
+  ParallelDiagnosticHandlerImpl(MLIRContext *ctx)
+      : prevHandler(ctx->getDiagEngine().getHandler()), context(ctx) {
+    ctx->getDiagEngine().setHandler(
+        [this](Location loc, StringRef message, DiagnosticSeverity kind) {
+          uint64_t tid = llvm::get_threadid();
+          llvm::sys::SmartScopedLock<true> lock(mutex);
+
+          // Append a new diagnostic.
+          diagnostics.emplace_back(threadToOrderID[tid], loc, message, kind);
+        });
+  }
+
+  ~ParallelDiagnosticHandlerImpl() {
+    // Restore the previous diagnostic handler.
+    context->getDiagEngine().setHandler(prevHandler);
+
+    // Early exit if there are no diagnostics, this is the common case.
+    if (diagnostics.empty())
+      return;
+
+    // Emit the diagnostics back to the previous handler. The diagnostics were
+    // already split into notes and fused locations by the engine, so they are
+    // forwarded as is.
+    emitDiagnostics(
+        [&](Location loc, StringRef message, DiagnosticSeverity kind) {
+          if (prevHandler)
+            return prevHandler(loc, message, kind);
+          if (kind != DiagnosticSeverity::Note)
+            context->getDiagEngine().emit(loc, kind) << message;
+        });
+  }
+
+  /// Utility method to emit any held diagnostics.
+  void emitDiagnostics(
+      std::function<void(Location, StringRef, DiagnosticSeverity)> emitFn) {
+    // Stable sort all of the diagnostics that were emitted. This creates a
+    // deterministic ordering for the diagnostics based upon which order id they
+    // were emitted for.
+    std::stable_sort(diagnostics.begin(), diagnostics.end());
+
+    // Emit each diagnostic to the context again.
+    for (ThreadDiagnostic &diag : diagnostics)
+      emitFn(diag.loc, diag.msg, diag.kind);
+  }
+
+  /// Set the order id for the current thread.
+  void setOrderIDForThread(size_t orderID) {
+    uint64_t tid = llvm::get_threadid();
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    threadToOrderID[tid] = orderID;
+  }
+
+  /// Dump any dangling diagnostics in the event of a crash.
+  void print(raw_ostream &os) const override {
+    // Early exit if there are no diagnostics, this is the common case.
+    if (diagnostics.empty())
+      return;
+
+    os << "In-Flight Diagnostics:\n";
+    const_cast<ParallelDiagnosticHandlerImpl *>(this)->emitDiagnostics(
+        [&](Location loc, StringRef message, DiagnosticSeverity severity) {
+          os.indent(4);
+
+          // Print each diagnostic with the format:
+          //   "<location>: <kind>: <msg>"
+          if (!loc.isa<UnknownLoc>())
+            os << loc << ": ";
+          switch (severity) {
+          case DiagnosticSeverity::Error:
+            os << "error: ";
+            break;
+          case DiagnosticSeverity::Warning:
+            os << "warning: ";
+            break;
+          case DiagnosticSeverity::Note:
+            os << "note: ";
+            break;
+          case DiagnosticSeverity::Remark:
+            os << "remark: ";
+            break;
+          }
+          os << message << '\n';
+        });
+  }
+
+  /// The previous context diagnostic handler.
+  DiagnosticEngine::HandlerTy prevHandler;
+
+  /// A smart mutex to lock access to the internal state.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// A mapping between the thread id and the current order id.
+  DenseMap<uint64_t, size_t> threadToOrderID;
+
+  /// An unordered list of diagnostics that were emitted.
+  std::vector<ThreadDiagnostic> diagnostics;
+
+  /// The context to emit the diagnostics to.
+  MLIRContext *context;
+};
+} // end namespace detail
+} // end namespace mlir
+
+ParallelDiagnosticHandler::ParallelDiagnosticHandler(MLIRContext *ctx)
+    : impl(new ParallelDiagnosticHandlerImpl(ctx)) {}
+ParallelDiagnosticHandler::~ParallelDiagnosticHandler() {}
+
+/// Set the order id for the current thread.
+void ParallelDiagnosticHandler::setOrderIDForThread(size_t orderID) {
+  impl->setOrderIDForThread(orderID);
+}
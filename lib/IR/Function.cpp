@@ -25,6 +25,7 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorHandling.h"
 using namespace mlir;
 
 Function::Function(Location location, StringRef name, FunctionType type,
@@ -83,9 +84,12 @@ void llvm::ilist_traits<Function>::addNodeToList(Function *function) {
 }
 
 /// This is a trait method invoked when a Function is removed from a Module.
-/// We keep the module pointer up to date.
+/// We keep the module pointer up to date, and notify the listeners of the
+/// module.
 void llvm::ilist_traits<Function>::removeNodeFromList(Function *function) {
   assert(function->module && "not already in a module!");
+  for (auto *listener : function->module->listeners)
+    listener->notifyFunctionRemoved(function);
 
   // Remove the symbol table entry.
   function->module->symbolTable.erase(function->getName());
@@ -116,6 +120,12 @@ void Function::erase() {
   getModule()->getFunctions().erase(this);
 }
 
+void Function::reportBodyMaterializationFailure() {
+  llvm::report_fatal_error("accessing the body of function @" +
+                           getName().strref() +
+                           ", which failed to materialize");
+}
+
 /// Emit an error about fatal conditions with this function, reporting up to
 /// any diagnostic handlers that may be listening.  This function always
 /// returns failure.  NOTE: This may terminate the containing application, only
@@ -155,7 +165,7 @@ void Function::cloneInto(Function *dest, BlockAndValueMapping &mapper) {
   dest->setAttrs(newAttrs.takeVector());
 
   // Clone the body.
-  body.cloneInto(&dest->body, mapper, getContext());
+  getBody().cloneInto(&dest->getBody(), mapper, getContext());
 }
 
 /// Create a deep copy of this function and all of its blocks, remapping
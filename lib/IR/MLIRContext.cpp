@@ -35,12 +35,18 @@
 #include "mlir/IR/Types.h"
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/RWMutex.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <memory>
 
 using namespace mlir;
@@ -49,6 +55,73 @@ using namespace mlir::detail;
 using llvm::hash_combine;
 using llvm::hash_combine_range;
 
+#define DEBUG_TYPE "mlir-context"
+
+STATISTIC(NumSharedLockAcquires,
+          "Number of shared locks taken to lookup uniqued instances");
+STATISTIC(NumExclusiveLockAcquires,
+          "Number of exclusive locks taken to create uniqued instances");
+
+namespace {
+/// A fixed-size, direct-mapped cache of uniqued instances that can be queried
+/// without taking any lock. This sits in front of the uniquing tables that are
+/// protected by a mutex, so that repeated lookups of the same instance on hot
+/// paths never touch the mutex.
+///
+/// Instances are only inserted once they are fully constructed, and are never
+/// freed before the context is destroyed. A lookup may thus observe a stale
+/// entry, but never a dangling one: every hit is validated by comparing the
+/// cached instance with the lookup key.
+template <typename StorageT, unsigned NumEntries = 256> class LockFreeCache {
+  static_assert(llvm::isPowerOf2_32(NumEntries),
+                "expected a power of two number of entries");
+
+public:
+  LockFreeCache() {
+    for (auto &entry : entries)
+      entry.store(nullptr, std::memory_order_relaxed);
+  }
+
+  /// Return the cached instance for the given hash value if it is equal to the
+  /// lookup key, as checked by `isEqual`. Returns null otherwise.
+  template <typename IsEqualFn>
+  StorageT *lookup(unsigned hashValue, IsEqualFn &&isEqual) {
+    StorageT *storage = getEntry(hashValue).load(std::memory_order_acquire);
+    if (!storage || !isEqual(storage))
+      return nullptr;
+    return storage;
+  }
+
+  /// Insert the given instance into the cache, evicting any instance with a
+  /// conflicting hash value.
+  void insert(unsigned hashValue, StorageT *storage) {
+    getEntry(hashValue).store(storage, std::memory_order_release);
+  }
+
+private:
+  std::atomic<StorageT *> &getEntry(unsigned hashValue) {
+    return entries[hashValue & (NumEntries - 1)];
+  }
+
+  std::atomic<StorageT *> entries[NumEntries];
+};
+} // end anonymous namespace
+
+/// A utility function to get or create a uniqued instance, first checking the
+/// given lock-free cache. `getOrCreateFn` is invoked on a cache miss, and its
+/// result is added to the cache.
+template <typename StorageT, unsigned NumEntries, typename IsEqualFn,
+          typename GetOrCreateFn>
+static StorageT *cachedGetOrCreate(LockFreeCache<StorageT, NumEntries> &cache,
+                                   unsigned hashValue, IsEqualFn &&isEqual,
+                                   GetOrCreateFn &&getOrCreateFn) {
+  if (StorageT *storage = cache.lookup(hashValue, isEqual))
+    return storage;
+  StorageT *storage = getOrCreateFn();
+  cache.insert(hashValue, storage);
+  return storage;
+}
+
 /// A utility function to safely get or create a uniqued instance within the
 /// given set container.
 template <typename ValueT, typename DenseInfoT, typename KeyT,
@@ -57,6 +130,7 @@ static ValueT safeGetOrCreate(DenseSet<ValueT, DenseInfoT> &container,
                               KeyT &&key, llvm::sys::SmartRWMutex<true> &mutex,
                               ConstructorFn &&constructorFn) {
   { // Check for an existing instance in read-only mode.
+    ++NumSharedLockAcquires;
     llvm::sys::SmartScopedReader<true> instanceLock(mutex);
     auto it = container.find_as(key);
     if (it != container.end())
@@ -64,6 +138,7 @@ static ValueT safeGetOrCreate(DenseSet<ValueT, DenseInfoT> &container,
   }
 
   // Aquire a writer-lock so that we can safely create the new instance.
+  ++NumExclusiveLockAcquires;
   llvm::sys::SmartScopedWriter<true> instanceLock(mutex);
 
   // Check for an existing instance again here, because another writer thread
@@ -83,12 +158,14 @@ ValueT safeGetOrCreate(std::vector<ValueT> &container, unsigned position,
                        llvm::sys::SmartRWMutex<true> &mutex,
                        ConstructorFn &&constructorFn) {
   { // Check for an existing instance in read-only mode.
+    ++NumSharedLockAcquires;
     llvm::sys::SmartScopedReader<true> lock(mutex);
     if (container.size() > position && container[position])
       return container[position];
   }
 
   // Aquire a writer-lock so that we can safely create the new instance.
+  ++NumExclusiveLockAcquires;
   llvm::sys::SmartScopedWriter<true> lock(mutex);
 
   // Check if we need to resize.
@@ -112,6 +189,7 @@ safeGetOrCreate(ContainerTy &container, KeyT &&key,
                 llvm::sys::SmartRWMutex<true> &mutex,
                 ConstructorFn &&constructorFn) {
   { // Check for an existing instance in read-only mode.
+    ++NumSharedLockAcquires;
     llvm::sys::SmartScopedReader<true> instanceLock(mutex);
     auto it = container.find(key);
     if (it != container.end())
@@ -119,6 +197,7 @@ safeGetOrCreate(ContainerTy &container, KeyT &&key,
   }
 
   // Aquire a writer-lock so that we can safely create the new instance.
+  ++NumExclusiveLockAcquires;
   llvm::sys::SmartScopedWriter<true> instanceLock(mutex);
 
   // Check for an existing instance again here, because another writer thread
@@ -279,10 +358,14 @@ public:
   /// These are filename locations uniqued into this MLIRContext.
   llvm::StringMap<char, llvm::BumpPtrAllocator &> filenames;
 
+  /// Lock-free cache of uniqued filenames.
+  LockFreeCache<llvm::StringMapEntry<char>> filenameCache;
+
   /// FileLineColLoc uniquing.
   DenseMap<std::tuple<const char *, unsigned, unsigned>,
            FileLineColLocationStorage *>
       fileLineColLocs;
+  LockFreeCache<FileLineColLocationStorage> fileLineColLocCache;
 
   /// NameLocation uniquing.
   DenseMap<const char *, NameLocationStorage *> nameLocs;
@@ -329,6 +412,9 @@ public:
   /// These are identifiers uniqued into this MLIRContext.
   llvm::StringMap<char, llvm::BumpPtrAllocator &> identifiers;
 
+  /// Lock-free cache of recently used identifiers.
+  LockFreeCache<llvm::StringMapEntry<char>> identifierCache;
+
   //===--------------------------------------------------------------------===//
   // Affine uniquing
   //===--------------------------------------------------------------------===//
@@ -347,15 +433,20 @@ public:
 
   // Affine binary op expression uniquing. Figure out uniquing of dimensional
   // or symbolic identifiers.
-  DenseMap<std::tuple<unsigned, AffineExpr, AffineExpr>, AffineExpr>
+  DenseMap<std::tuple<unsigned, AffineExpr, AffineExpr>,
+           AffineBinaryOpExprStorage *>
       affineExprs;
+  LockFreeCache<AffineBinaryOpExprStorage> affineExprCache;
 
   // Uniqui'ing of AffineDimExpr, AffineSymbolExpr's by their position.
   std::vector<AffineDimExprStorage *> dimExprs;
   std::vector<AffineSymbolExprStorage *> symbolExprs;
+  LockFreeCache<AffineDimExprStorage, 64> dimExprCache;
+  LockFreeCache<AffineSymbolExprStorage, 64> symbolExprCache;
 
   // Uniqui'ing of AffineConstantExprStorage using constant value as key.
   DenseMap<int64_t, AffineConstantExprStorage *> constExprs;
+  LockFreeCache<AffineConstantExprStorage> constExprCache;
 
   //===--------------------------------------------------------------------===//
   // SDBM uniquing
@@ -385,6 +476,12 @@ public:
   //===--------------------------------------------------------------------===//
   // Attribute uniquing
   //===--------------------------------------------------------------------===//
+
+  // Buffers retained by the context, that attributes may refer to.  They are
+  // declared before the attribute uniquer, so that they outlive the attributes.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> retainedBuffers;
+  llvm::sys::SmartMutex<true> retainedBufferMutex;
+
   StorageUniquer attributeUniquer;
 
   // Attribute list allocator and mutex for thread safety.
@@ -395,6 +492,14 @@ public:
       DenseSet<AttributeListStorage *, AttributeListKeyInfo>;
   AttributeListSet attributeLists;
 
+  //===--------------------------------------------------------------------===//
+  // Threading
+  //===--------------------------------------------------------------------===//
+
+  // The thread pool used to process IR in parallel.  Its worker threads are
+  // only created when it is first used.
+  WorkStealingThreadPool threadPool;
+
 public:
   MLIRContextImpl()
       : filenames(locationAllocator), identifiers(identifierAllocator) {}
@@ -463,6 +568,11 @@ InFlightDiagnostic MLIRContext::emitRemark(Location location,
 /// Returns the diagnostic engine for this context.
 DiagnosticEngine &MLIRContext::getDiagEngine() { return getImpl().diagEngine; }
 
+/// Returns the thread pool used to process IR in parallel.
+WorkStealingThreadPool &MLIRContext::getThreadPool() {
+  return getImpl().threadPool;
+}
+
 //===----------------------------------------------------------------------===//
 // Dialect and Operation Registration
 //===----------------------------------------------------------------------===//
@@ -589,18 +699,26 @@ Identifier Identifier::get(StringRef str, MLIRContext *context) {
          "Cannot create an identifier with a nul character");
 
   auto &impl = context->getImpl();
-
-  { // Check for an existing identifier in read-only mode.
-    llvm::sys::SmartScopedReader<true> contextLock(impl.identifierMutex);
-    auto it = impl.identifiers.find(str);
-    if (it != impl.identifiers.end())
-      return Identifier(it->getKeyData());
-  }
-
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> contextLock(impl.identifierMutex);
-  auto it = impl.identifiers.insert({str, char()}).first;
-  return Identifier(it->getKeyData());
+  using EntryT = llvm::StringMapEntry<char>;
+
+  auto *result = cachedGetOrCreate(
+      impl.identifierCache, llvm::hash_value(str),
+      [&](EntryT *entry) { return entry->getKey() == str; },
+      [&]() -> EntryT * {
+        { // Check for an existing identifier in read-only mode.
+          ++NumSharedLockAcquires;
+          llvm::sys::SmartScopedReader<true> contextLock(impl.identifierMutex);
+          auto it = impl.identifiers.find(str);
+          if (it != impl.identifiers.end())
+            return &*it;
+        }
+
+        // Aquire a writer-lock so that we can safely create the new instance.
+        ++NumExclusiveLockAcquires;
+        llvm::sys::SmartScopedWriter<true> contextLock(impl.identifierMutex);
+        return &*impl.identifiers.insert({str, char()}).first;
+      });
+  return Identifier(result->getKeyData());
 }
 
 //===----------------------------------------------------------------------===//
@@ -613,11 +731,26 @@ UnknownLoc UnknownLoc::get(MLIRContext *context) {
 
 UniquedFilename UniquedFilename::get(StringRef filename, MLIRContext *context) {
   auto &impl = context->getImpl();
-
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> locationLock(impl.locationMutex);
-  auto it = impl.filenames.insert({filename, char()}).first;
-  return UniquedFilename(it->getKeyData());
+  using EntryT = llvm::StringMapEntry<char>;
+
+  auto *result = cachedGetOrCreate(
+      impl.filenameCache, llvm::hash_value(filename),
+      [&](EntryT *entry) { return entry->getKey() == filename; },
+      [&]() -> EntryT * {
+        { // Check for an existing filename in read-only mode.
+          ++NumSharedLockAcquires;
+          llvm::sys::SmartScopedReader<true> locationLock(impl.locationMutex);
+          auto it = impl.filenames.find(filename);
+          if (it != impl.filenames.end())
+            return &*it;
+        }
+
+        // Aquire a writer-lock so that we can safely create the new instance.
+        ++NumExclusiveLockAcquires;
+        llvm::sys::SmartScopedWriter<true> locationLock(impl.locationMutex);
+        return &*impl.filenames.insert({filename, char()}).first;
+      });
+  return UniquedFilename(result->getKeyData());
 }
 
 FileLineColLoc FileLineColLoc::get(UniquedFilename filename, unsigned line,
@@ -626,10 +759,20 @@ FileLineColLoc FileLineColLoc::get(UniquedFilename filename, unsigned line,
 
   // Safely get or create a location instance.
   auto key = std::make_tuple(filename.data(), line, column);
-  return safeGetOrCreate(impl.fileLineColLocs, key, impl.locationMutex, [&] {
-    return new (impl.locationAllocator.Allocate<FileLineColLocationStorage>())
-        FileLineColLocationStorage(filename, line, column);
-  });
+  auto isEqual = [&](FileLineColLocationStorage *storage) {
+    return storage->filename.data() == filename.data() &&
+           storage->line == line && storage->column == column;
+  };
+  return cachedGetOrCreate(
+      impl.fileLineColLocCache, hash_combine(filename.data(), line, column),
+      isEqual, [&] {
+        return safeGetOrCreate(
+            impl.fileLineColLocs, key, impl.locationMutex, [&] {
+              return new (impl.locationAllocator
+                              .Allocate<FileLineColLocationStorage>())
+                  FileLineColLocationStorage(filename, line, column);
+            });
+      });
 }
 
 NameLoc NameLoc::get(Identifier name, MLIRContext *context) {
@@ -839,6 +982,13 @@ StorageUniquer &MLIRContext::getAttributeUniquer() {
   return getImpl().attributeUniquer;
 }
 
+/// Transfer the ownership of the given buffer to the context.
+void MLIRContext::retainBuffer(std::unique_ptr<llvm::MemoryBuffer> buffer) {
+  auto &impl = getImpl();
+  llvm::sys::SmartScopedLock<true> lock(impl.retainedBufferMutex);
+  impl.retainedBuffers.push_back(std::move(buffer));
+}
+
 /// Perform a three-way comparison between the names of the specified
 /// NamedAttributes.
 static int compareNamedAttributes(const NamedAttribute *lhs,
@@ -1139,11 +1289,23 @@ AffineExpr AffineBinaryOpExprStorage::get(AffineExprKind kind, AffineExpr lhs,
   // Check if we already have this affine expression, and return it if we do.
   auto keyValue = std::make_tuple((unsigned)kind, lhs, rhs);
 
+  // Check the lock-free cache first.
+  unsigned hashValue = hash_combine((unsigned)kind, lhs, rhs);
+  auto isEqual = [&](AffineBinaryOpExprStorage *storage) {
+    return storage->contextAndKind.getInt() == kind && storage->lhs == lhs &&
+           storage->rhs == rhs;
+  };
+  if (auto *storage = impl.affineExprCache.lookup(hashValue, isEqual))
+    return storage;
+
   { // Check for an existing instance in read-only mode.
+    ++NumSharedLockAcquires;
     llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
     auto cached = impl.affineExprs.find(keyValue);
-    if (cached != impl.affineExprs.end())
+    if (cached != impl.affineExprs.end()) {
+      impl.affineExprCache.insert(hashValue, cached->second);
       return cached->second;
+    }
   }
 
   // Simplify the expression if possible.
@@ -1173,6 +1335,7 @@ AffineExpr AffineBinaryOpExprStorage::get(AffineExprKind kind, AffineExpr lhs,
     return simplified;
 
   // Aquire a writer-lock so that we can safely create the new instance.
+  ++NumExclusiveLockAcquires;
   llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
 
   // Check for an existing instance again here, because another writer thread
@@ -1184,6 +1347,7 @@ AffineExpr AffineBinaryOpExprStorage::get(AffineExprKind kind, AffineExpr lhs,
     result = new (impl.affineAllocator.Allocate<AffineBinaryOpExprStorage>())
         AffineBinaryOpExprStorage{{kind, lhs.getContext()}, lhs, rhs};
   }
+  impl.affineExprCache.insert(hashValue, result);
   return result;
 }
 
@@ -1195,26 +1359,44 @@ AffineExpr mlir::getAffineBinaryOpExpr(AffineExprKind kind, AffineExpr lhs,
 AffineExpr mlir::getAffineDimExpr(unsigned position, MLIRContext *context) {
   auto &impl = context->getImpl();
 
-  return safeGetOrCreate(
-      impl.dimExprs, position, impl.affineMutex, [&impl, context, position] {
-        auto *result = impl.affineAllocator.Allocate<AffineDimExprStorage>();
-        // Initialize the memory using placement new.
-        new (result)
-            AffineDimExprStorage{{AffineExprKind::DimId, context}, position};
-        return result;
+  return cachedGetOrCreate(
+      impl.dimExprCache, position,
+      [&](AffineDimExprStorage *storage) {
+        return storage->position == position;
+      },
+      [&] {
+        return safeGetOrCreate(
+            impl.dimExprs, position, impl.affineMutex,
+            [&impl, context, position] {
+              auto *result =
+                  impl.affineAllocator.Allocate<AffineDimExprStorage>();
+              // Initialize the memory using placement new.
+              new (result) AffineDimExprStorage{
+                  {AffineExprKind::DimId, context}, position};
+              return result;
+            });
       });
 }
 
 AffineExpr mlir::getAffineSymbolExpr(unsigned position, MLIRContext *context) {
   auto &impl = context->getImpl();
 
-  return safeGetOrCreate(
-      impl.symbolExprs, position, impl.affineMutex, [&impl, context, position] {
-        auto *result = impl.affineAllocator.Allocate<AffineSymbolExprStorage>();
-        // Initialize the memory using placement new.
-        new (result) AffineSymbolExprStorage{
-            {AffineExprKind::SymbolId, context}, position};
-        return result;
+  return cachedGetOrCreate(
+      impl.symbolExprCache, position,
+      [&](AffineSymbolExprStorage *storage) {
+        return storage->position == position;
+      },
+      [&] {
+        return safeGetOrCreate(
+            impl.symbolExprs, position, impl.affineMutex,
+            [&impl, context, position] {
+              auto *result =
+                  impl.affineAllocator.Allocate<AffineSymbolExprStorage>();
+              // Initialize the memory using placement new.
+              new (result) AffineSymbolExprStorage{
+                  {AffineExprKind::SymbolId, context}, position};
+              return result;
+            });
       });
 }
 
@@ -1222,11 +1404,20 @@ AffineExpr mlir::getAffineConstantExpr(int64_t constant, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create an AffineConstantExpr instance.
-  return safeGetOrCreate(impl.constExprs, constant, impl.affineMutex, [&] {
-    auto *result = impl.affineAllocator.Allocate<AffineConstantExprStorage>();
-    return new (result) AffineConstantExprStorage{
-        {AffineExprKind::Constant, context}, constant};
-  });
+  return cachedGetOrCreate(
+      impl.constExprCache, llvm::hash_value(constant),
+      [&](AffineConstantExprStorage *storage) {
+        return storage->constant == constant;
+      },
+      [&] {
+        return safeGetOrCreate(
+            impl.constExprs, constant, impl.affineMutex, [&] {
+              auto *result =
+                  impl.affineAllocator.Allocate<AffineConstantExprStorage>();
+              return new (result) AffineConstantExprStorage{
+                  {AffineExprKind::Constant, context}, constant};
+            });
+      });
 }
 
 //===----------------------------------------------------------------------===//
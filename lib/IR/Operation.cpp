@@ -338,12 +338,40 @@ bool Operation::isBeforeInBlock(Operation *other) {
   assert(block && "Operations without parent blocks have no order.");
   assert(other && other->block == block &&
          "Expected other operation to have the same parent block.");
-  // Recompute the parent ordering if necessary.
-  if (!block->isInstOrderValid())
+  // Recompute the parent ordering if necessary, or number the operations that
+  // were inserted since it was computed.
+  if (!block->isInstOrderValid()) {
     block->recomputeInstOrder();
+  } else {
+    updateOrderIfNecessary();
+    other->updateOrderIfNecessary();
+  }
   return orderIndex < other->orderIndex;
 }
 
+void Operation::updateOrderIfNecessary() {
+  assert(block && "expected a parent block");
+  if (hasValidOrder())
+    return;
+
+  // Place the operation after its previous operation, or before its next one,
+  // if there is an index left in between.
+  Block::iterator it(this);
+  Operation *prevOp = it == block->begin() ? nullptr : &*std::prev(it);
+  Operation *nextOp = std::next(it) == block->end() ? nullptr : &*std::next(it);
+  if ((prevOp && !prevOp->hasValidOrder()) ||
+      (nextOp && !nextOp->hasValidOrder()) || (!prevOp && !nextOp))
+    return block->recomputeInstOrder();
+  if (!nextOp) {
+    orderIndex = prevOp->orderIndex + kOrderStride;
+    return;
+  }
+  unsigned prevIndex = prevOp ? prevOp->orderIndex : 0;
+  if (prevIndex + 1 >= nextOp->orderIndex)
+    return block->recomputeInstOrder();
+  orderIndex = prevIndex + (nextOp->orderIndex - prevIndex) / 2;
+}
+
 //===----------------------------------------------------------------------===//
 // ilist_traits for Operation
 //===----------------------------------------------------------------------===//
@@ -390,8 +418,8 @@ void llvm::ilist_traits<::mlir::Operation>::addNodeToList(Operation *op) {
   assert(!op->getBlock() && "already in a operation block!");
   op->block = getContainingBlock();
 
-  // Invalidate the block ordering.
-  op->block->invalidateInstOrder();
+  // The operation is numbered lazily, when its order is first queried.
+  op->orderIndex = Operation::kInvalidOrderIdx;
 }
 
 /// This is a trait method invoked when a operation is removed from a block.
@@ -38,6 +38,8 @@ unsigned short PatternBenefit::getBenefit() const {
 Pattern::Pattern(StringRef rootName, PatternBenefit benefit,
                  MLIRContext *context)
     : rootKind(OperationName(rootName, context)), benefit(benefit) {}
+Pattern::Pattern(PatternBenefit benefit, MatchAnyOpTypeTag)
+    : benefit(benefit) {}
 
 // Out-of-line vtable anchor.
 void Pattern::anchor() {}
@@ -126,25 +128,52 @@ RewritePatternMatcher::RewritePatternMatcher(
     OwningRewritePatternList &&patterns, PatternRewriter &rewriter)
     : patterns(std::move(patterns)), rewriter(rewriter) {
   // Sort the patterns by benefit to simplify the matching logic.
+  auto byBenefit = [](const RewritePattern *l, const RewritePattern *r) {
+    return r->getBenefit() < l->getBenefit();
+  };
   std::stable_sort(this->patterns.begin(), this->patterns.end(),
-                   [](const std::unique_ptr<RewritePattern> &l,
-                      const std::unique_ptr<RewritePattern> &r) {
-                     return r->getBenefit() < l->getBenefit();
+                   [&](const std::unique_ptr<RewritePattern> &l,
+                       const std::unique_ptr<RewritePattern> &r) {
+                     return byBenefit(l.get(), r.get());
                    });
+
+  // Bucket the patterns by root operation. Patterns that are impossible to
+  // match are dropped entirely. Inserting in sorted order keeps each bucket
+  // sorted by benefit.
+  for (auto &pattern : this->patterns) {
+    if (pattern->getBenefit().isImpossibleToMatch())
+      continue;
+    if (Optional<OperationName> rootKind = pattern->getRootKind())
+      opPatterns[*rootKind].push_back(pattern.get());
+    else
+      anyOpPatterns.push_back(pattern.get());
+  }
+
+  // Merge the patterns that match any operation into each of the root
+  // specific buckets. A stable merge preserves the relative order of patterns
+  // with equal benefit.
+  if (anyOpPatterns.empty())
+    return;
+  for (auto &it : opPatterns) {
+    PatternListT merged;
+    merged.reserve(it.second.size() + anyOpPatterns.size());
+    std::merge(it.second.begin(), it.second.end(), anyOpPatterns.begin(),
+               anyOpPatterns.end(), std::back_inserter(merged), byBenefit);
+    it.second = std::move(merged);
+  }
 }
 
 /// Try to match the given operation to a pattern and rewrite it.
 bool RewritePatternMatcher::matchAndRewrite(Operation *op) {
-  for (auto &pattern : patterns) {
-    // Ignore patterns that are for the wrong root or are impossible to match.
-    if (pattern->getRootKind() != op->getName() ||
-        pattern->getBenefit().isImpossibleToMatch())
-      continue;
-
-    // Try to match and rewrite this pattern. The patterns are sorted by
-    // benefit, so if we match we can immediately rewrite and return.
+  // Only consider the patterns that may apply to this operation.
+  auto it = opPatterns.find(op->getName());
+  ArrayRef<RewritePattern *> candidates =
+      it == opPatterns.end() ? anyOpPatterns : it->second;
+
+  // Try to match and rewrite each pattern. The patterns are sorted by benefit,
+  // so if we match we can immediately rewrite and return.
+  for (auto *pattern : candidates)
     if (pattern->matchAndRewrite(op, rewriter))
       return true;
-  }
   return false;
 }
@@ -37,9 +37,16 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace mlir;
 
+static llvm::cl::opt<bool> clParallelLowering(
+    "lower-to-llvm-parallel",
+    llvm::cl::desc("Convert the functions to the LLVM IR dialect concurrently, "
+                   "on the thread pool of the context"),
+    llvm::cl::init(false));
+
 namespace {
 // Type converter for the LLVM IR dialect.  Converts MLIR standard and builtin
 // types into equivalent LLVM IR dialect types.
@@ -73,10 +80,19 @@ public:
       llvm::function_ref<Type(Type)> typeConversionCallback = {});
 
 private:
-  // Construct a type converter.
+  // Construct a type converter.  The lock of the LLVM IR dialect is only held
+  // while LLVM types are constructed in the shared LLVM context, so that the
+  // functions converted concurrently don't wait for each other's conversions.
   explicit TypeConverter(llvm::Module &llvmModule, MLIRContext *context)
-      : module(llvmModule), llvmContext(llvmModule.getContext()),
-        builder(llvmModule.getContext()), mlirContext(context) {}
+      : mutex(getLLVMDialect(context).getMutex()), module(llvmModule),
+        llvmContext(llvmModule.getContext()), builder(llvmModule.getContext()),
+        mlirContext(context) {}
+
+  // Get the LLVM IR dialect registered in `context`.
+  static LLVM::LLVMDialect &getLLVMDialect(MLIRContext *context) {
+    return *static_cast<LLVM::LLVMDialect *>(
+        context->getRegisteredDialect("llvm"));
+  }
 
   // Convert a function type.  The arguments and results are converted one by
   // one.  Additionally, if the function returns more than one value, pack the
@@ -142,6 +158,7 @@ private:
     return wrappedLLVMType.getUnderlyingType();
   }
 
+  llvm::sys::SmartMutex<true> &mutex;
   llvm::Module &module;
   llvm::LLVMContext &llvmContext;
   llvm::IRBuilder<> builder;
@@ -151,6 +168,7 @@ private:
 } // end anonymous namespace
 
 llvm::IntegerType *TypeConverter::getIndexType() {
+  llvm::sys::SmartScopedLock<true> lock(mutex);
   return builder.getIntNTy(module.getDataLayout().getPointerSizeInBits());
 }
 
@@ -159,6 +177,7 @@ Type TypeConverter::convertIndexType(IndexType type) {
 }
 
 Type TypeConverter::convertIntegerType(IntegerType type) {
+  llvm::sys::SmartScopedLock<true> lock(mutex);
   return wrap(builder.getIntNTy(type.getWidth()));
 }
 
@@ -199,6 +218,7 @@ Type TypeConverter::getPackedResultType(ArrayRef<Type> types) {
   // pack them into an LLVM struct type.
   if (resultTypes.size() == 1)
     return wrap(resultTypes.front());
+  llvm::sys::SmartScopedLock<true> lock(mutex);
   return wrap(llvm::StructType::get(llvmContext, resultTypes));
 }
 
@@ -224,6 +244,7 @@ Type TypeConverter::convertFunctionType(FunctionType type) {
                                : unwrap(getPackedResultType(type.getResults()));
   if (!resultType)
     return {};
+  llvm::sys::SmartScopedLock<true> lock(mutex);
   return wrap(llvm::FunctionType::get(resultType, argTypes, /*isVarArg=*/false)
                   ->getPointerTo());
 }
@@ -261,6 +282,7 @@ Type TypeConverter::convertMemRefType(MemRefType type) {
   llvm::Type *elementType = unwrap(convertType(type.getElementType()));
   if (!elementType)
     return {};
+  llvm::sys::SmartScopedLock<true> lock(mutex);
   auto ptrType = elementType->getPointerTo();
 
   // Extra value for the memory space.
@@ -284,9 +306,10 @@ Type TypeConverter::convertVectorType(VectorType type) {
   }
 
   llvm::Type *elementType = unwrap(convertType(type.getElementType()));
-  return elementType
-             ? wrap(llvm::VectorType::get(elementType, type.getShape().front()))
-             : Type();
+  if (!elementType)
+    return {};
+  llvm::sys::SmartScopedLock<true> lock(mutex);
+  return wrap(llvm::VectorType::get(elementType, type.getShape().front()));
 }
 
 // Dispatch based on the actual type.  Return null type on error.
@@ -327,6 +350,8 @@ Type TypeConverter::getMemRefElementPtrType(MemRefType t,
   if (!converted)
     return {};
   llvm::Type *llvmType = converted.cast<LLVM::LLVMType>().getUnderlyingType();
+  llvm::sys::SmartScopedLock<true> lock(
+      getLLVMDialect(t.getContext()).getMutex());
   return LLVM::LLVMType::get(t.getContext(), llvmType->getPointerTo());
 }
 
@@ -365,6 +390,7 @@ public:
   // Get the MLIR type wrapping the LLVM integer type whose bit width is defined
   // by the pointer size used in the LLVM module.
   LLVM::LLVMType getIndexType() const {
+    llvm::sys::SmartScopedLock<true> lock(dialect.getMutex());
     llvm::Type *llvmType = llvm::Type::getIntNTy(
         getContext(), getModule().getDataLayout().getPointerSizeInBits());
     return LLVM::LLVMType::get(dialect.getContext(), llvmType);
@@ -372,10 +398,25 @@ public:
 
   // Get the MLIR type wrapping the LLVM i8* type.
   LLVM::LLVMType getVoidPtrType() const {
+    llvm::sys::SmartScopedLock<true> lock(dialect.getMutex());
     return LLVM::LLVMType::get(dialect.getContext(),
                                llvm::Type::getInt8PtrTy(getContext()));
   }
 
+  // Get the function named `name` in the module of `op`, or declare it with
+  // the given type if the module doesn't contain it yet.  The dialect lock is
+  // held since other functions of the module may be converted concurrently.
+  Function *getOrDeclareFunction(Operation *op, StringRef name,
+                                 FunctionType type) const {
+    llvm::sys::SmartScopedLock<true> lock(dialect.getMutex());
+    Module *module = op->getFunction()->getModule();
+    if (Function *func = module->getNamedFunction(name))
+      return func;
+    auto *func = new Function(UnknownLoc::get(op->getContext()), name, type);
+    module->getFunctions().push_back(func);
+    return func;
+  }
+
   // Create an LLVM IR pseudo-operation defining the given index constant.
   Value *createIndexConstant(FuncBuilder &builder, Location loc,
                              uint64_t value) const {
@@ -606,14 +647,9 @@ struct AllocOpLowering : public LLVMLegalizationPattern<AllocOp> {
             createIndexConstant(rewriter, op->getLoc(), elementSize)});
 
     // Insert the `malloc` declaration if it is not already present.
-    Function *mallocFunc =
-        op->getFunction()->getModule()->getNamedFunction("malloc");
-    if (!mallocFunc) {
-      auto mallocType =
-          rewriter.getFunctionType(getIndexType(), getVoidPtrType());
-      mallocFunc = new Function(rewriter.getUnknownLoc(), "malloc", mallocType);
-      op->getFunction()->getModule()->getFunctions().push_back(mallocFunc);
-    }
+    Function *mallocFunc = getOrDeclareFunction(
+        op, "malloc",
+        rewriter.getFunctionType(getIndexType(), getVoidPtrType()));
 
     // Allocate the underlying buffer and store a pointer to it in the MemRef
     // descriptor.
@@ -623,11 +659,8 @@ struct AllocOpLowering : public LLVMLegalizationPattern<AllocOp> {
                                   rewriter.getFunctionAttr(mallocFunc),
                                   cumulativeSize)
             .getResult(0);
-    auto structElementType = TypeConverter::convert(elementType, getModule());
-    auto elementPtrType = LLVM::LLVMType::get(
-        op->getContext(), structElementType.cast<LLVM::LLVMType>()
-                              .getUnderlyingType()
-                              ->getPointerTo());
+    auto elementPtrType =
+        TypeConverter::getMemRefElementPtrType(type, getModule());
     allocated = rewriter.create<LLVM::BitcastOp>(op->getLoc(), elementPtrType,
                                                  ArrayRef<Value *>(allocated));
 
@@ -669,13 +702,8 @@ struct DeallocOpLowering : public LLVMLegalizationPattern<DeallocOp> {
     assert(operands.size() == 1 && "dealloc takes one operand");
 
     // Insert the `free` declaration if it is not already present.
-    Function *freeFunc =
-        op->getFunction()->getModule()->getNamedFunction("free");
-    if (!freeFunc) {
-      auto freeType = rewriter.getFunctionType(getVoidPtrType(), {});
-      freeFunc = new Function(rewriter.getUnknownLoc(), "free", freeType);
-      op->getFunction()->getModule()->getFunctions().push_back(freeFunc);
-    }
+    Function *freeFunc = getOrDeclareFunction(
+        op, "free", rewriter.getFunctionType(getVoidPtrType(), {}));
 
     auto *type =
         operands[0]->getType().cast<LLVM::LLVMType>().getUnderlyingType();
@@ -1169,8 +1197,11 @@ public:
   void runOnModule() override {
     Module *m = &getModule();
     LLVM::ensureDistinctSuccessors(m);
-    if (failed(impl.convert(m)))
-      signalPassFailure();
+    if (failed(impl.convert(m, clParallelLowering
+                                   ? ConversionMode::ParallelInPlace
+                                   : ConversionMode::Clone)))
+      return signalPassFailure();
+    LLVM::lowerParallelCalls(m);
   }
 
 private:
@@ -0,0 +1,229 @@
+//===- LowerParallelCalls.cpp - Lower parallel loops to the runtime -------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the lowering of the calls to the functions outlined by
+// the loop parallelization pass, once converted to the LLVM IR dialect, to
+// calls to the parallel loop runtime of the ExecutionEngine.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/LLVMIR/LLVMDialect.h"
+#include "mlir/LLVMIR/Transforms.h"
+
+#include "llvm/IR/DerivedTypes.h"
+
+using namespace mlir;
+
+namespace {
+/// Lowers the parallel calls of a module to calls to the runtime function
+/// `mlirParallelFor`, which calls a task function on chunks of iterations.
+///
+/// The values passed to the outlined function in addition to the bounds of the
+/// iterations are stored in a structure allocated on the stack of the caller.
+/// A task function is created for each outlined function, which unpacks this
+/// structure and calls the outlined function with the bounds of a chunk.
+class ParallelCallLowering {
+public:
+  ParallelCallLowering(Module &module, LLVM::LLVMDialect &dialect);
+
+  void lower(LLVM::CallOp callOp);
+
+private:
+  LLVM::LLVMType wrap(llvm::Type *type) {
+    return LLVM::LLVMType::get(module.getContext(), type);
+  }
+  llvm::Type *unwrap(Type type) {
+    return type.cast<LLVM::LLVMType>().getUnderlyingType();
+  }
+
+  // Returns the structure type holding the values passed to 'outlined' in
+  // addition to the bounds of the iterations.
+  llvm::StructType *getContextType(Function *outlined);
+  // Returns the task function calling 'outlined', creating it if needed.
+  Function *getTaskFunction(Function *outlined);
+  // Returns the runtime function, declaring it if needed.
+  Function *getRuntimeFunction();
+  // Returns a pointer to field 'index' of the structure pointed to by 'ptr'.
+  Value *createFieldPtr(FuncBuilder &builder, Location loc, Value *ptr,
+                        llvm::StructType *type, unsigned index);
+
+  Module &module;
+  llvm::LLVMContext &llvmContext;
+  LLVM::LLVMType indexType, int32Type, int64Type, voidPtrType, taskPtrType;
+  DenseMap<Function *, Function *> taskFunctions;
+};
+} // end anonymous namespace
+
+ParallelCallLowering::ParallelCallLowering(Module &module,
+                                           LLVM::LLVMDialect &dialect)
+    : module(module), llvmContext(dialect.getLLVMContext()) {
+  auto *llvmIndexType = llvm::Type::getIntNTy(
+      llvmContext,
+      dialect.getLLVMModule().getDataLayout().getPointerSizeInBits());
+  auto *llvmVoidPtrType = llvm::Type::getInt8PtrTy(llvmContext);
+  indexType = wrap(llvmIndexType);
+  int32Type = wrap(llvm::Type::getInt32Ty(llvmContext));
+  int64Type = wrap(llvm::Type::getInt64Ty(llvmContext));
+  voidPtrType = wrap(llvmVoidPtrType);
+  taskPtrType = wrap(llvm::FunctionType::get(
+                         llvm::Type::getVoidTy(llvmContext),
+                         {llvmVoidPtrType, llvmIndexType, llvmIndexType},
+                         /*isVarArg=*/false)
+                         ->getPointerTo());
+}
+
+llvm::StructType *ParallelCallLowering::getContextType(Function *outlined) {
+  SmallVector<llvm::Type *, 8> fieldTypes;
+  for (Type type : outlined->getType().getInputs().drop_front(2))
+    fieldTypes.push_back(unwrap(type));
+  return llvm::StructType::get(llvmContext, fieldTypes);
+}
+
+Value *ParallelCallLowering::createFieldPtr(FuncBuilder &builder, Location loc,
+                                            Value *ptr, llvm::StructType *type,
+                                            unsigned index) {
+  Value *zero = builder.create<LLVM::ConstantOp>(
+      loc, int32Type, builder.getI32IntegerAttr(0));
+  Value *field = builder.create<LLVM::ConstantOp>(
+      loc, int32Type, builder.getI32IntegerAttr(index));
+  auto fieldPtrType = wrap(type->getElementType(index)->getPointerTo());
+  return builder.create<LLVM::GEPOp>(loc, fieldPtrType,
+                                     ArrayRef<Value *>{ptr, zero, field},
+                                     ArrayRef<NamedAttribute>{});
+}
+
+Function *ParallelCallLowering::getTaskFunction(Function *outlined) {
+  auto it = taskFunctions.find(outlined);
+  if (it != taskFunctions.end())
+    return it->second;
+
+  std::string name = (outlined->getName().strref() + "_task").str();
+  while (module.getNamedFunction(name))
+    name += '_';
+  Location loc = outlined->getLoc();
+  auto *task = new Function(
+      loc, name,
+      FunctionType::get({voidPtrType, indexType, indexType}, {},
+                        module.getContext()));
+  module.getFunctions().push_back(task);
+  task->addEntryBlock();
+
+  // Unpack the context and call the outlined function on the chunk.
+  FuncBuilder builder(task);
+  auto *contextType = getContextType(outlined);
+  Value *context = builder.create<LLVM::BitcastOp>(
+      loc, wrap(contextType->getPointerTo()),
+      ArrayRef<Value *>(task->getArgument(0)));
+  SmallVector<Value *, 8> arguments{task->getArgument(1),
+                                    task->getArgument(2)};
+  for (unsigned i = 0, e = contextType->getNumElements(); i < e; ++i) {
+    Value *fieldPtr = createFieldPtr(builder, loc, context, contextType, i);
+    arguments.push_back(builder.create<LLVM::LoadOp>(
+        loc, wrap(contextType->getElementType(i)),
+        ArrayRef<Value *>{fieldPtr}));
+  }
+  builder.create<LLVM::CallOp>(loc, ArrayRef<Type>(),
+                               builder.getFunctionAttr(outlined), arguments);
+  builder.create<LLVM::ReturnOp>(loc, ArrayRef<Value *>(),
+                                 ArrayRef<Block *>(),
+                                 ArrayRef<ArrayRef<Value *>>(),
+                                 ArrayRef<NamedAttribute>());
+
+  taskFunctions[outlined] = task;
+  return task;
+}
+
+Function *ParallelCallLowering::getRuntimeFunction() {
+  if (auto *runtime = module.getNamedFunction("mlirParallelFor"))
+    return runtime;
+  auto *runtime = new Function(
+      UnknownLoc::get(module.getContext()), "mlirParallelFor",
+      FunctionType::get({taskPtrType, voidPtrType, indexType, indexType,
+                         int64Type, int64Type, int64Type},
+                        {}, module.getContext()));
+  module.getFunctions().push_back(runtime);
+  return runtime;
+}
+
+void ParallelCallLowering::lower(LLVM::CallOp callOp) {
+  Operation *op = callOp.getOperation();
+  Location loc = op->getLoc();
+  Function *outlined = op->getAttrOfType<FunctionAttr>("callee").getValue();
+  Function *caller = op->getFunction();
+
+  // Allocate the context in the entry block, so that it is allocated once even
+  // if the call is in a loop.
+  FuncBuilder entryBuilder(caller);
+  auto *contextType = getContextType(outlined);
+  Value *one = entryBuilder.create<LLVM::ConstantOp>(
+      loc, indexType,
+      entryBuilder.getIntegerAttr(entryBuilder.getIndexType(), 1));
+  Value *context = entryBuilder.create<LLVM::AllocaOp>(
+      loc, wrap(contextType->getPointerTo()), ArrayRef<Value *>{one});
+
+  FuncBuilder builder(op);
+  for (unsigned i = 0, e = contextType->getNumElements(); i < e; ++i) {
+    Value *fieldPtr = createFieldPtr(builder, loc, context, contextType, i);
+    builder.create<LLVM::StoreOp>(loc, op->getOperand(i + 2), fieldPtr);
+  }
+  Value *rawContext = builder.create<LLVM::BitcastOp>(
+      loc, voidPtrType, ArrayRef<Value *>(context));
+  Value *task = builder.create<LLVM::ConstantOp>(
+      loc, taskPtrType, builder.getFunctionAttr(getTaskFunction(outlined)));
+
+  auto createI64Constant = [&](int64_t value) -> Value * {
+    return builder.create<LLVM::ConstantOp>(loc, int64Type,
+                                            builder.getI64IntegerAttr(value));
+  };
+  bool isDynamic =
+      op->getAttrOfType<StringAttr>("parallel.schedule").getValue() ==
+      "dynamic";
+  SmallVector<Value *, 7> arguments = {
+      task,
+      rawContext,
+      op->getOperand(0),
+      op->getOperand(1),
+      createI64Constant(
+          op->getAttrOfType<IntegerAttr>("parallel.step").getInt()),
+      createI64Constant(
+          op->getAttrOfType<IntegerAttr>("parallel.chunk_size").getInt()),
+      createI64Constant(isDynamic)};
+  builder.create<LLVM::CallOp>(loc, ArrayRef<Type>(),
+                               builder.getFunctionAttr(getRuntimeFunction()),
+                               arguments);
+  op->erase();
+}
+
+void mlir::LLVM::lowerParallelCalls(Module *m) {
+  SmallVector<LLVM::CallOp, 4> parallelCalls;
+  for (auto &function : *m)
+    function.walk<LLVM::CallOp>([&](LLVM::CallOp callOp) {
+      if (callOp.getAttr("parallel.schedule"))
+        parallelCalls.push_back(callOp);
+    });
+  if (parallelCalls.empty())
+    return;
+
+  auto *dialect = static_cast<LLVM::LLVMDialect *>(
+      m->getContext()->getRegisteredDialect("llvm"));
+  ParallelCallLowering lowering(*m, *dialect);
+  for (auto callOp : parallelCalls)
+    lowering.lower(callOp);
+}
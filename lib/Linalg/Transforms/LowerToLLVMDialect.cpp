@@ -39,10 +39,17 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 
 using namespace mlir;
 using namespace mlir::edsc;
+
+static llvm::cl::opt<bool> clParallelLowering(
+    "linalg-lower-to-llvm-parallel",
+    llvm::cl::desc("Lower the functions from the linalg dialect into the LLVM "
+                   "dialect concurrently, on the thread pool of the context"),
+    llvm::cl::init(false));
 using namespace mlir::edsc::intrinsics;
 using namespace mlir::LLVM;
 
@@ -65,9 +72,18 @@ static llvm::Module *getLLVMModule(MLIRContext *context) {
   return &llvmDialect->getLLVMModule();
 }
 
+// Get the mutex of the LLVM IR dialect, which must be held to construct LLVM
+// types or to look up functions while other functions are converted.
+static llvm::sys::SmartMutex<true> &getLLVMDialectMutex(MLIRContext *context) {
+  return static_cast<LLVM::LLVMDialect *>(context->getRegisteredDialect("llvm"))
+      ->getMutex();
+}
+
 template <typename T>
 static llvm::Type *getPtrToElementType(T containerType,
                                        llvm::Module &llvmModule) {
+  llvm::sys::SmartScopedLock<true> lock(
+      getLLVMDialectMutex(containerType.getContext()));
   return convertToLLVMDialectType(containerType.getElementType(), llvmModule)
       .template cast<LLVMType>()
       .getUnderlyingType()
@@ -84,6 +100,7 @@ static llvm::Type *getPtrToElementType(T containerType,
 //     containing the respective dynamic values.
 static Type convertLinalgType(Type t, llvm::Module &llvmModule) {
   auto *context = t.getContext();
+  llvm::sys::SmartScopedLock<true> lock(getLLVMDialectMutex(context));
   auto *int64Ty = llvm::Type::getInt64Ty(llvmModule.getContext());
 
   // A buffer descriptor contains the pointer to a flat region of storage and
@@ -364,8 +381,13 @@ public:
 
   SmallVector<Value *, 4> rewrite(Operation *op, ArrayRef<Value *> operands,
                                   FuncBuilder &rewriter) const override {
-    auto *f =
-        op->getFunction()->getModule()->getNamedFunction(libraryFunctionName());
+    Function *f;
+    {
+      llvm::sys::SmartScopedLock<true> lock(
+          getLLVMDialectMutex(op->getContext()));
+      f = op->getFunction()->getModule()->getNamedFunction(
+          libraryFunctionName());
+    }
     if (!f)
       op->emitError("Could not find function: " + libraryFunctionName() +
                     "in lowering to LLVM ");
@@ -403,7 +425,9 @@ void LowerLinalgToLLVMPass::runOnModule() {
   auto &module = getModule();
 
   // Convert to the LLVM IR dialect using the converter defined above.
-  auto r = Lowering().convert(&module);
+  auto r = Lowering().convert(&module, clParallelLowering
+                                           ? ConversionMode::ParallelInPlace
+                                           : ConversionMode::Clone);
   if (failed(r))
     signalPassFailure();
 }
@@ -25,6 +25,7 @@
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
@@ -32,14 +33,20 @@
 #include "mlir/IR/OpImplementation.h"
 #include "mlir/IR/StandardTypes.h"
 #include "mlir/Support/STLExtras.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/SourceMgr.h"
 #include <algorithm>
+#include <atomic>
 using namespace mlir;
 using llvm::MemoryBuffer;
 using llvm::SMLoc;
@@ -49,19 +56,19 @@ using llvm::SourceMgr;
 /// bool value.  Failure is "true" in a boolean context.
 enum ParseResult { ParseSuccess, ParseFailure };
 
+static llvm::cl::opt<bool> parallelParse(
+    "mlir-parallel-parse",
+    llvm::cl::desc("Parse the bodies of functions on multiple threads"),
+    llvm::cl::init(false));
+
 namespace {
 class Parser;
 
-/// This class refers to all of the state maintained globally by the parser,
-/// such as the current lexer position etc.  The Parser base class provides
-/// methods to access this.
-class ParserState {
-public:
-  ParserState(const llvm::SourceMgr &sourceMgr, Module *module)
-      : context(module->getContext()), module(module), lex(sourceMgr, context),
-        curToken(lex.lexToken()) {}
-
-  ~ParserState() {
+/// This class contains the module-level symbols, i.e. the aliases and forward
+/// references to functions, that are shared by all of the parsers processing a
+/// source file.
+struct ParserSymbolState {
+  ~ParserSymbolState() {
     // Destroy the forward references upon error.
     for (auto forwardRef : functionForwardRefs)
       delete forwardRef.second;
@@ -81,6 +88,26 @@ public:
   // temporary function used to represent them.
   llvm::DenseMap<Identifier, Function *> functionForwardRefs;
 
+  // A mutex guarding the forward references, which may be created concurrently
+  // when function bodies are parsed in parallel. The alias definitions are
+  // only ever modified while no function body is being parsed.
+  llvm::sys::SmartMutex<true> functionForwardRefMutex;
+};
+
+/// This class refers to all of the state maintained globally by the parser,
+/// such as the current lexer position etc.  The Parser base class provides
+/// methods to access this.
+class ParserState {
+public:
+  ParserState(const llvm::SourceMgr &sourceMgr, Module *module,
+              ParserSymbolState &symbols)
+      : symbols(symbols), context(module->getContext()), module(module),
+        lex(sourceMgr, context), curToken(lex.lexToken()) {}
+
+  // The module-level symbols, shared with any other parser state operating
+  // on the same source file.
+  ParserSymbolState &symbols;
+
 private:
   ParserState(const ParserState &) = delete;
   void operator=(const ParserState &) = delete;
@@ -118,6 +145,13 @@ public:
   Module *getModule() { return state.module; }
   const llvm::SourceMgr &getSourceMgr() { return state.lex.getSourceMgr(); }
 
+  /// Reset the lexer to the given position in the source buffer, and lex the
+  /// token starting there.
+  void resetToken(const char *tokPos) {
+    state.lex.resetPointer(tokPos);
+    state.curToken = state.lex.lexToken();
+  }
+
   /// Return the current token the parser is inspecting.
   const Token &getToken() const { return state.curToken; }
   StringRef getTokenSpelling() const { return state.curToken.getSpelling(); }
@@ -210,6 +244,7 @@ public:
                                                   IntegerSet &set);
   DenseElementsAttr parseDenseElementsAttr(VectorOrTensorType type);
   DenseElementsAttr parseDenseElementsAttrAsTensor(Type eltType);
+  DenseElementsAttr parseDenseElementsAttrFromHex(VectorOrTensorType type);
   VectorOrTensorType parseVectorOrTensorType();
 
   // Location Parsing.
@@ -576,8 +611,8 @@ Type Parser::parseExtendedType() {
   // dot, then we are parsing a type alias.
   if (getToken().isNot(Token::less) && !identifier.contains('.')) {
     // Check for an alias for this type.
-    auto aliasIt = state.typeAliasDefinitions.find(identifier);
-    if (aliasIt == state.typeAliasDefinitions.end())
+    auto aliasIt = state.symbols.typeAliasDefinitions.find(identifier);
+    if (aliasIt == state.symbols.typeAliasDefinitions.end())
       return (emitError("undefined type alias id '" + identifier + "'"),
               nullptr);
     return aliasIt->second;
@@ -855,19 +890,46 @@ ParseResult Parser::parseFunctionResultTypes(SmallVectorImpl<Type> &elements) {
 // Attribute parsing.
 //===----------------------------------------------------------------------===//
 
+/// Returns the number of bits of an element of the given type in the packed
+/// storage of a DenseElementsAttr, or zero if the type isn't an integer or float
+/// type.
+static size_t getElementBitWidth(Type eltTy) {
+  if (!eltTy.isIntOrFloat())
+    return 0;
+  // FIXME(b/121118307): using 64 bits for BF16 because it is currently stored
+  // with double semantics.
+  return eltTy.isBF16() ? 64 : eltTy.getIntOrFloatBitWidth();
+}
+
 namespace {
+/// Parses a tensor literal, decoding the elements straight into the packed
+/// storage of a DenseElementsAttr instead of going through a uniqued attribute
+/// per element.
 class TensorLiteralParser {
 public:
-  TensorLiteralParser(Parser &p, Type eltTy) : p(p), eltTy(eltTy) {}
+  TensorLiteralParser(Parser &p, Type eltTy)
+      : p(p), eltTy(eltTy), bitWidth(getElementBitWidth(eltTy)) {}
 
   ParseResult parse() {
+    if (!eltTy.isIntOrFloat())
+      return p.emitError("expected integer or float tensor element");
     if (p.getToken().is(Token::l_square)) {
       return parseList(shape);
     }
     return parseElement();
   }
 
-  ArrayRef<Attribute> getValues() const { return storage; }
+  /// Reserves storage for 'numElements' elements, when their number is known
+  /// before parsing.
+  void reserve(int64_t numElements) {
+    data.reserve(getStorageSize(numElements));
+  }
+
+  /// Returns the packed elements, in the format expected by
+  /// DenseElementsAttr::get.
+  ArrayRef<char> getData() const {
+    return ArrayRef<char>(data).take_front(getStorageSize(numElements));
+  }
 
   ArrayRef<int64_t> getShape() const { return shape; }
 
@@ -878,6 +940,11 @@ private:
   /// parseElement([1]) -> Failure
   ParseResult parseElement();
 
+  /// Parse an integer or floating point literal, optionally negated, into the
+  /// bit representation of an element.
+  ParseResult parseIntegerElement(bool isNegative, APInt &result);
+  ParseResult parseFloatElement(bool isNegative, APInt &result);
+
   /// Parse a list of either lists or elements, returning the dimensions of the
   /// parsed sub-tensors in dims. For example:
   ///   parseList([1, 2, 3]) -> Success, [3]
@@ -886,60 +953,88 @@ private:
   ///   parseList([[1, [2, 3]], [4, [5]]]) -> Failure
   ParseResult parseList(llvm::SmallVectorImpl<int64_t> &dims);
 
+  /// Returns the size in bytes of the packed storage of 'count' elements,
+  /// which is padded to APInt words.
+  size_t getStorageSize(int64_t count) const {
+    return APInt::getNumWords(bitWidth * count) * APInt::APINT_WORD_SIZE;
+  }
+
   Parser &p;
   Type eltTy;
+  size_t bitWidth;
   SmallVector<int64_t, 4> shape;
-  std::vector<Attribute> storage;
+
+  /// The packed elements, and their number.
+  std::vector<char> data;
+  int64_t numElements = 0;
 };
 } // namespace
 
 ParseResult TensorLiteralParser::parseElement() {
+  bool isNegative = p.consumeIf(Token::minus);
+  APInt value;
   switch (p.getToken().getKind()) {
-  case Token::floatliteral:
   case Token::integer:
-  case Token::minus: {
-    auto result = p.parseAttribute(eltTy);
-    if (!result)
-      return ParseResult::ParseFailure;
-    // check result matches the element type.
-    switch (eltTy.getKind()) {
-    case StandardTypes::BF16:
-    case StandardTypes::F16:
-    case StandardTypes::F32:
-    case StandardTypes::F64: {
-      // Bitcast the APFloat value to APInt and store the bit representation.
-      auto fpAttrResult = result.dyn_cast<FloatAttr>();
-      if (!fpAttrResult)
-        return p.emitError(
-            "expected tensor literal element with floating point type");
-      auto apInt = fpAttrResult.getValue().bitcastToAPInt();
-
-      // FIXME: using 64 bits and double semantics for BF16 because APFloat does
-      // not support BF16 directly.
-      size_t bitWidth = eltTy.isBF16() ? 64 : eltTy.getIntOrFloatBitWidth();
-      assert(apInt.getBitWidth() == bitWidth);
-      (void)bitWidth;
-      (void)apInt;
-      break;
-    }
-    case StandardTypes::Integer: {
-      if (!result.isa<IntegerAttr>())
-        return p.emitError("expected tensor literal element has integer type");
-      auto value = result.cast<IntegerAttr>().getValue();
-      if (value.getMinSignedBits() > eltTy.getIntOrFloatBitWidth())
-        return p.emitError("tensor literal element has more bits than that "
-                           "specified in the type");
-      break;
-    }
-    default:
-      return p.emitError("expected integer or float tensor element");
-    }
-    storage.push_back(result);
+    if (parseIntegerElement(isNegative, value))
+      return ParseFailure;
+    break;
+  case Token::floatliteral:
+    if (parseFloatElement(isNegative, value))
+      return ParseFailure;
     break;
-  }
   default:
+    if (isNegative)
+      return p.emitError("expected constant integer or floating point value");
     return p.emitError("expected element literal of primitive type");
   }
+
+  // Grow the storage by whole words: std::vector grows its capacity
+  // geometrically, so appending is amortized constant time.
+  size_t storageSize = getStorageSize(numElements + 1);
+  if (data.size() < storageSize)
+    data.resize(storageSize);
+  assert(value.getBitWidth() == bitWidth);
+  DenseElementsAttr::writeBits(data.data(), numElements * bitWidth, value);
+  ++numElements;
+  return ParseSuccess;
+}
+
+ParseResult TensorLiteralParser::parseIntegerElement(bool isNegative,
+                                                     APInt &result) {
+  auto val = p.getToken().getUInt64IntegerValue();
+  if (!val.hasValue() || (isNegative ? (int64_t)-val.getValue() >= 0
+                                     : (int64_t)val.getValue() < 0))
+    return p.emitError("integer constant out of range for attribute");
+  if (!eltTy.isa<IntegerType>())
+    return p.emitError("integer value not valid for specified type");
+  p.consumeToken(Token::integer);
+
+  result = APInt(bitWidth, *val, /*isSigned=*/isNegative);
+  if (result != *val)
+    return p.emitError("integer constant out of range for attribute");
+  if (isNegative)
+    result.negate();
+  return ParseSuccess;
+}
+
+ParseResult TensorLiteralParser::parseFloatElement(bool isNegative,
+                                                   APInt &result) {
+  auto val = p.getToken().getFloatingPointValue();
+  if (!val.hasValue())
+    return p.emitError("floating point value too large for attribute");
+  if (!eltTy.isa<FloatType>())
+    return p.emitError("floating point value not valid for specified type");
+  p.consumeToken(Token::floatliteral);
+
+  // Convert the value the same way as FloatAttr does, and store its bit
+  // representation. BF16 uses double semantics.
+  APFloat value(isNegative ? -*val : *val);
+  if (!eltTy.isBF16() && !eltTy.isF64()) {
+    bool unused;
+    value.convert(eltTy.cast<FloatType>().getFloatSemantics(),
+                  APFloat::rmNearestTiesToEven, &unused);
+  }
+  result = value.bitcastToAPInt();
   return ParseSuccess;
 }
 
@@ -1002,7 +1097,9 @@ Function *Parser::resolveFunctionReference(StringRef nameStr, SMLoc nameLoc,
 
   // If not, get or create a forward reference to one.
   if (!function) {
-    auto &entry = state.functionForwardRefs[name];
+    llvm::sys::SmartScopedLock<true> lock(
+        state.symbols.functionForwardRefMutex);
+    auto &entry = state.symbols.functionForwardRefs[name];
     if (!entry)
       entry = new Function(getEncodedSourceLocation(nameLoc), name, type,
                            /*attrs=*/{});
@@ -1362,13 +1459,13 @@ DenseElementsAttr Parser::parseDenseElementsAttrAsTensor(Type eltType) {
     return nullptr;
 
   auto type = builder.getTensorType(literalParser.getShape(), eltType);
-  return builder.getDenseElementsAttr(type, literalParser.getValues())
-      .cast<DenseElementsAttr>();
+  return DenseElementsAttr::get(type, literalParser.getData());
 }
 
 /// Dense elements attribute.
 ///
 ///   dense-attr-list ::= `[` attribute-value `]`
+///                     | hex-string-literal
 ///   attribute-value ::= integer-literal
 ///                     | float-literal
 ///                     | `[` (attribute-value (`,` attribute-value)*)? `]`
@@ -1377,8 +1474,12 @@ DenseElementsAttr Parser::parseDenseElementsAttrAsTensor(Type eltType) {
 /// input argument. It returns a constructed dense elements attribute if both
 /// match.
 DenseElementsAttr Parser::parseDenseElementsAttr(VectorOrTensorType type) {
+  if (getToken().is(Token::string))
+    return parseDenseElementsAttrFromHex(type);
+
   auto eltTy = type.getElementType();
   TensorLiteralParser literalParser(*this, eltTy);
+  literalParser.reserve(type.getNumElements());
   if (literalParser.parse())
     return nullptr;
 
@@ -1393,8 +1494,58 @@ DenseElementsAttr Parser::parseDenseElementsAttr(VectorOrTensorType type) {
     return (emitError(s.str()), nullptr);
   }
 
-  return builder.getDenseElementsAttr(type, literalParser.getValues())
-      .cast<DenseElementsAttr>();
+  return DenseElementsAttr::get(type, literalParser.getData());
+}
+
+/// Dense elements attribute in hexadecimal form.
+///
+///   hex-string-literal ::= `"0x` hex-digit* `"`
+///
+/// The string holds the raw bytes of the packed elements, in the layout of
+/// DenseElementsAttr::getRawData: each element takes the bit width of the
+/// element type (64 bits for bf16), and elements are packed in little-endian
+/// order without padding, regardless of the host. This avoids tokenizing every
+/// element of large constants.
+DenseElementsAttr
+Parser::parseDenseElementsAttrFromHex(VectorOrTensorType type) {
+  // The string can't contain escapes if it is valid: decode its spelling
+  // directly instead of copying it.
+  StringRef hex = getTokenSpelling().drop_front().drop_back();
+  if (!hex.startswith("0x"))
+    return (emitError("hex string should start with '0x'"), nullptr);
+  hex = hex.drop_front(2);
+
+  size_t bitWidth = getElementBitWidth(type.getElementType());
+  if (bitWidth == 0)
+    return (emitError("expected integer or float tensor element"), nullptr);
+  size_t numBits = bitWidth * type.getNumElements();
+  size_t numBytes = llvm::divideCeil(numBits, 8);
+  if (hex.size() != 2 * numBytes)
+    return (emitError("hex string has " + Twine(hex.size() / 2) +
+                      " bytes, but type requires " + Twine(numBytes)),
+            nullptr);
+
+  // The raw data is stored as 64-bit words in host order: on big-endian hosts,
+  // the bytes of each word are stored in reverse order.
+  auto getDataIndex = [](size_t byteIndex) {
+    return llvm::sys::IsBigEndianHost ? byteIndex ^ 7 : byteIndex;
+  };
+  std::vector<char> data(APInt::getNumWords(numBits) * APInt::APINT_WORD_SIZE);
+  for (size_t i = 0; i != numBytes; ++i) {
+    unsigned high = llvm::hexDigitValue(hex[2 * i]);
+    unsigned low = llvm::hexDigitValue(hex[2 * i + 1]);
+    if (high == -1U || low == -1U)
+      return (emitError("hex string only contains hex digits"), nullptr);
+    data[getDataIndex(i)] = static_cast<char>((high << 4) | low);
+  }
+  consumeToken(Token::string);
+
+  // Clear the bits past the last element, which the uniquing of the attribute
+  // would otherwise depend on.
+  if (numBits % 8 != 0)
+    data[getDataIndex(numBytes - 1)] &=
+        static_cast<char>((1u << (numBits % 8)) - 1);
+  return DenseElementsAttr::get(type, data);
 }
 
 /// Vector or tensor type for elements attribute.
@@ -2224,9 +2375,9 @@ IntegerSet Parser::parseIntegerSetReference() {
 
   // Parse integer set identifier and verify that it exists.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().integerSetDefinitions.count(id) > 0) {
+  if (getState().symbols.integerSetDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    return getState().integerSetDefinitions[id];
+    return getState().symbols.integerSetDefinitions.lookup(id);
   }
 
   // The id isn't among any of the recorded definitions.
@@ -2246,9 +2397,9 @@ AffineMap Parser::parseAffineMapReference() {
 
   // Parse affine map identifier and verify that it exists.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().affineMapDefinitions.count(id) > 0) {
+  if (getState().symbols.affineMapDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    return getState().affineMapDefinitions[id];
+    return getState().symbols.affineMapDefinitions.lookup(id);
   }
 
   // The id isn't among any of the recorded definitions.
@@ -2268,14 +2419,14 @@ ParseResult Parser::parseAffineMapOrIntegerSetReference(AffineMap &map,
   // Note that an id can't be in both affineMapDefinitions and
   // integerSetDefinitions since they use the same sigil '#'.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().affineMapDefinitions.count(id) > 0) {
+  if (getState().symbols.affineMapDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    map = getState().affineMapDefinitions[id];
+    map = getState().symbols.affineMapDefinitions.lookup(id);
     return ParseSuccess;
   }
-  if (getState().integerSetDefinitions.count(id) > 0) {
+  if (getState().symbols.integerSetDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    set = getState().integerSetDefinitions[id];
+    set = getState().symbols.integerSetDefinitions.lookup(id);
     return ParseSuccess;
   }
 
@@ -3614,9 +3765,52 @@ private:
       StringRef &name, FunctionType &type, SmallVectorImpl<StringRef> &argNames,
       SmallVectorImpl<SmallVector<NamedAttribute, 2>> &argAttrs);
   ParseResult parseFunc();
+
+  // Parallel parsing of function bodies.
+  const char *skipFunctionBody();
+  ParseResult parseDeferredFunctionBodies();
+
+  /// A function whose body was skipped over during the pre-scan of the module,
+  /// to be parsed later on a separate thread.
+  struct DeferredFunctionBody {
+    Function *function;
+    SmallVector<StringRef, 4> argNames;
+    SMLoc loc;
+
+    /// The position of the '{' starting the body, and of the first token after
+    /// the matching '}'.
+    const char *bodyStart, *bodyEnd;
+  };
+
+  /// The function bodies that have been skipped and not yet parsed, in the
+  /// order in which they appear in the file.
+  std::vector<DeferredFunctionBody> deferredBodies;
 };
 } // end anonymous namespace
 
+/// Parse the body of 'function', which starts at the current token, defining
+/// the given argument names.
+static ParseResult parseFunctionBody(ParserState &state, Function *function,
+                                     ArrayRef<StringRef> argNames, SMLoc loc) {
+  // Create the parser.
+  auto parser = FunctionParser(state, function);
+
+  bool hadNamedArguments = !argNames.empty();
+
+  // Add the entry block and argument list.
+  function->addEntryBlock();
+
+  // Add definitions of the function arguments.
+  if (hadNamedArguments) {
+    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
+      if (parser.addDefinition({argNames[i], 0, loc}, function->getArgument(i)))
+        return ParseFailure;
+    }
+  }
+
+  return parser.parseFunctionBody(hadNamedArguments);
+}
+
 /// Parses either an affine map declaration or an integer set declaration.
 ///
 /// Affine map declaration.
@@ -3633,10 +3827,10 @@ ParseResult ModuleParser::parseAffineStructureDef() {
   StringRef affineStructureId = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().affineMapDefinitions.count(affineStructureId) > 0)
+  if (getState().symbols.affineMapDefinitions.count(affineStructureId) > 0)
     return emitError("redefinition of affine map id '" + affineStructureId +
                      "'");
-  if (getState().integerSetDefinitions.count(affineStructureId) > 0)
+  if (getState().symbols.integerSetDefinitions.count(affineStructureId) > 0)
     return emitError("redefinition of integer set id '" + affineStructureId +
                      "'");
 
@@ -3653,12 +3847,12 @@ ParseResult ModuleParser::parseAffineStructureDef() {
     return ParseFailure;
 
   if (map) {
-    getState().affineMapDefinitions[affineStructureId] = map;
+    getState().symbols.affineMapDefinitions[affineStructureId] = map;
     return ParseSuccess;
   }
 
   assert(set);
-  getState().integerSetDefinitions[affineStructureId] = set;
+  getState().symbols.integerSetDefinitions[affineStructureId] = set;
   return ParseSuccess;
 }
 
@@ -3672,7 +3866,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
   StringRef aliasName = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().typeAliasDefinitions.count(aliasName) > 0)
+  if (getState().symbols.typeAliasDefinitions.count(aliasName) > 0)
     return emitError("redefinition of type alias id '" + aliasName + "'");
 
   // Make sure this isn't invading the dialect type namespace.
@@ -3693,7 +3887,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
     return ParseFailure;
 
   // Register this alias with the parser state.
-  getState().typeAliasDefinitions.try_emplace(aliasName, aliasedType);
+  getState().symbols.typeAliasDefinitions.try_emplace(aliasName, aliasedType);
 
   return ParseSuccess;
 }
@@ -3831,23 +4025,129 @@ ParseResult ModuleParser::parseFunc() {
   if (getToken().isNot(Token::l_brace))
     return ParseSuccess;
 
-  // Create the parser.
-  auto parser = FunctionParser(getState(), function);
-
-  bool hadNamedArguments = !argNames.empty();
+  // When parsing in parallel, skip over the body for now and parse it later
+  // along with the bodies of the other functions. If the extent of the body
+  // can't be determined, parse it right away to diagnose the error, after the
+  // bodies preceding it.
+  if (parallelParse) {
+    if (const char *bodyEnd = skipFunctionBody()) {
+      const char *bodyStart = getToken().getLoc().getPointer();
+      resetToken(bodyEnd);
+      deferredBodies.push_back({function, {}, loc, bodyStart,
+                                getToken().getLoc().getPointer()});
+      deferredBodies.back().argNames.assign(argNames.begin(), argNames.end());
+      return ParseSuccess;
+    }
+    if (parseDeferredFunctionBodies())
+      return ParseFailure;
+  }
 
-  // Add the entry block and argument list.
-  function->addEntryBlock();
+  return parseFunctionBody(getState(), function, argNames, loc);
+}
 
-  // Add definitions of the function arguments.
-  if (hadNamedArguments) {
-    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
-      if (parser.addDefinition({argNames[i], 0, loc}, function->getArgument(i)))
-        return ParseFailure;
+/// Scan over the body of a function, starting at the current '{' token,
+/// without lexing or parsing it.  Returns the position just after the matching
+/// '}', or null if the end of the body could not be found.
+const char *ModuleParser::skipFunctionBody() {
+  const char *curPtr = getToken().getLoc().getPointer();
+  assert(*curPtr == '{' && "expected the start of a function body");
+
+  unsigned depth = 0;
+  while (true) {
+    switch (*curPtr++) {
+    case 0:
+      // Bail out on the end of the buffer as well as on stray nul characters,
+      // the lexer diagnoses the latter.
+      return nullptr;
+    case '{':
+      ++depth;
+      continue;
+    case '}':
+      if (--depth == 0)
+        return curPtr;
+      continue;
+    case '"':
+      // Skip over string literals, which may contain braces.
+      while (true) {
+        char c = *curPtr++;
+        if (c == '"')
+          break;
+        if (c == 0 || c == '\n' || c == '\v' || c == '\f')
+          return nullptr;
+        // Skip over the escaped character, the lexer checks its validity.
+        if (c == '\\' && *curPtr != 0)
+          ++curPtr;
+      }
+      continue;
+    case '/':
+      // Skip over comments, which may contain braces.
+      if (*curPtr == '/')
+        while (*curPtr != 0 && *curPtr != '\n' && *curPtr != '\r')
+          ++curPtr;
+      continue;
+    default:
+      continue;
     }
   }
+}
 
-  return parser.parseFunctionBody(hadNamedArguments);
+/// Parse the function bodies that were skipped by 'parseFunc', distributing
+/// them over multiple threads.  Diagnostics are emitted in the order in which
+/// the functions appear in the file.
+ParseResult ModuleParser::parseDeferredFunctionBodies() {
+  if (deferredBodies.empty())
+    return ParseSuccess;
+  auto bodies = std::move(deferredBodies);
+  deferredBodies.clear();
+
+  // The source manager lazily computes the line information of the buffer the
+  // first time a location is encoded, which isn't thread-safe. Make sure this
+  // is done before any thread is started.
+  getEncodedSourceLocation(SMLoc::getFromPointer(bodies.front().bodyStart));
+
+  // A parallel diagnostic handler that provides deterministic diagnostic
+  // ordering.
+  ParallelDiagnosticHandler diagHandler(getContext());
+
+  // Each thread of the pool lexes the source buffer with its own parser state,
+  // created on its first task, but shares the module-level symbols.
+  WorkStealingThreadPool &threadPool = getContext()->getThreadPool();
+  std::vector<std::unique_ptr<ParserState>> threadStates(
+      threadPool.getNumThreads());
+
+  // An atomic failure variable for the parsing threads.
+  std::atomic<bool> parseFailed(false);
+  threadPool.parallelFor(
+      bodies.size(), [&](unsigned threadIndex, size_t bodyIndex) {
+        if (parseFailed)
+          return;
+
+        // Set the function id for this thread in the diagnostic handler.
+        diagHandler.setOrderIDForThread(bodyIndex);
+
+        auto &threadState = threadStates[threadIndex];
+        if (!threadState)
+          threadState = llvm::make_unique<ParserState>(
+              getSourceMgr(), getModule(), getState().symbols);
+        ModuleParser threadParser(*threadState);
+
+        auto &body = bodies[bodyIndex];
+        threadParser.resetToken(body.bodyStart);
+        if (parseFunctionBody(*threadState, body.function, body.argNames,
+                              body.loc)) {
+          parseFailed = true;
+          return;
+        }
+
+        // Check that the body ended where the pre-scan expected it to.
+        if (threadParser.getToken().getLoc().getPointer() != body.bodyEnd) {
+          threadParser.emitError("unexpected end of function body when "
+                                 "parsing in parallel");
+          parseFailed = true;
+        }
+      });
+
+  return parseFailed ? ParseFailure : ParseSuccess;
 }
 
 /// Finish the end of module parsing - when the result is valid, do final
@@ -3856,7 +4156,7 @@ ParseResult ModuleParser::finalizeModule() {
 
   // Resolve all forward references, building a remapping table of attributes.
   DenseMap<Attribute, FunctionAttr> remappingTable;
-  for (auto forwardRef : getState().functionForwardRefs) {
+  for (auto forwardRef : getState().symbols.functionForwardRefs) {
     auto name = forwardRef.first;
 
     // Resolve the reference.
@@ -3881,9 +4181,9 @@ ParseResult ModuleParser::finalizeModule() {
 
   // Now that all references to the forward definition placeholders are
   // resolved, we can deallocate the placeholders.
-  for (auto forwardRef : getState().functionForwardRefs)
+  for (auto forwardRef : getState().symbols.functionForwardRefs)
     delete forwardRef.second;
-  getState().functionForwardRefs.clear();
+  getState().symbols.functionForwardRefs.clear();
   return ParseSuccess;
 }
 
@@ -3892,32 +4192,43 @@ ParseResult ModuleParser::parseModule() {
   while (1) {
     switch (getToken().getKind()) {
     default:
+      // Diagnose the errors of the bodies preceding this point first, as the
+      // sequential parser would have.
+      if (parseDeferredFunctionBodies())
+        return ParseFailure;
       emitError("expected a top level entity");
       return ParseFailure;
 
       // If we got to the end of the file, then we're done.
     case Token::eof:
+      if (parseDeferredFunctionBodies())
+        return ParseFailure;
       return finalizeModule();
 
     // If we got an error token, then the lexer already emitted an error, just
     // stop.  Someday we could introduce error recovery if there was demand
     // for it.
     case Token::error:
+      (void)parseDeferredFunctionBodies();
       return ParseFailure;
 
+    // Function bodies may only refer to the aliases defined before them, so
+    // parse any pending function body before introducing a new alias.
     case Token::hash_identifier:
-      if (parseAffineStructureDef())
+      if (parseDeferredFunctionBodies() || parseAffineStructureDef())
         return ParseFailure;
       break;
 
     case Token::exclamation_identifier:
-      if (parseTypeAliasDef())
+      if (parseDeferredFunctionBodies() || parseTypeAliasDef())
         return ParseFailure;
       break;
 
     case Token::kw_func:
-      if (parseFunc())
+      if (parseFunc()) {
+        (void)parseDeferredFunctionBodies();
         return ParseFailure;
+      }
       break;
     }
   }
@@ -3934,7 +4245,8 @@ Module *mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
   // This is the result module we are parsing into.
   std::unique_ptr<Module> module(new Module(context));
 
-  ParserState state(sourceMgr, module.get());
+  ParserSymbolState symbols;
+  ParserState state(sourceMgr, module.get(), symbols);
   if (ModuleParser(state).parseModule()) {
     return nullptr;
   }
@@ -3975,3 +4287,40 @@ Module *mlir::parseSourceString(StringRef moduleStr, MLIRContext *context) {
   sourceMgr.AddNewSourceBuffer(std::move(memBuffer), SMLoc());
   return parseSourceFile(sourceMgr, context);
 }
+
+/// Parse a single symbol, i.e. a type or an attribute, from the given string
+/// using 'parseFn'.  Returns null if the symbol is invalid or if it is followed
+/// by anything else.
+template <typename T>
+static T parseSymbol(StringRef inputStr, MLIRContext *context,
+                     llvm::function_ref<T(Parser &)> parseFn) {
+  // The lexer expects a nul terminated buffer, so the input is copied.
+  SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(MemoryBuffer::getMemBufferCopy(inputStr),
+                               SMLoc());
+
+  // Symbols are parsed in the context of an empty module.
+  Module module(context);
+  ParserSymbolState symbols;
+  ParserState state(sourceMgr, &module, symbols);
+  Parser parser(state);
+
+  T symbol = parseFn(parser);
+  if (!symbol)
+    return T();
+  if (parser.getToken().isNot(Token::eof)) {
+    parser.emitError("unexpected characters after the end of the symbol");
+    return T();
+  }
+  return symbol;
+}
+
+Type mlir::parseType(StringRef typeStr, MLIRContext *context) {
+  return parseSymbol<Type>(typeStr, context,
+                           [](Parser &parser) { return parser.parseType(); });
+}
+
+Attribute mlir::parseAttribute(StringRef attrStr, MLIRContext *context) {
+  return parseSymbol<Attribute>(
+      attrStr, context, [](Parser &parser) { return parser.parseAttribute(); });
+}
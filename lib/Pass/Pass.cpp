@@ -22,22 +22,37 @@
 #include "mlir/Pass/Pass.h"
 #include "PassDetail.h"
 #include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Mutex.h"
-#include "llvm/Support/Parallel.h"
-#include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Threading.h"
+#include <numeric>
 
 using namespace mlir;
 using namespace mlir::detail;
 
+#define DEBUG_TYPE "pass-manager"
+
+STATISTIC(NumAnalysisCacheHits, "Number of analyses found in the cache");
+STATISTIC(NumAnalysisCacheMisses, "Number of analyses computed");
+STATISTIC(NumAnalysisEvictions,
+          "Number of analyses evicted to meet the retention budget");
+
 static llvm::cl::opt<bool>
     disableThreads("disable-pass-threading",
                    llvm::cl::desc("Disable multithreading in the pass manager"),
                    llvm::cl::init(false));
 
+static llvm::cl::opt<unsigned> passThreads(
+    "pass-threads",
+    llvm::cl::desc("Number of threads used to run function passes in "
+                   "parallel, defaults to the hardware concurrency"),
+    llvm::cl::init(0));
+
 //===----------------------------------------------------------------------===//
 // Pass
 //===----------------------------------------------------------------------===//
@@ -89,8 +104,10 @@ LogicalResult ModulePassBase::run(Module *module, ModuleAnalysisManager &mam) {
   // Invoke the virtual runOnModule function.
   runOnModule();
 
-  // Invalidate any non preserved analyses.
+  // Invalidate any non preserved analyses, and evict the analyses of the least
+  // recently used functions if they exceed the retention budget.
   mam.invalidate(passState->preservedAnalyses);
+  mam.enforceRetentionBudget();
 
   // Instrument after the pass has run.
   bool passFailed = passState->irAndPassFailed.getInt();
@@ -144,15 +161,10 @@ LogicalResult detail::ModulePassExecutor::run(Module *module,
 static LogicalResult runFunctionPipeline(FunctionPassExecutor &fpe,
                                          Function *func,
                                          FunctionAnalysisManager &fam) {
-  // Run the function pipeline over the provided function.
-  auto result = fpe.run(func, fam);
-
-  // Clear out any computed function analyses. These analyses won't be used
-  // any more in this pipeline, and this helps reduce the current working set
-  // of memory. If preserving these analyses becomes important in the future
-  // we can re-evalutate this.
-  fam.clear();
-  return result;
+  // Run the function pipeline over the provided function. The analyses that
+  // were preserved by each of the passes are kept in the analysis manager, so
+  // that they may be reused by later pipelines.
+  return fpe.run(func, fam);
 }
 
 /// Run the held function pipeline over all non-external functions within the
@@ -160,7 +172,10 @@ static LogicalResult runFunctionPipeline(FunctionPassExecutor &fpe,
 void ModuleToFunctionPassAdaptor::runOnModule() {
   ModuleAnalysisManager &mam = getAnalysisManager();
   for (auto &func : getModule()) {
-    // Skip external functions.
+    // Skip external functions.  A body that fails to materialize was already
+    // reported.
+    if (failed(func.materialize()))
+      return signalPassFailure();
     if (func.isExternal())
       continue;
 
@@ -168,202 +183,95 @@ void ModuleToFunctionPassAdaptor::runOnModule() {
     auto fam = mam.slice(&func);
     if (failed(runFunctionPipeline(fpe, &func, fam)))
       return signalPassFailure();
-
-    // Clear out any computed function analyses. These analyses won't be used
-    // any more in this pipeline, and this helps reduce the current working set
-    // of memory. If preserving these analyses becomes important in the future
-    // we can re-evalutate this.
-    fam.clear();
-  }
-}
-
-namespace {
-/// A utility class to ensure that diagnostics are emitted in a deterministic
-/// order when executing a pipeline asynchronously with
-/// ModuleToFunctionPassAdaptorParallel.
-struct ParallelDiagnosticHandler {
-  struct ThreadDiagnostic {
-    ThreadDiagnostic(size_t id, Location loc, StringRef msg,
-                     DiagnosticSeverity kind)
-        : id(id), loc(loc), msg(msg), kind(kind) {}
-    bool operator<(const ThreadDiagnostic &rhs) const { return id < rhs.id; }
-
-    /// The function id for this diagnostic, this is used for ordering.
-    /// Note: This id corresponds to the ordered position of the current
-    ///       function within its parent module.
-    size_t id;
-
-    /// Information for the diagnostic.
-    Location loc;
-    std::string msg;
-    DiagnosticSeverity kind;
-  };
-
-  ParallelDiagnosticHandler(MLIRContext &ctx)
-      : prevHandler(ctx.getDiagEngine().getHandler()), context(ctx) {
-    ctx.getDiagEngine().setHandler(
-        [this](Location loc, StringRef message, DiagnosticSeverity kind) {
-          uint64_t tid = llvm::get_threadid();
-          llvm::sys::SmartScopedLock<true> lock(mutex);
-
-          // Append a new diagnostic.
-          diagnostics.emplace_back(threadToFuncID[tid], loc, message, kind);
-        });
-  }
-
-  ~ParallelDiagnosticHandler() {
-    // Restore the previous diagnostic handler.
-    context.getDiagEngine().setHandler(prevHandler);
-
-    // Early exit if there are no diagnostics, this is the common case.
-    if (diagnostics.empty())
-      return;
-
-    // Emit the diagnostics back to the context.
-    emitDiagnostics(
-        [&](Location loc, StringRef message, DiagnosticSeverity kind) {
-          return context.getDiagEngine().emit(loc, kind) << message;
-        });
   }
 
-  /// Utility method to emit any held diagnostics.
-  void emitDiagnostics(
-      std::function<void(Location, StringRef, DiagnosticSeverity)> emitFn) {
-    // Stable sort all of the diagnostics that were emitted. This creates a
-    // deterministic ordering for the diagnostics based upon which function they
-    // were emitted for.
-    std::stable_sort(diagnostics.begin(), diagnostics.end());
-
-    // Emit each diagnostic to the context again.
-    for (ThreadDiagnostic &diag : diagnostics)
-      emitFn(diag.loc, diag.msg, diag.kind);
-  }
-
-  /// Set the function id for the current thread.
-  void setFuncIDForThread(size_t funcID) {
-    uint64_t tid = llvm::get_threadid();
-    llvm::sys::SmartScopedLock<true> lock(mutex);
-    threadToFuncID[tid] = funcID;
-  }
-
-  /// The previous context diagnostic handler.
-  DiagnosticEngine::HandlerTy prevHandler;
-
-  /// A smart mutex to lock access to the internal state.
-  llvm::sys::SmartMutex<true> mutex;
-
-  /// A mapping between the thread id and the current function id.
-  DenseMap<uint64_t, size_t> threadToFuncID;
-
-  /// An unordered list of diagnostics that were emitted.
-  std::vector<ThreadDiagnostic> diagnostics;
-
-  /// The context to emit the diagnostics to.
-  MLIRContext &context;
-};
-
-/// A utility stack trace entry that dumps any dangling diagnostics held by a
-/// ParallelDiagnosticHandler in the event of a crash.
-struct PrettyStackTraceParallelDiagnosticEntry
-    : public llvm::PrettyStackTraceEntry {
-  PrettyStackTraceParallelDiagnosticEntry(
-      ParallelDiagnosticHandler &parallelHandler)
-      : parallelHandler(parallelHandler) {}
-
-  void print(raw_ostream &os) const override {
-    // Early exit if there are no diagnostics, this is the common case.
-    if (parallelHandler.diagnostics.empty())
-      return;
-
-    os << "In-Flight Diagnostics:\n";
-    parallelHandler.emitDiagnostics(
-        [&](Location loc, StringRef message, DiagnosticSeverity severity) {
-          os.indent(4);
-
-          // Print each diagnostic with the format:
-          //   "<location>: <kind>: <msg>"
-          if (!loc.isa<UnknownLoc>())
-            os << loc << ": ";
-          switch (severity) {
-          case DiagnosticSeverity::Error:
-            os << "error: ";
-            break;
-          case DiagnosticSeverity::Warning:
-            os << "warning: ";
-            break;
-          case DiagnosticSeverity::Note:
-            os << "note: ";
-            break;
-          case DiagnosticSeverity::Remark:
-            os << "remark: ";
-            break;
-          }
-          os << message << '\n';
-        });
-  }
+  // The remaining function analyses were preserved by each of the function
+  // passes, so they are kept. The module analyses may have been invalidated by
+  // the changes to the functions.
+  markAllAnalysesPreserved();
+  mam.clearModuleAnalyses();
+}
 
-  // A reference to the parallel handler to dump on the event of a crash.
-  ParallelDiagnosticHandler &parallelHandler;
-};
-} // end anonymous namespace
+/// Returns an estimate of the cost of running a function pipeline over the
+/// given function, i.e. the number of operations within it.
+static size_t estimateFunctionCost(Function &func) {
+  size_t numOps = 0;
+  func.walk([&](Operation *) { ++numOps; });
+  return numOps;
+}
 
-// Run the held function pipeline synchronously across the functions within
-// the module.
+// Run the held function pipeline asynchronously across the functions within
+// the module, on the thread pool of the context.
 void ModuleToFunctionPassAdaptorParallel::runOnModule() {
   ModuleAnalysisManager &mam = getAnalysisManager();
 
+  // Apply the thread count requested on the command line, if any.
+  WorkStealingThreadPool &threadPool = getContext().getThreadPool();
+  if (passThreads && passThreads != threadPool.getNumThreads())
+    threadPool.setNumThreads(passThreads);
+
   // Create the async executors if they haven't been created, or if the main
-  // function pipeline has changed.
-  if (asyncExecutors.empty() || asyncExecutors.front().size() != fpe.size())
-    asyncExecutors = {llvm::hardware_concurrency(), fpe};
+  // function pipeline or the number of threads has changed.
+  unsigned numThreads = threadPool.getNumThreads();
+  if (asyncExecutors.size() != numThreads ||
+      asyncExecutors.front().size() != fpe.size())
+    asyncExecutors = {numThreads, fpe};
 
   // Run a prepass over the module to collect the functions to execute a over.
   // This ensures that an analysis manager exists for each function, as well as
-  // providing a queue of functions to execute over.
+  // providing a cost estimate for each function.
   std::vector<std::pair<Function *, FunctionAnalysisManager>> funcAMPairs;
-  for (auto &func : getModule())
-    if (!func.isExternal())
+  std::vector<size_t> funcCosts;
+  for (auto &func : getModule()) {
+    if (failed(func.materialize()))
+      return signalPassFailure();
+    if (!func.isExternal()) {
       funcAMPairs.emplace_back(&func, mam.slice(&func));
+      funcCosts.push_back(estimateFunctionCost(func));
+    }
+  }
+
+  // Schedule the most expensive functions first, so that a large function
+  // isn't left to run on its own at the end of the pipeline.
+  std::vector<unsigned> schedule(funcAMPairs.size());
+  std::iota(schedule.begin(), schedule.end(), 0);
+  std::stable_sort(schedule.begin(), schedule.end(),
+                   [&](unsigned lhs, unsigned rhs) {
+                     return funcCosts[lhs] > funcCosts[rhs];
+                   });
 
   // A parallel diagnostic handler that provides deterministic diagnostic
   // ordering.
-  ParallelDiagnosticHandler diagHandler(getContext());
-
-  // A pretty stack entry to print any dangling diagnostics in the event of a
-  // crash.
-  PrettyStackTraceParallelDiagnosticEntry diagCrashEntry(diagHandler);
-
-  // An index for the current function/analysis manager pair.
-  std::atomic<unsigned> funcIt(0);
+  ParallelDiagnosticHandler diagHandler(&getContext());
 
   // An atomic failure variable for the async executors.
   std::atomic<bool> passFailed(false);
-  llvm::parallel::for_each(
-      llvm::parallel::par, asyncExecutors.begin(),
-      std::next(asyncExecutors.begin(),
-                std::min(asyncExecutors.size(), funcAMPairs.size())),
-      [&](FunctionPassExecutor &executor) {
-        for (auto e = funcAMPairs.size(); !passFailed && funcIt < e;) {
-          // Get the next available function index.
-          unsigned nextID = funcIt++;
-          if (nextID >= e)
-            break;
-
-          // Set the function id for this thread in the diagnostic handler.
-          diagHandler.setFuncIDForThread(nextID);
-
-          // Run the executor over the current function.
-          auto &it = funcAMPairs[nextID];
-          if (failed(runFunctionPipeline(executor, it.first, it.second))) {
-            passFailed = true;
-            break;
-          }
-        }
+  threadPool.parallelFor(
+      schedule.size(), [&](unsigned threadIndex, size_t taskIndex) {
+        if (passFailed)
+          return;
+
+        // Set the function id for this thread in the diagnostic handler. The
+        // functions are ordered as in the module, rather than as scheduled.
+        unsigned funcIndex = schedule[taskIndex];
+        diagHandler.setOrderIDForThread(funcIndex);
+
+        // Run the executor of this thread over the current function.
+        auto &it = funcAMPairs[funcIndex];
+        if (failed(runFunctionPipeline(asyncExecutors[threadIndex], it.first,
+                                       it.second)))
+          passFailed = true;
       });
 
   // Signal a failure if any of the executors failed.
   if (passFailed)
-    signalPassFailure();
+    return signalPassFailure();
+
+  // The remaining function analyses were preserved by each of the function
+  // passes, so they are kept. The module analyses may have been invalidated by
+  // the changes to the functions.
+  markAllAnalysesPreserved();
+  mam.clearModuleAnalyses();
 }
 
 //===----------------------------------------------------------------------===//
@@ -392,14 +300,23 @@ class ModuleVerifier : public ModulePass<ModuleVerifier> {
 
 PassManager::PassManager(bool verifyPasses)
     : mpe(new ModulePassExecutor()), verifyPasses(verifyPasses),
-      passTiming(false) {}
+      passTiming(false),
+      analysisRetentionBudget(std::numeric_limits<size_t>::max()) {}
 
 PassManager::~PassManager() {}
 
 /// Run the passes within this manager on the provided module.
 LogicalResult PassManager::run(Module *module) {
   ModuleAnalysisManager mam(module, instrumentor.get());
-  return mpe->run(module, mam);
+  mam.setRetentionBudget(analysisRetentionBudget);
+  auto result = mpe->run(module, mam);
+
+  // Record the use of the analysis cache.
+  auto statistics = mam.getCacheStatistics();
+  NumAnalysisCacheHits += statistics.numHits;
+  NumAnalysisCacheMisses += statistics.numMisses;
+  NumAnalysisEvictions += statistics.numEvictions;
+  return result;
 }
 
 /// Add an opaque pass pointer to the current manager. This takes ownership
@@ -433,7 +350,8 @@ void PassManager::addPass(FunctionPassBase *pass) {
   detail::FunctionPassExecutor *fpe;
   if (nestedExecutorStack.empty()) {
     /// Create an executor adaptor for this pass.
-    if (disableThreads || !llvm::llvm_is_multithreaded()) {
+    if (disableThreads || passThreads == 1 ||
+        !llvm::llvm_is_multithreaded()) {
       // If multi-threading is disabled, then create a synchronous adaptor.
       auto *adaptor = new ModuleToFunctionPassAdaptor();
       addPass(adaptor);
@@ -474,12 +392,25 @@ PassInstrumentor *FunctionAnalysisManager::getPassInstrumentor() const {
   return parent->getPassInstrumentor();
 }
 
+ModuleAnalysisManager::ModuleAnalysisManager(Module *module,
+                                             PassInstrumentor *passInstrumentor)
+    : moduleAnalyses(module), passInstrumentor(passInstrumentor) {
+  module->addListener(this);
+}
+
+ModuleAnalysisManager::~ModuleAnalysisManager() {
+  moduleAnalyses.getIRUnit()->removeListener(this);
+}
+
 /// Create an analysis slice for the given child function.
 FunctionAnalysisManager ModuleAnalysisManager::slice(Function *function) {
   assert(function->getModule() == moduleAnalyses.getIRUnit() &&
          "function has a different parent module");
-  auto it = functionAnalyses.try_emplace(function, function);
-  return {this, &it.first->second};
+  auto &analyses = functionAnalyses[function];
+  if (!analyses)
+    analyses = llvm::make_unique<detail::AnalysisMap<Function>>(function);
+  analyses->lastUse = ++useCounter;
+  return {this, analyses.get()};
 }
 
 /// Invalidate any non preserved analyses.
@@ -494,13 +425,67 @@ void ModuleAnalysisManager::invalidate(const detail::PreservedAnalyses &pa) {
   // If no analyses were preserved, then just simply clear out the function
   // analysis results.
   if (pa.isNone()) {
-    functionAnalyses.clear();
+    clearFunctionAnalyses();
     return;
   }
 
   // Otherwise, invalidate each function analyses.
   for (auto &analysisPair : functionAnalyses)
-    analysisPair.second.invalidate(pa);
+    analysisPair.second->invalidate(pa);
+}
+
+/// Evict the analyses of the least recently used functions until the retention
+/// budget is met.
+void ModuleAnalysisManager::enforceRetentionBudget() {
+  // Collect the functions that hold analyses, along with their memory usage.
+  size_t memoryUsage = 0;
+  std::vector<std::pair<uint64_t, Function *>> functionsByLastUse;
+  for (auto &analysisPair : functionAnalyses) {
+    auto &analyses = *analysisPair.second;
+    if (analyses.empty())
+      continue;
+    memoryUsage += analyses.getMemoryUsage();
+    functionsByLastUse.emplace_back(analyses.lastUse, analysisPair.first);
+  }
+  if (memoryUsage <= retentionBudget)
+    return;
+
+  // Evict the analyses of the least recently used functions first.
+  llvm::array_pod_sort(functionsByLastUse.begin(), functionsByLastUse.end());
+  for (auto &it : functionsByLastUse) {
+    auto &analyses = *functionAnalyses.find(it.second)->second;
+    memoryUsage -= analyses.getMemoryUsage();
+    erasedStatistics.numEvictions += analyses.size();
+    analyses.clear();
+    if (memoryUsage <= retentionBudget)
+      break;
+  }
+}
+
+/// Returns the statistics on the use of the analyses of this manager.
+detail::AnalysisCacheStatistics
+ModuleAnalysisManager::getCacheStatistics() const {
+  detail::AnalysisCacheStatistics statistics = erasedStatistics;
+  statistics += moduleAnalyses.getStatistics();
+  for (auto &analysisPair : functionAnalyses)
+    statistics += analysisPair.second->getStatistics();
+  return statistics;
+}
+
+/// Erase the analysis maps of all of the functions.
+void ModuleAnalysisManager::clearFunctionAnalyses() {
+  for (auto &analysisPair : functionAnalyses)
+    erasedStatistics += analysisPair.second->getStatistics();
+  functionAnalyses.clear();
+}
+
+/// Erase the analysis map of a function removed from the module.
+void ModuleAnalysisManager::notifyFunctionRemoved(Function *function) {
+  auto it = functionAnalyses.find(function);
+  if (it == functionAnalyses.end())
+    return;
+  erasedStatistics += it->second->getStatistics();
+  functionAnalyses.erase(it);
 }
 
 //===----------------------------------------------------------------------===//
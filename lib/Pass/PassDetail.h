@@ -112,7 +112,9 @@ private:
 };
 
 /// An adaptor module pass used to run function passes over all of the
-/// non-external functions of a module asynchronously across multiple threads.
+/// non-external functions of a module asynchronously across multiple threads,
+/// using the thread pool of the context. The functions are scheduled from the
+/// largest to the smallest, to balance the load between the threads.
 class ModuleToFunctionPassAdaptorParallel
     : public ModulePass<ModuleToFunctionPassAdaptorParallel> {
 public:
@@ -128,7 +130,7 @@ private:
   FunctionPassExecutor fpe;
 
   // A set of executors, cloned from the main executor, that run asynchronously
-  // on different threads.
+  // on different threads. There is one executor per thread of the pool.
   std::vector<FunctionPassExecutor> asyncExecutors;
 };
 
@@ -42,6 +42,15 @@ struct PassManagerOptions {
   /// Add an IR printing instrumentation if enabled by any 'print-ir' flags.
   void addPrinterInstrumentation(PassManager &pm);
 
+  //===--------------------------------------------------------------------===//
+  // Analysis Management
+  //===--------------------------------------------------------------------===//
+  llvm::cl::opt<unsigned> analysisRetentionBudget;
+
+  /// Set the analysis retention budget if specified by the
+  /// 'pass-analysis-budget' flag.
+  void applyAnalysisRetentionBudget(PassManager &pm);
+
   //===--------------------------------------------------------------------===//
   // Pass Timing
   //===--------------------------------------------------------------------===//
@@ -76,6 +85,14 @@ PassManagerOptions::PassManagerOptions()
                          "a module IR"),
           llvm::cl::init(false)),
 
+      //===----------------------------------------------------------------===//
+      // Analysis Management
+      //===----------------------------------------------------------------===//
+      analysisRetentionBudget(
+          "pass-analysis-budget",
+          llvm::cl::desc("Maximum memory, in KiB, used by the function "
+                         "analyses retained between pass pipelines")),
+
       //===----------------------------------------------------------------===//
       // Pass Timing
       //===----------------------------------------------------------------===//
@@ -130,6 +147,13 @@ void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
                       printModuleScope, llvm::errs());
 }
 
+/// Set the analysis retention budget if specified by the 'pass-analysis-budget'
+/// flag.
+void PassManagerOptions::applyAnalysisRetentionBudget(PassManager &pm) {
+  if (analysisRetentionBudget.getNumOccurrences())
+    pm.setAnalysisRetentionBudget(size_t(analysisRetentionBudget) * 1024);
+}
+
 /// Add a pass timing instrumentation if enabled by 'pass-timing' flags.
 void PassManagerOptions::addTimingInstrumentation(PassManager &pm) {
   if (passTiming)
@@ -143,6 +167,9 @@ void mlir::registerPassManagerCLOptions() {
 }
 
 void mlir::applyPassManagerCLOptions(PassManager &pm) {
+  // Set the analysis retention budget.
+  (*options)->applyAnalysisRetentionBudget(pm);
+
   // Add the IR printing instrumentation.
   (*options)->addPrinterInstrumentation(pm);
 
@@ -16,7 +16,10 @@
 // =============================================================================
 
 #include "PassDetail.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -30,6 +33,8 @@ using namespace mlir::detail;
 
 constexpr llvm::StringLiteral kPassTimingDescription =
     "... Pass execution timing report ...";
+constexpr llvm::StringLiteral kThreadUtilizationDescription =
+    "... Parallel function pipeline thread utilization ...";
 
 namespace {
 /// Simple record class to record timing information.
@@ -154,7 +159,9 @@ struct PassTiming : public PassInstrumentation {
   ~PassTiming() { print(); }
 
   /// Setup the instrumentation hooks.
-  void runBeforePass(Pass *pass, const llvm::Any &) override {
+  void runBeforePass(Pass *pass, const llvm::Any &ir) override {
+    if (isa<ModuleToFunctionPassAdaptorParallel>(pass))
+      startThreadUtilization(ir);
     startPassTimer(pass);
   }
   void runAfterPass(Pass *pass, const llvm::Any &) override;
@@ -190,6 +197,17 @@ struct PassTiming : public PassInstrumentation {
   void printResultsAsPipeline(raw_ostream &os, Timer *root,
                               TimeRecord totalTime);
 
+  /// Start recording the utilization of the threads of the pool for a
+  /// parallel function pipeline over the given module.
+  void startThreadUtilization(const llvm::Any &ir);
+
+  /// Stop recording the utilization of the threads of the pool.
+  void stopThreadUtilization(const llvm::Any &ir);
+
+  /// Print the utilization of the threads running parallel function
+  /// pipelines.
+  void printThreadUtilization(raw_ostream &os);
+
   /// Returns a timer for the provided identifier and name.
   Timer *getTimer(const void *id, std::function<std::string()> &&nameBuilder) {
     auto tid = llvm::get_threadid();
@@ -219,6 +237,16 @@ struct PassTiming : public PassInstrumentation {
 
   /// The display mode to use when printing the timing results.
   PassTimingDisplayMode displayMode;
+
+  /// The statistics of the thread pool, and the time, when the currently
+  /// running parallel function pipeline started.
+  std::vector<WorkStealingThreadPool::ThreadStatistics> startThreadStats;
+  std::chrono::time_point<std::chrono::steady_clock> startParallelTime;
+
+  /// The total time spent in parallel function pipelines, and the work done
+  /// by each thread of the pool during this time.
+  std::chrono::nanoseconds parallelTime = std::chrono::nanoseconds(0);
+  std::vector<WorkStealingThreadPool::ThreadStatistics> parallelThreadStats;
 };
 } // end anonymous namespace
 
@@ -242,8 +270,39 @@ void PassTiming::startAnalysisTimer(llvm::StringRef name, AnalysisID *id) {
   timer->start();
 }
 
+/// Start recording the utilization of the threads of the pool.
+void PassTiming::startThreadUtilization(const llvm::Any &ir) {
+  auto *module = llvm::any_cast<Module *>(ir);
+  startThreadStats = module->getContext()->getThreadPool().getStatistics();
+  startParallelTime = std::chrono::steady_clock::now();
+}
+
+/// Stop recording the utilization of the threads of the pool, and accumulate
+/// the work done by each thread since it was started.
+void PassTiming::stopThreadUtilization(const llvm::Any &ir) {
+  parallelTime += std::chrono::steady_clock::now() - startParallelTime;
+
+  auto *module = llvm::any_cast<Module *>(ir);
+  auto threadStats = module->getContext()->getThreadPool().getStatistics();
+  if (parallelThreadStats.size() < threadStats.size())
+    parallelThreadStats.resize(threadStats.size());
+  for (unsigned i = 0, e = threadStats.size(); i != e; ++i) {
+    auto &stats = parallelThreadStats[i];
+    stats.busyTime += threadStats[i].busyTime;
+    stats.numTasks += threadStats[i].numTasks;
+    stats.numStolenTasks += threadStats[i].numStolenTasks;
+
+    // Remove the work that was done before the pipeline started.
+    if (i < startThreadStats.size()) {
+      stats.busyTime -= startThreadStats[i].busyTime;
+      stats.numTasks -= startThreadStats[i].numTasks;
+      stats.numStolenTasks -= startThreadStats[i].numStolenTasks;
+    }
+  }
+}
+
 /// Stop a pass timer.
-void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
+void PassTiming::runAfterPass(Pass *pass, const llvm::Any &ir) {
   auto tid = llvm::get_threadid();
   auto &activeTimers = activeThreadTimers[tid];
   assert(!activeTimers.empty() && "expected active timer");
@@ -253,6 +312,8 @@ void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
   // the timing data for the other threads.
   if (auto *asyncMTFPass =
           dyn_cast<ModuleToFunctionPassAdaptorParallel>(pass)) {
+    stopThreadUtilization(ir);
+
     // The asychronous pipeline timers should exist as children of root timers
     // for other threads.
     for (auto &rootTimer : llvm::make_early_inc_range(rootTimers)) {
@@ -286,13 +347,18 @@ void PassTiming::runAfterAnalysis(llvm::StringRef, AnalysisID *,
   timer->stop();
 }
 
-/// Utility to print the timer heading information.
-static void printTimerHeader(llvm::raw_ostream &os, TimeRecord total) {
+/// Utility to print the heading of a report with the given description.
+static void printReportHeader(llvm::raw_ostream &os, StringRef description) {
   os << "===" << std::string(73, '-') << "===\n";
   // Figure out how many spaces to description name.
-  unsigned Padding = (80 - kPassTimingDescription.size()) / 2;
-  os.indent(Padding) << kPassTimingDescription << '\n';
+  unsigned Padding = (80 - description.size()) / 2;
+  os.indent(Padding) << description << '\n';
   os << "===" << std::string(73, '-') << "===\n";
+}
+
+/// Utility to print the timer heading information.
+static void printTimerHeader(llvm::raw_ostream &os, TimeRecord total) {
+  printReportHeader(os, kPassTimingDescription);
 
   // Print the total time followed by the section headers.
   os << llvm::format("  Total Execution Time: %5.4f seconds\n\n", total.wall);
@@ -332,11 +398,17 @@ void PassTiming::print() {
     break;
   }
   printTimeEntry(*os, 0, "Total", totalTime, totalTime);
+
+  // Print the thread utilization if any function pipeline ran in parallel.
+  if (parallelTime.count())
+    printThreadUtilization(*os);
   os->flush();
 
   // Reset root timers.
   rootTimers.clear();
   activeThreadTimers.clear();
+  parallelTime = std::chrono::nanoseconds(0);
+  parallelThreadStats.clear();
 }
 
 /// Print the timing result in list mode.
@@ -387,6 +459,31 @@ void PassTiming::printResultsAsPipeline(raw_ostream &os, Timer *root,
     printTimer(0, topLevelTimer.second.get());
 }
 
+/// Print the utilization of the threads running parallel function pipelines,
+/// i.e. the fraction of the time spent in these pipelines that each thread
+/// spent executing functions.
+void PassTiming::printThreadUtilization(raw_ostream &os) {
+  auto toSeconds = [](std::chrono::nanoseconds time) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(time)
+        .count();
+  };
+  double totalTime = toSeconds(parallelTime);
+
+  os << "\n";
+  printReportHeader(os, kThreadUtilizationDescription);
+  os << llvm::format("  Total Parallel Time: %5.4f seconds\n\n", totalTime);
+  os << "   ---Busy Time---  ---Functions---  ---Stolen---  --- Thread ---\n";
+  for (unsigned i = 0, e = parallelThreadStats.size(); i != e; ++i) {
+    auto &stats = parallelThreadStats[i];
+    double busyTime = toSeconds(stats.busyTime);
+    os << llvm::format("  %7.4f (%5.1f%%)  %15llu  %12llu  ", busyTime,
+                       100.0 * busyTime / totalTime,
+                       (unsigned long long)stats.numTasks,
+                       (unsigned long long)stats.numStolenTasks)
+       << "Thread " << i << "\n";
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // PassManager
 //===----------------------------------------------------------------------===//
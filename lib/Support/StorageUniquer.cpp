@@ -19,6 +19,7 @@
 #include "mlir/Support/LLVM.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/RWMutex.h"
+#include <atomic>
 
 using namespace mlir;
 using namespace mlir::detail;
@@ -26,10 +27,24 @@ using namespace mlir::detail;
 namespace mlir {
 namespace detail {
 /// This is the implementation of the StorageUniquer class.
+///
+/// Storage instances are partitioned into a fixed number of shards based on
+/// their hash value. Each shard has its own lock, table, and allocator, so that
+/// threads creating unrelated instances do not contend with each other. Each
+/// shard also contains a small direct-mapped cache of recently accessed
+/// instances that may be queried without taking any lock.
 struct StorageUniquerImpl {
   using BaseStorage = StorageUniquer::BaseStorage;
   using StorageAllocator = StorageUniquer::StorageAllocator;
 
+  /// The number of shards, must be a power of two.
+  static constexpr unsigned kLog2NumShards = 5;
+  static constexpr unsigned kNumShards = 1u << kLog2NumShards;
+
+  /// The number of entries in the lock-free cache of each shard, must be a
+  /// power of two.
+  static constexpr unsigned kNumCacheEntries = 128;
+
   /// A lookup key for derived instances of storage objects.
   struct LookupKey {
     /// The known derived kind for the storage.
@@ -49,60 +64,130 @@ struct StorageUniquerImpl {
     BaseStorage *storage;
   };
 
+  /// Storage info for derived TypeStorage objects.
+  struct StorageKeyInfo : DenseMapInfo<HashedStorage> {
+    static HashedStorage getEmptyKey() {
+      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getEmptyKey()};
+    }
+    static HashedStorage getTombstoneKey() {
+      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getTombstoneKey()};
+    }
+
+    static unsigned getHashValue(const HashedStorage &key) {
+      return key.hashValue;
+    }
+    static unsigned getHashValue(LookupKey key) { return key.hashValue; }
+
+    static bool isEqual(const HashedStorage &lhs, const HashedStorage &rhs) {
+      return lhs.storage == rhs.storage;
+    }
+    static bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
+      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
+        return false;
+      // If the lookup kind matches the kind of the storage, then invoke the
+      // equality function on the lookup key.
+      return lhs.kind == rhs.storage->getKind() && lhs.isEqual(rhs.storage);
+    }
+  };
+
+  /// A single partition of the uniqued storage instances.
+  struct Shard {
+    Shard() {
+      for (auto &entry : cache)
+        entry.store(nullptr, std::memory_order_relaxed);
+    }
+
+    /// Return the cache entry used for the given hash value. The low bits of
+    /// the hash are used, as the high bits select the shard.
+    std::atomic<BaseStorage *> &getCacheEntry(unsigned hashValue) {
+      return cache[hashValue & (kNumCacheEntries - 1)];
+    }
+
+    /// Try to find an existing instance in the cache, without locking.
+    BaseStorage *lookupCached(const LookupKey &key) {
+      BaseStorage *storage =
+          getCacheEntry(key.hashValue).load(std::memory_order_acquire);
+      if (storage && storage->getKind() == key.kind && key.isEqual(storage))
+        return storage;
+      return nullptr;
+    }
+
+    /// Publish the given instance to the cache. Instances are only published
+    /// once they are fully constructed, and the release ordering makes the
+    /// construction visible to the threads that read it from the cache.
+    void publish(unsigned hashValue, BaseStorage *storage) {
+      getCacheEntry(hashValue).store(storage, std::memory_order_release);
+    }
+
+    /// Unique types with specific hashing or storage constraints.
+    using StorageTypeSet = llvm::DenseSet<HashedStorage, StorageKeyInfo>;
+    StorageTypeSet storageTypes;
+
+    /// Allocator to use when constructing derived type instances.
+    StorageUniquer::StorageAllocator allocator;
+
+    /// A mutex to keep type uniquing thread-safe.
+    llvm::sys::SmartRWMutex<true> mutex;
+
+    /// A direct-mapped cache of instances in this shard, indexed by hash value.
+    /// Stale entries are never harmful, as hits are always checked with the
+    /// equality function of the lookup key.
+    std::atomic<BaseStorage *> cache[kNumCacheEntries];
+  };
+
+  /// Return the shard that contains instances with the given hash value.
+  Shard &getShard(unsigned hashValue) {
+    return shards[hashValue >> (32 - kLog2NumShards)];
+  }
+
   /// Get or create an instance of a complex derived type.
   BaseStorage *
   getOrCreate(unsigned kind, unsigned hashValue,
               llvm::function_ref<bool(const BaseStorage *)> isEqual,
               llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     LookupKey lookupKey{kind, hashValue, isEqual};
+    Shard &shard = getShard(hashValue);
+
+    // Check for a recently used instance without taking any lock.
+    if (BaseStorage *storage = shard.lookupCached(lookupKey))
+      return storage;
 
     // Check for an existing instance in read-only mode.
     {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
-      auto it = storageTypes.find_as(lookupKey);
-      if (it != storageTypes.end())
+      llvm::sys::SmartScopedReader<true> typeLock(shard.mutex);
+      auto it = shard.storageTypes.find_as(lookupKey);
+      if (it != shard.storageTypes.end()) {
+        shard.publish(hashValue, it->storage);
         return it->storage;
+      }
     }
 
     // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
+    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
 
     // Check for an existing instance again here, because another writer thread
     // may have already created one.
-    auto existing = storageTypes.insert_as({}, lookupKey);
+    auto existing = shard.storageTypes.insert_as({}, lookupKey);
     if (!existing.second)
       return existing.first->storage;
 
     // Otherwise, construct and initialize the derived storage for this type
     // instance.
-    BaseStorage *storage = initializeStorage(kind, ctorFn);
+    BaseStorage *storage = initializeStorage(kind, shard.allocator, ctorFn);
     *existing.first = HashedStorage{hashValue, storage};
+    shard.publish(hashValue, storage);
     return storage;
   }
 
-  /// Get or create an instance of a simple derived type.
+  /// Get or create an instance of a simple derived type. These are uniqued
+  /// solely by their kind, so any existing instance of the same kind is a
+  /// match.
   BaseStorage *
   getOrCreate(unsigned kind,
               llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    // Check for an existing instance in read-only mode.
-    {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
-      auto it = simpleTypes.find(kind);
-      if (it != simpleTypes.end())
-        return it->second;
-    }
-
-    // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
-
-    // Check for an existing instance again here, because another writer thread
-    // may have already created one.
-    auto &result = simpleTypes[kind];
-    if (result)
-      return result;
-
-    // Otherwise, create and return a new storage instance.
-    return result = initializeStorage(kind, ctorFn);
+    unsigned hashValue = llvm::hash_value(kind);
+    return getOrCreate(kind, hashValue,
+                       [](const BaseStorage *) { return true; }, ctorFn);
   }
 
   /// Erase an instance of a complex derived type.
@@ -110,16 +195,26 @@ struct StorageUniquerImpl {
              llvm::function_ref<bool(const BaseStorage *)> isEqual,
              llvm::function_ref<void(BaseStorage *)> cleanupFn) {
     LookupKey lookupKey{kind, hashValue, isEqual};
+    Shard &shard = getShard(hashValue);
 
     // Acquire a writer-lock so that we can safely erase the type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
-    auto existing = storageTypes.find_as(lookupKey);
-    if (existing == storageTypes.end())
+    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
+    auto existing = shard.storageTypes.find_as(lookupKey);
+    if (existing == shard.storageTypes.end())
       return;
 
+    // Drop the instance from the cache before cleaning it up. The storage
+    // memory itself is never freed, so a concurrent reader that already loaded
+    // it will just observe the cleaned up instance fail the equality check.
+    // The reader doesn't hold the lock: the fields written by the cleanup and
+    // read by the equality check are atomic, as documented in the header.
+    BaseStorage *storage = existing->storage;
+    shard.getCacheEntry(hashValue).compare_exchange_strong(
+        storage, nullptr, std::memory_order_relaxed);
+
     // Cleanup the storage and remove it from the map.
     cleanupFn(existing->storage);
-    storageTypes.erase(existing);
+    shard.storageTypes.erase(existing);
   }
 
   //===--------------------------------------------------------------------===//
@@ -128,51 +223,15 @@ struct StorageUniquerImpl {
 
   /// Utility to create and initialize a storage instance.
   BaseStorage *initializeStorage(
-      unsigned kind,
+      unsigned kind, StorageAllocator &allocator,
       llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     BaseStorage *storage = ctorFn(allocator);
     storage->kind = kind;
     return storage;
   }
 
-  /// Storage info for derived TypeStorage objects.
-  struct StorageKeyInfo : DenseMapInfo<HashedStorage> {
-    static HashedStorage getEmptyKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getEmptyKey()};
-    }
-    static HashedStorage getTombstoneKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getTombstoneKey()};
-    }
-
-    static unsigned getHashValue(const HashedStorage &key) {
-      return key.hashValue;
-    }
-    static unsigned getHashValue(LookupKey key) { return key.hashValue; }
-
-    static bool isEqual(const HashedStorage &lhs, const HashedStorage &rhs) {
-      return lhs.storage == rhs.storage;
-    }
-    static bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
-      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
-        return false;
-      // If the lookup kind matches the kind of the storage, then invoke the
-      // equality function on the lookup key.
-      return lhs.kind == rhs.storage->getKind() && lhs.isEqual(rhs.storage);
-    }
-  };
-
-  // Unique types with specific hashing or storage constraints.
-  using StorageTypeSet = llvm::DenseSet<HashedStorage, StorageKeyInfo>;
-  StorageTypeSet storageTypes;
-
-  // Unique types with just the kind.
-  DenseMap<unsigned, BaseStorage *> simpleTypes;
-
-  // Allocator to use when constructing derived type instances.
-  StorageUniquer::StorageAllocator allocator;
-
-  // A mutex to keep type uniquing thread-safe.
-  llvm::sys::SmartRWMutex<true> mutex;
+  /// The partitions of the uniqued storage instances.
+  Shard shards[kNumShards];
 };
 } // end namespace detail
 } // namespace mlir
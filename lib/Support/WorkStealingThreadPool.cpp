@@ -0,0 +1,287 @@
+//===- WorkStealingThreadPool.cpp - Work stealing thread pool -------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/WorkStealingThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace mlir;
+using namespace mlir::detail;
+
+namespace {
+/// The pool and the thread index of the task being executed by the current
+/// thread, if any.
+struct CurrentTask {
+  const WorkStealingThreadPoolImpl *pool;
+  unsigned threadIndex;
+};
+} // end anonymous namespace
+
+static thread_local CurrentTask currentTask = {nullptr, 0};
+
+namespace mlir {
+namespace detail {
+/// This is the implementation of the WorkStealingThreadPool class.
+///
+/// The pool holds a queue of task indices per thread. When a batch is started,
+/// the tasks are dealt out to the queues, the worker threads are woken up, and
+/// the submitting thread starts executing the tasks of queue 0. Each thread
+/// leaves the batch once all of the queues are empty; as all of the tasks are
+/// queued up front, no new work can appear after this point.
+struct WorkStealingThreadPoolImpl {
+  using ThreadStatistics = WorkStealingThreadPool::ThreadStatistics;
+  using TaskCallback = llvm::function_ref<void(unsigned, size_t)>;
+
+  /// The queue of tasks assigned to a single thread.
+  struct TaskQueue {
+    /// Pop the task at the front of the queue, for execution by its owner.
+    bool popFront(size_t &task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (tasks.empty())
+        return false;
+      task = tasks.front();
+      tasks.pop_front();
+      return true;
+    }
+
+    /// Pop the task at the back of the queue, for execution by another thread.
+    bool popBack(size_t &task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (tasks.empty())
+        return false;
+      task = tasks.back();
+      tasks.pop_back();
+      return true;
+    }
+
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  WorkStealingThreadPoolImpl(unsigned numThreads) { resize(numThreads); }
+  ~WorkStealingThreadPoolImpl() { stopWorkers(); }
+
+  /// Resize the pool to the given number of threads. The workers must not be
+  /// running.
+  void resize(unsigned newNumThreads) {
+    if (newNumThreads == 0)
+      newNumThreads = llvm::hardware_concurrency();
+    numThreads = std::max(newNumThreads, 1u);
+
+    queues.clear();
+    for (unsigned i = 0; i != numThreads; ++i)
+      queues.emplace_back(new TaskQueue());
+
+    // Keep the statistics of threads that are removed, as they may still be of
+    // interest to the user.
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (statistics.size() < numThreads)
+      statistics.resize(numThreads);
+  }
+
+  /// Start the worker threads if they aren't running yet.
+  void startWorkers() {
+    if (!workers.empty())
+      return;
+    uint64_t startGeneration = generation;
+    for (unsigned i = 1; i != numThreads; ++i)
+      workers.emplace_back(
+          [this, i, startGeneration] { runWorker(i, startGeneration); });
+  }
+
+  /// Stop and join the worker threads.
+  void stopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      shutdown = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+    workers.clear();
+    shutdown = false;
+  }
+
+  /// The main loop of the worker thread with the given index.
+  void runWorker(unsigned threadIndex, uint64_t lastGeneration) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [&] {
+          return shutdown || generation != lastGeneration;
+        });
+        if (shutdown)
+          return;
+        lastGeneration = generation;
+      }
+
+      runTasks(threadIndex);
+
+      std::lock_guard<std::mutex> lock(stateMutex);
+      if (--numActiveWorkers == 0)
+        workDone.notify_one();
+    }
+  }
+
+  /// Execute tasks of the current batch on the given thread until all of the
+  /// queues are empty.
+  void runTasks(unsigned threadIndex) {
+    ThreadStatistics threadStats;
+    while (true) {
+      // Take the next task from our own queue, or steal one from another
+      // thread, starting with our neighbour.
+      size_t task;
+      bool stolen = false;
+      if (!queues[threadIndex]->popFront(task)) {
+        for (unsigned i = 1; i != numThreads && !stolen; ++i)
+          stolen = queues[(threadIndex + i) % numThreads]->popBack(task);
+        if (!stolen)
+          break;
+      }
+
+      auto startTime = std::chrono::steady_clock::now();
+      CurrentTask enclosingTask = currentTask;
+      currentTask = {this, threadIndex};
+      (*callback)(threadIndex, task);
+      currentTask = enclosingTask;
+      threadStats.busyTime += std::chrono::steady_clock::now() - startTime;
+      ++threadStats.numTasks;
+      threadStats.numStolenTasks += stolen;
+    }
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    ThreadStatistics &stats = statistics[threadIndex];
+    stats.busyTime += threadStats.busyTime;
+    stats.numTasks += threadStats.numTasks;
+    stats.numStolenTasks += threadStats.numStolenTasks;
+  }
+
+  /// The number of threads of the pool, including the submitting thread.
+  std::atomic<unsigned> numThreads;
+
+  /// The worker threads, with indices [1, numThreads).
+  std::vector<std::thread> workers;
+
+  /// The task queue of each thread.
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+
+  /// A mutex held for the duration of a batch.
+  std::mutex batchMutex;
+
+  /// The callback of the batch being executed.
+  TaskCallback *callback = nullptr;
+
+  /// The state shared with the worker threads, guarded by 'stateMutex'.
+  std::mutex stateMutex;
+  std::condition_variable workAvailable, workDone;
+
+  /// The number of batches started, used to wake up the workers.
+  uint64_t generation = 0;
+
+  /// The number of workers that haven't finished the current batch.
+  unsigned numActiveWorkers = 0;
+
+  /// Set when the workers should exit.
+  bool shutdown = false;
+
+  /// The statistics accumulated by each thread.
+  std::vector<ThreadStatistics> statistics;
+};
+} // end namespace detail
+} // end namespace mlir
+
+WorkStealingThreadPool::WorkStealingThreadPool(unsigned numThreads)
+    : impl(new WorkStealingThreadPoolImpl(numThreads)) {}
+WorkStealingThreadPool::~WorkStealingThreadPool() {}
+
+/// Returns the number of threads of this pool.
+unsigned WorkStealingThreadPool::getNumThreads() const {
+  return impl->numThreads;
+}
+
+/// Set the number of threads of this pool.
+void WorkStealingThreadPool::setNumThreads(unsigned numThreads) {
+  if (numThreads == 0)
+    numThreads = llvm::hardware_concurrency();
+
+  std::lock_guard<std::mutex> batchLock(impl->batchMutex);
+  if (numThreads == impl->numThreads)
+    return;
+  impl->stopWorkers();
+  impl->resize(numThreads);
+}
+
+/// Execute 'callback' for each task index in [0, numTasks), and wait for all
+/// of the tasks to complete.
+void WorkStealingThreadPool::parallelFor(
+    size_t numTasks,
+    llvm::function_ref<void(unsigned threadIndex, size_t taskIndex)>
+        callback) {
+  if (numTasks == 0)
+    return;
+
+  // A batch submitted from within a task of this pool can't wait for the pool,
+  // which is busy executing the enclosing batch: run its tasks on the calling
+  // thread, as the thread executing the enclosing task.
+  if (currentTask.pool == impl.get()) {
+    for (size_t i = 0; i != numTasks; ++i)
+      callback(currentTask.threadIndex, i);
+    return;
+  }
+
+  // Otherwise, wait for the batch being executed, if any, to complete.
+  std::unique_lock<std::mutex> batchLock(impl->batchMutex);
+
+  // Deal out the tasks to the queues, in order, so that each thread starts
+  // with one of the first tasks of the batch.
+  unsigned numThreads = impl->numThreads;
+  if (!llvm::llvm_is_multithreaded() || numTasks == 1)
+    numThreads = 1;
+  for (size_t i = 0; i != numTasks; ++i)
+    impl->queues[i % numThreads]->tasks.push_back(i);
+  impl->callback = &callback;
+
+  // Wake up the workers, and execute tasks on this thread until there are none
+  // left.
+  if (numThreads != 1) {
+    impl->startWorkers();
+    {
+      std::lock_guard<std::mutex> lock(impl->stateMutex);
+      impl->numActiveWorkers = numThreads - 1;
+      ++impl->generation;
+    }
+    impl->workAvailable.notify_all();
+  }
+  impl->runTasks(/*threadIndex=*/0);
+
+  // Wait for the workers to finish the tasks they have started.
+  std::unique_lock<std::mutex> lock(impl->stateMutex);
+  impl->workDone.wait(lock, [&] { return impl->numActiveWorkers == 0; });
+  impl->callback = nullptr;
+}
+
+/// Returns the statistics accumulated by each thread of the pool.
+auto WorkStealingThreadPool::getStatistics() const
+    -> std::vector<ThreadStatistics> {
+  std::lock_guard<std::mutex> lock(impl->stateMutex);
+  return impl->statistics;
+}
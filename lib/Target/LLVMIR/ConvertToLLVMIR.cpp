@@ -26,7 +26,9 @@
 #include "mlir/Translation.h"
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ToolOutputFile.h"
 
 using namespace mlir;
@@ -35,6 +37,11 @@ std::unique_ptr<llvm::Module> mlir::translateModuleToLLVMIR(Module &m) {
   return LLVM::ModuleTranslation::translateModule<>(m);
 }
 
+std::vector<LLVMIRShard>
+mlir::translateModuleToLLVMIRShards(Module &m, unsigned numShards) {
+  return LLVM::ModuleTranslation::translateModuleToShards<>(m, numShards);
+}
+
 static TranslateFromMLIRRegistration registration(
     "mlir-to-llvmir", [](Module *module, llvm::StringRef outputFilename) {
       if (!module)
@@ -52,3 +59,29 @@ static TranslateFromMLIRRegistration registration(
       file->keep();
       return false;
     });
+
+static llvm::cl::opt<unsigned>
+    clNumShards("llvmir-num-shards",
+                llvm::cl::desc("Number of LLVM IR modules produced by "
+                               "-mlir-to-llvmir-shards"),
+                llvm::cl::init(2));
+
+static TranslateFromMLIRRegistration shardsRegistration(
+    "mlir-to-llvmir-shards",
+    [](Module *module, llvm::StringRef outputFilename) {
+      if (!module)
+        return true;
+
+      auto shards = translateModuleToLLVMIRShards(*module, clNumShards);
+      if (shards.empty())
+        return true;
+
+      auto file = openOutputFile(outputFilename);
+      if (!file)
+        return true;
+
+      for (auto &shard : shards)
+        shard.module->print(file->os(), nullptr);
+      file->keep();
+      return false;
+    });
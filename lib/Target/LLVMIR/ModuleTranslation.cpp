@@ -23,12 +23,18 @@
 #include "mlir/Target/LLVMIR/ModuleTranslation.h"
 
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
 #include "mlir/LLVMIR/LLVMDialect.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/LLVM.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -37,15 +43,93 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
+#include <algorithm>
+
 namespace mlir {
 namespace LLVM {
 
+llvm::Type *ModuleTranslation::convertType(LLVMType type) {
+  return translateType(type.getUnderlyingType());
+}
+
+// Rebuild `type` in the context of the LLVM IR module being built.  The type is
+// returned as is when it already belongs to that context, which is the case
+// unless translating to shards.
+llvm::Type *ModuleTranslation::translateType(llvm::Type *type) {
+  llvm::LLVMContext &llvmContext = llvmModule->getContext();
+  if (&type->getContext() == &llvmContext)
+    return type;
+  if (llvm::Type *mapped = typeMapping.lookup(type))
+    return mapped;
+
+  llvm::Type *mapped = nullptr;
+  switch (type->getTypeID()) {
+  case llvm::Type::IntegerTyID:
+    mapped = llvm::IntegerType::get(llvmContext, type->getIntegerBitWidth());
+    break;
+  case llvm::Type::PointerTyID:
+    mapped = llvm::PointerType::get(
+        translateType(type->getPointerElementType()),
+        type->getPointerAddressSpace());
+    break;
+  case llvm::Type::ArrayTyID:
+    mapped = llvm::ArrayType::get(translateType(type->getArrayElementType()),
+                                  type->getArrayNumElements());
+    break;
+  case llvm::Type::VectorTyID:
+    mapped = llvm::VectorType::get(translateType(type->getVectorElementType()),
+                                   type->getVectorNumElements());
+    break;
+  case llvm::Type::FunctionTyID: {
+    auto *functionType = cast<llvm::FunctionType>(type);
+    SmallVector<llvm::Type *, 8> params;
+    for (llvm::Type *param : functionType->params())
+      params.push_back(translateType(param));
+    mapped = llvm::FunctionType::get(
+        translateType(functionType->getReturnType()), params,
+        functionType->isVarArg());
+    break;
+  }
+  case llvm::Type::StructTyID: {
+    auto *structType = cast<llvm::StructType>(type);
+    SmallVector<llvm::Type *, 8> elements;
+    if (structType->isLiteral()) {
+      for (llvm::Type *element : structType->elements())
+        elements.push_back(translateType(element));
+      mapped = llvm::StructType::get(llvmContext, elements,
+                                     structType->isPacked());
+      break;
+    }
+    // Identified structures may be recursive: map them before their body.
+    // They may also already be defined by the globals of the module.
+    llvm::StructType *mappedStruct =
+        llvmModule->getTypeByName(structType->getName());
+    if (!mappedStruct)
+      mappedStruct = llvm::StructType::create(llvmContext,
+                                              structType->getName());
+    typeMapping[type] = mappedStruct;
+    if (mappedStruct->isOpaque() && !structType->isOpaque()) {
+      for (llvm::Type *element : structType->elements())
+        elements.push_back(translateType(element));
+      mappedStruct->setBody(elements, structType->isPacked());
+    }
+    return mappedStruct;
+  }
+  default:
+    mapped = llvm::Type::getPrimitiveType(llvmContext, type->getTypeID());
+    break;
+  }
+  assert(mapped && "unsupported LLVM IR type");
+  typeMapping[type] = mapped;
+  return mapped;
+}
+
 // Convert an MLIR function type to LLVM IR.  Arguments of the function must of
 // MLIR LLVM IR dialect types.  Use `loc` as a location when reporting errors.
 // Return nullptr on errors.
-static llvm::FunctionType *convertFunctionType(llvm::LLVMContext &llvmContext,
-                                               FunctionType type, Location loc,
-                                               bool isVarArgs) {
+llvm::FunctionType *ModuleTranslation::convertFunctionType(FunctionType type,
+                                                           Location loc,
+                                                           bool isVarArgs) {
   assert(type && "expected non-null type");
 
   auto context = type.getContext();
@@ -61,19 +145,19 @@ static llvm::FunctionType *convertFunctionType(llvm::LLVMContext &llvmContext,
     if (!wrappedLLVMType)
       return context->emitError(loc, "non-LLVM function argument type"),
              nullptr;
-    argTypes.push_back(wrappedLLVMType.getUnderlyingType());
+    argTypes.push_back(convertType(wrappedLLVMType));
   }
 
   if (type.getNumResults() == 0)
-    return llvm::FunctionType::get(llvm::Type::getVoidTy(llvmContext), argTypes,
-                                   isVarArgs);
+    return llvm::FunctionType::get(
+        llvm::Type::getVoidTy(llvmModule->getContext()), argTypes, isVarArgs);
 
   auto wrappedResultType = type.getResult(0).dyn_cast<LLVM::LLVMType>();
   if (!wrappedResultType)
     return context->emitError(loc, "non-LLVM function result"), nullptr;
 
-  return llvm::FunctionType::get(wrappedResultType.getUnderlyingType(),
-                                 argTypes, isVarArgs);
+  return llvm::FunctionType::get(convertType(wrappedResultType), argTypes,
+                                 isVarArgs);
 }
 
 // Create an LLVM IR constant of `llvmType` from the MLIR attribute `attr`.
@@ -238,7 +322,7 @@ bool ModuleTranslation::convertBlock(Block &bb, bool ignoreArguments) {
             bb.front().getLoc(), "block argument does not have an LLVM type");
         return true;
       }
-      llvm::Type *type = wrappedType.getUnderlyingType();
+      llvm::Type *type = convertType(wrappedType);
       llvm::PHINode *phi = builder.CreatePHI(type, numPredecessors);
       valueMapping[arg] = phi;
     }
@@ -375,7 +459,7 @@ bool ModuleTranslation::convertOneFunction(Function &func) {
   return false;
 }
 
-bool ModuleTranslation::convertFunctions() {
+bool ModuleTranslation::declareFunctions() {
   // Declare all functions first because there may be function calls that form a
   // call graph with cycles.
   for (Function &function : mlirModule) {
@@ -384,8 +468,7 @@ bool ModuleTranslation::convertFunctions() {
         function.getAttrOfType<BoolAttr>("std.varargs");
     bool isVarArgs = isVarArgsAttr && isVarArgsAttr.getValue();
     llvm::FunctionType *functionType =
-        convertFunctionType(llvmModule->getContext(), function.getType(),
-                            function.getLoc(), isVarArgs);
+        convertFunctionType(function.getType(), function.getLoc(), isVarArgs);
     if (!functionType)
       return true;
     llvm::FunctionCallee llvmFuncCst =
@@ -394,6 +477,12 @@ bool ModuleTranslation::convertFunctions() {
     functionMapping[functionPtr] =
         cast<llvm::Function>(llvmFuncCst.getCallee());
   }
+  return false;
+}
+
+bool ModuleTranslation::convertFunctions() {
+  if (declareFunctions())
+    return true;
 
   // Convert functions.
   for (Function &function : mlirModule) {
@@ -408,6 +497,106 @@ bool ModuleTranslation::convertFunctions() {
   return false;
 }
 
+bool ModuleTranslation::convertShard(ArrayRef<Function *> functions) {
+  // The functions are already declared in the module of the shard, this only
+  // maps them.
+  if (declareFunctions())
+    return true;
+
+  for (Function *function : functions)
+    if (convertOneFunction(*function))
+      return true;
+
+  // Only keep the declarations of the functions of the other shards that this
+  // shard refers to.
+  llvm::DenseSet<Function *> shardFunctions(functions.begin(), functions.end());
+  for (Function &function : mlirModule) {
+    if (function.isExternal() || shardFunctions.count(&function))
+      continue;
+    llvm::Function *llvmFunc = functionMapping.lookup(&function);
+    if (llvmFunc->use_empty()) {
+      functionMapping.erase(&function);
+      llvmFunc->eraseFromParent();
+    }
+  }
+  return false;
+}
+
+std::vector<LLVMIRShard>
+ModuleTranslation::translateShards(Module &m, unsigned numShards,
+                                   ShardTranslator translateShard) {
+  // Split the defined functions into contiguous ranges with similar numbers of
+  // operations.  Keeping the functions in order lets the diagnostics of the
+  // shards be emitted in the order of the module.
+  std::vector<Function *> functions;
+  std::vector<size_t> functionSizes;
+  size_t totalSize = 0;
+  for (Function &function : m) {
+    if (function.isExternal())
+      continue;
+    size_t size = 0;
+    function.walk([&](Operation *) { ++size; });
+    functions.push_back(&function);
+    functionSizes.push_back(size);
+    totalSize += size;
+  }
+  numShards =
+      std::max<size_t>(1, std::min<size_t>(numShards, functions.size()));
+  std::vector<std::vector<Function *>> shardFunctions(numShards);
+  size_t sizeBefore = 0;
+  for (unsigned i = 0, e = functions.size(); i < e; ++i) {
+    size_t shard = std::min<size_t>(numShards - 1,
+                                    sizeBefore * numShards / totalSize);
+    shardFunctions[shard].push_back(functions[i]);
+    sizeBefore += functionSizes[i];
+  }
+  // A large function may leave the shards before it empty.
+  if (!functions.empty())
+    shardFunctions.erase(
+        std::remove_if(shardFunctions.begin(), shardFunctions.end(),
+                       [](const std::vector<Function *> &shard) {
+                         return shard.empty();
+                       }),
+        shardFunctions.end());
+
+  // The globals and the declarations of all the functions are prepared once,
+  // which also reports invalid function types once, and are moved to the
+  // context of each shard through bitcode.
+  llvm::SmallString<0> baseBitcode;
+  std::string moduleIdentifier;
+  {
+    ModuleTranslation baseTranslator(m);
+    baseTranslator.llvmModule = prepareLLVMModule(m);
+    if (!baseTranslator.llvmModule || baseTranslator.declareFunctions())
+      return {};
+    moduleIdentifier = baseTranslator.llvmModule->getModuleIdentifier();
+    llvm::raw_svector_ostream os(baseBitcode);
+    llvm::WriteBitcodeToFile(*baseTranslator.llvmModule, os);
+  }
+
+  std::vector<LLVMIRShard> shards(shardFunctions.size());
+  std::vector<char> translated(shards.size(), false);
+  MLIRContext *context = m.getContext();
+  {
+    ParallelDiagnosticHandler diagHandler(context);
+    context->getThreadPool().parallelFor(
+        shards.size(), [&](unsigned threadIndex, size_t shardIndex) {
+          diagHandler.setOrderIDForThread(shardIndex);
+          LLVMIRShard &shard = shards[shardIndex];
+          shard.context = llvm::make_unique<llvm::LLVMContext>();
+          auto shardModule = llvm::cantFail(llvm::parseBitcodeFile(
+              llvm::MemoryBufferRef(baseBitcode, moduleIdentifier),
+              *shard.context));
+          shard.module = translateShard(std::move(shardModule),
+                                        shardFunctions[shardIndex]);
+          translated[shardIndex] = shard.module != nullptr;
+        });
+  }
+  if (llvm::is_contained(translated, false))
+    return {};
+  return shards;
+}
+
 std::unique_ptr<llvm::Module> ModuleTranslation::prepareLLVMModule(Module &m) {
   Dialect *dialect = m.getContext()->getRegisteredDialect("llvm");
   assert(dialect && "LLVM dialect must be registered");
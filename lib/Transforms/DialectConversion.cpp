@@ -22,9 +22,13 @@
 #include "mlir/Transforms/DialectConversion.h"
 #include "mlir/IR/BlockAndValueMapping.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
+#include "mlir/Support/WorkStealingThreadPool.h"
 #include "mlir/Transforms/Utils.h"
+#include <numeric>
 
 using namespace mlir;
 
@@ -33,22 +37,26 @@ namespace impl {
 // Implementation detail class of the DialectConversion pass.  Performs
 // function-by-function conversions by creating new functions, filling them in
 // with converted blocks, updating the function attributes, and replacing the
-// old functions with the new ones in the module.
+// old functions with the new ones in the module.  In the in-place mode,
+// rewrites the functions instead.
 class FunctionConversion {
 public:
   // Entry point.  Uses hooks defined in `conversion` to obtain the list of
   // conversion patterns and to convert function and block argument types.
   // Converts the `module` in-place by replacing all existing functions with the
-  // converted ones.
-  static LogicalResult convert(DialectConversion *conversion, Module *module);
+  // converted ones, or by rewriting them, depending on `mode`.
+  static LogicalResult convert(DialectConversion *conversion, Module *module,
+                               ConversionMode mode);
 
 private:
   // Constructs a FunctionConversion by storing the hooks.
-  explicit FunctionConversion(DialectConversion *conversion)
-      : dialectConversion(conversion) {}
+  FunctionConversion(DialectConversion *conversion, ConversionMode mode)
+      : dialectConversion(conversion), mode(mode),
+        inPlace(mode != ConversionMode::Clone) {}
 
   // Utility that looks up a list of value in the value remapping table. Returns
-  // an empty vector if one of the values is not mapped yet.
+  // an empty vector if one of the values is not mapped yet.  In the in-place
+  // mode, values that are not mapped are left unchanged.
   SmallVector<Value *, 4> lookupValues(Operation::operand_range operands);
 
   // Converts the given function to the dialect using hooks defined in
@@ -61,6 +69,36 @@ private:
   std::unique_ptr<Region> convertRegion(MLIRContext *context, Region *region,
                                         RegionParent *parent);
 
+  // Converts the given function in place.  On error, restores the function and
+  // returns failure.
+  LogicalResult convertFunctionInPlace(Function *f);
+
+  // Converts the body of the given function in place, and returns its converted
+  // type and argument attributes without updating the function.  On error,
+  // restores the function and returns failure.
+  LogicalResult
+  convertFunctionBodyInPlace(Function *f, FunctionType &newType,
+                             SmallVectorImpl<NamedAttributeList> &newArgAttrs);
+
+  // Converts the given functions in place, converting their bodies concurrently
+  // on the thread pool of the context, then updates the types of the functions
+  // that were converted.
+  LogicalResult convertFunctionsInParallel(MLIRContext *context,
+                                           ArrayRef<Function *> funcs);
+
+  // Converts the given region in place, starting from the entry block and
+  // following the block successors.  The changes are recorded, and only
+  // applied by `commitInPlaceConversion`.
+  LogicalResult convertRegionInPlace(MLIRContext *context, Region *region);
+
+  // Replaces the original operations and block arguments with the converted
+  // ones, and erases them.
+  void commitInPlaceConversion();
+
+  // Erases the operations and block arguments created by the in-place
+  // conversion, which restores the original IR.
+  void rollbackInPlaceConversion();
+
   // Converts an operation with successors.  Extracts the converted operands
   // from `valueRemapping` and the converted blocks from `blockRemapping`, and
   // passes them to `converter->rewriteTerminator` function defined in the
@@ -74,10 +112,15 @@ private:
   LogicalResult convertOp(DialectOpConversion *converter, Operation *op,
                           FuncBuilder &builder);
 
+  // Returns the first conversion pattern matching `op`, or `nullptr` if there
+  // is none.
+  DialectOpConversion *findConversion(Operation *op);
+
   // Converts a block by traversing its operations sequentially, looking for
   // the first pattern match and dispatching the operation conversion to
   // either `convertOp` or `convertOpWithSuccessors` depending on the presence
-  // of successors.  If there is no match, clones the operation.
+  // of successors.  If there is no match, clones the operation, or leaves it in
+  // place in the in-place mode.
   //
   // After converting operations, traverses the successor blocks unless they
   // have been visited already as indicated in `visitedBlocks`.
@@ -90,17 +133,35 @@ private:
   // 2. Remap all function attributes in the new functions to point to the new
   // functions instead of the old ones.
   // 3. Replace old functions with the new in the module.
+  // In the in-place modes, calls `convertFunctionInPlace` on each function, or
+  // `convertFunctionsInParallel` on all of them, instead.
   LogicalResult run(Module *m);
 
   // Pointer to a specific dialect pass.
   DialectConversion *dialectConversion;
 
-  // Set of known conversion patterns.
-  llvm::DenseSet<DialectOpConversion *> conversions;
+  // The way functions are converted, and whether they are converted in place.
+  ConversionMode mode;
+  bool inPlace;
+
+  // Known conversion patterns, indexed by the name of their root operation and
+  // sorted by decreasing benefit.  Patterns without a root operation are kept
+  // separately.
+  llvm::DenseMap<OperationName, SmallVector<DialectOpConversion *, 2>>
+      conversionsByRoot;
+  SmallVector<DialectOpConversion *, 2> conversionsWithoutRoot;
 
   // Mapping between values(blocks) in the original function and in the new
   // function.
   BlockAndValueMapping mapping;
+
+  // Changes made by the in-place conversion of the current function: the
+  // operations created by the patterns in creation order, the operations they
+  // replace, and the blocks that got arguments of converted types along with
+  // their original number of arguments.
+  SmallVector<Operation *, 16> createdOps;
+  SmallVector<Operation *, 16> replacedOps;
+  SmallVector<std::pair<Block *, unsigned>, 4> convertedBlocks;
 };
 } // end namespace impl
 } // end namespace mlir
@@ -110,7 +171,8 @@ impl::FunctionConversion::lookupValues(Operation::operand_range operands) {
   SmallVector<Value *, 4> remapped;
   remapped.reserve(llvm::size(operands));
   for (Value *operand : operands) {
-    Value *value = mapping.lookupOrNull(operand);
+    Value *value = inPlace ? mapping.lookupOrDefault(operand)
+                           : mapping.lookupOrNull(operand);
     if (!value)
       return {};
     remapped.push_back(value);
@@ -133,7 +195,8 @@ LogicalResult impl::FunctionConversion::convertOpWithSuccessors(
   unsigned seen = 0;
   unsigned firstSuccessorOperand = op->getNumOperands() - numSuccessorOperands;
   for (unsigned i = 0, e = op->getNumSuccessors(); i < e; ++i) {
-    Block *successor = mapping.lookupOrNull(op->getSuccessor(i));
+    Block *successor = inPlace ? op->getSuccessor(i)
+                               : mapping.lookupOrNull(op->getSuccessor(i));
     assert(successor && "block was not remapped");
     destinations.push_back(successor);
     unsigned n = op->getNumSuccessorOperands(i);
@@ -166,44 +229,86 @@ impl::FunctionConversion::convertOp(DialectOpConversion *converter,
   return success();
 }
 
+DialectOpConversion *
+impl::FunctionConversion::findConversion(Operation *op) {
+  // Try the patterns rooted at the operation first, then the others, in order
+  // of decreasing benefit.
+  auto rootIt = conversionsByRoot.find(op->getName());
+  ArrayRef<DialectOpConversion *> rootConversions;
+  if (rootIt != conversionsByRoot.end())
+    rootConversions = rootIt->second;
+  auto otherConversions = llvm::makeArrayRef(conversionsWithoutRoot);
+
+  while (!rootConversions.empty() || !otherConversions.empty()) {
+    DialectOpConversion *conversion;
+    if (otherConversions.empty() ||
+        (!rootConversions.empty() && !(rootConversions.front()->getBenefit() <
+                                       otherConversions.front()->getBenefit()))) {
+      conversion = rootConversions.front();
+      rootConversions = rootConversions.drop_front();
+    } else {
+      conversion = otherConversions.front();
+      otherConversions = otherConversions.drop_front();
+    }
+    if (conversion->match(op))
+      return conversion;
+  }
+  return nullptr;
+}
+
 LogicalResult
 impl::FunctionConversion::convertBlock(Block *block, FuncBuilder &builder,
                                        llvm::DenseSet<Block *> &visitedBlocks) {
   // First, add the current block to the list of visited blocks.
   visitedBlocks.insert(block);
   // Setup the builder to the insert to the converted block.
-  builder.setInsertionPointToStart(mapping.lookupOrNull(block));
+  if (!inPlace)
+    builder.setInsertionPointToStart(mapping.lookupOrNull(block));
 
-  // Iterate over ops and convert them.
+  // Iterate over ops and convert them.  In the in-place mode, the operations
+  // created by a pattern are inserted before the operation being converted,
+  // and thus aren't visited.
   for (Operation &op : *block) {
     // Find the first matching conversion and apply it.
-    bool converted = false;
-    for (auto *conversion : conversions) {
-      // Ignore patterns that are for the wrong root or are impossible to match.
-      if (conversion->getRootKind() != op.getName() ||
-          conversion->getBenefit().isImpossibleToMatch())
-        continue;
-
-      if (!conversion->match(&op))
-        continue;
-
-      if (op.getNumSuccessors() != 0) {
-        if (failed(convertOpWithSuccessors(conversion, &op, builder)))
-          return failure();
-      } else if (failed(convertOp(conversion, &op, builder))) {
-        return failure();
+    if (auto *conversion = findConversion(&op)) {
+      // Remember where the created operations will start, i.e. after the
+      // operation preceding 'op', if any.
+      Block::iterator opIt(&op);
+      Operation *prevOp = opIt == block->begin() ? nullptr : &*std::prev(opIt);
+      if (inPlace)
+        builder.setInsertionPoint(&op);
+
+      LogicalResult result =
+          op.getNumSuccessors() != 0
+              ? convertOpWithSuccessors(conversion, &op, builder)
+              : convertOp(conversion, &op, builder);
+
+      // Record the operations that were created, even by a failed pattern, so
+      // that they are erased by a rollback, and the one they replace.
+      if (inPlace) {
+        auto createdIt = prevOp ? std::next(Block::iterator(prevOp))
+                                : block->begin();
+        for (; &*createdIt != &op; ++createdIt)
+          createdOps.push_back(&*createdIt);
+        replacedOps.push_back(&op);
       }
-      converted = true;
-      break;
+      if (failed(result))
+        return failure();
+      continue;
     }
+
     // If there is no conversion provided for the op, clone the op and convert
-    // its regions, if any.
-    if (!converted) {
-      auto *newOp = builder.cloneWithoutRegions(op, mapping);
-      for (int i = 0, e = op.getNumRegions(); i < e; ++i) {
-        auto newRegion = convertRegion(op.getContext(), &op.getRegion(i), &op);
-        newOp->getRegion(i).takeBody(*newRegion);
-      }
+    // its regions, if any.  In the in-place mode, convert its regions only.
+    if (inPlace) {
+      for (int i = 0, e = op.getNumRegions(); i < e; ++i)
+        if (failed(convertRegionInPlace(op.getContext(), &op.getRegion(i))))
+          return failure();
+      continue;
+    }
+    auto *newOp = builder.cloneWithoutRegions(op, mapping);
+    for (int i = 0, e = op.getNumRegions(); i < e; ++i) {
+      auto newRegion = convertRegion(op.getContext(), &op.getRegion(i), &op);
+      newOp->getRegion(i).takeBody(*newRegion);
     }
   }
 
@@ -260,6 +365,55 @@ impl::FunctionConversion::convertRegion(MLIRContext *context, Region *region,
   return newRegion;
 }
 
+LogicalResult
+impl::FunctionConversion::convertRegionInPlace(MLIRContext *context,
+                                               Region *region) {
+  assert(region && "expected a region");
+  if (region->empty())
+    return success();
+
+  auto emitError = [context](llvm::Twine f) {
+    context->emitError(UnknownLoc::get(context), f.str());
+    return failure();
+  };
+
+  // Add arguments of the converted types to the blocks whose argument types
+  // change.  The original arguments are kept until the conversion is
+  // committed, since the operations using them are not converted yet.
+  SmallVector<Type, 4> convertedTypes;
+  for (Block &block : *region) {
+    convertedTypes.clear();
+    bool typesChanged = false;
+    for (auto *arg : block.getArguments()) {
+      auto convertedType = dialectConversion->convertType(arg->getType());
+      if (!convertedType)
+        return emitError("could not convert block argument type");
+      convertedTypes.push_back(convertedType);
+      typesChanged |= convertedType != arg->getType();
+    }
+    if (!typesChanged)
+      continue;
+
+    unsigned numArgs = block.getNumArguments();
+    convertedBlocks.emplace_back(&block, numArgs);
+    for (unsigned i = 0; i < numArgs; ++i)
+      mapping.map(block.getArgument(i), block.addArgument(convertedTypes[i]));
+  }
+
+  // Start a DFS-order traversal of the CFG to make sure defs are converted
+  // before uses in dominated blocks.
+  llvm::DenseSet<Block *> visitedBlocks;
+  FuncBuilder builder(&region->front());
+  if (failed(convertBlock(&region->front(), builder, visitedBlocks)))
+    return failure();
+
+  // If some blocks are not reachable through successor chains, they should have
+  // been removed by the DCE before this.
+  if (visitedBlocks.size() != std::distance(region->begin(), region->end()))
+    return emitError("unreachable blocks were not converted");
+  return success();
+}
+
 Function *impl::FunctionConversion::convertFunction(Function *f) {
   assert(f && "expected function");
   MLIRContext *context = f->getContext();
@@ -291,9 +445,145 @@ Function *impl::FunctionConversion::convertFunction(Function *f) {
   return newFunction.release();
 }
 
+// Sets the type and the argument attributes of a function converted in place.
+static void setConvertedSignature(Function *f, FunctionType type,
+                                  ArrayRef<NamedAttributeList> argAttrs) {
+  f->setType(type);
+  auto allArgAttrs = f->getAllArgAttrs();
+  for (unsigned i = 0, e = argAttrs.size(); i < e; ++i)
+    allArgAttrs[i] = argAttrs[i];
+}
+
+LogicalResult impl::FunctionConversion::convertFunctionInPlace(Function *f) {
+  FunctionType newFunctionType;
+  SmallVector<NamedAttributeList, 4> newFunctionArgAttrs;
+  if (failed(convertFunctionBodyInPlace(f, newFunctionType,
+                                        newFunctionArgAttrs)))
+    return failure();
+  setConvertedSignature(f, newFunctionType, newFunctionArgAttrs);
+  return success();
+}
+
+LogicalResult impl::FunctionConversion::convertFunctionBodyInPlace(
+    Function *f, FunctionType &newType,
+    SmallVectorImpl<NamedAttributeList> &newArgAttrs) {
+  assert(f && "expected function");
+  MLIRContext *context = f->getContext();
+  auto emitError = [context](llvm::Twine f) {
+    context->emitError(UnknownLoc::get(context), f.str());
+    return failure();
+  };
+
+  Type newFunctionType = dialectConversion->convertFunctionSignatureType(
+      f->getType(), f->getAllArgAttrs(), newArgAttrs);
+  if (!newFunctionType)
+    return emitError("could not convert function type");
+  newType = newFunctionType.cast<FunctionType>();
+
+  // Convert the body, and apply the changes only if it succeeds.
+  mapping.clear();
+  createdOps.clear();
+  replacedOps.clear();
+  convertedBlocks.clear();
+  if (failed(convertRegionInPlace(context, &f->getBody()))) {
+    rollbackInPlaceConversion();
+    return emitError("could not convert function body");
+  }
+  commitInPlaceConversion();
+  return success();
+}
+
+LogicalResult impl::FunctionConversion::convertFunctionsInParallel(
+    MLIRContext *context, ArrayRef<Function *> funcs) {
+  // Each thread of the pool converts functions with its own copy of this
+  // conversion, which shares the patterns but not the per-function state.
+  WorkStealingThreadPool &threadPool = context->getThreadPool();
+  std::vector<FunctionConversion> threadConversions(threadPool.getNumThreads(),
+                                                    *this);
+
+  // Schedule the largest functions first, so that a large function isn't left
+  // to be converted on its own at the end.
+  std::vector<size_t> funcSizes(funcs.size());
+  for (unsigned i = 0, e = funcs.size(); i < e; ++i)
+    funcs[i]->walk([&](Operation *) { ++funcSizes[i]; });
+  std::vector<unsigned> schedule(funcs.size());
+  std::iota(schedule.begin(), schedule.end(), 0);
+  std::stable_sort(schedule.begin(), schedule.end(),
+                   [&](unsigned lhs, unsigned rhs) {
+                     return funcSizes[lhs] > funcSizes[rhs];
+                   });
+
+  // Convert the bodies of the functions.  The types of the functions are only
+  // updated below, since they are shared with the attributes referring to the
+  // functions, which may be used by the other threads.
+  std::vector<FunctionType> newTypes(funcs.size());
+  std::vector<SmallVector<NamedAttributeList, 4>> newArgAttrs(funcs.size());
+  std::vector<char> converted(funcs.size(), false);
+  {
+    // Emit the diagnostics in the order of the functions in the module.
+    ParallelDiagnosticHandler diagHandler(context);
+    threadPool.parallelFor(
+        schedule.size(), [&](unsigned threadIndex, size_t taskIndex) {
+          unsigned funcIndex = schedule[taskIndex];
+          diagHandler.setOrderIDForThread(funcIndex);
+          converted[funcIndex] = succeeded(
+              threadConversions[threadIndex].convertFunctionBodyInPlace(
+                  funcs[funcIndex], newTypes[funcIndex],
+                  newArgAttrs[funcIndex]));
+        });
+  }
+
+  bool allConverted = true;
+  for (unsigned i = 0, e = funcs.size(); i < e; ++i) {
+    if (converted[i])
+      setConvertedSignature(funcs[i], newTypes[i], newArgAttrs[i]);
+    else
+      allConverted = false;
+  }
+  return success(allConverted);
+}
+
+void impl::FunctionConversion::commitInPlaceConversion() {
+  // Redirect the uses of the original values to the converted ones.  The
+  // remaining uses are in the replaced operations, which are erased below.
+  for (auto *op : replacedOps)
+    for (auto *result : op->getResults())
+      result->replaceAllUsesWith(mapping.lookupOrNull(result));
+  for (auto &blockAndNumArgs : convertedBlocks) {
+    Block *block = blockAndNumArgs.first;
+    for (unsigned i = 0, e = blockAndNumArgs.second; i < e; ++i)
+      block->getArgument(i)->replaceAllUsesWith(
+          mapping.lookupOrNull(block->getArgument(i)));
+  }
+
+  // Erase the replaced operations, including the original terminators.  The
+  // terminators created by the patterns now pass the operands of the block
+  // arguments, so the predecessors aren't updated when erasing the original
+  // arguments.
+  for (auto *op : llvm::reverse(replacedOps))
+    op->erase();
+  for (auto &blockAndNumArgs : convertedBlocks)
+    for (unsigned i = 0, e = blockAndNumArgs.second; i < e; ++i)
+      blockAndNumArgs.first->eraseArgument(0, /*updatePredTerms=*/false);
+}
+
+void impl::FunctionConversion::rollbackInPlaceConversion() {
+  // The created operations are only used by operations created after them, so
+  // they can be erased in reverse order.
+  for (auto *op : llvm::reverse(createdOps))
+    op->erase();
+  for (auto &blockAndNumArgs : convertedBlocks) {
+    Block *block = blockAndNumArgs.first;
+    while (block->getNumArguments() != blockAndNumArgs.second)
+      block->eraseArgument(block->getNumArguments() - 1,
+                           /*updatePredTerms=*/false);
+  }
+}
+
 LogicalResult impl::FunctionConversion::convert(DialectConversion *conversion,
-                                                Module *module) {
-  return impl::FunctionConversion(conversion).run(module);
+                                                Module *module,
+                                                ConversionMode mode) {
+  return impl::FunctionConversion(conversion, mode).run(module);
 }
 
 LogicalResult impl::FunctionConversion::run(Module *module) {
@@ -301,15 +591,45 @@ LogicalResult impl::FunctionConversion::run(Module *module) {
     return failure();
 
   MLIRContext *context = module->getContext();
-  conversions = dialectConversion->initConverters(context);
+  for (auto *conversion : dialectConversion->initConverters(context)) {
+    // Ignore patterns that are impossible to match.
+    if (conversion->getBenefit().isImpossibleToMatch())
+      continue;
+    if (auto rootKind = conversion->getRootKind())
+      conversionsByRoot[*rootKind].push_back(conversion);
+    else
+      conversionsWithoutRoot.push_back(conversion);
+  }
+  auto byDecreasingBenefit = [](DialectOpConversion *lhs,
+                                DialectOpConversion *rhs) {
+    return rhs->getBenefit() < lhs->getBenefit();
+  };
+  for (auto &rootAndConversions : conversionsByRoot)
+    std::stable_sort(rootAndConversions.second.begin(),
+                     rootAndConversions.second.end(), byDecreasingBenefit);
+  std::stable_sort(conversionsWithoutRoot.begin(), conversionsWithoutRoot.end(),
+                   byDecreasingBenefit);
 
-  // Convert the functions but don't add them to the module yet to avoid
-  // converted functions to be converted again.
-  SmallVector<Function *, 0> originalFuncs, convertedFuncs;
-  DenseMap<Attribute, FunctionAttr> functionAttrRemapping;
+  SmallVector<Function *, 0> originalFuncs;
   originalFuncs.reserve(module->getFunctions().size());
   for (auto &func : *module)
     originalFuncs.push_back(&func);
+
+  // Convert the functions in place.  The functions that patterns add to the
+  // module, e.g. declarations of runtime functions, are created converted.
+  if (mode == ConversionMode::ParallelInPlace)
+    return convertFunctionsInParallel(context, originalFuncs);
+  if (inPlace) {
+    for (auto *func : originalFuncs)
+      if (failed(convertFunctionInPlace(func)))
+        return failure();
+    return success();
+  }
+
+  // Convert the functions but don't add them to the module yet to avoid
+  // converted functions to be converted again.
+  SmallVector<Function *, 0> convertedFuncs;
+  DenseMap<Attribute, FunctionAttr> functionAttrRemapping;
   convertedFuncs.reserve(module->getFunctions().size());
   for (auto *func : originalFuncs) {
     Function *converted = convertFunction(func);
@@ -364,6 +684,6 @@ FunctionType DialectConversion::convertFunctionSignatureType(
   return FunctionType::get(arguments, results, type.getContext());
 }
 
-LogicalResult DialectConversion::convert(Module *m) {
-  return impl::FunctionConversion::convert(this, m);
+LogicalResult DialectConversion::convert(Module *m, ConversionMode mode) {
+  return impl::FunctionConversion::convert(this, m, mode);
 }
@@ -29,6 +29,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/StandardOps/Ops.h"
+#include "mlir/Support/STLExtras.h"
 #include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
@@ -250,6 +251,10 @@ public:
   // Map from memref to a count on the dependence edges associated with that
   // memref.
   DenseMap<Value *, unsigned> memrefEdgeCount;
+  // The set of edges (src id, dst id, value), for constant time edge lookup.
+  DenseSet<std::tuple<unsigned, unsigned, Value *>> edgeSet;
+  // Map from the operation of each node to the node id.
+  DenseMap<Operation *, unsigned> opToNodeId;
   // The next unique identifier to use for newly created graph nodes.
   unsigned nextNodeId = 0;
 
@@ -268,19 +273,29 @@ public:
 
   // Returns the graph node for 'forOp'.
   Node *getForOpNode(AffineForOp forOp) {
-    for (auto &idAndNode : nodes)
-      if (idAndNode.second.op == forOp.getOperation())
-        return &idAndNode.second;
-    return nullptr;
+    auto it = opToNodeId.find(forOp.getOperation());
+    if (it == opToNodeId.end())
+      return nullptr;
+    return getNode(it->second);
   }
 
   // Adds a node with 'op' to the graph and returns its unique identifier.
   unsigned addNode(Operation *op) {
     Node node(nextNodeId++, op);
     nodes.insert({node.id, node});
+    opToNodeId[op] = node.id;
     return node.id;
   }
 
+  // Sets the operation of node 'id' to 'op', e.g., when the root of its loop
+  // nest changed.
+  void setNodeOp(unsigned id, Operation *op) {
+    Node *node = getNode(id);
+    opToNodeId.erase(node->op);
+    node->op = op;
+    opToNodeId[op] = id;
+  }
+
   // Remove node 'id' (and its associated edges) from graph.
   void removeNode(unsigned id) {
     // Remove each edge in 'inEdges[id]'.
@@ -300,6 +315,7 @@ public:
     // Erase remaining node state.
     inEdges.erase(id);
     outEdges.erase(id);
+    opToNodeId.erase(getNode(id)->op);
     nodes.erase(id);
   }
 
@@ -343,6 +359,8 @@ public:
   // is for 'value' if non-null, or for any value otherwise. Returns false
   // otherwise.
   bool hasEdge(unsigned srcId, unsigned dstId, Value *value = nullptr) {
+    if (value)
+      return edgeSet.count(std::make_tuple(srcId, dstId, value)) > 0;
     if (outEdges.count(srcId) == 0 || inEdges.count(dstId) == 0) {
       return false;
     }
@@ -357,7 +375,7 @@ public:
 
   // Adds an edge from node 'srcId' to node 'dstId' for 'value'.
   void addEdge(unsigned srcId, unsigned dstId, Value *value) {
-    if (!hasEdge(srcId, dstId, value)) {
+    if (edgeSet.insert(std::make_tuple(srcId, dstId, value)).second) {
       outEdges[srcId].push_back({dstId, value});
       inEdges[dstId].push_back({srcId, value});
       if (value->getType().isa<MemRefType>())
@@ -369,6 +387,7 @@ public:
   void removeEdge(unsigned srcId, unsigned dstId, Value *value) {
     assert(inEdges.count(dstId) > 0);
     assert(outEdges.count(srcId) > 0);
+    edgeSet.erase(std::make_tuple(srcId, dstId, value));
     if (value->getType().isa<MemRefType>()) {
       assert(memrefEdgeCount.count(value) > 0);
       memrefEdgeCount[value]--;
@@ -395,6 +414,9 @@ public:
     // Worklist state is: <node-id, next-output-edge-index-to-visit>
     SmallVector<std::pair<unsigned, unsigned>, 4> worklist;
     worklist.push_back({srcId, 0});
+    // The nodes pushed on the worklist so far, each is visited once.
+    DenseSet<unsigned> visited;
+    visited.insert(srcId);
     // Run DFS traversal to see if 'dstId' is reachable from 'srcId'.
     while (!worklist.empty()) {
       auto &idAndIndex = worklist.back();
@@ -412,8 +434,9 @@ public:
       Edge edge = outEdges[idAndIndex.first][idAndIndex.second];
       // Increment next output edge index for 'idAndIndex'.
       ++idAndIndex.second;
-      // Add node at 'edge.id' to worklist.
-      worklist.push_back({edge.id, 0});
+      // Add node at 'edge.id' to worklist, unless it was already visited.
+      if (visited.insert(edge.id).second)
+        worklist.push_back({edge.id, 0});
     }
     return false;
   }
@@ -638,13 +661,15 @@ public:
 // TODO(andydavis) Add support for taking a Block arg to construct the
 // dependence graph at a different depth.
 bool MemRefDependenceGraph::init(Function &f) {
+  // Map from memref to the ids of the nodes accessing it, in program order.
   DenseMap<Value *, SetVector<unsigned>> memrefAccesses;
+  // The (memref, node id) pairs for which the node stores to the memref.
+  DenseSet<std::pair<Value *, unsigned>> memrefStores;
 
   // TODO: support multi-block functions.
   if (f.getBlocks().size() != 1)
     return false;
 
-  DenseMap<Operation *, unsigned> forToNodeMap;
   for (auto &op : f.front()) {
     if (auto forOp = op.dyn_cast<AffineForOp>()) {
       // Create graph node 'id' to represent top-level 'forOp' and record
@@ -665,9 +690,10 @@ bool MemRefDependenceGraph::init(Function &f) {
         node.stores.push_back(opInst);
         auto *memref = opInst->cast<StoreOp>().getMemRef();
         memrefAccesses[memref].insert(node.id);
+        memrefStores.insert({memref, node.id});
       }
-      forToNodeMap[&op] = node.id;
       nodes.insert({node.id, node});
+      opToNodeId[&op] = node.id;
     } else if (auto loadOp = op.dyn_cast<LoadOp>()) {
       // Create graph node for top-level load op.
       Node node(nextNodeId++, &op);
@@ -675,13 +701,16 @@ bool MemRefDependenceGraph::init(Function &f) {
       auto *memref = op.cast<LoadOp>().getMemRef();
       memrefAccesses[memref].insert(node.id);
       nodes.insert({node.id, node});
+      opToNodeId[&op] = node.id;
     } else if (auto storeOp = op.dyn_cast<StoreOp>()) {
       // Create graph node for top-level store op.
       Node node(nextNodeId++, &op);
       node.stores.push_back(&op);
       auto *memref = op.cast<StoreOp>().getMemRef();
       memrefAccesses[memref].insert(node.id);
+      memrefStores.insert({memref, node.id});
       nodes.insert({node.id, node});
+      opToNodeId[&op] = node.id;
     } else if (op.getNumRegions() != 0) {
       // Return false if another region is found (not currently supported).
       return false;
@@ -690,6 +719,7 @@ bool MemRefDependenceGraph::init(Function &f) {
       // could be used by loop nest nodes.
       Node node(nextNodeId++, &op);
       nodes.insert({node.id, node});
+      opToNodeId[&op] = node.id;
     }
   }
 
@@ -706,27 +736,31 @@ bool MemRefDependenceGraph::init(Function &f) {
         getLoopIVs(*use.getOwner(), &loops);
         if (loops.empty())
           continue;
-        assert(forToNodeMap.count(loops[0].getOperation()) > 0);
-        unsigned userLoopNestId = forToNodeMap[loops[0].getOperation()];
+        assert(opToNodeId.count(loops[0].getOperation()) > 0);
+        unsigned userLoopNestId = opToNodeId[loops[0].getOperation()];
         addEdge(node.id, userLoopNestId, value);
       }
     }
   }
 
-  // Walk memref access lists and add graph edges between dependent nodes.
+  // Walk memref access lists and add graph edges between dependent nodes: from
+  // each node to the later nodes accessing the same memref, if either of them
+  // stores to it. Only the stores are paired with all other accesses, so a
+  // memref read by many loop nests doesn't add a quadratic number of checks.
+  SmallVector<unsigned, 8> storeIds;
   for (auto &memrefAndList : memrefAccesses) {
-    unsigned n = memrefAndList.second.size();
-    for (unsigned i = 0; i < n; ++i) {
-      unsigned srcId = memrefAndList.second[i];
-      bool srcHasStore =
-          getNode(srcId)->getStoreOpCount(memrefAndList.first) > 0;
-      for (unsigned j = i + 1; j < n; ++j) {
-        unsigned dstId = memrefAndList.second[j];
-        bool dstHasStore =
-            getNode(dstId)->getStoreOpCount(memrefAndList.first) > 0;
-        if (srcHasStore || dstHasStore)
-          addEdge(srcId, dstId, memrefAndList.first);
-      }
+    Value *memref = memrefAndList.first;
+    ArrayRef<unsigned> ids = memrefAndList.second.getArrayRef();
+    storeIds.clear();
+    for (unsigned j = 0, e = ids.size(); j < e; ++j) {
+      unsigned dstId = ids[j];
+      bool dstHasStore = memrefStores.count({memref, dstId}) > 0;
+      ArrayRef<unsigned> srcIds =
+          dstHasStore ? ids.take_front(j) : ArrayRef<unsigned>(storeIds);
+      for (unsigned srcId : srcIds)
+        addEdge(srcId, dstId, memref);
+      if (dstHasStore)
+        storeIds.push_back(dstId);
     }
   }
   return true;
@@ -897,65 +931,61 @@ static void moveLoadsAccessingMemrefTo(Value *memref,
   srcLoads->swap(srcLoadsToKeep);
 }
 
-// Returns the innermost common loop depth for the set of operations in 'ops'.
-static unsigned getInnermostCommonLoopDepth(ArrayRef<Operation *> ops) {
-  unsigned numOps = ops.size();
-  assert(numOps > 0);
-
-  std::vector<SmallVector<AffineForOp, 4>> loops(numOps);
-  unsigned loopDepthLimit = std::numeric_limits<unsigned>::max();
-  for (unsigned i = 0; i < numOps; ++i) {
-    getLoopIVs(*ops[i], &loops[i]);
-    loopDepthLimit =
-        std::min(loopDepthLimit, static_cast<unsigned>(loops[i].size()));
-  }
-
-  unsigned loopDepth = 0;
-  for (unsigned d = 0; d < loopDepthLimit; ++d) {
-    unsigned i;
-    for (i = 1; i < numOps; ++i) {
-      if (loops[i - 1][d] != loops[i][d])
-        break;
-    }
-    if (i != numOps)
+// Returns the number of loops common to the loop nests 'loopsA' and 'loopsB',
+// which list the surrounding loops of two operations from outermost to
+// innermost.
+static unsigned getNumCommonLoops(ArrayRef<AffineForOp> loopsA,
+                                  ArrayRef<AffineForOp> loopsB) {
+  unsigned minNumLoops = std::min(loopsA.size(), loopsB.size());
+  unsigned numCommonLoops = 0;
+  for (unsigned i = 0; i < minNumLoops; ++i) {
+    AffineForOp loopA = loopsA[i], loopB = loopsB[i];
+    if (loopA.getOperation() != loopB.getOperation())
       break;
-    ++loopDepth;
+    ++numCommonLoops;
   }
-  return loopDepth;
+  return numCommonLoops;
 }
 
 // Returns the maximum loop depth at which no dependences between 'loadOpInsts'
 // and 'storeOpInsts' are satisfied.
 static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
-                                ArrayRef<Operation *> storeOpInsts) {
+                                ArrayRef<Operation *> storeOpInsts,
+                                DependenceAnalysis *dependenceAnalysis) {
   // Merge loads and stores into the same array.
   SmallVector<Operation *, 2> ops(loadOpInsts.begin(), loadOpInsts.end());
   ops.append(storeOpInsts.begin(), storeOpInsts.end());
+  assert(!ops.empty());
+
+  // Gather the surrounding loops of each op once, they are needed for each of
+  // the pairs below.
+  unsigned numOps = ops.size();
+  std::vector<SmallVector<AffineForOp, 4>> loops(numOps);
+  for (unsigned i = 0; i < numOps; ++i)
+    getLoopIVs(*ops[i], &loops[i]);
 
   // Compute the innermost common loop depth for loads and stores.
-  unsigned loopDepth = getInnermostCommonLoopDepth(ops);
+  unsigned loopDepth = loops[0].size();
+  for (unsigned i = 1; i < numOps; ++i)
+    loopDepth = std::min(loopDepth, getNumCommonLoops(loops[0], loops[i]));
 
   // Return common loop depth for loads if there are no store ops.
   if (storeOpInsts.empty())
     return loopDepth;
 
   // Check dependences on all pairs of ops in 'ops' and store the minimum
-  // loop depth at which a dependence is satisfied.
-  for (unsigned i = 0, e = ops.size(); i < e; ++i) {
+  // loop depth at which a dependence is satisfied. Depths beyond the current
+  // minimum can't lower it, and aren't checked.
+  for (unsigned i = 0; i < numOps && loopDepth > 0; ++i) {
     auto *srcOpInst = ops[i];
-    MemRefAccess srcAccess(srcOpInst);
-    for (unsigned j = 0; j < e; ++j) {
+    for (unsigned j = 0; j < numOps && loopDepth > 0; ++j) {
       auto *dstOpInst = ops[j];
-      MemRefAccess dstAccess(dstOpInst);
-
-      unsigned numCommonLoops =
-          getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
-      for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
-        // TODO(andydavis) Cache dependence analysis results, check cache here.
-        if (checkMemrefAccessDependence(srcAccess, dstAccess, d,
-                                        &dependenceConstraints,
-                                        /*dependenceComponents=*/nullptr)) {
+
+      unsigned numCommonLoops = getNumCommonLoops(loops[i], loops[j]);
+      unsigned maxDepth = std::min(numCommonLoops + 1, loopDepth);
+      for (unsigned d = 1; d <= maxDepth; ++d) {
+        if (dependenceAnalysis->checkDependence(
+                srcOpInst, dstOpInst, d, /*dependenceComponents=*/nullptr)) {
           // Store minimum loop depth and break because we want the min 'd' at
           // which there is a dependence.
           loopDepth = std::min(loopDepth, d - 1);
@@ -980,13 +1010,15 @@ static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
 // TODO(andydavis) Move this function to LoopUtils.
 static bool
 computeLoopInterchangePermutation(ArrayRef<AffineForOp> loops,
-                                  SmallVectorImpl<unsigned> *loopPermMap) {
+                                  SmallVectorImpl<unsigned> *loopPermMap,
+                                  DependenceAnalysis *dependenceAnalysis) {
   assert(loops.size() > 1);
   // Gather dependence components for dependences between all ops in loop nest
   // rooted at 'loops[0]', at loop depths in range [1, maxLoopDepth].
   unsigned maxLoopDepth = loops.size();
   std::vector<llvm::SmallVector<DependenceComponent, 2>> depCompsVec;
-  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec);
+  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec,
+                          dependenceAnalysis);
   // Mark loops as either parallel or sequential.
   llvm::SmallVector<bool, 8> isParallelLoop(maxLoopDepth, true);
   for (unsigned i = 0, e = depCompsVec.size(); i < e; ++i) {
@@ -1050,7 +1082,9 @@ computeLoopInterchangePermutation(ArrayRef<AffineForOp> loops,
 // outermost (while again preserving relative order among them).
 // This can increase the loop depth at which we can fuse a slice, since we are
 // pushing loop carried dependence to a greater depth in the loop nest.
-static void sinkSequentialLoops(MemRefDependenceGraph::Node *node) {
+static void sinkSequentialLoops(MemRefDependenceGraph *mdg,
+                                MemRefDependenceGraph::Node *node,
+                                DependenceAnalysis *dependenceAnalysis) {
   assert(node->op->isa<AffineForOp>());
   SmallVector<AffineForOp, 4> loops;
   AffineForOp curr = node->op->cast<AffineForOp>();
@@ -1060,7 +1094,8 @@ static void sinkSequentialLoops(MemRefDependenceGraph::Node *node) {
 
   // Compute loop permutation in 'loopPermMap'.
   llvm::SmallVector<unsigned, 4> loopPermMap;
-  if (!computeLoopInterchangePermutation(loops, &loopPermMap))
+  if (!computeLoopInterchangePermutation(loops, &loopPermMap,
+                                         dependenceAnalysis))
     return;
 
   int loopNestRootIndex = -1;
@@ -1075,22 +1110,9 @@ static void sinkSequentialLoops(MemRefDependenceGraph::Node *node) {
     }
   }
   assert(loopNestRootIndex != -1 && "invalid root index");
-  node->op = loops[loopNestRootIndex].getOperation();
-}
-
-//  TODO(mlir-team): improve/complete this when we have target data.
-unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
-  auto elementType = memRefType.getElementType();
-
-  unsigned sizeInBits;
-  if (elementType.isIntOrFloat()) {
-    sizeInBits = elementType.getIntOrFloatBitWidth();
-  } else {
-    auto vectorType = elementType.cast<VectorType>();
-    sizeInBits =
-        vectorType.getElementTypeBitWidth() * vectorType.getNumElements();
-  }
-  return llvm::divideCeil(sizeInBits, 8);
+  mdg->setNodeOp(node->id, loops[loopNestRootIndex].getOperation());
+  // The iteration domains of the accesses in the nest have been permuted.
+  dependenceAnalysis->invalidate(node->op);
 }
 
 // Creates and returns a private (single-user) memref for fused loop rooted
@@ -1409,7 +1431,8 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
                                ArrayRef<Operation *> dstLoadOpInsts,
                                ArrayRef<Operation *> dstStoreOpInsts,
                                ComputationSliceState *sliceState,
-                               unsigned *dstLoopDepth, bool maximalFusion) {
+                               unsigned *dstLoopDepth, bool maximalFusion,
+                               DependenceAnalysis *dependenceAnalysis) {
   LLVM_DEBUG({
     llvm::dbgs() << "Checking whether fusion is profitable between:\n";
     llvm::dbgs() << " " << *srcOpInst << " and \n";
@@ -1449,7 +1472,8 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
   // and still satisfy dest loop nest dependences, for producer-consumer fusion.
   unsigned maxDstLoopDepth =
       (srcOpInst == srcStoreOpInst)
-          ? getMaxLoopDepth(dstLoadOpInsts, dstStoreOpInsts)
+          ? getMaxLoopDepth(dstLoadOpInsts, dstStoreOpInsts,
+                            dependenceAnalysis)
           : dstLoopIVs.size();
   if (maxDstLoopDepth == 0) {
     LLVM_DEBUG(llvm::dbgs() << "Can't fuse: maxDstLoopDepth == 0 .\n");
@@ -1783,13 +1807,17 @@ public:
   // If true, ignore any additional (redundant) computation tolerance threshold
   // that would have prevented fusion.
   bool maximalFusion;
+  // Memoized dependence checks, invalidated on the loop nests being changed.
+  DependenceAnalysis *dependenceAnalysis;
 
   using Node = MemRefDependenceGraph::Node;
 
   GreedyFusion(MemRefDependenceGraph *mdg, unsigned localBufSizeThreshold,
-               Optional<unsigned> fastMemorySpace, bool maximalFusion)
+               Optional<unsigned> fastMemorySpace, bool maximalFusion,
+               DependenceAnalysis *dependenceAnalysis)
       : mdg(mdg), localBufSizeThreshold(localBufSizeThreshold),
-        fastMemorySpace(fastMemorySpace), maximalFusion(maximalFusion) {}
+        fastMemorySpace(fastMemorySpace), maximalFusion(maximalFusion),
+        dependenceAnalysis(dependenceAnalysis) {}
 
   // Initializes 'worklist' with nodes from 'mdg'
   void init() {
@@ -1837,7 +1865,7 @@ public:
       // while preserving relative order. This can increase the maximum loop
       // depth at which we can fuse a slice of a producer loop nest into a
       // consumer loop nest.
-      sinkSequentialLoops(dstNode);
+      sinkSequentialLoops(mdg, dstNode, dependenceAnalysis);
 
       SmallVector<Operation *, 4> loads = dstNode->loads;
       SmallVector<Operation *, 4> dstLoadOpInsts;
@@ -1908,7 +1936,8 @@ public:
           // Check if fusion would be profitable.
           if (!isFusionProfitable(srcStoreOpInst, srcStoreOpInst,
                                   dstLoadOpInsts, dstStoreOpInsts, &sliceState,
-                                  &bestDstLoopDepth, maximalFusion))
+                                  &bestDstLoopDepth, maximalFusion,
+                                  dependenceAnalysis))
             continue;
 
           // Fuse computation slice of 'srcLoopNest' into 'dstLoopNest'.
@@ -1919,6 +1948,9 @@ public:
                                     << *sliceLoopNest.getOperation() << "\n");
             // Move 'dstAffineForOp' before 'insertPointInst' if needed.
             auto dstAffineForOp = dstNode->op->cast<AffineForOp>();
+            // Drop the cached dependences of the dst accesses before they are
+            // moved, or erased by memref privatization.
+            dependenceAnalysis->invalidate(dstAffineForOp.getOperation());
             if (insertPointInst != dstAffineForOp.getOperation()) {
               dstAffineForOp.getOperation()->moveBefore(insertPointInst);
             }
@@ -1975,6 +2007,7 @@ public:
             // so it is safe to remove.
             if (writesToLiveInOrOut || mdg->canRemoveNode(srcNode->id)) {
               mdg->removeNode(srcNode->id);
+              dependenceAnalysis->invalidate(srcNode->op);
               srcNode->op->erase();
             } else {
               // Add remaining users of 'oldMemRef' back on the worklist (if not
@@ -2067,7 +2100,7 @@ public:
       // Check if fusion would be profitable.
       if (!isFusionProfitable(sibLoadOpInst, sibStoreOpInst, dstLoadOpInsts,
                               dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
-                              maximalFusion))
+                              maximalFusion, dependenceAnalysis))
         continue;
 
       // Fuse computation slice of 'sibLoopNest' into 'dstLoopNest'.
@@ -2075,6 +2108,7 @@ public:
           sibLoadOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
       if (sliceLoopNest != nullptr) {
         auto dstForInst = dstNode->op->cast<AffineForOp>();
+        dependenceAnalysis->invalidate(dstForInst.getOperation());
         // Update operation position of fused loop nest (if needed).
         if (insertPointInst != dstForInst.getOperation()) {
           dstForInst.getOperation()->moveBefore(insertPointInst);
@@ -2126,7 +2160,12 @@ public:
     // Search for siblings which load the same memref function argument.
     auto *fn = dstNode->op->getFunction();
     for (unsigned i = 0, e = fn->getNumArguments(); i != e; ++i) {
-      for (auto &use : fn->getArgument(i)->getUses()) {
+      // Skip memref arguments which 'dstNode' doesn't load from without
+      // visiting their uses.
+      auto *arg = fn->getArgument(i);
+      if (arg->getType().isa<MemRefType>() && dstNode->getLoadOpCount(arg) == 0)
+        continue;
+      for (auto &use : arg->getUses()) {
         if (auto loadOp = use.getOwner()->dyn_cast<LoadOp>()) {
           // Gather loops surrounding 'use'.
           SmallVector<AffineForOp, 4> loops;
@@ -2228,6 +2267,7 @@ public:
     // function.
     if (mdg->getOutEdgeCount(sibNode->id) == 0) {
       mdg->removeNode(sibNode->id);
+      dependenceAnalysis->invalidate(sibNode->op);
       sibNode->op->cast<AffineForOp>().erase();
     }
   }
@@ -2267,7 +2307,8 @@ void LoopFusion::runOnFunction() {
 
   MemRefDependenceGraph g;
   if (g.init(getFunction()))
-    GreedyFusion(&g, localBufSizeThreshold, fastMemorySpace, maximalFusion)
+    GreedyFusion(&g, localBufSizeThreshold, fastMemorySpace, maximalFusion,
+                 &getAnalysis<DependenceAnalysis>())
         .run();
 }
 
@@ -0,0 +1,304 @@
+//===- LoopParallelization.cpp - Parallelize affine loops -----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that outlines the bodies of parallel affine.for
+// loops into functions called on chunks of iterations. The calls are lowered
+// to the parallel loop runtime of the ExecutionEngine by the conversion to the
+// LLVM IR dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/LoopAnalysis.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace mlir;
+
+#define DEBUG_TYPE "affine-parallelize"
+
+static llvm::cl::OptionCategory clOptionsCategory(DEBUG_TYPE " options");
+
+static llvm::cl::opt<ParallelSchedule> clSchedule(
+    "parallel-schedule",
+    llvm::cl::desc("How the chunks of iterations are assigned to threads"),
+    llvm::cl::values(clEnumValN(ParallelSchedule::Static, "static",
+                                "round-robin, ahead of time"),
+                     clEnumValN(ParallelSchedule::Dynamic, "dynamic",
+                                "to the next idle thread")),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<unsigned> clChunkSize(
+    "parallel-chunk-size",
+    llvm::cl::desc("Number of iterations of a chunk (overrides the grain size "
+                   "heuristic)"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<unsigned long long> clGrainSize(
+    "parallel-grain-size",
+    llvm::cl::desc("Minimum number of operations executed by a chunk of "
+                   "iterations"),
+    llvm::cl::cat(clOptionsCategory));
+
+namespace {
+
+/// Outlines the outermost parallel loops of each function into a function over
+/// a range of iterations, and replaces each loop with a call to that function
+/// over the whole iteration space, tagged with the schedule of the loop.
+struct LoopParallelization : public ModulePass<LoopParallelization> {
+  explicit LoopParallelization(
+      ParallelSchedule schedule = ParallelSchedule::Static,
+      unsigned chunkSize = 0, uint64_t grainSize = kDefaultGrainSize)
+      : schedule(schedule), chunkSize(chunkSize), grainSize(grainSize) {}
+
+  void runOnModule() override;
+  bool isProfitable(AffineForOp forOp);
+  unsigned getChunkSize(AffineForOp forOp);
+  void collectLoopsToParallelize(Block &block,
+                                 SmallVectorImpl<AffineForOp> &loops);
+  void outline(AffineForOp forOp, StringRef name);
+
+  // Default minimum number of operations executed by a chunk.
+  constexpr static uint64_t kDefaultGrainSize = 4096;
+
+  ParallelSchedule schedule;
+  unsigned chunkSize;
+  uint64_t grainSize;
+};
+
+} // end anonymous namespace
+
+ModulePassBase *mlir::createLoopParallelizationPass(ParallelSchedule schedule,
+                                                    unsigned chunkSize,
+                                                    uint64_t grainSize) {
+  return new LoopParallelization(schedule, chunkSize, grainSize);
+}
+
+// Returns the number of operations executed by one iteration of 'forOp',
+// counting the iterations of the nested loops, or None if a nested loop has an
+// unknown trip count.
+static Optional<uint64_t> getNumOpsPerIteration(AffineForOp forOp) {
+  uint64_t numOps = 0;
+  for (auto &op : *forOp.getBody()) {
+    if (auto nestedForOp = op.dyn_cast<AffineForOp>()) {
+      auto tripCount = getConstantTripCount(nestedForOp);
+      auto nestedNumOps = getNumOpsPerIteration(nestedForOp);
+      if (!tripCount || !nestedNumOps)
+        return llvm::None;
+      numOps += *tripCount * *nestedNumOps;
+      continue;
+    }
+    // The operations of conditionals are counted as always executed.
+    bool hasNestedLoop = false;
+    op.walk([&](Operation *nestedOp) {
+      hasNestedLoop |= nestedOp->isa<AffineForOp>();
+      ++numOps;
+    });
+    if (hasNestedLoop)
+      return llvm::None;
+  }
+  return numOps;
+}
+
+// A loop is worth parallelizing unless it is known to execute a single grain of
+// work.
+bool LoopParallelization::isProfitable(AffineForOp forOp) {
+  auto tripCount = getConstantTripCount(forOp);
+  if (!tripCount)
+    return true;
+  if (*tripCount <= 1)
+    return false;
+  auto numOps = getNumOpsPerIteration(forOp);
+  return !numOps || *tripCount * *numOps > grainSize;
+}
+
+// Returns the number of iterations of the chunks of 'forOp', such that each
+// chunk executes at least a grain of work. Returns zero, to let the runtime
+// divide the iterations evenly among the threads, when the amount of work of
+// an iteration is unknown.
+unsigned LoopParallelization::getChunkSize(AffineForOp forOp) {
+  if (chunkSize != 0)
+    return chunkSize;
+  auto numOps = getNumOpsPerIteration(forOp);
+  if (!numOps)
+    return schedule == ParallelSchedule::Dynamic ? 1 : 0;
+  return llvm::divideCeil(grainSize, std::max<uint64_t>(*numOps, 1));
+}
+
+// Returns true if the only operations of 'forOp' with side effects are loads
+// and stores, whose dependences are checked by isLoopParallel. Other
+// operations, like calls, DMAs and unregistered operations, may access any
+// memory.
+static bool hasOnlyAnalyzableSideEffects(AffineForOp forOp) {
+  bool analyzable = true;
+  forOp.getOperation()->walk([&](Operation *op) {
+    analyzable &= op->isa<LoadOp>() || op->isa<StoreOp>() ||
+                  op->isa<AffineForOp>() || op->isa<AffineIfOp>() ||
+                  op->isa<AffineApplyOp>() || op->isa<AffineTerminatorOp>() ||
+                  op->hasNoSideEffect();
+  });
+  return analyzable;
+}
+
+// Collects the outermost parallel loops of 'block' and of its nested blocks.
+// The bounds of a loop must be single-result maps, so that they can be computed
+// outside of the loop.
+void LoopParallelization::collectLoopsToParallelize(
+    Block &block, SmallVectorImpl<AffineForOp> &loops) {
+  for (auto &op : block) {
+    auto forOp = op.dyn_cast<AffineForOp>();
+    if (forOp && forOp.getLowerBoundMap().getNumResults() == 1 &&
+        forOp.getUpperBoundMap().getNumResults() == 1 &&
+        hasOnlyAnalyzableSideEffects(forOp) && isLoopParallel(forOp) &&
+        isProfitable(forOp)) {
+      loops.push_back(forOp);
+      continue;
+    }
+    for (auto &region : op.getRegions())
+      for (auto &nestedBlock : region)
+        collectLoopsToParallelize(nestedBlock, loops);
+  }
+}
+
+// Outlines the body of 'forOp' into a function 'name' taking the bounds of a
+// range of iterations followed by the values used in the loop and defined
+// above it, and replaces the loop with a call to this function.
+void LoopParallelization::outline(AffineForOp forOp, StringRef name) {
+  Operation *loop = forOp.getOperation();
+  Region &loopRegion = forOp.getRegion();
+  Location loc = loop->getLoc();
+  unsigned loopChunkSize = getChunkSize(forOp);
+
+  // Collect the values defined above the loop and used in it.
+  llvm::SetVector<Value *> capturedValues;
+  loop->walk([&](Operation *op) {
+    if (op == loop)
+      return;
+    for (auto *operand : op->getOperands()) {
+      Region *definingRegion =
+          operand->getDefiningOp()
+              ? operand->getDefiningOp()->getContainingRegion()
+              : cast<BlockArgument>(operand)->getOwner()->getParent();
+      if (!loopRegion.isAncestor(definingRegion))
+        capturedValues.insert(operand);
+    }
+  });
+
+  // Create the outlined function.
+  FuncBuilder builder(loop);
+  SmallVector<Type, 8> argTypes(2, builder.getIndexType());
+  for (auto *value : capturedValues)
+    argTypes.push_back(value->getType());
+  auto *function =
+      new Function(loc, name, builder.getFunctionType(argTypes, {}));
+  loop->getFunction()->getModule()->getFunctions().push_back(function);
+  function->addEntryBlock();
+
+  // The outlined loop iterates over the range passed as its first arguments.
+  FuncBuilder bodyBuilder(function);
+  AffineMap symbolMap = bodyBuilder.getSymbolIdentityMap();
+  Value *lowerBound = function->getArgument(0);
+  Value *upperBound = function->getArgument(1);
+  auto outlinedForOp =
+      bodyBuilder.create<AffineForOp>(loc, lowerBound, symbolMap, upperBound,
+                                      symbolMap, forOp.getStep());
+  bodyBuilder.create<ReturnOp>(loc);
+
+  auto &outlinedOps = outlinedForOp.getBody()->getOperations();
+  auto &loopOps = forOp.getBody()->getOperations();
+  outlinedOps.splice(std::prev(outlinedOps.end()), loopOps, loopOps.begin(),
+                     std::prev(loopOps.end()));
+  forOp.getInductionVar()->replaceAllUsesWith(
+      outlinedForOp.getInductionVar());
+  DenseMap<Value *, Value *> argumentMap;
+  for (auto en : llvm::enumerate(capturedValues))
+    argumentMap[en.value()] = function->getArgument(en.index() + 2);
+  outlinedForOp.getOperation()->walk([&](Operation *op) {
+    for (unsigned i = 0, e = op->getNumOperands(); i < e; ++i) {
+      auto it = argumentMap.find(op->getOperand(i));
+      if (it != argumentMap.end())
+        op->setOperand(i, it->second);
+    }
+  });
+
+  // Replace the loop with a call over its whole iteration space.
+  SmallVector<Value *, 8> operands;
+  operands.push_back(builder.create<AffineApplyOp>(
+      loc, forOp.getLowerBoundMap(),
+      llvm::to_vector<4>(forOp.getLowerBoundOperands())));
+  operands.push_back(builder.create<AffineApplyOp>(
+      loc, forOp.getUpperBoundMap(),
+      llvm::to_vector<4>(forOp.getUpperBoundOperands())));
+  operands.append(capturedValues.begin(), capturedValues.end());
+  auto callOp = builder.create<CallOp>(loc, function, operands);
+  callOp.setAttr("parallel.step", builder.getI64IntegerAttr(forOp.getStep()));
+  callOp.setAttr("parallel.chunk_size",
+                 builder.getI64IntegerAttr(loopChunkSize));
+  callOp.setAttr("parallel.schedule",
+                 builder.getStringAttr(schedule == ParallelSchedule::Dynamic
+                                           ? "dynamic"
+                                           : "static"));
+  loop->erase();
+}
+
+void LoopParallelization::runOnModule() {
+  if (clSchedule.getNumOccurrences() > 0)
+    schedule = clSchedule;
+  if (clChunkSize.getNumOccurrences() > 0)
+    chunkSize = clChunkSize;
+  if (clGrainSize.getNumOccurrences() > 0)
+    grainSize = clGrainSize;
+
+  Module &module = getModule();
+  // The outlined functions are appended to the module while iterating.
+  SmallVector<Function *, 8> functions;
+  for (auto &function : module)
+    if (!function.isExternal())
+      functions.push_back(&function);
+
+  for (auto *function : functions) {
+    SmallVector<AffineForOp, 4> loops;
+    for (auto &block : *function)
+      collectLoopsToParallelize(block, loops);
+
+    unsigned index = 0;
+    for (auto forOp : loops) {
+      std::string name;
+      do {
+        name = (function->getName().strref() + "_parallel_for" + Twine(index++))
+                   .str();
+      } while (module.getNamedFunction(name));
+      LLVM_DEBUG(llvm::dbgs() << "outlining parallel loop into @" << name
+                              << "\n");
+      outline(forOp, name);
+    }
+  }
+}
+
+constexpr uint64_t LoopParallelization::kDefaultGrainSize;
+
+static PassRegistration<LoopParallelization>
+    pass("affine-parallelize",
+         "Outline parallel loops into functions run by a threaded runtime");
@@ -26,11 +26,14 @@
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include <iomanip>
 #include <sstream>
 
@@ -58,6 +61,28 @@ static llvm::cl::list<unsigned> clTileSizes(
         "List of tile sizes for each perfect nest (overridden by -tile-size)"),
     llvm::cl::ZeroOrMore, llvm::cl::cat(clOptionsCategory));
 
+// Sizes of the cache levels to tile for, from L1 outwards. Enables multi-level
+// tiling, which overrides -tile-cache-size.
+static llvm::cl::list<unsigned> clCacheLevelSizesKiB(
+    "tile-cache-levels",
+    llvm::cl::desc("Tile for each of the cache levels of these sizes in KiB, "
+                   "from L1 outwards"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(clOptionsCategory));
+
+// Line sizes and associativities of the cache levels of -tile-cache-levels. If
+// any of them aren't provided, they are filled with the defaults.
+static llvm::cl::list<unsigned> clCacheLineSizes(
+    "tile-cache-line-sizes",
+    llvm::cl::desc("Line size in bytes of each of the -tile-cache-levels"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(clOptionsCategory));
+static llvm::cl::list<unsigned> clCacheAssociativities(
+    "tile-cache-associativities",
+    llvm::cl::desc("Associativity of each of the -tile-cache-levels"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(clOptionsCategory));
+
 namespace {
 
 /// A pass to perform loop tiling on all suitable loop nests of a Function.
@@ -65,19 +90,36 @@ struct LoopTiling : public FunctionPass<LoopTiling> {
   explicit LoopTiling(uint64_t cacheSizeBytes = kDefaultCacheMemCapacity,
                       bool avoidMaxMinBounds = true)
       : cacheSizeBytes(cacheSizeBytes), avoidMaxMinBounds(avoidMaxMinBounds) {}
+  explicit LoopTiling(ArrayRef<CacheLevelInfo> cacheLevels,
+                      bool avoidMaxMinBounds = true)
+      : cacheSizeBytes(kDefaultCacheMemCapacity),
+        avoidMaxMinBounds(avoidMaxMinBounds),
+        cacheLevels(cacheLevels.begin(), cacheLevels.end()) {}
 
   void runOnFunction() override;
   void getTileSizes(ArrayRef<AffineForOp> band,
                     SmallVectorImpl<unsigned> *tileSizes);
+  void getMultiLevelTileSizes(
+      ArrayRef<AffineForOp> band,
+      std::vector<SmallVector<unsigned, 6>> *levelTileSizes);
+  LogicalResult tileForCacheLevels(MutableArrayRef<AffineForOp> band);
 
   // Default tile size if nothing is provided.
   constexpr static unsigned kDefaultTileSize = 4;
   constexpr static uint64_t kDefaultCacheMemCapacity = 512 * 1024UL;
+  // Default cache line size and associativity of the cache levels.
+  constexpr static unsigned kDefaultCacheLineSize = 64;
+  constexpr static unsigned kDefaultCacheAssociativity = 8;
+  // Largest tile size for a loop whose trip count isn't known.
+  constexpr static unsigned kMaxTileSizeForUnknownTripCount = 1024;
 
   // Capacity of the cache to tile for.
   uint64_t cacheSizeBytes;
   // If true, tile sizes are set to avoid max/min in bounds if possible.
   bool avoidMaxMinBounds;
+  // The cache levels to tile for, from L1 outwards. If not empty, each band is
+  // tiled once per level instead of once for 'cacheSizeBytes'.
+  SmallVector<CacheLevelInfo, 3> cacheLevels;
 };
 
 } // end anonymous namespace
@@ -88,6 +130,13 @@ FunctionPassBase *mlir::createLoopTilingPass(uint64_t cacheSizeBytes) {
   return new LoopTiling(cacheSizeBytes);
 }
 
+/// Creates a pass to perform multi-level tiling on all suitable loop nests of a
+/// Function.
+FunctionPassBase *
+mlir::createLoopTilingPass(ArrayRef<CacheLevelInfo> cacheLevels) {
+  return new LoopTiling(cacheLevels);
+}
+
 // Move the loop body of AffineForOp 'src' from 'src' into the specified
 // location in destination's body, ignoring the terminator.
 static inline void moveLoopBody(AffineForOp src, AffineForOp dest,
@@ -186,7 +235,8 @@ constructTiledIndexSetHyperRect(MutableArrayRef<AffineForOp> origLoops,
 /// and intra-tile loops. A band is a contiguous set of loops.
 //  TODO(bondhugula): handle non hyper-rectangular spaces.
 LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
-                                ArrayRef<unsigned> tileSizes) {
+                                ArrayRef<unsigned> tileSizes,
+                                SmallVectorImpl<AffineForOp> *tiledNest) {
   assert(!band.empty());
   assert(band.size() == tileSizes.size() && "Incorrect number of tile sizes");
 
@@ -258,6 +308,8 @@ LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
   // Erase the old loop nest.
   rootAffineForOp.erase();
 
+  if (tiledNest)
+    tiledNest->assign(newLoops.begin(), newLoops.end());
   return success();
 }
 
@@ -382,29 +434,377 @@ void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
     adjustToDivisorsOfTripCounts(band, tileSizes);
 }
 
+namespace {
+
+/// An analytical model of the number of cache lines touched by a tile of a band
+/// of loops. The accesses to a memref whose access functions only differ by
+/// constants are grouped together. A tile touches a hyper-rectangular box of
+/// elements of each group, whose extent along each memref dimension is a
+/// linear function of the tile sizes. This is the bounding box that
+/// MemRefRegion::getConstantBoundingSizeAndShape computes for a region, but in
+/// closed form for any tile sizes, without generating the tiled loops.
+class TileFootprintModel {
+public:
+  /// Builds the model for the loads and stores in 'band'. Returns None if an
+  /// access function has mod's or div's, or depends on a loop nested in the
+  /// band whose trip count isn't constant.
+  static Optional<TileFootprintModel> build(ArrayRef<AffineForOp> band);
+
+  /// Returns the number of distinct cache lines of 'lineSizeBytes' bytes
+  /// touched by a tile with the given sizes.
+  uint64_t getNumLines(ArrayRef<unsigned> tileSizes,
+                       unsigned lineSizeBytes) const;
+
+private:
+  /// The access function along a memref dimension, minus its constant term.
+  struct DimAccess {
+    /// The coefficients of the IVs of the band.
+    SmallVector<int64_t, 4> ivCoeffs;
+    /// The coefficients of the other operands, which are fixed within a tile,
+    /// sorted by operand.
+    SmallVector<std::pair<Value *, int64_t>, 2> otherCoeffs;
+
+    bool operator==(const DimAccess &other) const {
+      return ivCoeffs == other.ivCoeffs && otherCoeffs == other.otherCoeffs;
+    }
+  };
+
+  /// The accesses to a memref that only differ by constants.
+  struct AccessGroup {
+    Value *memref;
+    unsigned eltSizeInBytes;
+    ArrayRef<int64_t> shape;
+    SmallVector<DimAccess, 4> dims;
+    /// The smallest and largest constant term along each dimension.
+    SmallVector<int64_t, 4> minOffsets, maxOffsets;
+    /// The extent along each dimension spanned by the loops nested in the band.
+    SmallVector<int64_t, 4> innerSpans;
+  };
+
+  SmallVector<AccessGroup, 8> groups;
+};
+
+} // end anonymous namespace
+
+Optional<TileFootprintModel>
+TileFootprintModel::build(ArrayRef<AffineForOp> band) {
+  DenseMap<Value *, unsigned> bandIVPositions;
+  for (auto forOp : band)
+    bandIVPositions.try_emplace(forOp.getInductionVar(),
+                                bandIVPositions.size());
+
+  // Collect the accesses, and the trip counts of the loops nested in the band.
+  SmallVector<Operation *, 8> accessOps;
+  DenseMap<Value *, Optional<uint64_t>> innerTripCounts;
+  AffineForOp innermostForOp = band.back();
+  innermostForOp.getOperation()->walk([&](Operation *op) {
+    if (op->isa<LoadOp>() || op->isa<StoreOp>())
+      accessOps.push_back(op);
+    else if (auto forOp = op->dyn_cast<AffineForOp>())
+      innerTripCounts[forOp.getInductionVar()] = getConstantTripCount(forOp);
+  });
+
+  TileFootprintModel model;
+  for (auto *op : accessOps) {
+    MemRefAccess access(op);
+    AffineValueMap accessMap;
+    access.getAccessMap(&accessMap);
+    std::vector<SmallVector<int64_t, 8>> flatExprs;
+    FlatAffineConstraints localVarCst;
+    if (failed(getFlattenedAffineExprs(accessMap.getAffineMap(), &flatExprs,
+                                       &localVarCst)))
+      return None;
+
+    unsigned numOperands = accessMap.getNumOperands();
+    SmallVector<DimAccess, 4> dims(flatExprs.size());
+    SmallVector<int64_t, 4> offsets, innerSpans;
+    for (unsigned d = 0, e = flatExprs.size(); d < e; ++d) {
+      ArrayRef<int64_t> flatExpr = flatExprs[d];
+      // The local identifiers introduced for mod's and div's aren't modeled.
+      for (unsigned j = numOperands, f = flatExpr.size() - 1; j < f; ++j)
+        if (flatExpr[j] != 0)
+          return None;
+
+      DimAccess &dim = dims[d];
+      dim.ivCoeffs.resize(band.size());
+      int64_t innerSpan = 0;
+      for (unsigned j = 0; j < numOperands; ++j) {
+        int64_t coeff = flatExpr[j];
+        if (coeff == 0)
+          continue;
+        Value *operand = accessMap.getOperand(j);
+        auto posIt = bandIVPositions.find(operand);
+        if (posIt != bandIVPositions.end()) {
+          dim.ivCoeffs[posIt->second] += coeff;
+          continue;
+        }
+        // The loops nested in the band run to completion within a tile.
+        auto tripCountIt = innerTripCounts.find(operand);
+        if (tripCountIt != innerTripCounts.end()) {
+          if (!tripCountIt->second.hasValue())
+            return None;
+          uint64_t tripCount = tripCountIt->second.getValue();
+          if (tripCount > 0)
+            innerSpan += std::abs(coeff) * (tripCount - 1);
+          continue;
+        }
+        dim.otherCoeffs.emplace_back(operand, coeff);
+      }
+      llvm::sort(dim.otherCoeffs.begin(), dim.otherCoeffs.end());
+      offsets.push_back(flatExpr.back());
+      innerSpans.push_back(innerSpan);
+    }
+
+    auto groupIt = llvm::find_if(model.groups, [&](const AccessGroup &group) {
+      return group.memref == access.memref && group.dims == dims;
+    });
+    if (groupIt == model.groups.end()) {
+      auto memRefType = access.memref->getType().cast<MemRefType>();
+      model.groups.push_back({access.memref,
+                              getMemRefEltSizeInBytes(memRefType),
+                              memRefType.getShape(), std::move(dims), offsets,
+                              offsets, innerSpans});
+      continue;
+    }
+    for (unsigned d = 0, e = offsets.size(); d < e; ++d) {
+      groupIt->minOffsets[d] = std::min(groupIt->minOffsets[d], offsets[d]);
+      groupIt->maxOffsets[d] = std::max(groupIt->maxOffsets[d], offsets[d]);
+      groupIt->innerSpans[d] = std::max(groupIt->innerSpans[d], innerSpans[d]);
+    }
+  }
+  return model;
+}
+
+uint64_t TileFootprintModel::getNumLines(ArrayRef<unsigned> tileSizes,
+                                         unsigned lineSizeBytes) const {
+  uint64_t numLines = 0;
+  for (const auto &group : groups) {
+    uint64_t groupLines = 1;
+    for (unsigned d = 0, rank = group.shape.size(); d < rank; ++d) {
+      const DimAccess &dim = group.dims[d];
+      uint64_t extent = group.maxOffsets[d] - group.minOffsets[d] +
+                        group.innerSpans[d] + 1;
+      for (unsigned i = 0, e = tileSizes.size(); i < e; ++i)
+        extent += std::abs(dim.ivCoeffs[i]) * (tileSizes[i] - 1);
+      // A tile can't touch more than the whole memref.
+      if (group.shape[d] >= 0)
+        extent = std::min<uint64_t>(extent, group.shape[d]);
+      // Elements are contiguous along the innermost dimension.
+      if (d == rank - 1)
+        extent = llvm::divideCeil(extent * group.eltSizeInBytes, lineSizeBytes);
+      groupLines = llvm::SaturatingMultiply(groupLines, extent);
+    }
+    numLines = llvm::SaturatingAdd(numLines, groupLines);
+  }
+  return numLines;
+}
+
+// Returns the number of cache lines of 'level' that a tile can use. One way of
+// each set is left for the data streamed through the cache and for conflict
+// misses, and half of the cache if it is direct-mapped.
+static uint64_t getUsableCacheLines(const CacheLevelInfo &level) {
+  uint64_t numLines = level.sizeBytes / level.lineSizeBytes;
+  if (level.associativity <= 1)
+    return numLines / 2;
+  return numLines / level.associativity * (level.associativity - 1);
+}
+
+// Grows 'tileSizes' for the cache level 'level', by doubling one of the tile
+// sizes at a time as long as a tile fits in the cache. An access reused across
+// iterations of a tile-space loop of this level is reused at a distance of at
+// most one tile, i.e., the reuse hits the cache as long as a tile fits in it.
+// Each step thus picks the tile size that lowers the number of cache lines
+// touched per iteration of the tile the most, i.e., the loop carrying the most
+// reuse. Tile sizes are capped by 'maxTileSizes'.
+static void growTileSizes(const TileFootprintModel &model,
+                          const CacheLevelInfo &level,
+                          ArrayRef<uint64_t> maxTileSizes,
+                          SmallVectorImpl<unsigned> *tileSizes) {
+  uint64_t usableLines = getUsableCacheLines(level);
+  SmallVector<unsigned, 6> candidate;
+  while (true) {
+    Optional<unsigned> bestPos;
+    double bestLinesPerIteration = 0;
+    for (unsigned i = 0, e = tileSizes->size(); i < e; ++i) {
+      if ((*tileSizes)[i] >= maxTileSizes[i])
+        continue;
+      candidate.assign(tileSizes->begin(), tileSizes->end());
+      candidate[i] = std::min<uint64_t>(2 * candidate[i], maxTileSizes[i]);
+      uint64_t numLines = model.getNumLines(candidate, level.lineSizeBytes);
+      if (numLines > usableLines)
+        continue;
+      double numIterations = 1;
+      for (auto tileSize : candidate)
+        numIterations *= tileSize;
+      double linesPerIteration = numLines / numIterations;
+      if (!bestPos || linesPerIteration < bestLinesPerIteration) {
+        bestPos = i;
+        bestLinesPerIteration = linesPerIteration;
+      }
+    }
+    if (!bestPos)
+      return;
+    unsigned &tileSize = (*tileSizes)[bestPos.getValue()];
+    tileSize = std::min<uint64_t>(2 * tileSize, maxTileSizes[*bestPos]);
+  }
+}
+
+// Returns the tile sizes to use for each of the cache levels, from the
+// outermost level inwards, dropping the levels that don't split the tiles of
+// their enclosing level. The tile sizes of a level are those of the next inner
+// level, grown by growTileSizes for the capacity of the level.
+void LoopTiling::getMultiLevelTileSizes(
+    ArrayRef<AffineForOp> band,
+    std::vector<SmallVector<unsigned, 6>> *levelTileSizes) {
+  unsigned width = band.size();
+  auto model = TileFootprintModel::build(band);
+  if (!model.hasValue()) {
+    // Use a single level of default tile sizes if accesses can't be modeled.
+    levelTileSizes->emplace_back(width, LoopTiling::kDefaultTileSize);
+    if (avoidMaxMinBounds)
+      adjustToDivisorsOfTripCounts(band, &levelTileSizes->back());
+    auto rootForOp = band[0];
+    LLVM_DEBUG(rootForOp.emitWarning("memory accesses can't be modeled: using "
+                                   "default tile sizes adjusted to trip count "
+                                   "divisors"));
+    return;
+  }
+
+  SmallVector<Optional<uint64_t>, 6> tripCounts;
+  SmallVector<uint64_t, 6> maxTileSizes;
+  for (auto forOp : band) {
+    tripCounts.push_back(getConstantTripCount(forOp));
+    maxTileSizes.push_back(std::max<uint64_t>(
+        1, tripCounts.back().getValueOr(kMaxTileSizeForUnknownTripCount)));
+  }
+
+  std::vector<SmallVector<unsigned, 6>> tileSizesPerLevel;
+  SmallVector<unsigned, 6> tileSizes(width, 1);
+  for (const auto &level : cacheLevels) {
+    growTileSizes(*model, level, maxTileSizes, &tileSizes);
+    tileSizesPerLevel.push_back(tileSizes);
+  }
+
+  // Reduce the tile sizes of each level to divisors of those of the enclosing
+  // level, or of the trip counts for the outermost level.
+  if (avoidMaxMinBounds) {
+    for (unsigned l = tileSizesPerLevel.size(); l-- > 0;) {
+      for (unsigned i = 0; i < width; ++i) {
+        Optional<uint64_t> extent = l + 1 == tileSizesPerLevel.size()
+                                        ? tripCounts[i]
+                                        : tileSizesPerLevel[l + 1][i];
+        if (!extent.hasValue())
+          continue;
+        unsigned &tileSize = tileSizesPerLevel[l][i];
+        while (extent.getValue() % tileSize != 0)
+          tileSize--;
+      }
+    }
+  }
+
+  SmallVector<Optional<uint64_t>, 6> enclosingSizes(tripCounts);
+  for (auto &tileSizes : llvm::reverse(tileSizesPerLevel)) {
+    bool splitsEnclosingTile = false, isTrivial = true;
+    for (unsigned i = 0; i < width; ++i) {
+      if (!enclosingSizes[i] || tileSizes[i] < *enclosingSizes[i])
+        splitsEnclosingTile = true;
+      if (tileSizes[i] != 1)
+        isTrivial = false;
+    }
+    if (!splitsEnclosingTile || isTrivial)
+      continue;
+    levelTileSizes->push_back(tileSizes);
+    enclosingSizes.assign(tileSizes.begin(), tileSizes.end());
+  }
+}
+
+// Emits a remark with the tile sizes used for 'band' in debug mode.
+static void emitTileSizesRemark(ArrayRef<AffineForOp> band,
+                                ArrayRef<unsigned> tileSizes) {
+  if (!llvm::DebugFlag)
+    return;
+  std::stringstream msg;
+  msg << "using tile sizes [";
+  for (auto tSize : tileSizes)
+    msg << tSize << " ";
+  msg << "]\n";
+  auto rootForOp = band[0];
+  rootForOp.emitRemark(msg.str());
+}
+
+// Tiles 'band' for each of the cache levels, from the outermost level inwards:
+// the intra-tile loops of each level are tiled again for the next inner level.
+LogicalResult
+LoopTiling::tileForCacheLevels(MutableArrayRef<AffineForOp> band) {
+  std::vector<SmallVector<unsigned, 6>> levelTileSizes;
+  getMultiLevelTileSizes(band, &levelTileSizes);
+
+  unsigned width = band.size();
+  SmallVector<AffineForOp, 6> pointBand(band.begin(), band.end());
+  SmallVector<AffineForOp, 12> tiledNest;
+  for (const auto &tileSizes : levelTileSizes) {
+    emitTileSizesRemark(pointBand, tileSizes);
+    if (failed(tileCodeGen(pointBand, tileSizes, &tiledNest)))
+      return failure();
+    pointBand.assign(tiledNest.begin() + width, tiledNest.end());
+  }
+  return success();
+}
+
 void LoopTiling::runOnFunction() {
   // Override cache size if provided on command line.
   if (clCacheSizeKiB.getNumOccurrences() > 0)
     cacheSizeBytes = clCacheSizeKiB * 1024;
 
+  // Override cache levels if provided on command line.
+  if (!clCacheLevelSizesKiB.empty()) {
+    cacheLevels.clear();
+    for (unsigned i = 0, e = clCacheLevelSizesKiB.size(); i < e; ++i) {
+      CacheLevelInfo level;
+      level.sizeBytes = clCacheLevelSizesKiB[i] * 1024ULL;
+      level.lineSizeBytes = i < clCacheLineSizes.size() ? clCacheLineSizes[i]
+                                                        : kDefaultCacheLineSize;
+      level.associativity = i < clCacheAssociativities.size()
+                                ? clCacheAssociativities[i]
+                                : kDefaultCacheAssociativity;
+      cacheLevels.push_back(level);
+    }
+  }
+  // Explicit tile sizes override the cache levels.
+  bool tileForCaches = !cacheLevels.empty() &&
+                       clTileSize.getNumOccurrences() == 0 &&
+                       clTileSizes.empty();
+
+  // The tile size models divide by the cache size and the line sizes.
+  if (tileForCaches) {
+    for (unsigned i = 0, e = cacheLevels.size(); i < e; ++i) {
+      if (cacheLevels[i].sizeBytes == 0 || cacheLevels[i].lineSizeBytes == 0) {
+        getFunction().emitError("invalid cache level ")
+            << i + 1 << " for loop tiling: size and line size must be positive";
+        return signalPassFailure();
+      }
+    }
+  } else if (cacheSizeBytes == 0) {
+    getFunction().emitError(
+        "invalid cache size for loop tiling: must be positive");
+    return signalPassFailure();
+  }
+
   // Bands of loops to tile.
   std::vector<SmallVector<AffineForOp, 6>> bands;
   getTileableBands(getFunction(), &bands);
 
   for (auto &band : bands) {
+    if (tileForCaches) {
+      if (failed(tileForCacheLevels(band)))
+        return signalPassFailure();
+      continue;
+    }
     // Set up tile sizes; fill missing tile sizes at the end with default tile
     // size or clTileSize if one was provided.
     SmallVector<unsigned, 6> tileSizes;
     getTileSizes(band, &tileSizes);
-    if (llvm::DebugFlag) {
-      std::stringstream msg;
-      msg << "using tile sizes [";
-      for (auto tSize : tileSizes)
-        msg << tSize << " ";
-      msg << "]\n";
-      auto rootForOp = band[0];
-      rootForOp.emitRemark(msg.str());
-    }
+    emitTileSizesRemark(band, tileSizes);
     if (failed(tileCodeGen(band, tileSizes)))
       return signalPassFailure();
   }
@@ -412,5 +812,8 @@ void LoopTiling::runOnFunction() {
 
 constexpr unsigned LoopTiling::kDefaultTileSize;
 constexpr uint64_t LoopTiling::kDefaultCacheMemCapacity;
+constexpr unsigned LoopTiling::kDefaultCacheLineSize;
+constexpr unsigned LoopTiling::kDefaultCacheAssociativity;
+constexpr unsigned LoopTiling::kMaxTileSizeForUnknownTripCount;
 
 static PassRegistration<LoopTiling> pass("affine-loop-tile", "Tile loop nests");
@@ -21,6 +21,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Dominance.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/IntegerSet.h"
@@ -247,6 +248,12 @@ struct LowerAffinePass : public FunctionPass<LowerAffinePass> {
   bool lowerAffineFor(AffineForOp forOp);
   bool lowerAffineIf(AffineIfOp ifOp);
   bool lowerAffineApply(AffineApplyOp op);
+  void updateDominance(Block *entryBlock, Block *exitBlock, Operation *op);
+
+  // The dominance analyses computed by earlier passes, if any. They are kept
+  // up to date with the lowered CFG rather than recomputed by later passes.
+  DominanceInfo *domInfo;
+  PostDominanceInfo *postDomInfo;
 };
 } // end anonymous namespace
 
@@ -391,6 +398,7 @@ bool LowerAffinePass::lowerAffineFor(AffineForOp forOp) {
                                endBlock, ArrayRef<Value *>());
 
   // Ok, we're done!
+  updateDominance(initBlock, endBlock, forInst);
   forOp.erase();
   return false;
 }
@@ -556,19 +564,55 @@ bool LowerAffinePass::lowerAffineIf(AffineIfOp ifOp) {
   // We will have ended up with an empty block as our continuation block (or, in
   // the degenerate case where there were zero conditions, we have the original
   // condition block).  Redirect that to the thenBlock.
-  condBlock = builder.getInsertionBlock();
-  if (condBlock->empty()) {
-    condBlock->replaceAllUsesWith(thenBlock);
-    condBlock->eraseFromFunction();
+  auto *lastCondBlock = builder.getInsertionBlock();
+  if (lastCondBlock->empty()) {
+    lastCondBlock->replaceAllUsesWith(thenBlock);
+    lastCondBlock->eraseFromFunction();
   } else {
     builder.create<BranchOp>(loc, thenBlock);
   }
 
   // Ok, we're done!
+  updateDominance(condBlock, continueBlock, ifInst);
   ifInst->erase();
   return false;
 }
 
+// Update the known dominance analyses for the lowering of the affine operation
+// 'op', which split 'entryBlock' before 'op' and replaced it with the blocks
+// following 'entryBlock' up to 'exitBlock'.  The former terminator of
+// 'entryBlock', and thus its former successors, now belong to 'exitBlock'.  All
+// of the other edges out of these blocks are new.
+void LowerAffinePass::updateDominance(Block *entryBlock, Block *exitBlock,
+                                      Operation *op) {
+  if (!domInfo && !postDomInfo)
+    return;
+
+  SmallVector<DominanceUpdate, 8> updates;
+  auto addUpdates = [&](llvm::cfg::UpdateKind kind, Block *from,
+                        Block *successorsOf) {
+    // A block may branch to the same successor more than once.
+    SmallPtrSet<Block *, 4> successors;
+    for (Block *succ : successorsOf->getSuccessors())
+      if (successors.insert(succ).second)
+        updates.emplace_back(kind, from, succ);
+  };
+  addUpdates(llvm::cfg::UpdateKind::Delete, entryBlock, exitBlock);
+  auto blockIt = Region::iterator(entryBlock);
+  auto blockEnd = std::next(Region::iterator(exitBlock));
+  for (; blockIt != blockEnd; ++blockIt)
+    addUpdates(llvm::cfg::UpdateKind::Insert, &*blockIt, &*blockIt);
+
+  if (domInfo) {
+    domInfo->applyUpdates(updates);
+    domInfo->notifyOperationErased(op);
+  }
+  if (postDomInfo) {
+    postDomInfo->applyUpdates(updates);
+    postDomInfo->notifyOperationErased(op);
+  }
+}
+
 // Convert an "affine.apply" operation into a sequence of arithmetic
 // operations using the StandardOps dialect.  Return true on error.
 bool LowerAffinePass::lowerAffineApply(AffineApplyOp op) {
@@ -609,6 +653,11 @@ bool LowerAffinePass::lowerAffineApply(AffineApplyOp op) {
 void LowerAffinePass::runOnFunction() {
   SmallVector<Operation *, 8> instsToRewrite;
 
+  auto cachedDomInfo = getCachedAnalysis<DominanceInfo>();
+  auto cachedPostDomInfo = getCachedAnalysis<PostDominanceInfo>();
+  domInfo = cachedDomInfo ? &cachedDomInfo->get() : nullptr;
+  postDomInfo = cachedPostDomInfo ? &cachedPostDomInfo->get() : nullptr;
+
   // Collect all the For operations as well as AffineIfOps and AffineApplyOps.
   // We do this as a prepass to avoid invalidating the walker with our rewrite.
   getFunction().walk([&](Operation *op) {
@@ -630,6 +679,9 @@ void LowerAffinePass::runOnFunction() {
       return signalPassFailure();
     }
   }
+
+  // The dominance analyses were updated along with the CFG.
+  markAnalysesPreserved<DominanceInfo, PostDominanceInfo>();
 }
 
 /// Lowers If and For operations within a function into their lower level CFG
@@ -0,0 +1,57 @@
+// RUN: mlir-opt %s -emit-bytecode -o %t && mlir-opt %t | FileCheck %s
+// RUN: mlir-translate %s -mlir-to-bytecode -o %t && mlir-translate %t -bytecode-to-mlir | FileCheck %s
+
+// CHECK-DAG: #map{{[0-9]+}} = (d0, d1) -> (d1, d0)
+#map0 = (d0, d1) -> (d1, d0)
+
+// CHECK-LABEL: func @external(memref<4x?xf32, #map{{[0-9]+}}, 1>) -> i64
+func @external(memref<4x?xf32, #map0, 1>) -> i64
+
+// CHECK-LABEL: func @attributes(%arg0: i32 {arg.attr})
+// CHECK-NEXT: attributes {dialect.bool: true, dialect.callee: @external : (memref<4x?xf32, #map{{[0-9]+}}, 1>) -> i64, dialect.float: 2.500000e+00 : f16, dialect.int: -42 : i7, dialect.str: "foo\0Abar", dialect.type: tuple<i1, complex<f32>>}
+func @attributes(%arg0: i32 {arg.attr}) attributes {dialect.bool: true, dialect.callee: @external : (memref<4x?xf32, #map0, 1>) -> i64, dialect.float: 2.5 : f16, dialect.int: -42 : i7, dialect.str: "foo\nbar", dialect.type: tuple<i1, complex<f32>>} {
+  return
+}
+
+// CHECK-LABEL: func @elements()
+func @elements() -> (tensor<2x3xi32>, vector<4xf64>, tensor<8xi16>) {
+  // CHECK-NEXT: %cst = constant dense<tensor<2x3xi32>, {{\[\[}}1, 2, 3], [-4, -5, -6]]> : tensor<2x3xi32>
+  %0 = constant dense<tensor<2x3xi32>, [[1, 2, 3], [-4, -5, -6]]> : tensor<2x3xi32>
+  // CHECK-NEXT: %cst_0 = constant splat<vector<4xf64>, 1.500000e+00> : vector<4xf64>
+  %1 = constant splat<vector<4xf64>, 1.5> : vector<4xf64>
+  // CHECK-NEXT: %cst_1 = constant sparse<tensor<8xi16>, {{\[\[}}1], [5]], [7, -7]> : tensor<8xi16>
+  %2 = constant sparse<tensor<8xi16>, [[1], [5]], [7, -7]> : tensor<8xi16>
+  return %0, %1, %2 : tensor<2x3xi32>, vector<4xf64>, tensor<8xi16>
+}
+
+// CHECK-LABEL: func @forward_refs(%arg0: i1, %arg1: index)
+func @forward_refs(%cond: i1, %n: index) -> index {
+  // CHECK-NEXT: br ^bb2
+  br ^bb2
+// CHECK-NEXT: ^bb1(%0: index):
+^bb1(%arg: index):
+  // CHECK-NEXT: %1 = addi %0, %3 : index
+  %sum = addi %arg, %def : index
+  // CHECK-NEXT: return %1 : index
+  return %sum : index
+// CHECK-NEXT: ^bb2:
+^bb2:
+  // CHECK-NEXT: %2 = "foo"() : () -> index
+  %v = "foo"() : () -> index
+  // CHECK-NEXT: %3 = "bar"(%2) : (index) -> index
+  %def = "bar"(%v) : (index) -> index
+  // CHECK-NEXT: cond_br %arg0, ^bb1(%2 : index), ^bb1(%3 : index)
+  cond_br %cond, ^bb1(%v : index), ^bb1(%def : index)
+}
+
+// CHECK-LABEL: func @regions(%arg0: memref<10xf32>)
+func @regions(%A: memref<10xf32>) {
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i = 0 to 10 {
+    // CHECK-NEXT: %0 = load %arg0[%i0] : memref<10xf32>
+    %v = load %A[%i] : memref<10xf32>
+    // CHECK-NEXT: store %0, %arg0[%i0] : memref<10xf32>
+    store %v, %A[%i] : memref<10xf32>
+  }
+  return
+}
@@ -0,0 +1,51 @@
+// RUN: mlir-opt %s -mlir-parallel-parse -split-input-file -verify
+
+// Braces within strings and comments don't end the body early.
+func @braces() {
+  "foo"() {bar: "}\"}"} : () -> () // }
+  return
+}
+
+func @after_braces() {
+  br ^missing  // expected-error {{reference to an undefined block}}
+}
+
+// -----
+
+func @use_before_alias() {
+  %0 = "foo"() : () -> !alias // expected-error@+1 {{undefined type alias id 'alias'}}
+  return
+}
+
+!alias = type i32
+
+// -----
+
+func @use_before_map() {
+  "foo"() {map: #map0} : () -> () // expected-error {{undefined affine map or integer set id 'map0'}}
+  return
+}
+
+#map0 = (d0) -> (d0)
+
+// -----
+
+func @forward_ref() {
+  %x = constant @undefined : () -> ()  // expected-error {{reference to undefined function 'undefined'}}
+  return
+}
+
+// -----
+
+func @unterminated() {
+  "foo"() {bar: "unterminated} : () -> () // expected-error {{in string literal}}
+}
+
+// -----
+
+// Errors in a skipped body are reported before the errors following it.
+func @body_before_error() {
+  "foo"() : () -> (i32 // expected-error@+1 {{expected ')'}}
+}
+
+)
@@ -670,6 +670,48 @@ func @elementsattr_toolarge2() -> () {
 
 // -----
 
+func @elementsattr_hex_prefix() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi32>, "01000000">} : () -> () // expected-error {{hex string should start with '0x'}}
+}
+
+// -----
+
+func @elementsattr_hex_size() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<2xi32>, "0x01000000">} : () -> () // expected-error {{hex string has 4 bytes, but type requires 8}}
+}
+
+// -----
+
+func @elementsattr_hex_digits() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi32>, "0x0100000G">} : () -> () // expected-error {{hex string only contains hex digits}}
+}
+
+// -----
+
+func @elementsattr_vector_element() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<2xvector<2xf32>>, [1.0, 2.0]>} : () -> () // expected-error {{expected integer or float tensor element}}
+}
+
+// -----
+
+func @elementsattr_vector_element_empty() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<0xvector<2xf32>>, []>} : () -> () // expected-error {{expected integer or float tensor element}}
+}
+
+// -----
+
+func @elementsattr_vector_element_hex() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xvector<2xf32>>, "0x0000000000000000">} : () -> () // expected-error {{expected integer or float tensor element}}
+}
+
+// -----
+
 func @elementsattr_malformed_opaque() -> () {
 ^bb0:
   "foo"(){bar: opaque<tensor<1xi8>, "0xQZz123">} : () -> () // expected-error {{expected dialect namespace}}
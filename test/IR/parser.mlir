@@ -1,4 +1,6 @@
 // RUN: mlir-opt %s | FileCheck %s
+// RUN: mlir-opt %s -mlir-parallel-parse | FileCheck %s
+// RUN: mlir-opt %s -emit-bytecode -o %t && mlir-opt %t | FileCheck %s
 
 // CHECK-DAG: #map{{[0-9]+}} = (d0, d1, d2, d3, d4)[s0] -> (d0, d1, d2, d4, d3)
 #map0 = (d0, d1, d2, d3, d4)[s0] -> (d0, d1, d2, d4, d3)
@@ -667,6 +669,21 @@ func @densetensorattr() -> () {
   "intscalar"(){bar: dense<tensor<i32>, 1>} : () -> ()
 // CHECK: "floatscalar"() {bar: dense<tensor<f32>, 5.000000e+00>} : () -> ()
   "floatscalar"(){bar: dense<tensor<f32>, 5.0>} : () -> ()
+
+// The hex form holds the packed elements of the attribute.
+// CHECK: "hexfloat32"() {bar: dense<tensor<2xf32>, [1.000000e+00, 2.000000e+00]>} : () -> ()
+  "hexfloat32"(){bar: dense<tensor<2xf32>, "0x0000803F00000040">} : () -> ()
+// CHECK: "hexbfloat16"() {bar: dense<tensor<1xbf16>, [1.000000e+00]>} : () -> ()
+  "hexbfloat16"(){bar: dense<tensor<1xbf16>, "0x000000000000F03F">} : () -> ()
+// CHECK: "hexi16"() {bar: dense<tensor<2x2xi16>, {{\[\[}}1, -1], [3, -2]]>} : () -> ()
+  "hexi16"(){bar: dense<tensor<2x2xi16>, "0x0100FFFF0300FEFF">} : () -> ()
+// CHECK: "hexi3"() {bar: dense<vector<2xi3>, [-3, -1]>} : () -> ()
+  "hexi3"(){bar: dense<vector<2xi3>, "0x3D">} : () -> ()
+// The bits past the last element are ignored.
+// CHECK: "hexi1"() {bar: dense<tensor<3xi1>, [1, 0, 1]>} : () -> ()
+  "hexi1"(){bar: dense<tensor<3xi1>, "0xFD">} : () -> ()
+// CHECK: "hexempty"() {bar: dense<tensor<0xi32>, []>} : () -> ()
+  "hexempty"(){bar: dense<tensor<0xi32>, "0x">} : () -> ()
   return
 }
 
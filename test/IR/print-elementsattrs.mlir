@@ -0,0 +1,36 @@
+// RUN: mlir-opt %s -mlir-print-elementsattrs-with-hex-if-larger=2 | FileCheck %s --check-prefix=HEX
+// RUN: mlir-opt %s -mlir-print-elementsattrs-with-hex-if-larger=2 | mlir-opt | FileCheck %s
+// RUN: mlir-opt %s -mlir-elide-elementsattrs-if-larger=2 | FileCheck %s --check-prefix=ELIDE
+
+// CHECK-LABEL: func @dense
+// HEX-LABEL: func @dense
+// ELIDE-LABEL: func @dense
+func @dense() {
+  // CHECK: "small"() {bar: dense<tensor<2xf32>, [1.000000e+00, 2.000000e+00]>} : () -> ()
+  // HEX: "small"() {bar: dense<tensor<2xf32>, [1.000000e+00, 2.000000e+00]>} : () -> ()
+  // ELIDE: "small"() {bar: dense<tensor<2xf32>, [1.000000e+00, 2.000000e+00]>} : () -> ()
+  "small"(){bar: dense<tensor<2xf32>, [1.0, 2.0]>} : () -> ()
+
+  // CHECK: "float32"() {bar: dense<tensor<2x2xf32>, {{\[\[}}1.000000e+00, 2.000000e+00], [-1.000000e+00, 1.000000e-01]]>} : () -> ()
+  // HEX: "float32"() {bar: dense<tensor<2x2xf32>, "0x0000803F00000040000080BFCDCCCC3D">} : () -> ()
+  // ELIDE: "float32"() {bar: dense<tensor<2x2xf32>, "...">} : () -> ()
+  "float32"(){bar: dense<tensor<2x2xf32>, [[1.0, 2.0], [-1.0, 0.1]]>} : () -> ()
+
+  // CHECK: "int3"() {bar: dense<vector<3xi3>, [-3, -1, 2]>} : () -> ()
+  // HEX: "int3"() {bar: dense<vector<3xi3>, "0xBD00">} : () -> ()
+  // ELIDE: "int3"() {bar: dense<vector<3xi3>, "...">} : () -> ()
+  "int3"(){bar: dense<vector<3xi3>, [-3, -1, 2]>} : () -> ()
+
+  // CHECK: "bool"() {bar: dense<tensor<3xi1>, [1, 0, 1]>} : () -> ()
+  // HEX: "bool"() {bar: dense<tensor<3xi1>, "0x05">} : () -> ()
+  "bool"(){bar: dense<tensor<3xi1>, [1, 0, 1]>} : () -> ()
+
+  // CHECK: "int67"() {bar: dense<tensor<3xi67>, [-5, 4, 6]>} : () -> ()
+  "int67"(){bar: dense<tensor<3xi67>, [-5, 4, 6]>} : () -> ()
+
+  // Sparse attributes are always printed in full.
+  // HEX: "sparse"() {bar: sparse<tensor<1x1x4xi16>, {{\[\[}}0, 0, 0], [0, 0, 2], [0, 0, 3]], [1, 2, 3]>} : () -> ()
+  // ELIDE: "sparse"() {bar: sparse<tensor<1x1x4xi16>, {{\[\[}}0, 0, 0], [0, 0, 2], [0, 0, 3]], [1, 2, 3]>} : () -> ()
+  "sparse"(){bar: sparse<tensor<1x1x4xi16>, [[0, 0, 0], [0, 0, 2], [0, 0, 3]], [1, 2, 3]>} : () -> ()
+  return
+}
@@ -0,0 +1,36 @@
+// RUN: mlir-opt %s -affine-parallelize -parallel-chunk-size=32 -lower-affine -lower-to-llvm | FileCheck %s
+
+// CHECK-LABEL: func @scale(%arg0: !llvm<"{ float*, i64 }">, %arg1: !llvm.i64, %arg2: !llvm.float) {
+// CHECK:   %[[CTX:.*]] = llvm.alloca %{{.*}} x !llvm<"{ { float*, i64 }, float }"> : (!llvm.i64) -> !llvm<"{ { float*, i64 }, float }*">
+// CHECK:   %[[PTR0:.*]] = llvm.getelementptr %[[CTX]][%{{.*}}, %{{.*}}] : (!llvm<"{ { float*, i64 }, float }*">, !llvm.i32, !llvm.i32) -> !llvm<"{ float*, i64 }*">
+// CHECK-NEXT:   llvm.store %arg0, %[[PTR0]] : !llvm<"{ float*, i64 }*">
+// CHECK:   %[[PTR1:.*]] = llvm.getelementptr %[[CTX]][%{{.*}}, %{{.*}}] : (!llvm<"{ { float*, i64 }, float }*">, !llvm.i32, !llvm.i32) -> !llvm<"float*">
+// CHECK-NEXT:   llvm.store %arg2, %[[PTR1]] : !llvm<"float*">
+// CHECK-NEXT:   %[[OPAQUE:.*]] = llvm.bitcast %[[CTX]] : !llvm<"{ { float*, i64 }, float }*"> to !llvm<"i8*">
+// CHECK-NEXT:   %[[TASK:.*]] = llvm.constant(@scale_parallel_for0_task : (!llvm<"i8*">, !llvm.i64, !llvm.i64) -> ()) : !llvm<"void (i8*, i64, i64)*">
+// CHECK-NEXT:   %[[STEP:.*]] = llvm.constant(1) : !llvm.i64
+// CHECK-NEXT:   %[[CHUNK:.*]] = llvm.constant(32) : !llvm.i64
+// CHECK-NEXT:   %[[DYNAMIC:.*]] = llvm.constant(0) : !llvm.i64
+// CHECK-NEXT:   llvm.call @mlirParallelFor(%[[TASK]], %[[OPAQUE]], %{{.*}}, %arg1, %[[STEP]], %[[CHUNK]], %[[DYNAMIC]])
+// CHECK-NEXT:   llvm.return
+func @scale(%m: memref<?xf32>, %n: index, %s: f32) {
+  affine.for %i = 0 to %n {
+    %0 = load %m[%i] : memref<?xf32>
+    %1 = mulf %0, %s : f32
+    store %1, %m[%i] : memref<?xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func @scale_parallel_for0(%arg0: !llvm.i64, %arg1: !llvm.i64, %arg2: !llvm<"{ float*, i64 }">, %arg3: !llvm.float) {
+
+// The task function unpacks the captured values from the context and calls the
+// outlined function on the chunk [%arg1, %arg2).
+// CHECK-LABEL: func @scale_parallel_for0_task(%arg0: !llvm<"i8*">, %arg1: !llvm.i64, %arg2: !llvm.i64) {
+// CHECK-NEXT:   %[[CTX:.*]] = llvm.bitcast %arg0 : !llvm<"i8*"> to !llvm<"{ { float*, i64 }, float }*">
+// CHECK:        %[[MEMREF:.*]] = llvm.load %{{.*}} : !llvm<"{ float*, i64 }*">
+// CHECK:        %[[SCALE:.*]] = llvm.load %{{.*}} : !llvm<"float*">
+// CHECK-NEXT:   llvm.call @scale_parallel_for0(%arg1, %arg2, %[[MEMREF]], %[[SCALE]])
+// CHECK-NEXT:   llvm.return
+
+// CHECK: func @mlirParallelFor(!llvm<"void (i8*, i64, i64)*">, !llvm<"i8*">, !llvm.i64, !llvm.i64, !llvm.i64, !llvm.i64, !llvm.i64)
@@ -1,4 +1,5 @@
 // RUN: mlir-opt -lower-to-llvm %s | FileCheck %s
+// RUN: mlir-opt -lower-to-llvm -lower-to-llvm-parallel %s | FileCheck %s
 
 // CHECK-LABEL: func @empty() {
 // CHECK-NEXT:  llvm.return
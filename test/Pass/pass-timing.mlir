@@ -2,6 +2,7 @@
 // RUN: mlir-opt %s -disable-pass-threading=true -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=pipeline 2>&1 | FileCheck -check-prefix=PIPELINE %s
 // RUN: mlir-opt %s -disable-pass-threading=false -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=list 2>&1 | FileCheck -check-prefix=MT_LIST %s
 // RUN: mlir-opt %s -disable-pass-threading=false -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=pipeline 2>&1 | FileCheck -check-prefix=MT_PIPELINE %s
+// RUN: mlir-opt %s -pass-threads=2 -verify-each=true -cse -canonicalize -cse -pass-timing 2>&1 | FileCheck -check-prefix=MT_UTILIZATION %s
 
 // LIST: Pass execution timing report
 // LIST: Total Execution Time:
@@ -53,6 +54,15 @@
 // MT_PIPELINE-NEXT: ModuleVerifier
 // MT_PIPELINE-NEXT: Total
 
+// MT_UTILIZATION: Pass execution timing report
+// MT_UTILIZATION: Total
+// MT_UTILIZATION: Parallel function pipeline thread utilization
+// MT_UTILIZATION: Total Parallel Time:
+// MT_UTILIZATION: Functions
+// MT_UTILIZATION-SAME: Thread
+// MT_UTILIZATION-NEXT: Thread 0
+// MT_UTILIZATION-NEXT: Thread 1
+
 func @foo() {
   return
 }
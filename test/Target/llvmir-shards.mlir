@@ -0,0 +1,31 @@
+// RUN: mlir-translate -mlir-to-llvmir-shards -llvmir-num-shards=2 %s | FileCheck %s
+
+func @external(!llvm.i32) -> !llvm.i32
+
+// The first shard declares the function of the second shard that it calls.
+// CHECK-LABEL: ModuleID
+// CHECK:       declare i32 @external(i32)
+// CHECK:       define { i32, float* } @first(i32{{.*}})
+// CHECK-NEXT:    call i32 @second(i32 %{{[0-9]+}})
+// CHECK-NEXT:    insertvalue { i32, float* } undef, i32 %{{[0-9]+}}, 0
+// CHECK:       declare i32 @second(i32)
+func @first(%arg0: !llvm.i32) -> !llvm<"{ i32, float* }"> {
+  %0 = llvm.call @second(%arg0) : (!llvm.i32) -> !llvm.i32
+  %1 = llvm.undef : !llvm<"{ i32, float* }">
+  %2 = llvm.insertvalue %0, %1[0] : !llvm<"{ i32, float* }">
+  llvm.return %2 : !llvm<"{ i32, float* }">
+}
+
+// The second shard doesn't declare the function of the first shard, which it
+// doesn't use.
+// CHECK-LABEL: ModuleID
+// CHECK-NOT:   @first
+// CHECK:       declare i32 @external(i32)
+// CHECK-NOT:   @first
+// CHECK:       define i32 @second(i32{{.*}})
+// CHECK-NEXT:    call i32 @external(i32 %{{[0-9]+}})
+// CHECK-NOT:   @first
+func @second(%arg0: !llvm.i32) -> !llvm.i32 {
+  %0 = llvm.call @external(%arg0) : (!llvm.i32) -> !llvm.i32
+  llvm.return %0 : !llvm.i32
+}
@@ -810,3 +810,10 @@ func @llvm_noalias(%arg0: !llvm<"float*"> {llvm.noalias: true}) {
 // CHECK-LABEL: @llvm_varargs(...) 
 func @llvm_varargs()
   attributes {std.varargs: true}
+
+// CHECK-LABEL: define void @alloca(i64)
+func @alloca(%arg0: !llvm.i64) {
+// CHECK-NEXT: %2 = alloca { float*, i64 }, i64 %0
+  %0 = llvm.alloca %arg0 x !llvm<"{ float*, i64 }"> : (!llvm.i64) -> !llvm<"{ float*, i64 }*">
+  llvm.return
+}
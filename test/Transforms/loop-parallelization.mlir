@@ -0,0 +1,94 @@
+// RUN: mlir-opt %s -affine-parallelize | FileCheck %s
+// RUN: mlir-opt %s -affine-parallelize -parallel-schedule=dynamic -parallel-grain-size=100 | FileCheck %s --check-prefix=DYNAMIC
+// RUN: mlir-opt %s -affine-parallelize -parallel-chunk-size=8 | FileCheck %s --check-prefix=CHUNK
+
+// CHECK-LABEL: func @nest(%arg0: memref<?x64xf32>, %arg1: index, %arg2: f32) {
+func @nest(%m: memref<?x64xf32>, %n: index, %s: f32) {
+  // CHECK-NEXT: %c0 = affine.apply #map{{[0-9]+}}()
+  // CHECK-NEXT: %0 = affine.apply #map{{[0-9]+}}()[%arg1]
+  // CHECK-NEXT: call @nest_parallel_for0(%c0, %0, %arg0, %arg2) {parallel.chunk_size: 16, parallel.schedule: "static", parallel.step: 1} : (index, index, memref<?x64xf32>, f32) -> ()
+  // CHECK-NEXT: return
+  // DYNAMIC: call @nest_parallel_for0({{.*}}) {parallel.chunk_size: 1, parallel.schedule: "dynamic", parallel.step: 1}
+  // CHUNK: call @nest_parallel_for0({{.*}}) {parallel.chunk_size: 8, parallel.schedule: "static", parallel.step: 1}
+  affine.for %i = 0 to %n {
+    affine.for %j = 0 to 64 {
+      %0 = load %m[%i, %j] : memref<?x64xf32>
+      %1 = mulf %0, %s : f32
+      store %1, %m[%i, %j] : memref<?x64xf32>
+    }
+  }
+  return
+}
+
+// The loop does too little work to be parallelized, unless the grain size is
+// lowered.
+// CHECK-LABEL: func @small_step(%arg0: memref<1024xf32>) {
+// DYNAMIC-LABEL: func @small_step(%arg0: memref<1024xf32>) {
+func @small_step(%m: memref<1024xf32>) {
+  // CHECK-NEXT: affine.for %i0 = 0 to 1024 step 2 {
+  // DYNAMIC: call @small_step_parallel_for0({{.*}}) {parallel.chunk_size: 34, parallel.schedule: "dynamic", parallel.step: 2}
+  affine.for %i = 0 to 1024 step 2 {
+    %0 = load %m[%i] : memref<1024xf32>
+    store %0, %m[%i] : memref<1024xf32>
+  }
+  return
+}
+
+// Loops carrying a dependence are not parallelized, but their nested parallel
+// loops are.
+// DYNAMIC-LABEL: func @carried(%arg0: memref<1024x1024xf32>) {
+func @carried(%m: memref<1024x1024xf32>) {
+  // DYNAMIC-NEXT: affine.for %i0 = 1 to 1024 {
+  // DYNAMIC:        call @carried_parallel_for0(%c0, %c1024, %i0, %arg0) {parallel.chunk_size: 25, parallel.schedule: "dynamic", parallel.step: 1}
+  affine.for %i = 1 to 1024 {
+    affine.for %j = 0 to 1024 {
+      %im1 = affine.apply (d0) -> (d0 - 1)(%i)
+      %0 = load %m[%im1, %j] : memref<1024x1024xf32>
+      store %0, %m[%i, %j] : memref<1024x1024xf32>
+    }
+  }
+  return
+}
+
+// Loops with operations whose side effects aren't analyzed, like calls and
+// unregistered operations, are not parallelized.
+func @log(index)
+
+// CHECK-LABEL: func @call(%arg0: index) {
+func @call(%n: index) {
+  // CHECK-NEXT: affine.for %i0 = 0 to %arg0 {
+  // CHECK-NEXT:   call @log(%i0) : (index) -> ()
+  affine.for %i = 0 to %n {
+    call @log(%i) : (index) -> ()
+  }
+  return
+}
+
+// CHECK-LABEL: func @unregistered(%arg0: memref<?xf32>, %arg1: index) {
+func @unregistered(%m: memref<?xf32>, %n: index) {
+  // CHECK-NEXT: affine.for %i0 = 0 to %arg1 {
+  // CHECK-NEXT:   %0 = load %arg0[%i0] : memref<?xf32>
+  // CHECK-NEXT:   "foo.write"(%arg0, %0) : (memref<?xf32>, f32) -> ()
+  affine.for %i = 0 to %n {
+    %0 = load %m[%i] : memref<?xf32>
+    "foo.write"(%m, %0) : (memref<?xf32>, f32) -> ()
+  }
+  return
+}
+
+// CHECK-LABEL: func @nest_parallel_for0(%arg0: index, %arg1: index, %arg2: memref<?x64xf32>, %arg3: f32) {
+// CHECK-NEXT:    affine.for %i0 = %arg0 to %arg1 {
+// CHECK-NEXT:      affine.for %i1 = 0 to 64 {
+// CHECK-NEXT:        %0 = load %arg2[%i0, %i1] : memref<?x64xf32>
+// CHECK-NEXT:        %1 = mulf %0, %arg3 : f32
+// CHECK-NEXT:        store %1, %arg2[%i0, %i1] : memref<?x64xf32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:    }
+// CHECK-NEXT:    return
+// CHECK-NEXT:  }
+
+// DYNAMIC-LABEL: func @carried_parallel_for0(%arg0: index, %arg1: index, %arg2: index, %arg3: memref<1024x1024xf32>) {
+// DYNAMIC-NEXT:    affine.for %i0 = %arg0 to %arg1 {
+// DYNAMIC-NEXT:      %0 = affine.apply #map{{[0-9]+}}(%arg2)
+// DYNAMIC-NEXT:      %1 = load %arg3[%0, %i0] : memref<1024x1024xf32>
+// DYNAMIC-NEXT:      store %1, %arg3[%arg2, %i0] : memref<1024x1024xf32>
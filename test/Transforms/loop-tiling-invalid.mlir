@@ -0,0 +1,13 @@
+// RUN: mlir-opt %s -affine-loop-tile -tile-cache-size=0 -verify
+// RUN: mlir-opt %s -affine-loop-tile -tile-cache-levels=32,1024 -tile-cache-line-sizes=64,0 -verify
+
+// expected-error@+1 {{for loop tiling: }}
+func @zero_cache_parameter(%A: memref<256x256xf32>) {
+  affine.for %i = 0 to 256 {
+    affine.for %j = 0 to 256 {
+      %a = load %A[%j, %i] : memref<256x256xf32>
+      store %a, %A[%i, %j] : memref<256x256xf32>
+    }
+  }
+  return
+}
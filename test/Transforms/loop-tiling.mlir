@@ -1,5 +1,6 @@
 // RUN: mlir-opt %s -split-input-file  -affine-loop-tile -tile-size=32 | FileCheck %s
 // RUN: mlir-opt %s -split-input-file -affine-loop-tile -tile-cache-size=512 | FileCheck %s --check-prefix=MODEL
+// RUN: mlir-opt %s -split-input-file -affine-loop-tile -tile-cache-levels=32,1024 -tile-cache-associativities=8,16 | FileCheck %s --check-prefix=MULTI
 
 // -----
 
@@ -166,3 +167,63 @@ func @tile_with_loop_upper_bounds_in_two_symbols(%arg0: memref<?xf32>, %limit: i
 // CHECK-NEXT:      %1 = load %arg0[%i1] : memref<?xf32>
 // CHECK-NEXT:    }
 // CHECK-NEXT:  }
+
+// -----
+
+// Tiled for a 32 KiB L1 and a 1 MiB L2 with 64-byte lines. A 64 x 32 x 32 tile
+// of the L1 level touches 320 of the 448 lines left by its 8 ways, and a 256 x
+// 256 x 256 tile of the L2 level 12288 of the 15360 lines left by its 16 ways.
+
+// MULTI-DAG: [[IDENTITY:#map[0-9]+]] = (d0) -> (d0)
+// MULTI-DAG: [[PLUS32:#map[0-9]+]] = (d0) -> (d0 + 32)
+// MULTI-DAG: [[PLUS64:#map[0-9]+]] = (d0) -> (d0 + 64)
+// MULTI-DAG: [[PLUS256:#map[0-9]+]] = (d0) -> (d0 + 256)
+
+// MULTI-LABEL: func @multi_level_matmul
+func @multi_level_matmul(%A: memref<1024x1024xf32>, %B: memref<1024x1024xf32>, %C: memref<1024x1024xf32>) {
+  affine.for %i = 0 to 1024 {
+    affine.for %j = 0 to 1024 {
+      affine.for %k = 0 to 1024 {
+        %a = load %A[%i, %k] : memref<1024x1024xf32>
+        %b = load %B[%k, %j] : memref<1024x1024xf32>
+        %c = load %C[%i, %j] : memref<1024x1024xf32>
+        %p = mulf %a, %b : f32
+        %s = addf %c, %p : f32
+        store %s, %C[%i, %j] : memref<1024x1024xf32>
+      }
+    }
+  }
+  return
+}
+// MULTI:       affine.for %i0 = 0 to 1024 step 256 {
+// MULTI-NEXT:    affine.for %i1 = 0 to 1024 step 256 {
+// MULTI-NEXT:      affine.for %i2 = 0 to 1024 step 256 {
+// MULTI-NEXT:        affine.for %i3 = [[IDENTITY]](%i0) to [[PLUS256]](%i0) step 64 {
+// MULTI-NEXT:          affine.for %i4 = [[IDENTITY]](%i1) to [[PLUS256]](%i1) step 32 {
+// MULTI-NEXT:            affine.for %i5 = [[IDENTITY]](%i2) to [[PLUS256]](%i2) step 32 {
+// MULTI-NEXT:              affine.for %i6 = [[IDENTITY]](%i3) to [[PLUS64]](%i3) {
+// MULTI-NEXT:                affine.for %i7 = [[IDENTITY]](%i4) to [[PLUS32]](%i4) {
+// MULTI-NEXT:                  affine.for %i8 = [[IDENTITY]](%i5) to [[PLUS32]](%i5) {
+// MULTI-NEXT:                    load %arg0[%i6, %i8] : memref<1024x1024xf32>
+// MULTI-NEXT:                    load %arg1[%i8, %i7] : memref<1024x1024xf32>
+
+// -----
+
+// The whole loop nest fits in the L1 cache: it isn't tiled.
+
+// MULTI-LABEL: func @multi_level_fits_in_cache
+func @multi_level_fits_in_cache(%A: memref<32x32xf32>) {
+  affine.for %i = 0 to 32 {
+    affine.for %j = 0 to 32 {
+      %a = load %A[%j, %i] : memref<32x32xf32>
+      store %a, %A[%i, %j] : memref<32x32xf32>
+    }
+  }
+  return
+}
+// MULTI:       affine.for %i0 = 0 to 32 {
+// MULTI-NEXT:    affine.for %i1 = 0 to 32 {
+// MULTI-NEXT:      load
+// MULTI-NEXT:      store
+// MULTI-NEXT:    }
+// MULTI-NEXT:  }
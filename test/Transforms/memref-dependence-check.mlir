@@ -1,4 +1,5 @@
 // RUN: mlir-opt %s -memref-dependence-check  -split-input-file -verify | FileCheck %s
+// RUN: mlir-opt %s -memref-dependence-check -affine-dependence-simplex -split-input-file -verify | FileCheck %s
 
 // -----
 
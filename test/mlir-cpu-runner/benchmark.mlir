@@ -0,0 +1,25 @@
+// RUN: mlir-cpu-runner -benchmark -benchmark-warmup=1 -benchmark-iterations=5 -random-seed=42 %s | FileCheck %s
+// RUN: mlir-cpu-runner -benchmark -benchmark-iterations=0 %s 2>&1 | FileCheck -check-prefix=ZERO %s
+
+func @main(%a : memref<16xf32>, %b : memref<16xf32>) {
+  affine.for %i = 0 to 16 {
+    %0 = load %a[%i] : memref<16xf32>
+    %1 = mulf %0, %0 : f32
+    store %1, %b[%i] : memref<16xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: {
+// CHECK-DAG:   "compile_ms":
+// CHECK-DAG:   "execution_ms": {
+// CHECK-DAG:     "median":
+// CHECK-DAG:     "min":
+// CHECK-DAG:     "p99":
+// CHECK-DAG:     "stddev":
+// CHECK-DAG:   "function": "main"
+// CHECK-DAG:   "iterations": 5
+// CHECK-DAG:   "seed": 42
+// CHECK-DAG:   "warmup_iterations": 1
+
+// ZERO: Error: -benchmark-iterations must be positive
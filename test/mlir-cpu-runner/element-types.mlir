@@ -0,0 +1,34 @@
+// RUN: mlir-cpu-runner -e int32 -init-value 5 %s | FileCheck -check-prefix=INT32 %s
+// RUN: mlir-cpu-runner -e int8 -init-value 100 %s | FileCheck -check-prefix=INT8 %s
+// RUN: mlir-cpu-runner -e float64 -init-value 1.5 %s | FileCheck -check-prefix=FLOAT64 %s
+
+func @int32(%a : memref<2xi32>) {
+  %c1 = constant 1 : index
+  %0 = constant 37 : i32
+  %1 = load %a[%c1] : memref<2xi32>
+  %2 = addi %1, %0 : i32
+  store %2, %a[%c1] : memref<2xi32>
+  return
+}
+// INT32: 5 42
+
+func @int8(%a : memref<3xi8>) {
+  %c2 = constant 2 : index
+  %0 = constant 27 : i8
+  %1 = load %a[%c2] : memref<3xi8>
+  %2 = addi %1, %0 : i8
+  store %2, %a[%c2] : memref<3xi8>
+  return
+}
+// INT8: 100 100 127
+
+func @float64(%a : memref<1xf64>, %b : memref<1xf64>) {
+  %c0 = constant 0 : index
+  %0 = constant 2.0 : f64
+  %1 = load %a[%c0] : memref<1xf64>
+  %2 = mulf %1, %0 : f64
+  store %2, %b[%c0] : memref<1xf64>
+  return
+}
+// FLOAT64: 1.500000e+00
+// FLOAT64-NEXT: 3.000000e+00
@@ -0,0 +1,18 @@
+// RUN: rm -rf %t
+// RUN: mlir-cpu-runner %s -object-cache-dir=%t 2>&1 | FileCheck %s --check-prefix=MISS
+// RUN: mlir-cpu-runner %s -object-cache-dir=%t 2>&1 | FileCheck %s --check-prefix=HIT
+// RUN: mlir-cpu-runner %s -O3 -object-cache-dir=%t 2>&1 | FileCheck %s --check-prefix=MISS
+// RUN: mlir-cpu-runner %s -O3 -object-cache-dir=%t 2>&1 | FileCheck %s --check-prefix=HIT
+
+func @main(%a : memref<2xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %0 = constant 42.0 : f32
+  store %0, %a[%c1] : memref<2xf32>
+  return
+}
+// The cached object computes the same result.
+// MISS: 0.000000e+00 4.200000e+01
+// MISS: object cache: 0 hits, 1 misses
+// HIT: 0.000000e+00 4.200000e+01
+// HIT: object cache: 1 hits, 0 misses
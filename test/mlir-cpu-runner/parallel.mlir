@@ -0,0 +1,13 @@
+// RUN: mlir-opt %s -affine-parallelize -parallel-grain-size=1 -parallel-chunk-size=3 | mlir-cpu-runner -e scale -init-value 2 | FileCheck %s
+// RUN: mlir-opt %s -affine-parallelize -parallel-grain-size=1 -parallel-schedule=dynamic | mlir-cpu-runner -e scale -init-value 2 | FileCheck %s
+
+func @scale(%a : memref<16xf32>) {
+  %0 = constant 3.0 : f32
+  affine.for %i = 0 to 16 step 2 {
+    %1 = load %a[%i] : memref<16xf32>
+    %2 = mulf %1, %0 : f32
+    store %2, %a[%i] : memref<16xf32>
+  }
+  return
+}
+// CHECK: 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00 6.000000e+00 2.000000e+00
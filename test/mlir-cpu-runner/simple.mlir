@@ -3,6 +3,9 @@
 // RUN: mlir-cpu-runner %s -O3 | FileCheck %s
 // RUN: mlir-cpu-runner %s -O3 -loop-distribute -loop-vectorize | FileCheck %s
 // RUN: mlir-cpu-runner %s -loop-distribute -loop-vectorize | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -compile-threads=4 | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -lazy-compile | FileCheck %s
+// RUN: mlir-cpu-runner -e foo -init-value 1000 -compile-threads=2 -lazy-compile %s | FileCheck -check-prefix=NOMAIN %s
 
 func @fabsf(f32) -> f32
 
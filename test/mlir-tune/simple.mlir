@@ -0,0 +1,35 @@
+// RUN: mlir-tune %s -affine-loop-tile -tune-param=tile-size=2,4 -tune-param=tile-sizes=1:2,8:8 -tune-db=%t.json | FileCheck %s
+// RUN: FileCheck --check-prefix=DB %s < %t.json
+// RUN: not mlir-tune %s -tune-param=no-such-option=1 2>&1 | FileCheck --check-prefix=UNKNOWN %s
+
+func @main(%A: memref<16x16xf32>, %B: memref<16x16xf32>, %C: memref<16x16xf32>) {
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      affine.for %k = 0 to 16 {
+        %a = load %A[%i, %k] : memref<16x16xf32>
+        %b = load %B[%k, %j] : memref<16x16xf32>
+        %c = load %C[%i, %j] : memref<16x16xf32>
+        %p = mulf %a, %b : f32
+        %s = addf %c, %p : f32
+        store %s, %C[%i, %j] : memref<16x16xf32>
+      }
+    }
+  }
+  return
+}
+
+// Every combination of the candidate values is timed.
+// CHECK: tile-size=2 tile-sizes=1:2 {{[0-9.]+}} ms
+// CHECK-NEXT: tile-size=4 tile-sizes=1:2 {{[0-9.]+}} ms
+// CHECK-NEXT: tile-size=2 tile-sizes=8:8 {{[0-9.]+}} ms
+// CHECK-NEXT: tile-size=4 tile-sizes=8:8 {{[0-9.]+}} ms
+// CHECK-NEXT: best: tile-size={{[24]}} tile-sizes={{1:2|8:8}} {{[0-9.]+}} ms
+
+// DB:      "function": "main",
+// DB-NEXT: "options": {
+// DB-NEXT:   "tile-size": "{{[24]}}",
+// DB-NEXT:   "tile-sizes": "{{1:2|8:8}}"
+// DB-NEXT: },
+// DB-NEXT: "time_ms":
+
+// UNKNOWN: Error: unknown option 'no-such-option' in -tune-param
@@ -22,6 +22,7 @@
 
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/ExecutionEngine/ObjectCache.h"
 #include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
@@ -35,13 +36,26 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <numeric>
+#include <random>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace mlir;
 using llvm::Error;
@@ -56,6 +70,51 @@ static llvm::cl::opt<std::string>
     mainFuncName("e", llvm::cl::desc("The function to be called"),
                  llvm::cl::value_desc("<function name>"),
                  llvm::cl::init("main"));
+static llvm::cl::opt<std::string> objectCacheDir(
+    "object-cache-dir",
+    llvm::cl::desc("Cache the compiled objects in this directory, and report "
+                   "the cache hits and misses"),
+    llvm::cl::value_desc("<directory>"));
+static llvm::cl::opt<unsigned> compileThreads(
+    "compile-threads",
+    llvm::cl::desc("Translate the module into this many LLVM modules, and "
+                   "compile them concurrently on this many threads"),
+    llvm::cl::init(0));
+static llvm::cl::opt<bool> lazyCompile(
+    "lazy-compile",
+    llvm::cl::desc("Split the module per function and only compile the "
+                   "functions reachable from the entry point"),
+    llvm::cl::init(false));
+static llvm::cl::opt<unsigned> randomSeed(
+    "random-seed",
+    llvm::cl::desc("Fill the memref arguments with pseudo-random values "
+                   "generated from this seed instead of -init-value"),
+    llvm::cl::value_desc("<seed>"));
+
+static llvm::cl::OptionCategory benchmarkFlags("benchmark flags");
+
+static llvm::cl::opt<bool> benchmark(
+    "benchmark",
+    llvm::cl::desc("Time repeated calls of the entry point and print a JSON "
+                   "report instead of the memref arguments"),
+    llvm::cl::init(false), llvm::cl::cat(benchmarkFlags));
+static llvm::cl::opt<unsigned> benchmarkWarmup(
+    "benchmark-warmup",
+    llvm::cl::desc("Number of untimed calls before the timed ones"),
+    llvm::cl::init(3), llvm::cl::cat(benchmarkFlags));
+static llvm::cl::opt<unsigned>
+    benchmarkIterations("benchmark-iterations",
+                        llvm::cl::desc("Number of timed calls"),
+                        llvm::cl::init(10), llvm::cl::cat(benchmarkFlags));
+static llvm::cl::opt<bool> benchmarkPerfCounters(
+    "benchmark-perf-counters",
+    llvm::cl::desc("Also report hardware performance counters per call, "
+                   "where perf_event_open is available"),
+    llvm::cl::init(false), llvm::cl::cat(benchmarkFlags));
+static llvm::cl::opt<std::string> benchmarkOutput(
+    "benchmark-output", llvm::cl::desc("File to write the JSON report to"),
+    llvm::cl::value_desc("filename"), llvm::cl::init("-"),
+    llvm::cl::cat(benchmarkFlags));
 
 static llvm::cl::OptionCategory optFlags("opt-like flags");
 
@@ -100,14 +159,36 @@ static inline Error make_string_error(const llvm::Twine &message) {
                                              llvm::inconvertibleErrorCode());
 }
 
+template <typename T> static void printElements(void *data, int64_t size) {
+  for (int64_t i = 0; i < size; ++i) {
+    // Promote the elements so that 8-bit integers aren't printed as characters.
+    llvm::outs() << +static_cast<T *>(data)[i] << ' ';
+  }
+}
+
 static void printOneMemRef(Type t, void *val) {
   auto memRefType = t.cast<MemRefType>();
   auto shape = memRefType.getShape();
   int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
                                  std::multiplies<int64_t>());
-  for (int64_t i = 0; i < size; ++i) {
-    llvm::outs() << reinterpret_cast<StaticFloatMemRef *>(val)->data[i] << ' ';
-  }
+  auto elementType = memRefType.getElementType();
+  void *data = *reinterpret_cast<void **>(val);
+  if (elementType.isF32())
+    printElements<float>(data, size);
+  else if (elementType.isF64())
+    printElements<double>(data, size);
+  else if (elementType.isIndex())
+    printElements<int64_t>(data, size);
+  else if (elementType.isInteger(1) || elementType.isInteger(8))
+    printElements<int8_t>(data, size);
+  else if (elementType.isInteger(16))
+    printElements<int16_t>(data, size);
+  else if (elementType.isInteger(32))
+    printElements<int32_t>(data, size);
+  else if (elementType.isInteger(64))
+    printElements<int64_t>(data, size);
+  else
+    llvm::outs() << "<unprintable element type>";
   llvm::outs() << '\n';
 }
 
@@ -129,9 +210,199 @@ static void printMemRefArguments(ArrayRef<Type> argTypes,
   }
 }
 
+template <typename T, typename Distribution>
+static void fillRandom(void *data, int64_t size, std::mt19937_64 &generator,
+                       Distribution distribution) {
+  for (int64_t i = 0; i < size; ++i)
+    static_cast<T *>(data)[i] = static_cast<T>(distribution(generator));
+}
+
+// Fills the data of the memref arguments with pseudo-random values: floats in
+// [-1, 1), booleans, and other integers in [0, 100).
+static void randomizeMemRefArguments(ArrayRef<Type> argTypes,
+                                     ArrayRef<void *> args, unsigned seed) {
+  std::mt19937_64 generator(seed);
+  std::uniform_real_distribution<double> floats(-1.0, 1.0);
+  std::uniform_int_distribution<int64_t> integers(0, 99);
+  std::uniform_int_distribution<int64_t> booleans(0, 1);
+  for (const auto &kvp : llvm::zip(argTypes, args)) {
+    auto memRefType = std::get<0>(kvp).cast<MemRefType>();
+    void *data = *reinterpret_cast<void **>(std::get<1>(kvp));
+    auto shape = memRefType.getShape();
+    int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                   std::multiplies<int64_t>());
+    auto elementType = memRefType.getElementType();
+    if (elementType.isF32())
+      fillRandom<float>(data, size, generator, floats);
+    else if (elementType.isF64())
+      fillRandom<double>(data, size, generator, floats);
+    else if (elementType.isInteger(1))
+      fillRandom<int8_t>(data, size, generator, booleans);
+    else if (elementType.isInteger(8))
+      fillRandom<int8_t>(data, size, generator, integers);
+    else if (elementType.isInteger(16))
+      fillRandom<int16_t>(data, size, generator, integers);
+    else if (elementType.isInteger(32))
+      fillRandom<int32_t>(data, size, generator, integers);
+    else if (elementType.isInteger(64) || elementType.isIndex())
+      fillRandom<int64_t>(data, size, generator, integers);
+  }
+}
+
+namespace {
+/// Hardware performance counters of the current thread, read through
+/// perf_event_open. Counters that can't be opened, e.g. because of the
+/// permissions of the process, are left out of the report.
+class PerfCounters {
+public:
+  PerfCounters() {
+#ifdef __linux__
+    const std::pair<const char *, uint64_t> events[] = {
+        {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+        {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES}};
+    for (const auto &event : events) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = event.second;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = syscall(__NR_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1,
+                       /*group_fd=*/-1, /*flags=*/0);
+      if (fd >= 0)
+        counters.push_back({event.first, fd});
+    }
+#endif
+  }
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (const auto &counter : counters)
+      close(counter.second);
+#endif
+  }
+
+  bool empty() const { return counters.empty(); }
+
+  /// Resets and starts all the counters.
+  void start() {
+#ifdef __linux__
+    for (const auto &counter : counters) {
+      ioctl(counter.second, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counter.second, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /// Stops all the counters.
+  void stop() {
+#ifdef __linux__
+    for (const auto &counter : counters)
+      ioctl(counter.second, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+  }
+
+  /// Returns the values of the counters divided by 'divisor'.
+  llvm::json::Object read(unsigned divisor) const {
+    llvm::json::Object values;
+#ifdef __linux__
+    for (const auto &counter : counters) {
+      uint64_t value;
+      if (::read(counter.second, &value, sizeof(value)) == sizeof(value))
+        values[counter.first] = static_cast<double>(value) / divisor;
+    }
+#endif
+    return values;
+  }
+
+private:
+  /// The name and file descriptor of each open counter.
+  SmallVector<std::pair<const char *, int>, 4> counters;
+};
+} // end anonymous namespace
+
+// Returns the statistics of the durations 'times', in milliseconds.
+static llvm::json::Object getStatistics(std::vector<double> times) {
+  std::sort(times.begin(), times.end());
+  double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+  double variance = 0.0;
+  for (double time : times)
+    variance += (time - mean) * (time - mean);
+  variance /= times.size();
+  // The median and p99 are nearest-rank percentiles.
+  auto percentile = [&](double p) {
+    size_t rank = std::ceil(p * times.size());
+    return times[std::max<size_t>(rank, 1) - 1];
+  };
+  return llvm::json::Object{{"min", times.front()},
+                            {"median", percentile(0.5)},
+                            {"p99", percentile(0.99)},
+                            {"mean", mean},
+                            {"stddev", std::sqrt(variance)}};
+}
+
+// Calls 'fptr' on 'args' repeatedly and writes a JSON report of the call times
+// and of 'compileMillis', the time it took to JIT-compile the module.
+static Error runBenchmark(StringRef entryPoint, void (*fptr)(void **),
+                          MutableArrayRef<void *> args, double compileMillis) {
+  if (benchmarkIterations == 0)
+    return make_string_error("-benchmark-iterations must be positive");
+
+  for (unsigned i = 0; i < benchmarkWarmup; ++i)
+    (*fptr)(args.data());
+
+  std::vector<double> times;
+  times.reserve(benchmarkIterations);
+  for (unsigned i = 0; i < benchmarkIterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    (*fptr)(args.data());
+    auto end = std::chrono::steady_clock::now();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  llvm::json::Object report{
+      {"function", entryPoint},
+      {"compile_ms", compileMillis},
+      {"warmup_iterations", static_cast<int64_t>(benchmarkWarmup)},
+      {"iterations", static_cast<int64_t>(benchmarkIterations)},
+      {"execution_ms", getStatistics(std::move(times))}};
+  if (randomSeed.getNumOccurrences())
+    report["seed"] = static_cast<int64_t>(randomSeed);
+
+  // The counters are measured on separate calls, so that reading them doesn't
+  // perturb the timings.
+  if (benchmarkPerfCounters) {
+    PerfCounters counters;
+    if (counters.empty()) {
+      llvm::errs() << "warning: no hardware performance counter available\n";
+    } else {
+      counters.start();
+      for (unsigned i = 0; i < benchmarkIterations; ++i)
+        (*fptr)(args.data());
+      counters.stop();
+      report["perf_counters"] = counters.read(benchmarkIterations);
+    }
+  }
+
+  std::string errorMessage;
+  auto output = openOutputFile(benchmarkOutput, &errorMessage);
+  if (!output)
+    return make_string_error(errorMessage);
+  output->os() << llvm::formatv("{0:2}", llvm::json::Value(std::move(report)))
+               << '\n';
+  output->keep();
+  return Error::success();
+}
+
 static Error
 compileAndExecute(Module *module, StringRef entryPoint,
-                  std::function<llvm::Error(llvm::Module *)> transformer) {
+                  std::function<llvm::Error(llvm::Module *)> transformer,
+                  OnDiskObjectCache *cache) {
   Function *mainFunction = module->getNamedFunction(entryPoint);
   if (!mainFunction || mainFunction->getBlocks().empty()) {
     return make_string_error("entry point not found");
@@ -151,7 +422,15 @@ compileAndExecute(Module *module, StringRef entryPoint,
   if (!expectedArguments)
     return expectedArguments.takeError();
 
-  auto expectedEngine = mlir::ExecutionEngine::create(module, transformer);
+  if (randomSeed.getNumOccurrences())
+    randomizeMemRefArguments(argTypes, *expectedArguments, randomSeed);
+
+  // The compile time includes the lowering to LLVM IR. With -lazy-compile,
+  // the partitions reachable from the entry point are compiled by its lookup,
+  // which is timed as well; the other partitions are never compiled.
+  auto compileStart = std::chrono::steady_clock::now();
+  auto expectedEngine = mlir::ExecutionEngine::create(
+      module, transformer, cache, compileThreads, lazyCompile);
   if (!expectedEngine)
     return expectedEngine.takeError();
 
@@ -159,7 +438,18 @@ compileAndExecute(Module *module, StringRef entryPoint,
   auto expectedFPtr = engine->lookup(entryPoint);
   if (!expectedFPtr)
     return expectedFPtr.takeError();
+  auto compileEnd = std::chrono::steady_clock::now();
   void (*fptr)(void **) = *expectedFPtr;
+
+  if (benchmark) {
+    auto error = runBenchmark(
+        entryPoint, fptr, *expectedArguments,
+        std::chrono::duration<double, std::milli>(compileEnd - compileStart)
+            .count());
+    freeMemRefArguments(*expectedArguments);
+    return error;
+  }
+
   (*fptr)(expectedArguments->data());
   printMemRefArguments(argTypes, resTypes, *expectedArguments);
   freeMemRefArguments(*expectedArguments);
@@ -212,7 +502,26 @@ int main(int argc, char **argv) {
 
   auto transformer =
       mlir::makeLLVMPassesTransformer(passes, optLevel, optPosition);
-  auto error = compileAndExecute(m.get(), mainFuncName.getValue(), transformer);
+
+  // The LLVM passes are part of the keys of the cached objects.
+  std::unique_ptr<OnDiskObjectCache> cache;
+  if (!objectCacheDir.empty()) {
+    std::string compileOptions;
+    llvm::raw_string_ostream os(compileOptions);
+    for (unsigned i = 0, e = passes.size(); i <= e; ++i) {
+      if (optLevel && i == optPosition)
+        os << "-O" << *optLevel << ' ';
+      if (i < e)
+        os << '-' << passes[i]->getPassArgument() << ' ';
+    }
+    cache = llvm::make_unique<OnDiskObjectCache>(objectCacheDir, os.str());
+  }
+
+  auto error = compileAndExecute(m.get(), mainFuncName.getValue(), transformer,
+                                 cache.get());
+  if (cache)
+    llvm::errs() << "object cache: " << cache->getNumHits() << " hits, "
+                 << cache->getNumMisses() << " misses\n";
   int exitCode = EXIT_SUCCESS;
   llvm::handleAllErrors(std::move(error),
                         [&exitCode](const llvm::ErrorInfoBase &info) {
@@ -22,6 +22,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Analysis/Passes.h"
+#include "mlir/Bytecode/Bytecode.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Function.h"
@@ -69,6 +70,11 @@ static cl::opt<bool>
                  cl::desc("Run the verifier after each transformation pass"),
                  cl::init(true));
 
+static cl::opt<bool>
+    emitBytecode("emit-bytecode",
+                 cl::desc("Write the output in the MLIR bytecode format"),
+                 cl::init(false));
+
 static std::vector<const mlir::PassRegistryEntry *> *passList;
 
 enum OptResult { OptSuccess, OptFailure };
@@ -119,10 +125,17 @@ static SMLoc getLocFromLineAndCol(MemoryBuffer &membuf, unsigned lineNo,
 /// within the specified context.
 ///
 /// This typically parses the main source file, runs zero or more optimization
-/// passes, then prints the output.
+/// passes, then prints the output.  The main source file may either be in the
+/// textual or in the bytecode format.
 ///
 static OptResult performActions(SourceMgr &sourceMgr, MLIRContext *context) {
-  std::unique_ptr<Module> module(parseSourceFile(sourceMgr, context));
+  std::unique_ptr<Module> module;
+  StringRef buffer =
+      sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBuffer();
+  if (isBytecode(buffer))
+    module.reset(readBytecode(buffer, context));
+  else
+    module.reset(parseSourceFile(sourceMgr, context));
   if (!module)
     return OptFailure;
 
@@ -146,7 +159,10 @@ static OptResult performActions(SourceMgr &sourceMgr, MLIRContext *context) {
   }
 
   // Print the output.
-  module->print(output->os());
+  if (emitBytecode)
+    writeBytecode(module.get(), output->os());
+  else
+    module->print(output->os());
   output->keep();
   return OptSuccess;
 }
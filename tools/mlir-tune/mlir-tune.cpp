@@ -0,0 +1,370 @@
+//===- mlir-tune.cpp - MLIR Autotuning Driver -----------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This is a command line utility that searches for the values of pass options,
+// e.g. tile sizes or unroll factors, that make a function run the fastest. The
+// input module is parsed once. For each combination of the candidate values, a
+// copy of the module goes through the pass pipeline and is JIT-compiled and
+// timed like in mlir-cpu-runner. The best configuration can be recorded in a
+// tuning database keyed by the hash of the function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Transforms/Utils.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include <chrono>
+#include <limits>
+
+using namespace mlir;
+using llvm::Error;
+using llvm::Expected;
+
+static llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional,
+                                                llvm::cl::desc("<input file>"),
+                                                llvm::cl::init("-"));
+static llvm::cl::opt<std::string>
+    initValue("init-value", llvm::cl::desc("Initial value of MemRef elements"),
+              llvm::cl::value_desc("<float value>"), llvm::cl::init("0.0"));
+static llvm::cl::opt<std::string>
+    mainFuncName("e", llvm::cl::desc("The function to be tuned"),
+                 llvm::cl::value_desc("<function name>"),
+                 llvm::cl::init("main"));
+
+static llvm::cl::OptionCategory tuneFlags("tuning flags");
+
+static llvm::cl::list<std::string> tuneParams(
+    "tune-param",
+    llvm::cl::desc("A pass option to tune with its candidate values, as "
+                   "<option>=<value>[,<value>...]; the elements of a value "
+                   "of a list option are separated by ':'"),
+    llvm::cl::ZeroOrMore, llvm::cl::cat(tuneFlags));
+static llvm::cl::opt<unsigned> numRepetitions(
+    "tune-repetitions",
+    llvm::cl::desc("Number of timed runs of each candidate, of which the "
+                   "fastest is kept"),
+    llvm::cl::init(3), llvm::cl::cat(tuneFlags));
+static llvm::cl::opt<std::string>
+    tuningDatabase("tune-db",
+                   llvm::cl::desc("Tuning database to record the best "
+                                  "configuration in"),
+                   llvm::cl::value_desc("filename"), llvm::cl::cat(tuneFlags));
+static llvm::cl::opt<unsigned>
+    llvmOptLevel("llvm-opt-level",
+                 llvm::cl::desc("Optimization level of the LLVM passes run on "
+                                "each candidate"),
+                 llvm::cl::init(3), llvm::cl::cat(tuneFlags));
+
+namespace {
+/// A pass option to tune, and the values to try for it.
+struct TuningParameter {
+  llvm::cl::Option *option;
+  SmallVector<std::string, 4> values;
+};
+} // end anonymous namespace
+
+static inline Error make_string_error(const llvm::Twine &message) {
+  return llvm::make_error<llvm::StringError>(message.str(),
+                                             llvm::inconvertibleErrorCode());
+}
+
+// Parses the -tune-param options into 'params'.
+static Error parseTuningParameters(std::vector<TuningParameter> *params) {
+  auto &registeredOptions = llvm::cl::getRegisteredOptions();
+  for (StringRef param : tuneParams) {
+    StringRef name, values;
+    std::tie(name, values) = param.split('=');
+    auto it = registeredOptions.find(name);
+    if (it == registeredOptions.end())
+      return make_string_error("unknown option '" + name + "' in -tune-param");
+    if (values.empty())
+      return make_string_error("no values to try for option '" + name + "'");
+
+    TuningParameter tuningParam;
+    tuningParam.option = it->second;
+    SmallVector<StringRef, 4> splitValues;
+    values.split(splitValues, ',');
+    for (auto value : splitValues)
+      tuningParam.values.push_back(value.str());
+    params->push_back(std::move(tuningParam));
+  }
+  return Error::success();
+}
+
+// Sets 'option' to 'value' as if it was the only occurrence of the option on
+// the command line. A value of a list option is split into its elements.
+static Error setOptionValue(llvm::cl::Option *option, StringRef value) {
+  option->reset();
+  SmallVector<StringRef, 4> elements;
+  auto flag = option->getNumOccurrencesFlag();
+  if (flag == llvm::cl::ZeroOrMore || flag == llvm::cl::OneOrMore)
+    value.split(elements, ':');
+  else
+    elements.push_back(value);
+  for (auto element : elements)
+    if (option->addOccurrence(/*pos=*/0, option->ArgStr, element))
+      return make_string_error("invalid value '" + value + "' for option '" +
+                               option->ArgStr + "'");
+  return Error::success();
+}
+
+// Returns the key of 'function' in the tuning database: the MD5 hash of its
+// textual form.
+static std::string getFunctionHash(Function *function) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  function->print(os);
+  llvm::MD5 hasher;
+  hasher.update(os.str());
+  llvm::MD5::MD5Result result;
+  hasher.final(result);
+  llvm::SmallString<32> digest = result.digest();
+  return digest.str().str();
+}
+
+// Returns a copy of 'module' whose function attributes refer to the copied
+// functions.
+static std::unique_ptr<Module> cloneModule(Module *module) {
+  MLIRContext *context = module->getContext();
+  auto clone = llvm::make_unique<Module>(context);
+  DenseMap<Attribute, FunctionAttr> remappingTable;
+  for (auto &function : *module) {
+    Function *functionClone = function.clone();
+    clone->getFunctions().push_back(functionClone);
+    remappingTable[FunctionAttr::get(&function, context)] =
+        FunctionAttr::get(functionClone, context);
+  }
+  remapFunctionAttrs(*clone, remappingTable);
+  return clone;
+}
+
+// Applies the pass pipeline to a copy of 'module', JIT-compiles the result and
+// returns the time in seconds of the fastest of the runs of the entry point.
+static Expected<double>
+compileAndTime(Module *module, ArrayRef<const PassRegistryEntry *> passes,
+               std::function<llvm::Error(llvm::Module *)> transformer) {
+  auto candidate = cloneModule(module);
+  PassManager pm;
+  for (const auto *passEntry : passes)
+    passEntry->addToPipeline(pm);
+  if (failed(pm.run(candidate.get())))
+    return make_string_error("passes failed");
+
+  // The arguments are allocated before the function is lowered to the LLVM
+  // dialect, which changes its signature.
+  Function *mainFunction = candidate->getNamedFunction(mainFuncName);
+  float init = std::stof(initValue.getValue());
+  auto expectedArguments = allocateMemRefArguments(mainFunction, init);
+  if (!expectedArguments)
+    return expectedArguments.takeError();
+
+  auto expectedEngine =
+      mlir::ExecutionEngine::create(candidate.get(), transformer);
+  if (!expectedEngine) {
+    freeMemRefArguments(*expectedArguments);
+    return expectedEngine.takeError();
+  }
+  auto engine = std::move(*expectedEngine);
+  auto expectedFPtr = engine->lookup(mainFuncName);
+  if (!expectedFPtr) {
+    freeMemRefArguments(*expectedArguments);
+    return expectedFPtr.takeError();
+  }
+  void (*fptr)(void **) = *expectedFPtr;
+
+  double bestSeconds = std::numeric_limits<double>::infinity();
+  for (unsigned i = 0; i < numRepetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    (*fptr)(expectedArguments->data());
+    auto end = std::chrono::steady_clock::now();
+    bestSeconds = std::min(
+        bestSeconds, std::chrono::duration<double>(end - start).count());
+  }
+  freeMemRefArguments(*expectedArguments);
+  return bestSeconds;
+}
+
+// Records the configuration 'config' of the function 'functionName' with hash
+// 'key' in the tuning database, replacing any previous entry for it.
+static Error
+updateTuningDatabase(StringRef filename, StringRef key,
+                     StringRef functionName,
+                     ArrayRef<std::pair<std::string, std::string>> config,
+                     double seconds) {
+  std::string errorMessage;
+  llvm::json::Object database;
+  if (llvm::sys::fs::exists(filename)) {
+    auto file = openInputFile(filename, &errorMessage);
+    if (!file)
+      return make_string_error(errorMessage);
+    auto expectedValue = llvm::json::parse(file->getBuffer());
+    if (!expectedValue)
+      return expectedValue.takeError();
+    auto *object = expectedValue->getAsObject();
+    if (!object)
+      return make_string_error("tuning database is not a JSON object");
+    database = std::move(*object);
+  }
+
+  llvm::json::Object options;
+  for (const auto &option : config)
+    options[option.first] = option.second;
+  database[key] = llvm::json::Object{{"function", functionName},
+                                     {"time_ms", seconds * 1e3},
+                                     {"options", std::move(options)}};
+
+  auto output = openOutputFile(filename, &errorMessage);
+  if (!output)
+    return make_string_error(errorMessage);
+  output->os() << llvm::formatv("{0:2}",
+                                llvm::json::Value(std::move(database)))
+               << '\n';
+  output->keep();
+  return Error::success();
+}
+
+static void printConfig(ArrayRef<std::pair<std::string, std::string>> config) {
+  for (const auto &option : config)
+    llvm::outs() << option.first << '=' << option.second << ' ';
+}
+
+// Tries every combination of the candidate values of the tuning parameters, and
+// reports the fastest one.
+static Error tune(Module *module, ArrayRef<const PassRegistryEntry *> passes) {
+  Function *mainFunction = module->getNamedFunction(mainFuncName);
+  if (!mainFunction || mainFunction->getBlocks().empty())
+    return make_string_error("entry point not found");
+  std::string key = getFunctionHash(mainFunction);
+
+  std::vector<TuningParameter> params;
+  if (auto err = parseTuningParameters(&params))
+    return err;
+
+  auto transformer = mlir::makeOptimizingTransformer(llvmOptLevel,
+                                                     /*sizeLevel=*/0);
+
+  // Enumerate the candidates with one counter per parameter.
+  SmallVector<unsigned, 4> positions(params.size(), 0);
+  std::vector<std::pair<std::string, std::string>> config, bestConfig;
+  double bestSeconds = std::numeric_limits<double>::infinity();
+  while (true) {
+    config.clear();
+    for (unsigned i = 0, e = params.size(); i < e; ++i) {
+      auto *option = params[i].option;
+      const auto &value = params[i].values[positions[i]];
+      if (auto err = setOptionValue(option, value))
+        return err;
+      config.emplace_back(option->ArgStr.str(), value);
+    }
+
+    printConfig(config);
+    auto expectedSeconds = compileAndTime(module, passes, transformer);
+    if (!expectedSeconds) {
+      llvm::outs() << "failed: " << llvm::toString(expectedSeconds.takeError())
+                   << '\n';
+    } else {
+      llvm::outs() << llvm::format("%.3f ms", *expectedSeconds * 1e3) << '\n';
+      if (*expectedSeconds < bestSeconds) {
+        bestSeconds = *expectedSeconds;
+        bestConfig = config;
+      }
+    }
+
+    // Move to the next candidate.
+    unsigned i = 0;
+    for (unsigned e = params.size(); i < e; ++i) {
+      if (++positions[i] < params[i].values.size())
+        break;
+      positions[i] = 0;
+    }
+    if (i == params.size())
+      break;
+  }
+
+  if (bestSeconds == std::numeric_limits<double>::infinity())
+    return make_string_error("no candidate could be run");
+  llvm::outs() << "best: ";
+  printConfig(bestConfig);
+  llvm::outs() << llvm::format("%.3f ms", bestSeconds * 1e3) << '\n';
+
+  if (tuningDatabase.empty())
+    return Error::success();
+  return updateTuningDatabase(tuningDatabase, key, mainFuncName, bestConfig,
+                              bestSeconds);
+}
+
+int main(int argc, char **argv) {
+  llvm::PrettyStackTraceProgram x(argc, argv);
+  llvm::InitLLVM y(argc, argv);
+
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  mlir::initializeLLVMPasses();
+
+  // Parse pass names in main to ensure static initialization completed.
+  llvm::cl::list<const mlir::PassRegistryEntry *, bool, PassNameParser>
+      passList("", llvm::cl::desc("Compiler passes to run"));
+  llvm::cl::ParseCommandLineOptions(argc, argv, "MLIR autotuning driver\n");
+
+  std::string errorMessage;
+  auto file = openInputFile(inputFilename, &errorMessage);
+  if (!file) {
+    llvm::errs() << errorMessage << "\n";
+    return EXIT_FAILURE;
+  }
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(file), llvm::SMLoc());
+  MLIRContext context;
+  std::unique_ptr<Module> m(parseSourceFile(sourceMgr, &context));
+  if (!m) {
+    llvm::errs() << "could not parse the input IR\n";
+    return EXIT_FAILURE;
+  }
+
+  SmallVector<const PassRegistryEntry *, 8> passes(passList.begin(),
+                                                   passList.end());
+  auto error = tune(m.get(), passes);
+  int exitCode = EXIT_SUCCESS;
+  llvm::handleAllErrors(std::move(error),
+                        [&exitCode](const llvm::ErrorInfoBase &info) {
+                          llvm::errs() << "Error: ";
+                          info.log(llvm::errs());
+                          llvm::errs() << '\n';
+                          exitCode = EXIT_FAILURE;
+                        });
+  return exitCode;
+}
@@ -0,0 +1,90 @@
+//===- AffineAnalysisTest.cpp - Affine dependence analysis unit tests -----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/StandardOps/Ops.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+
+// A store to %m[0, 10) followed by a load from %m[0, 10), in separate nests.
+const char *const kProducerConsumer = R"mlir(
+func @producer_consumer(%m : memref<20xf32>, %c : f32) {
+  affine.for %i = 0 to 10 {
+    store %c, %m[%i] : memref<20xf32>
+  }
+  affine.for %j = 0 to 10 {
+    %v = load %m[%j] : memref<20xf32>
+  }
+  return
+}
+)mlir";
+
+TEST(DependenceAnalysisTest, CachesAndInvalidates) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kProducerConsumer, &context));
+  ASSERT_TRUE(module);
+  Function &fn = module->getFunctions().front();
+
+  SmallVector<AffineForOp, 2> loops;
+  Operation *store = nullptr, *load = nullptr;
+  fn.walk([&](Operation *op) {
+    if (auto forOp = op->dyn_cast<AffineForOp>())
+      loops.push_back(forOp);
+    else if (op->isa<StoreOp>())
+      store = op;
+    else if (op->isa<LoadOp>())
+      load = op;
+  });
+  ASSERT_EQ(loops.size(), 2u);
+  ASSERT_TRUE(store && load);
+
+  // The load reads what the store wrote. The second query is a hit.
+  DependenceAnalysis analysis(&fn);
+  SmallVector<DependenceComponent, 2> components;
+  EXPECT_TRUE(analysis.checkDependence(store, load, 1, &components));
+  EXPECT_TRUE(analysis.checkDependence(store, load, 1, &components));
+  EXPECT_EQ(analysis.getNumHits(), 1u);
+  EXPECT_EQ(analysis.getNumMisses(), 1u);
+
+  // Move the stores to %m[10, 20). Until the nest is invalidated, the stale
+  // result is returned from the cache.
+  loops[0].setConstantLowerBound(10);
+  loops[0].setConstantUpperBound(20);
+  EXPECT_TRUE(analysis.checkDependence(store, load, 1, &components));
+  EXPECT_EQ(analysis.getNumHits(), 2u);
+
+  // Once invalidated, the dependence is checked again and is gone.
+  analysis.invalidate(loops[0].getOperation());
+  EXPECT_FALSE(analysis.checkDependence(store, load, 1, &components));
+  EXPECT_EQ(analysis.getNumHits(), 2u);
+  EXPECT_EQ(analysis.getNumMisses(), 2u);
+
+  // Invalidating an operation without accesses keeps the result of the pair.
+  analysis.invalidate(&fn.front().back());
+  EXPECT_FALSE(analysis.checkDependence(store, load, 1, &components));
+  EXPECT_EQ(analysis.getNumHits(), 3u);
+}
+
+} // end anonymous namespace
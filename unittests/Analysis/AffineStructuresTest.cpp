@@ -0,0 +1,469 @@
+//===- AffineStructuresTest.cpp - Affine constraint system unit tests -----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/Simplex.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <limits>
+
+using namespace mlir;
+
+namespace {
+using Engine = FlatAffineConstraints::Engine;
+
+/// A constraint system of the kind built by the dependence analysis, in the
+/// layout of FlatAffineConstraints.
+struct CorpusEntry {
+  const char *name;
+  unsigned numIds;
+  std::vector<std::vector<int64_t>> inequalities;
+  std::vector<std::vector<int64_t>> equalities;
+  /// Whether the system has no integer point.
+  bool integerEmpty;
+};
+
+FlatAffineConstraints makeConstraints(const CorpusEntry &entry) {
+  FlatAffineConstraints cst(entry.numIds);
+  for (const auto &ineq : entry.inequalities)
+    cst.addInequality(ineq);
+  for (const auto &eq : entry.equalities)
+    cst.addEquality(eq);
+  return cst;
+}
+
+/// Dependence systems between the accesses of loop nests tiled by 32, as
+/// checked when fusing them. The identifiers are the tile and intra-tile
+/// induction variables of the source and destination accesses.
+const std::vector<CorpusEntry> &getCorpus() {
+  static const std::vector<CorpusEntry> corpus = {
+      // A[i] written, A[j] read with j == i + 1 in the same tile t < 8.
+      {"same-tile-shift",
+       3,
+       {{1, 0, 0, 0},
+        {-1, 0, 0, 7},
+        {-32, 1, 0, 0},
+        {32, -1, 0, 31},
+        {-32, 0, 1, 0},
+        {32, 0, -1, 31}},
+       {{0, -1, 1, -1}},
+       false},
+      // The same accesses, with j == i + 32: no dependence within a tile.
+      {"same-tile-cross",
+       3,
+       {{1, 0, 0, 0},
+        {-1, 0, 0, 7},
+        {-32, 1, 0, 0},
+        {32, -1, 0, 31},
+        {-32, 0, 1, 0},
+        {32, 0, -1, 31}},
+       {{0, -1, 1, -32}},
+       true},
+      // A[3 * i] written, A[3 * j + 1] or A[3 * j + 2] read: the accesses never
+      // overlap, but the system has rational points.
+      {"strided-gap",
+       2,
+       {{1, 0, 0},
+        {-1, 0, 127},
+        {0, 1, 0},
+        {0, -1, 127},
+        {3, -3, -1},
+        {-3, 3, 2}},
+       {},
+       true},
+      // A 2-d nest tiled in both dimensions, where the destination reads
+      // A[i - 1][j + 1] in the tile (ti, tj) of the source.
+      {"2d-tile-skew",
+       6,
+       {{1, 0, 0, 0, 0, 0, 0},
+        {-1, 0, 0, 0, 0, 0, 3},
+        {0, 1, 0, 0, 0, 0, 0},
+        {0, -1, 0, 0, 0, 0, 3},
+        {-32, 0, 1, 0, 0, 0, 0},
+        {32, 0, -1, 0, 0, 0, 31},
+        {0, -32, 0, 1, 0, 0, 0},
+        {0, 32, 0, -1, 0, 0, 31},
+        {-32, 0, 0, 0, 1, 0, 0},
+        {32, 0, 0, 0, -1, 0, 31},
+        {0, -32, 0, 0, 0, 1, 0},
+        {0, 32, 0, 0, 0, -1, 31}},
+       {{0, 0, 1, 0, -1, 0, -1}, {0, 0, 0, 1, 0, -1, 1}},
+       false},
+      // The same nest where the source must also execute before the
+      // destination in the intra-tile order, i.e. i < i' - 1: empty.
+      {"2d-tile-ordered",
+       6,
+       {{1, 0, 0, 0, 0, 0, 0},
+        {-1, 0, 0, 0, 0, 0, 3},
+        {0, 1, 0, 0, 0, 0, 0},
+        {0, -1, 0, 0, 0, 0, 3},
+        {-32, 0, 1, 0, 0, 0, 0},
+        {32, 0, -1, 0, 0, 0, 31},
+        {0, -32, 0, 1, 0, 0, 0},
+        {0, 32, 0, -1, 0, 0, 31},
+        {-32, 0, 0, 0, 1, 0, 0},
+        {32, 0, 0, 0, -1, 0, 31},
+        {0, -32, 0, 0, 0, 1, 0},
+        {0, 32, 0, 0, 0, -1, 31},
+        {0, 0, -1, 0, 1, 0, -2}},
+       {{0, 0, 1, 0, -1, 0, -1}, {0, 0, 0, 1, 0, -1, 1}},
+       true},
+      // A symbolic upper bound N >= 1 with 0 <= i < N and j == i: unbounded,
+      // but not empty.
+      {"symbolic-bound",
+       3,
+       {{1, 0, 0, -1}, {0, 1, 0, 0}, {1, -1, 0, -1}},
+       {{0, 1, -1, 0}},
+       false},
+      // A tile of 2 points whose origin is 4 * t + 2, accessed at 4 * k: the
+      // origin offset makes the tile miss every access.
+      {"tile-offset",
+       3,
+       {{1, 0, 0, 0}, {-1, 0, 0, 15}, {-4, 1, 0, -2}, {4, -1, 0, 3}},
+       {{0, 1, -4, 0}},
+       true},
+  };
+  return corpus;
+}
+
+TEST(SimplexTest, RationalEmptiness) {
+  // x >= 2 and x <= 1.
+  Simplex simplex(1);
+  simplex.addInequality({1, -2});
+  EXPECT_FALSE(simplex.isEmpty());
+  simplex.addInequality({-1, 1});
+  EXPECT_TRUE(simplex.isEmpty());
+}
+
+TEST(SimplexTest, IntegerEmptiness) {
+  // 1 <= 2x <= 1 has a rational point but no integer one.
+  Simplex simplex(1);
+  simplex.addInequality({2, -1});
+  simplex.addInequality({-2, 1});
+  EXPECT_FALSE(simplex.isEmpty());
+  Optional<bool> result = simplex.isIntegerEmpty();
+  ASSERT_TRUE(result.hasValue());
+  EXPECT_TRUE(*result);
+
+  // 0 <= 2x <= 1 has the integer point x = 0.
+  Simplex nonEmpty(1);
+  nonEmpty.addInequality({2, 0});
+  nonEmpty.addInequality({-2, 1});
+  SmallVector<int64_t, 1> sample;
+  result = nonEmpty.isIntegerEmpty(Simplex::kDefaultMaxBranches, &sample);
+  ASSERT_TRUE(result.hasValue());
+  EXPECT_FALSE(*result);
+  ASSERT_EQ(sample.size(), 1u);
+  EXPECT_EQ(sample[0], 0);
+}
+
+TEST(SimplexTest, MostNegativeCoefficient) {
+  // -2^63 x - 1 >= 0: the row must be pivoted, which negates the coefficient.
+  // It has no positive counterpart, so this overflows.
+  Simplex simplex(1);
+  simplex.addInequality({std::numeric_limits<int64_t>::min(), -1});
+  EXPECT_TRUE(simplex.hasOverflowed());
+  EXPECT_FALSE(simplex.isEmpty());
+  EXPECT_FALSE(simplex.isIntegerEmpty().hasValue());
+}
+
+TEST(SimplexTest, ComputeOptimum) {
+  // 0 <= x, 0 <= y and 2x + 3y <= 7.
+  Simplex simplex(2);
+  simplex.addInequality({1, 0, 0});
+  simplex.addInequality({0, 1, 0});
+  simplex.addInequality({-2, -3, 7});
+
+  Optional<Simplex::Fraction> max =
+      simplex.computeOptimum(Simplex::Direction::Up, {1, 1, 0});
+  ASSERT_TRUE(max.hasValue());
+  EXPECT_EQ(max->num, 7);
+  EXPECT_EQ(max->den, 2);
+
+  Optional<Simplex::Fraction> min =
+      simplex.computeOptimum(Simplex::Direction::Down, {1, -1, 0});
+  ASSERT_TRUE(min.hasValue());
+  EXPECT_EQ(min->num, -7);
+  EXPECT_EQ(min->den, 3);
+
+  // x - y isn't bounded when y isn't.
+  Simplex unbounded(2);
+  unbounded.addInequality({1, 0, 0});
+  EXPECT_FALSE(
+      unbounded.computeOptimum(Simplex::Direction::Down, {1, -1, 0}));
+}
+
+TEST(SimplexTest, Rollback) {
+  Simplex simplex(2);
+  simplex.addInequality({1, 0, 0});
+  simplex.addInequality({0, 1, 0});
+  unsigned snapshot = simplex.getSnapshot();
+  simplex.addInequality({-1, -1, -1});
+  EXPECT_TRUE(simplex.isEmpty());
+  simplex.rollback(snapshot);
+  EXPECT_FALSE(simplex.isEmpty());
+  EXPECT_EQ(simplex.getNumConstraints(), 2u);
+
+  Optional<Simplex::Fraction> min =
+      simplex.computeOptimum(Simplex::Direction::Down, {1, 1, 0});
+  ASSERT_TRUE(min.hasValue());
+  EXPECT_EQ(min->num, 0);
+}
+
+TEST(SimplexTest, DetectRedundant) {
+  // x >= 0, x >= -1, x <= 10, x <= 5 and 2x <= 30.
+  Simplex simplex(1);
+  simplex.addInequality({1, 0});
+  simplex.addInequality({1, 1});
+  simplex.addInequality({-1, 10});
+  simplex.addInequality({-1, 5});
+  simplex.addInequality({-2, 30});
+  simplex.detectRedundant(0, 5);
+  EXPECT_FALSE(simplex.isMarkedRedundant(0));
+  EXPECT_TRUE(simplex.isMarkedRedundant(1));
+  EXPECT_TRUE(simplex.isMarkedRedundant(2));
+  EXPECT_FALSE(simplex.isMarkedRedundant(3));
+  EXPECT_TRUE(simplex.isMarkedRedundant(4));
+}
+
+TEST(SimplexTest, Overflow) {
+  // 2^62 x >= 1 makes x a row with a denominator of 2^62, which the next
+  // constraint has to be scaled by: 2^62 y >= x + 1 overflows. The system has
+  // the integer point (1, 1), so it must not be reported empty.
+  const int64_t big = int64_t(1) << 62;
+  Simplex simplex(2);
+  simplex.addInequality({big, 0, -1});
+  simplex.addInequality({-1, big, -1});
+  simplex.addInequality({-1, 0, 1});
+  simplex.addInequality({0, -1, 1});
+  ASSERT_TRUE(simplex.hasOverflowed());
+  EXPECT_FALSE(simplex.isEmpty());
+  Optional<bool> result = simplex.isIntegerEmpty();
+  EXPECT_TRUE(!result.hasValue() || !*result);
+  EXPECT_FALSE(simplex.computeOptimum(Simplex::Direction::Up, {1, 0, 0}));
+}
+
+TEST(FlatAffineConstraintsTest, RemoveRedundantInequalities) {
+  for (Engine engine : {Engine::FourierMotzkin, Engine::Simplex}) {
+    // 0 <= i <= 31, i <= 40, and j == i with 0 <= j.
+    FlatAffineConstraints cst(2);
+    cst.addInequality({1, 0, 0});
+    cst.addInequality({-1, 0, 31});
+    cst.addInequality({-1, 0, 40});
+    cst.addInequality({0, 1, 0});
+    cst.addEquality({1, -1, 0});
+    cst.removeRedundantInequalities(engine);
+    EXPECT_EQ(cst.getNumInequalities(), 2u);
+    EXPECT_EQ(cst.getNumEqualities(), 1u);
+    EXPECT_FALSE(cst.isEmpty());
+  }
+}
+
+TEST(FlatAffineConstraintsTest, CorpusEmptiness) {
+  for (const CorpusEntry &entry : getCorpus()) {
+    FlatAffineConstraints cst = makeConstraints(entry);
+    EXPECT_EQ(cst.isEmpty(Engine::Simplex), entry.integerEmpty) << entry.name;
+    // Fourier-Motzkin isn't exact over the integers, but is never wrong when
+    // it finds a system empty.
+    if (!entry.integerEmpty)
+      EXPECT_FALSE(cst.isEmpty(Engine::FourierMotzkin)) << entry.name;
+  }
+}
+
+TEST(FlatAffineConstraintsTest, CorpusProjection) {
+  // Projecting out the source identifiers must give the same set with both
+  // engines, which we check by the emptiness of the difference of the
+  // projected sets at each of their constraints.
+  for (const CorpusEntry &entry : getCorpus()) {
+    FlatAffineConstraints fm = makeConstraints(entry);
+    FlatAffineConstraints simplex = makeConstraints(entry);
+    unsigned num = entry.numIds / 2;
+    fm.projectOut(0, num, Engine::FourierMotzkin);
+    simplex.projectOut(0, num, Engine::Simplex);
+    EXPECT_LE(simplex.getNumConstraints(), fm.getNumConstraints())
+        << entry.name;
+    EXPECT_EQ(simplex.isEmpty(Engine::Simplex), fm.isEmpty(Engine::Simplex))
+        << entry.name;
+
+    // Every constraint of one projection is implied by the other one.
+    auto checkImplied = [&](const FlatAffineConstraints &lhs,
+                            const FlatAffineConstraints &rhs) {
+      for (unsigned r = 0, e = rhs.getNumInequalities(); r < e; ++r) {
+        FlatAffineConstraints tmp(lhs);
+        SmallVector<int64_t, 8> complement;
+        for (int64_t coeff : rhs.getInequality(r))
+          complement.push_back(-coeff);
+        --complement.back();
+        tmp.addInequality(complement);
+        Simplex rational(tmp);
+        EXPECT_TRUE(rational.isEmpty()) << entry.name;
+      }
+    };
+    if (!fm.isEmpty(Engine::Simplex)) {
+      checkImplied(fm, simplex);
+      checkImplied(simplex, fm);
+    }
+  }
+}
+
+TEST(FlatAffineConstraintsTest, AddId) {
+  // 2 * d0 + 3 * s0 + 4 >= 0 and d0 - s0 == 0.
+  FlatAffineConstraints cst(/*numDims=*/1, /*numSymbols=*/1);
+  cst.addInequality({2, 3, 4});
+  cst.addEquality({1, -1, 0});
+  // Interleave insertions that grow the reserved columns with ones that don't.
+  for (unsigned i = 0; i < 8; ++i) {
+    cst.addDimId(0);
+    cst.addSymbolId(cst.getNumSymbolIds());
+    cst.addLocalId(0);
+  }
+  ASSERT_EQ(cst.getNumCols(), 27u);
+  for (unsigned c = 0; c < 27; ++c) {
+    int64_t ineq = c == 8 ? 2 : c == 9 ? 3 : c == 26 ? 4 : 0;
+    int64_t eq = c == 8 ? 1 : c == 9 ? -1 : 0;
+    EXPECT_EQ(cst.atIneq(0, c), ineq) << c;
+    EXPECT_EQ(cst.atEq(0, c), eq) << c;
+  }
+}
+
+TEST(FlatAffineConstraintsTest, OverflowRecovery) {
+  // x + 2^62 * (y + z + 1) >= 0 and -x + 2^62 * (y + z + 1) >= 0. Eliminating x
+  // yields 2^63 * (y + z + 1) >= 0, whose coefficients don't fit in int64_t,
+  // but which is y + z + 1 >= 0 once normalized.
+  const int64_t big = int64_t(1) << 62;
+  FlatAffineConstraints cst(3);
+  cst.addInequality({1, big, big, big});
+  cst.addInequality({-1, big, big, big});
+  EXPECT_FALSE(cst.isEmpty());
+
+  cst.projectOut(0, 1);
+  ASSERT_EQ(cst.getNumInequalities(), 1u);
+  EXPECT_EQ(cst.atIneq(0, 0), 1);
+  EXPECT_EQ(cst.atIneq(0, 1), 1);
+  EXPECT_EQ(cst.atIneq(0, 2), 1);
+}
+
+TEST(FlatAffineConstraintsTest, LcmOverflow) {
+  // a * x - y >= 0 and -b * x + z >= 0, with a and b coprime and lcm(a, b)
+  // beyond int64_t. Eliminating x yields -b * y + a * z >= 0, which fits.
+  const int64_t a = (int64_t(1) << 62) + 1, b = (int64_t(1) << 62) - 1;
+  FlatAffineConstraints cst(3);
+  cst.addInequality({a, -1, 0, 0});
+  cst.addInequality({-b, 0, 1, 0});
+
+  cst.projectOut(0, 1);
+  ASSERT_EQ(cst.getNumInequalities(), 1u);
+  EXPECT_EQ(cst.atIneq(0, 0), -b);
+  EXPECT_EQ(cst.atIneq(0, 1), a);
+  EXPECT_EQ(cst.atIneq(0, 2), 0);
+}
+
+/// Builds the dependence system of checkMemrefAccessDependence between
+/// A[i_0, ..., i_{depth-1}] and A[j_0, ..., j_{depth-1} - 1], in nests of
+/// 'depth' loops tiled by 32 with a symbolic tile count, identifiers being
+/// added one at a time as when merging the access and domain constraints.
+static FlatAffineConstraints buildDependenceSystem(unsigned depth) {
+  FlatAffineConstraints cst(/*numDims=*/0, /*numSymbols=*/1);
+  for (unsigned i = 0; i < 4 * depth; ++i)
+    cst.addDimId(cst.getNumDimIds());
+  // The identifiers are the tile and intra-tile IVs of the source, then those
+  // of the destination, then the symbol N.
+  unsigned numCols = cst.getNumCols();
+  SmallVector<int64_t, 16> row(numCols);
+  auto add = [&](bool isEq, ArrayRef<std::pair<unsigned, int64_t>> coeffs,
+                 int64_t constant) {
+    std::fill(row.begin(), row.end(), 0);
+    for (auto coeff : coeffs)
+      row[coeff.first] = coeff.second;
+    row.back() = constant;
+    isEq ? cst.addEquality(row) : cst.addInequality(row);
+  };
+  unsigned n = 4 * depth;
+  for (unsigned side = 0; side < 2; ++side) {
+    for (unsigned d = 0; d < depth; ++d) {
+      unsigned t = side * 2 * depth + d, i = t + depth;
+      // 0 <= t < N and 32 * t <= i < 32 * t + 32.
+      add(false, {{t, 1}}, 0);
+      add(false, {{t, -1}, {n, 1}}, -1);
+      add(false, {{i, 1}, {t, -32}}, 0);
+      add(false, {{i, -1}, {t, 32}}, 31);
+    }
+  }
+  for (unsigned d = 0; d < depth; ++d)
+    add(true, {{depth + d, 1}, {3 * depth + d, -1}},
+        d == depth - 1 ? 1 : 0);
+  return cst;
+}
+
+/// Measures the row operations on the dependence systems of tiled nests:
+/// building them, checking their emptiness and computing their direction
+/// vectors. Run with --gtest_also_run_disabled_tests.
+TEST(FlatAffineConstraintsTest, DISABLED_DependenceSystemBenchmark) {
+  const unsigned kIterations = 2000;
+  for (unsigned depth = 1; depth <= 4; ++depth) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < kIterations; ++i) {
+      FlatAffineConstraints cst = buildDependenceSystem(depth);
+      EXPECT_FALSE(cst.isEmpty());
+      // Add the direction identifiers and eliminate the others, as
+      // computeDirectionVector does.
+      unsigned numIds = cst.getNumIds();
+      for (unsigned d = 0; d < depth; ++d)
+        cst.addDimId(d);
+      SmallVector<int64_t, 32> eq(cst.getNumCols());
+      for (unsigned d = 0; d < depth; ++d) {
+        std::fill(eq.begin(), eq.end(), 0);
+        eq[d] = 1;
+        eq[2 * depth + d] = 1;
+        eq[4 * depth + d] = -1;
+        cst.addEquality(eq);
+      }
+      cst.projectOut(depth, numIds);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double micros =
+        std::chrono::duration<double, std::micro>(end - start).count();
+    llvm::outs() << "depth " << depth << ": "
+                 << llvm::format("%.0f", kIterations / micros * 1e6)
+                 << " systems/s\n";
+  }
+}
+
+/// Compares the time spent by both engines on the corpus. Run with
+/// --gtest_also_run_disabled_tests.
+TEST(FlatAffineConstraintsTest, DISABLED_CorpusBenchmark) {
+  const unsigned kIterations = 1000;
+  for (Engine engine : {Engine::FourierMotzkin, Engine::Simplex}) {
+    for (const CorpusEntry &entry : getCorpus()) {
+      FlatAffineConstraints cst = makeConstraints(entry);
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned i = 0; i < kIterations; ++i)
+        cst.isEmpty(engine);
+      auto end = std::chrono::steady_clock::now();
+      double micros =
+          std::chrono::duration<double, std::micro>(end - start).count();
+      llvm::outs() << (engine == Engine::Simplex ? "simplex " : "fm      ")
+                   << entry.name << ": "
+                   << llvm::format("%.3f", micros / kIterations) << " us\n";
+    }
+  }
+}
+
+} // end anonymous namespace
@@ -0,0 +1,142 @@
+//===- DominanceTest.cpp - Dominance unit tests ---------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Dominance.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+/// A diamond with a loop around its join block, followed by an operation whose
+/// region holds two blocks.
+const char *const kModuleStr = R"mlir(
+func @diamond(%cond: i1) {
+  "test.cond_br"(%cond)[^bb1, ^bb2] : (i1) -> ()
+^bb1:
+  "test.br"()[^bb3] : () -> ()
+^bb2:
+  "test.br"()[^bb3] : () -> ()
+^bb3:
+  "test.cond_br"(%cond)[^bb3, ^bb4] : (i1) -> ()
+^bb4:
+  "test.region"() ({
+    "test.br"()[^bb5] : () -> ()
+  ^bb5:
+    "test.foo"() : () -> ()
+    "test.return"() : () -> ()
+  }) : () -> ()
+  "test.return"() : () -> ()
+}
+)mlir";
+
+/// Returns the blocks of the given region.
+std::vector<Block *> getBlocks(Region &region) {
+  std::vector<Block *> blocks;
+  for (Block &block : region)
+    blocks.push_back(&block);
+  return blocks;
+}
+
+/// Check that the incrementally updated dominance info of the given region
+/// matches the one computed from scratch.
+void expectMatchesRecomputed(DominanceInfo &domInfo, Function &fn,
+                             Region &region) {
+  DominanceInfo expected(&fn);
+  for (Block &a : region)
+    for (Block &b : region)
+      EXPECT_EQ(domInfo.properlyDominates(&a, &b),
+                expected.properlyDominates(&a, &b));
+  EXPECT_EQ(domInfo.getRootNode(&region)->getBlock(), &region.front());
+}
+
+struct DominanceTest : public ::testing::Test {
+  void SetUp() override {
+    module.reset(parseSourceString(kModuleStr, &context));
+    ASSERT_TRUE(module);
+    fn = &module->getFunctions().front();
+    blocks = getBlocks(fn->getBody());
+    ASSERT_EQ(blocks.size(), 5u);
+  }
+
+  MLIRContext context;
+  std::unique_ptr<Module> module;
+  Function *fn;
+  std::vector<Block *> blocks;
+};
+
+TEST_F(DominanceTest, BatchedEdgeUpdates) {
+  DominanceInfo domInfo(fn);
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[0], blocks[3]));
+  EXPECT_FALSE(domInfo.properlyDominates(blocks[1], blocks[3]));
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[3], blocks[4]));
+
+  // Redirect ^bb2 to ^bb1, so that ^bb1 dominates the join block.
+  blocks[2]->getTerminator()->setSuccessor(blocks[1], 0);
+  domInfo.applyUpdates(
+      {{llvm::cfg::UpdateKind::Delete, blocks[2], blocks[3]},
+       {llvm::cfg::UpdateKind::Insert, blocks[2], blocks[1]}});
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[1], blocks[3]));
+  expectMatchesRecomputed(domInfo, *fn, fn->getBody());
+
+  // Redirect the entry to ^bb4 only, leaving the rest unreachable.
+  Operation *entryTerm = blocks[0]->getTerminator();
+  entryTerm->setSuccessor(blocks[4], 0);
+  entryTerm->setSuccessor(blocks[4], 1);
+  domInfo.applyUpdates(
+      {{llvm::cfg::UpdateKind::Delete, blocks[0], blocks[1]},
+       {llvm::cfg::UpdateKind::Delete, blocks[0], blocks[2]},
+       {llvm::cfg::UpdateKind::Insert, blocks[0], blocks[4]}});
+  EXPECT_FALSE(domInfo.properlyDominates(blocks[3], blocks[4]));
+  expectMatchesRecomputed(domInfo, *fn, fn->getBody());
+}
+
+TEST_F(DominanceTest, SplitBlockInOperationRegion) {
+  Region &region = blocks[4]->front().getRegion(0);
+  std::vector<Block *> regionBlocks = getBlocks(region);
+  ASSERT_EQ(regionBlocks.size(), 2u);
+
+  // The dominator tree of the region is computed before the split.
+  DominanceInfo domInfo(fn);
+  EXPECT_TRUE(domInfo.properlyDominates(regionBlocks[0], regionBlocks[1]));
+
+  // Split the second block of the region, and branch from its first half to
+  // the second. The new block belongs to the region, not to the function.
+  Operation *foo = &regionBlocks[1]->front();
+  Block *newBlock = regionBlocks[1]->splitBlock(foo);
+  EXPECT_EQ(newBlock->getParent(), &region);
+  EXPECT_EQ(std::next(Region::iterator(regionBlocks[1])),
+            Region::iterator(newBlock));
+  EXPECT_EQ(fn->getBody().getBlocks().size(), 5u);
+  EXPECT_TRUE(regionBlocks[1]->empty());
+  EXPECT_EQ(&newBlock->front(), foo);
+
+  OperationState state(&context, foo->getLoc(), "test.br");
+  state.addSuccessor(newBlock, {});
+  regionBlocks[1]->push_back(Operation::create(state));
+
+  domInfo.applyUpdates(
+      {{llvm::cfg::UpdateKind::Insert, regionBlocks[1], newBlock}});
+  EXPECT_TRUE(domInfo.properlyDominates(regionBlocks[1], newBlock));
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[4], newBlock));
+  expectMatchesRecomputed(domInfo, *fn, region);
+}
+
+} // end anonymous namespace
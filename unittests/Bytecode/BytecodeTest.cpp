@@ -0,0 +1,201 @@
+//===- BytecodeTest.cpp - MLIR Bytecode unit tests ------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+const char *const kModuleStr = R"mlir(
+func @external(i32) -> i32
+
+func @callee(%arg0: i32) -> i32 attributes {test.attr: "bar"} {
+  "test.br"()[^bb2] : () -> ()
+^bb1:
+  "test.return"(%0) : (i32) -> ()
+^bb2:
+  %0 = "test.op"(%arg0) {value: dense<tensor<2xi32>, [1, 2]>} : (i32) -> i32
+  "test.br"()[^bb1] : () -> ()
+}
+)mlir";
+
+std::string printModule(Module *module) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  module->print(os);
+  return os.str();
+}
+
+std::string writeModule(Module *module) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  writeBytecode(module, os);
+  return os.str();
+}
+
+TEST(BytecodeTest, RoundTrip) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+
+  std::string bytecode = writeModule(module.get());
+  EXPECT_TRUE(isBytecode(bytecode));
+
+  std::unique_ptr<Module> result(readBytecode(bytecode, &context));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(printModule(module.get()), printModule(result.get()));
+}
+
+TEST(BytecodeTest, LazyFunctionLoading) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+  std::string bytecode = writeModule(module.get());
+
+  std::unique_ptr<Module> result(
+      readBytecode(bytecode, &context, /*lazy=*/true));
+  ASSERT_TRUE(result);
+
+  // Only the function with a body is materializable.
+  Function *external = result->getNamedFunction("external");
+  Function *callee = result->getNamedFunction("callee");
+  ASSERT_TRUE(external && callee);
+  EXPECT_FALSE(external->isMaterializable());
+  EXPECT_TRUE(external->isExternal());
+  EXPECT_TRUE(callee->isMaterializable());
+  EXPECT_FALSE(callee->isExternal());
+
+  // Accessing the body materializes it.
+  EXPECT_FALSE(callee->empty());
+  EXPECT_FALSE(callee->isMaterializable());
+  EXPECT_TRUE(succeeded(result->verify()));
+  EXPECT_EQ(printModule(module.get()), printModule(result.get()));
+}
+
+TEST(BytecodeTest, MalformedLazyFunctionBody) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+  std::string bytecode = writeModule(module.get());
+
+  std::vector<std::string> errors;
+  context.getDiagEngine().setHandler(
+      [&](Location, StringRef message, DiagnosticSeverity) {
+        errors.push_back(message.str());
+      });
+
+  // The body of the last function ends the buffer: corrupt its last bytes,
+  // which are only read when the body is materialized.
+  bytecode[bytecode.size() - 1] = '\xff';
+  bytecode[bytecode.size() - 2] = '\xff';
+  std::unique_ptr<Module> result(
+      readBytecode(bytecode, &context, /*lazy=*/true));
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(errors.empty());
+
+  Function *callee = result->getNamedFunction("callee");
+  ASSERT_TRUE(callee);
+  EXPECT_TRUE(failed(callee->materialize()));
+  ASSERT_FALSE(errors.empty());
+  EXPECT_EQ(errors.back(),
+            "could not materialize the body of function @callee");
+
+  // The function doesn't turn into an external one, and its body can't be
+  // accessed anymore.
+  EXPECT_FALSE(callee->isExternal());
+  EXPECT_TRUE(failed(callee->materialize()));
+  EXPECT_TRUE(failed(result->verify()));
+  EXPECT_DEATH(callee->getBody(), "failed to materialize");
+}
+
+TEST(BytecodeTest, InvalidLazyFunctionBody) {
+  MLIRContext context;
+  std::vector<std::string> errors;
+  context.getDiagEngine().setHandler(
+      [&](Location, StringRef message, DiagnosticSeverity) {
+        errors.push_back(message.str());
+      });
+
+  // A function whose block has no terminator is written as is, but doesn't
+  // verify once its body is read back.
+  Module module(&context);
+  auto type = FunctionType::get({}, {}, &context);
+  auto *function = new Function(UnknownLoc::get(&context), "invalid", type);
+  module.getFunctions().push_back(function);
+  function->addEntryBlock();
+  std::string bytecode = writeModule(&module);
+
+  std::unique_ptr<Module> result(
+      readBytecode(bytecode, &context, /*lazy=*/true));
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(errors.empty());
+  Function *invalid = result->getNamedFunction("invalid");
+  ASSERT_TRUE(invalid);
+  EXPECT_TRUE(failed(invalid->materialize()));
+  ASSERT_FALSE(errors.empty());
+  EXPECT_EQ(errors.back(), "block with no terminator");
+}
+
+TEST(BytecodeTest, ExternalData) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+  std::string bytecode = writeModule(module.get());
+
+  // Reading from an owned buffer refers to the dense data in place.  A fresh
+  // context is used, as the parsed attribute is already uniqued in the first.
+  MLIRContext readContext;
+  std::unique_ptr<Module> result(readBytecode(
+      llvm::MemoryBuffer::getMemBufferCopy(bytecode), &readContext));
+  ASSERT_TRUE(result);
+  Function *callee = result->getNamedFunction("callee");
+  ASSERT_TRUE(callee);
+  Operation &op = callee->back().front();
+  auto attr = op.getAttrOfType<DenseElementsAttr>("value");
+  ASSERT_TRUE(attr);
+  EXPECT_TRUE(attr.hasExternalData());
+  EXPECT_EQ(printModule(module.get()), printModule(result.get()));
+}
+
+TEST(BytecodeTest, MalformedInput) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+  std::string bytecode = writeModule(module.get());
+
+  unsigned numErrors = 0;
+  context.getDiagEngine().setHandler(
+      [&](Location, StringRef, DiagnosticSeverity) { ++numErrors; });
+
+  // Every truncation of the buffer must be rejected.
+  for (size_t size = 0, e = bytecode.size(); size != e; ++size) {
+    std::unique_ptr<Module> result(
+        readBytecode(StringRef(bytecode).take_front(size), &context));
+    EXPECT_FALSE(result);
+  }
+  EXPECT_EQ(numErrors, bytecode.size());
+}
+} // end anonymous namespace
@@ -0,0 +1,157 @@
+//===- ExecutionEngineTest.cpp - ExecutionEngine invocation unit tests ----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+
+// Stores the sum of the elements of a dynamically-shaped memref.
+const char *const kSum = R"mlir(
+func @sum(%in : memref<?xf32>, %out : memref<1xf32>) {
+  %c0 = constant 0 : index
+  %zero = constant 0.0 : f32
+  store %zero, %out[%c0] : memref<1xf32>
+  %n = dim %in, 0 : memref<?xf32>
+  affine.for %i = 0 to %n {
+    %x = load %in[%i] : memref<?xf32>
+    %acc = load %out[%c0] : memref<1xf32>
+    %s = addf %acc, %x : f32
+    store %s, %out[%c0] : memref<1xf32>
+  }
+  return
+}
+)mlir";
+
+class ExecutionEngineTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  }
+
+  void SetUp() override {
+    module.reset(parseSourceString(kSum, &context));
+    ASSERT_TRUE(module);
+    auto expectedEngine = ExecutionEngine::create(module.get());
+    ASSERT_TRUE(bool(expectedEngine))
+        << llvm::toString(expectedEngine.takeError());
+    engine = std::move(*expectedEngine);
+  }
+
+  MLIRContext context;
+  std::unique_ptr<Module> module;
+  std::unique_ptr<ExecutionEngine> engine;
+};
+
+TEST_F(ExecutionEngineTest, DynamicShape) {
+  Builder builder(&context);
+  auto inType = MemRefType::get({-1}, builder.getF32Type());
+  auto outType = MemRefType::get({1}, builder.getF32Type());
+  auto in = OwningMemRef::create(inType, {5});
+  ASSERT_TRUE(bool(in)) << llvm::toString(in.takeError());
+  auto out = OwningMemRef::create(outType);
+  ASSERT_TRUE(bool(out)) << llvm::toString(out.takeError());
+  EXPECT_EQ((*in)->getNumElements(), 5);
+  for (int i = 0; i < 5; ++i)
+    (*in)->getData<float>()[i] = i + 1;
+
+  SmallVector<void *, 2> args = {(*in)->getDescriptor(),
+                                 (*out)->getDescriptor()};
+  llvm::Error error = engine->invoke("sum", MutableArrayRef<void *>(args));
+  ASSERT_FALSE(bool(error)) << llvm::toString(std::move(error));
+  EXPECT_EQ((*out)->getData<float>()[0], 15.0f);
+}
+
+TEST_F(ExecutionEngineTest, RepeatedBoundInvocation) {
+  float data[4] = {1, 2, 3, 4}, result = 0;
+  MemRefDescriptor<float, 1> in = {data, 4};
+  MemRefDescriptor<float> out = {&result};
+  auto invocation = engine->bind("sum", in, out);
+  ASSERT_TRUE(bool(invocation)) << llvm::toString(invocation.takeError());
+  ASSERT_EQ(invocation->getArguments().size(), 2u);
+  EXPECT_EQ(invocation->getArguments()[0], static_cast<void *>(&in));
+
+  (*invocation)();
+  EXPECT_EQ(result, 10.0f);
+
+  // The arguments are bound by address: updating the descriptors and the
+  // data is seen by the next call.
+  in.dynamicSizes[0] = 2;
+  (*invocation)();
+  EXPECT_EQ(result, 3.0f);
+  data[0] = 10;
+  (*invocation)();
+  EXPECT_EQ(result, 12.0f);
+}
+
+TEST_F(ExecutionEngineTest, RepeatedPackedInvocation) {
+  float data[3] = {1, 2, 3}, result = 0;
+  MemRefDescriptor<float, 1> in = {data, 3};
+  MemRefDescriptor<float> out = {&result};
+  // A list of pointers is bound as the list of arguments.
+  SmallVector<void *, 2> args = {&in, &out};
+  auto invocation = engine->bindPacked("sum", args);
+  ASSERT_TRUE(bool(invocation)) << llvm::toString(invocation.takeError());
+  ASSERT_EQ(invocation->getArguments().size(), 2u);
+
+  (*invocation)();
+  EXPECT_EQ(result, 6.0f);
+
+  // Rebinding an argument doesn't look up the function again.
+  float otherData[2] = {5, 7};
+  MemRefDescriptor<float, 1> other = {otherData, 2};
+  invocation->setArgument(0, &other);
+  (*invocation)();
+  EXPECT_EQ(result, 12.0f);
+}
+
+TEST(OwningMemRefTest, ElementSizes) {
+  MLIRContext context;
+  Builder builder(&context);
+  auto getElementSize = [](MemRefType type) {
+    auto memRef = OwningMemRef::create(type);
+    EXPECT_TRUE(bool(memRef)) << llvm::toString(memRef.takeError());
+    return memRef ? (*memRef)->getElementSizeInBytes() : 0;
+  };
+  EXPECT_EQ(getElementSize(MemRefType::get({2}, builder.getIndexType())), 8u);
+  EXPECT_EQ(getElementSize(MemRefType::get({2}, builder.getIntegerType(17))),
+            4u);
+  EXPECT_EQ(getElementSize(MemRefType::get({2}, builder.getF16Type())), 2u);
+
+  // BF16 isn't supported by the lowering to LLVM IR.
+  auto bf16MemRef =
+      OwningMemRef::create(MemRefType::get({2}, builder.getBF16Type()));
+  EXPECT_FALSE(bool(bf16MemRef));
+  llvm::consumeError(bf16MemRef.takeError());
+}
+
+TEST_F(ExecutionEngineTest, BindUnknownFunction) {
+  auto invocation = engine->bindPacked("unknown", {});
+  EXPECT_FALSE(bool(invocation));
+  llvm::consumeError(invocation.takeError());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,108 @@
+//===- AttributeTest.cpp - Attribute unit tests ---------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/StandardTypes.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+/// Create a buffer holding 'numElements' consecutive 32-bit integers.
+std::unique_ptr<llvm::MemoryBuffer> createBuffer(size_t numElements) {
+  auto buffer = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(
+      numElements * sizeof(int32_t));
+  auto *data = reinterpret_cast<int32_t *>(buffer->getBufferStart());
+  for (size_t i = 0; i != numElements; ++i)
+    data[i] = i;
+  return std::move(buffer);
+}
+
+ArrayRef<char> getData(llvm::MemoryBuffer &buffer) {
+  return {buffer.getBufferStart(), buffer.getBufferSize()};
+}
+
+TEST(DenseElementsAttrTest, ExternalData) {
+  MLIRContext context;
+  Builder builder(&context);
+  auto type = builder.getTensorType({4}, builder.getIntegerType(32));
+
+  auto buffer = createBuffer(4);
+  ArrayRef<char> data = getData(*buffer);
+  context.retainBuffer(std::move(buffer));
+
+  // The data is referred to in place.
+  auto attr = DenseElementsAttr::getFromExternalData(type, data);
+  EXPECT_TRUE(attr.hasExternalData());
+  EXPECT_EQ(attr.getRawData().data(), data.data());
+  EXPECT_TRUE(attr.isa<DenseIntElementsAttr>());
+  EXPECT_EQ(attr.getValue({2}), builder.getIntegerAttr(type.getElementType(),
+                                                       2));
+
+  // An attribute with the same content is uniqued to the external one.
+  SmallVector<Attribute, 4> values;
+  attr.getValues(values);
+  EXPECT_EQ(DenseElementsAttr::get(type, values), attr);
+}
+
+TEST(DenseElementsAttrTest, LargeDataUniquing) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  // Use enough data for the digest to only sample it.
+  const size_t numElements = 1 << 16;
+  auto type = builder.getTensorType({numElements}, builder.getIntegerType(32));
+  auto buffer = createBuffer(numElements), other = createBuffer(numElements);
+
+  // Equal data is uniqued to the same attribute.
+  auto attr = DenseElementsAttr::getFromExternalData(type, getData(*buffer));
+  EXPECT_EQ(DenseElementsAttr::get(type, getData(*other)), attr);
+
+  // Data that only differs in an element that is not part of the digest still
+  // results in a different attribute.
+  reinterpret_cast<int32_t *>(const_cast<char *>(other->getBufferStart()))[17] =
+      -1;
+  auto otherAttr = DenseElementsAttr::get(type, getData(*other));
+  EXPECT_NE(otherAttr, attr);
+  EXPECT_FALSE(otherAttr.hasExternalData());
+  EXPECT_EQ(otherAttr.getValue({17}),
+            builder.getIntegerAttr(type.getElementType(), -1));
+
+  context.retainBuffer(std::move(buffer));
+}
+
+TEST(FunctionAttrTest, TypeFollowsFunction) {
+  MLIRContext context;
+  Builder builder(&context);
+  auto i32 = builder.getIntegerType(32);
+  auto type = builder.getFunctionType({}, {});
+  auto newType = builder.getFunctionType({i32}, {i32});
+
+  Function function(builder.getUnknownLoc(), "f", type);
+  auto attr = builder.getFunctionAttr(&function);
+  EXPECT_EQ(attr.getType(), type);
+
+  // The attribute isn't updated, it reports the type of the function.
+  function.setType(newType);
+  EXPECT_EQ(attr.getType(), newType);
+  EXPECT_EQ(Attribute(attr).getType(), newType);
+  EXPECT_EQ(builder.getFunctionAttr(&function), attr);
+}
+} // end anonymous namespace
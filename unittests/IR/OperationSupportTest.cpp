@@ -114,4 +114,29 @@ TEST(OperandStorageTest, Resizable) {
   useOp->destroy();
 }
 
+TEST(OperationOrderTest, InsertedOperations) {
+  MLIRContext context;
+  Block block;
+  for (unsigned i = 0; i < 4; ++i)
+    block.push_back(createOp(&context, /*resizableOperands=*/false));
+  EXPECT_TRUE(block.front().isBeforeInBlock(&block.back()));
+
+  // Insert operations at the front, in the middle and at the back of the
+  // block, which are numbered without recomputing the order when possible.
+  for (unsigned i = 0; i < 8; ++i) {
+    block.push_front(createOp(&context, /*resizableOperands=*/false));
+    block.getOperations().insert(std::next(block.begin(), 3),
+                                 createOp(&context, /*resizableOperands=*/false));
+    block.push_back(createOp(&context, /*resizableOperands=*/false));
+
+    // The order must match the operation list.
+    for (auto a = block.begin(), e = block.end(); a != e; ++a)
+      for (auto b = block.begin(); b != e; ++b)
+        EXPECT_EQ(a->isBeforeInBlock(&*b),
+                  std::distance(block.begin(), a) <
+                      std::distance(block.begin(), b));
+  }
+  EXPECT_FALSE(block.verifyInstOrder());
+}
+
 } // end namespace
@@ -17,6 +17,8 @@
 
 #include "mlir/Pass/AnalysisManager.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
 #include "gtest/gtest.h"
 
 using namespace mlir;
@@ -33,6 +35,25 @@ struct OtherAnalysis {
   OtherAnalysis(Module *) {}
 };
 
+/// An analysis that reports its memory usage, and counts its instances.
+struct SizedAnalysis {
+  SizedAnalysis(Function *) { ++numInstances; }
+  size_t getMemoryUsage() const { return 100; }
+  static unsigned numInstances;
+};
+unsigned SizedAnalysis::numInstances = 0;
+
+/// Create a new non-external function in the given module.
+Function *createFunction(Module *module, StringRef name) {
+  Builder builder(module->getContext());
+  Function *func =
+      new Function(builder.getUnknownLoc(), name,
+                   builder.getFunctionType(llvm::None, llvm::None));
+  func->addEntryBlock();
+  module->getFunctions().push_back(func);
+  return func;
+}
+
 TEST(AnalysisManagerTest, FineGrainModuleAnalysisPreservation) {
   MLIRContext context;
 
@@ -109,4 +130,108 @@ TEST(AnalysisManagerTest, FineGrainChildFunctionAnalysisPreservation) {
   EXPECT_FALSE(mam.getCachedFunctionAnalysis<OtherAnalysis>(func1).hasValue());
 }
 
+TEST(AnalysisManagerTest, CacheStatistics) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 = createFunction(module.get(), "foo");
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+
+  // The first query computes the analysis, the second one hits the cache.
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+  mam.getAnalysis<MyAnalysis>();
+
+  // The statistics of invalidated function analyses are kept.
+  mam.invalidate(detail::PreservedAnalyses());
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+
+  auto statistics = mam.getCacheStatistics();
+  EXPECT_EQ(statistics.numHits, 1u);
+  EXPECT_EQ(statistics.numMisses, 3u);
+  EXPECT_EQ(statistics.numEvictions, 0u);
+}
+
+TEST(AnalysisManagerTest, RetentionBudgetEvictsLeastRecentlyUsed) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 = createFunction(module.get(), "foo");
+  Function *func2 = createFunction(module.get(), "bar");
+
+  // Only allow for a single analysis to be retained.
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+  mam.setRetentionBudget(150);
+  mam.getFunctionAnalysis<SizedAnalysis>(func1);
+  mam.getFunctionAnalysis<SizedAnalysis>(func2);
+  mam.enforceRetentionBudget();
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<SizedAnalysis>(func1).hasValue());
+  EXPECT_TRUE(mam.getCachedFunctionAnalysis<SizedAnalysis>(func2).hasValue());
+
+  // Using the first function again makes the second one the least recently
+  // used.
+  mam.getFunctionAnalysis<SizedAnalysis>(func1);
+  mam.enforceRetentionBudget();
+  EXPECT_TRUE(mam.getCachedFunctionAnalysis<SizedAnalysis>(func1).hasValue());
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<SizedAnalysis>(func2).hasValue());
+  EXPECT_EQ(mam.getCacheStatistics().numEvictions, 2u);
+}
+
+TEST(AnalysisManagerTest, RemovedFunctionAnalysesDropped) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 = createFunction(module.get(), "foo");
+  Function *func2 = createFunction(module.get(), "bar");
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+  mam.getFunctionAnalysis<MyAnalysis>(func2);
+
+  // The analyses of a function removed from the module are dropped, so that
+  // they aren't used when it is added back.
+  std::unique_ptr<Function> removed(module->getFunctions().remove(func1));
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<MyAnalysis>(func1).hasValue());
+  EXPECT_TRUE(mam.getCachedFunctionAnalysis<MyAnalysis>(func2).hasValue());
+  module->getFunctions().push_back(removed.release());
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<MyAnalysis>(func1).hasValue());
+
+  // The same holds for an erased function, and the statistics of its analyses
+  // are kept.
+  func2->erase();
+  EXPECT_EQ(mam.getCacheStatistics().numMisses, 2u);
+}
+
+/// A function pass that uses SizedAnalysis, and preserves all analyses.
+struct UseSizedAnalysisPass : public FunctionPass<UseSizedAnalysisPass> {
+  void runOnFunction() override {
+    getAnalysis<SizedAnalysis>();
+    markAllAnalysesPreserved();
+  }
+};
+
+/// A module pass that optionally preserves SizedAnalysis.
+struct ModuleTestPass : public ModulePass<ModuleTestPass> {
+  ModuleTestPass(bool preserve) : preserve(preserve) {}
+  void runOnModule() override {
+    if (preserve)
+      markAnalysesPreserved<SizedAnalysis>();
+  }
+  bool preserve;
+};
+
+TEST(AnalysisManagerTest, FunctionAnalysesRetainedAcrossPipelines) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(new Module(&context));
+  createFunction(module.get(), "foo");
+  createFunction(module.get(), "bar");
+
+  // The function analyses survive a module pass that preserves them.
+  for (bool preserve : {true, false}) {
+    SizedAnalysis::numInstances = 0;
+    PassManager pm(/*verifyPasses=*/false);
+    pm.addPass(new UseSizedAnalysisPass());
+    pm.addPass(new ModuleTestPass(preserve));
+    pm.addPass(new UseSizedAnalysisPass());
+    ASSERT_TRUE(succeeded(pm.run(module.get())));
+    EXPECT_EQ(SizedAnalysis::numInstances, preserve ? 2u : 4u);
+  }
+}
+
 } // end namespace
@@ -0,0 +1,131 @@
+//===- StorageUniquerTest.cpp - StorageUniquer unit tests -----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/StorageUniquer.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace mlir;
+
+namespace {
+
+/// A simple storage class uniqued by an integer key.
+struct IntStorage : public StorageUniquer::BaseStorage {
+  using KeyTy = int;
+
+  IntStorage(int value) : value(value) {}
+
+  bool operator==(const KeyTy &key) const { return key == value; }
+
+  static IntStorage *construct(StorageUniquer::StorageAllocator &allocator,
+                               const KeyTy &key) {
+    return new (allocator.allocate<IntStorage>()) IntStorage(key);
+  }
+
+  void cleanup() {}
+
+  int value;
+};
+
+/// A storage class uniqued solely by its kind.
+struct UnitStorage : public StorageUniquer::BaseStorage {};
+
+enum Kinds { Int, OtherInt, Unit };
+
+TEST(StorageUniquerTest, UniquesComplexStorage) {
+  StorageUniquer uniquer;
+  auto *a = uniquer.get<IntStorage>({}, Int, 42);
+  auto *b = uniquer.get<IntStorage>({}, Int, 42);
+  auto *c = uniquer.get<IntStorage>({}, Int, 43);
+  auto *d = uniquer.get<IntStorage>({}, OtherInt, 42);
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_NE(a, d);
+  EXPECT_EQ(a->value, 42);
+  EXPECT_EQ(a->getKind(), static_cast<unsigned>(Int));
+  EXPECT_EQ(d->getKind(), static_cast<unsigned>(OtherInt));
+}
+
+TEST(StorageUniquerTest, UniquesSimpleStorage) {
+  StorageUniquer uniquer;
+  auto *a = uniquer.get<UnitStorage>({}, Unit);
+  auto *b = uniquer.get<UnitStorage>({}, Unit);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a->getKind(), static_cast<unsigned>(Unit));
+}
+
+TEST(StorageUniquerTest, InitFnRunsOnce) {
+  StorageUniquer uniquer;
+  unsigned numInits = 0;
+  auto initFn = [&](IntStorage *) { ++numInits; };
+  for (int i = 0; i < 10; ++i)
+    uniquer.get<IntStorage>(initFn, Int, 7);
+  EXPECT_EQ(numInits, 1u);
+}
+
+TEST(StorageUniquerTest, EraseRemovesStorage) {
+  StorageUniquer uniquer;
+  auto *a = uniquer.get<IntStorage>({}, Int, 1);
+  // Query again to make sure the instance is in the lookup cache.
+  EXPECT_EQ(a, uniquer.get<IntStorage>({}, Int, 1));
+
+  unsigned numInits = 0;
+  auto initFn = [&](IntStorage *) { ++numInits; };
+  uniquer.erase<IntStorage>(Int, 1);
+  auto *b = uniquer.get<IntStorage>(initFn, Int, 1);
+  EXPECT_EQ(numInits, 1u);
+  EXPECT_EQ(b->value, 1);
+}
+
+/// Check that instances created concurrently from an increasing number of
+/// threads are still unique.
+TEST(StorageUniquerTest, ConcurrentGet) {
+  const int kNumValues = 4096;
+  for (unsigned numThreads : {1, 2, 4, 8, 16, 32, 64}) {
+    StorageUniquer uniquer;
+    std::vector<std::vector<IntStorage *>> results(numThreads);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t != numThreads; ++t) {
+      threads.emplace_back([&, t] {
+        auto &result = results[t];
+        result.reserve(kNumValues);
+        // Each thread walks the values starting from a different offset, to
+        // mix creation of new instances with lookups of existing ones.
+        for (int i = 0; i != kNumValues; ++i) {
+          int value = (i + t * 97) % kNumValues;
+          result.push_back(uniquer.get<IntStorage>({}, Int, value));
+        }
+      });
+    }
+    for (auto &thread : threads)
+      thread.join();
+
+    // All threads must agree on the instance of each value.
+    std::vector<IntStorage *> expected(kNumValues);
+    for (int i = 0; i != kNumValues; ++i)
+      expected[i] = uniquer.get<IntStorage>({}, Int, i);
+    for (unsigned t = 0; t != numThreads; ++t) {
+      for (int i = 0; i != kNumValues; ++i) {
+        int value = (i + t * 97) % kNumValues;
+        ASSERT_EQ(results[t][i], expected[value]);
+        ASSERT_EQ(results[t][i]->value, value);
+      }
+    }
+  }
+}
+
+} // end anonymous namespace
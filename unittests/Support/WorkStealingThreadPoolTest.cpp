@@ -0,0 +1,137 @@
+//===- WorkStealingThreadPoolTest.cpp - WorkStealingThreadPool unit tests -===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/WorkStealingThreadPool.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace mlir;
+
+namespace {
+
+TEST(WorkStealingThreadPoolTest, ExecutesEachTaskOnce) {
+  WorkStealingThreadPool pool(4);
+  EXPECT_EQ(pool.getNumThreads(), 4u);
+
+  // Run a few batches, to check that the workers are reused.
+  for (unsigned batch = 0; batch != 3; ++batch) {
+    std::vector<std::atomic<unsigned>> counts(1000);
+    pool.parallelFor(counts.size(), [&](unsigned threadIndex, size_t task) {
+      EXPECT_LT(threadIndex, 4u);
+      ++counts[task];
+    });
+    for (auto &count : counts)
+      EXPECT_EQ(count, 1u);
+  }
+
+  // Each task is accounted for in the statistics.
+  auto statistics = pool.getStatistics();
+  ASSERT_EQ(statistics.size(), 4u);
+  uint64_t numTasks = 0;
+  for (auto &threadStats : statistics)
+    numTasks += threadStats.numTasks;
+  EXPECT_EQ(numTasks, 3000u);
+}
+
+TEST(WorkStealingThreadPoolTest, StealsFromBlockedThread) {
+  WorkStealingThreadPool pool(2);
+
+  // The thread executing the first task doesn't finish it until all of the
+  // other tasks have been executed, so the other thread must execute the tasks
+  // of both queues.
+  const size_t numTasks = 16;
+  std::atomic<size_t> numCompleted(0);
+  pool.parallelFor(numTasks, [&](unsigned threadIndex, size_t task) {
+    if (task == 0) {
+      while (numCompleted != numTasks - 1)
+        std::this_thread::yield();
+    }
+    ++numCompleted;
+  });
+  EXPECT_EQ(numCompleted, numTasks);
+
+  auto statistics = pool.getStatistics();
+  ASSERT_EQ(statistics.size(), 2u);
+  EXPECT_EQ(statistics[0].numTasks + statistics[1].numTasks, numTasks);
+  EXPECT_GE(std::max(statistics[0].numTasks, statistics[1].numTasks),
+            numTasks - 1);
+  EXPECT_GE(statistics[0].numStolenTasks + statistics[1].numStolenTasks,
+            numTasks / 2 - 1);
+}
+
+TEST(WorkStealingThreadPoolTest, NestedBatchRunsSequentially) {
+  WorkStealingThreadPool pool(2);
+  std::atomic<unsigned> numInnerTasks(0);
+  pool.parallelFor(4, [&](unsigned outerThreadIndex, size_t) {
+    pool.parallelFor(8, [&](unsigned threadIndex, size_t) {
+      EXPECT_EQ(threadIndex, outerThreadIndex);
+      ++numInnerTasks;
+    });
+  });
+  EXPECT_EQ(numInnerTasks, 32u);
+}
+
+TEST(WorkStealingThreadPoolTest, ConcurrentBatchesRunInParallel) {
+  WorkStealingThreadPool pool(2);
+
+  // The first task of a batch waits for the second one to start, which only
+  // happens if the batch is executed by the pool rather than sequentially on
+  // the submitting thread.
+  auto runBatch = [&] {
+    std::atomic<bool> secondStarted(false);
+    bool sawSecond = false;
+    pool.parallelFor(2, [&](unsigned, size_t task) {
+      if (task == 1) {
+        secondStarted = true;
+        return;
+      }
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (!secondStarted && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+      sawSecond = secondStarted;
+    });
+    EXPECT_TRUE(sawSecond);
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != 4; ++i)
+    threads.emplace_back(runBatch);
+  for (auto &thread : threads)
+    thread.join();
+}
+
+TEST(WorkStealingThreadPoolTest, SetNumThreads) {
+  WorkStealingThreadPool pool(2);
+  std::atomic<unsigned> numTasks(0);
+  pool.parallelFor(8, [&](unsigned, size_t) { ++numTasks; });
+
+  pool.setNumThreads(3);
+  EXPECT_EQ(pool.getNumThreads(), 3u);
+  pool.parallelFor(8, [&](unsigned threadIndex, size_t) {
+    EXPECT_LT(threadIndex, 3u);
+    ++numTasks;
+  });
+  EXPECT_EQ(numTasks, 16u);
+  EXPECT_EQ(pool.getStatistics().size(), 3u);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,199 @@
+//===- DialectConversionTest.cpp - Dialect conversion unit tests ----------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Transforms/DialectConversion.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Parser.h"
+#include "mlir/StandardOps/Ops.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+
+using namespace mlir;
+
+namespace {
+
+/// Converts i32 additions into i64 subtractions.
+struct AddIConversion : public DialectOpConversion {
+  explicit AddIConversion(MLIRContext *context)
+      : DialectOpConversion(AddIOp::getOperationName(), 1, context) {}
+
+  SmallVector<Value *, 4> rewrite(Operation *op, ArrayRef<Value *> operands,
+                                  FuncBuilder &rewriter) const override {
+    return {rewriter.create<SubIOp>(op->getLoc(), operands[0], operands[1])};
+  }
+};
+
+/// Fails to convert multiplications, by not producing their result.
+struct MulIConversion : public DialectOpConversion {
+  explicit MulIConversion(MLIRContext *context)
+      : DialectOpConversion(MulIOp::getOperationName(), 1, context) {}
+
+  SmallVector<Value *, 4> rewrite(Operation *op, ArrayRef<Value *> operands,
+                                  FuncBuilder &rewriter) const override {
+    rewriter.create<AddIOp>(op->getLoc(), operands[0], operands[1]);
+    return {};
+  }
+};
+
+/// Converts i32 values to i64.
+class WideningConversion : public DialectConversion {
+protected:
+  llvm::DenseSet<DialectOpConversion *>
+  initConverters(MLIRContext *context) override {
+    return ConversionListBuilder<AddIConversion, MulIConversion>::build(
+        &allocator, context);
+  }
+
+  Type convertType(Type t) override {
+    if (t.isInteger(32))
+      return IntegerType::get(64, t.getContext());
+    return t;
+  }
+
+private:
+  llvm::BumpPtrAllocator allocator;
+};
+
+std::string printFunction(Function &function) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  function.print(os);
+  return os.str();
+}
+
+const char *const kConvertibleStr = R"mlir(
+func @convertible(%arg0: i32, %arg1: i32) -> i32 {
+  %0 = addi %arg0, %arg1 : i32
+  br ^bb1(%0 : i32)
+^bb1(%1: i32):
+  %2 = addi %1, %arg0 : i32
+  return %2 : i32
+}
+)mlir";
+
+const char *const kConvertedStr = R"mlir(func @convertible(%arg0: i64, %arg1: i64) -> i64 {
+  %0 = subi %arg0, %arg1 : i64
+  br ^bb1(%0 : i64)
+^bb1(%1: i64):	// pred: ^bb0
+  %2 = subi %1, %arg0 : i64
+  return %2 : i64
+}
+
+)mlir";
+
+TEST(DialectConversionTest, ConvertsInPlace) {
+  for (auto mode : {ConversionMode::Clone, ConversionMode::InPlace,
+                    ConversionMode::ParallelInPlace}) {
+    MLIRContext context;
+    std::unique_ptr<Module> module(
+        parseSourceString(kConvertibleStr, &context));
+    ASSERT_TRUE(module);
+    Function *function = &module->getFunctions().front();
+
+    ASSERT_TRUE(succeeded(WideningConversion().convert(module.get(), mode)));
+    ASSERT_TRUE(succeeded(module->verify()));
+    Function &converted = module->getFunctions().front();
+    EXPECT_EQ(printFunction(converted), kConvertedStr);
+
+    // Only the in-place modes keep the function, and its attribute is updated
+    // to the converted type.
+    if (mode != ConversionMode::Clone) {
+      EXPECT_EQ(&converted, function);
+      EXPECT_EQ(FunctionAttr::get(function, &context).getType(),
+                function->getType());
+    }
+  }
+}
+
+TEST(DialectConversionTest, RollsBackFailedFunction) {
+  MLIRContext context;
+  unsigned numErrors = 0;
+  context.getDiagEngine().setHandler(
+      [&](Location, StringRef, DiagnosticSeverity) { ++numErrors; });
+
+  std::unique_ptr<Module> module(parseSourceString(R"mlir(
+func @failing(%arg0: i32) -> i32 {
+  %0 = addi %arg0, %arg0 : i32
+  br ^bb1(%0 : i32)
+^bb1(%1: i32):
+  %2 = muli %1, %1 : i32
+  return %2 : i32
+}
+)mlir",
+                                                   &context));
+  ASSERT_TRUE(module);
+  Function &function = module->getFunctions().front();
+  std::string original = printFunction(function);
+
+  // The multiplication fails to convert after the addition is converted, which
+  // must leave the function unchanged.
+  EXPECT_TRUE(failed(WideningConversion().convert(module.get(),
+                                                  ConversionMode::InPlace)));
+  EXPECT_NE(numErrors, 0u);
+  ASSERT_TRUE(succeeded(module->verify()));
+  EXPECT_EQ(printFunction(function), original);
+}
+
+TEST(DialectConversionTest, ConvertsFunctionsInParallel) {
+  MLIRContext context;
+  // Collect the lines of the operations that failed to convert.
+  std::vector<unsigned> errorLines;
+  context.getDiagEngine().setHandler(
+      [&](Location loc, StringRef, DiagnosticSeverity) {
+        if (auto fileLoc = loc.dyn_cast<FileLineColLoc>())
+          errorLines.push_back(fileLoc->getLine());
+      });
+
+  // Every other function fails to convert.
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  for (unsigned i = 0; i < 64; ++i) {
+    os << "func @f" << i << "(%arg0: i32) -> i32 {\n";
+    os << "  %0 = " << (i % 2 ? "muli" : "addi") << " %arg0, %arg0 : i32\n";
+    os << "  return %0 : i32\n}\n";
+  }
+  std::unique_ptr<Module> module(parseSourceString(os.str(), &context));
+  ASSERT_TRUE(module);
+
+  EXPECT_TRUE(failed(WideningConversion().convert(
+      module.get(), ConversionMode::ParallelInPlace)));
+  ASSERT_TRUE(succeeded(module->verify()));
+
+  // The functions that failed are restored, the others are converted.
+  auto i32Type = IntegerType::get(32, &context);
+  auto i64Type = IntegerType::get(64, &context);
+  unsigned i = 0;
+  for (Function &function : *module) {
+    Type expectedType = i++ % 2 ? i32Type : i64Type;
+    EXPECT_EQ(function.getType(),
+              FunctionType::get(expectedType, expectedType, &context));
+    EXPECT_EQ(function.getArgument(0)->getType(), expectedType);
+  }
+
+  // The diagnostics are emitted in the order of the functions.
+  EXPECT_EQ(errorLines.size(), 32u);
+  EXPECT_TRUE(std::is_sorted(errorLines.begin(), errorLines.end()));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,110 @@
+//===- LoopFusionTest.cpp - Loop fusion unit tests ------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace mlir;
+
+namespace {
+
+/// Returns a function with 'numNests' top-level loop nests, in producer and
+/// consumer pairs communicating through a local buffer. All the producers read
+/// the same input buffer.
+std::string getProducerConsumerPairs(unsigned numNests) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  os << "func @pairs() {\n";
+  os << "  %in = alloc() : memref<16xf32>\n";
+  for (unsigned k = 0; k < numNests / 2; ++k) {
+    os << "  %t" << k << " = alloc() : memref<16xf32>\n";
+    os << "  %o" << k << " = alloc() : memref<16xf32>\n";
+    os << "  affine.for %i" << k << " = 0 to 16 {\n";
+    os << "    %v" << k << " = load %in[%i" << k << "] : memref<16xf32>\n";
+    os << "    store %v" << k << ", %t" << k << "[%i" << k
+       << "] : memref<16xf32>\n";
+    os << "  }\n";
+    os << "  affine.for %j" << k << " = 0 to 16 {\n";
+    os << "    %w" << k << " = load %t" << k << "[%j" << k
+       << "] : memref<16xf32>\n";
+    os << "    store %w" << k << ", %o" << k << "[%j" << k
+       << "] : memref<16xf32>\n";
+    os << "  }\n";
+  }
+  os << "  return\n}\n";
+  return os.str();
+}
+
+/// Returns the number of top-level loop nests of the given function.
+unsigned getNumLoopNests(Function &fn) {
+  unsigned numNests = 0;
+  for (auto &op : fn.front())
+    if (op.isa<AffineForOp>())
+      ++numNests;
+  return numNests;
+}
+
+LogicalResult runLoopFusion(Module *module) {
+  PassManager pm;
+  pm.addPass(createLoopFusionPass());
+  return pm.run(module);
+}
+
+TEST(LoopFusionTest, FusesProducerConsumerPairs) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(
+      parseSourceString(getProducerConsumerPairs(16), &context));
+  ASSERT_TRUE(module);
+  Function &fn = module->getFunctions().front();
+  EXPECT_EQ(getNumLoopNests(fn), 16u);
+
+  // Each producer is fused into its consumer, and not into the other nests
+  // reading the same input.
+  ASSERT_TRUE(succeeded(runLoopFusion(module.get())));
+  EXPECT_EQ(getNumLoopNests(fn), 8u);
+}
+
+// Measures how the fusion pass scales with the number of loop nests. Run with
+// --gtest_also_run_disabled_tests.
+TEST(LoopFusionTest, DISABLED_ScalingBenchmark) {
+  for (unsigned numNests : {1000u, 10000u, 50000u}) {
+    MLIRContext context;
+    std::unique_ptr<Module> module(
+        parseSourceString(getProducerConsumerPairs(numNests), &context));
+    ASSERT_TRUE(module);
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(succeeded(runLoopFusion(module.get())));
+    auto end = std::chrono::steady_clock::now();
+    EXPECT_EQ(getNumLoopNests(module->getFunctions().front()), numNests / 2);
+    double millis =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    llvm::outs() << numNests << " nests: " << llvm::format("%.1f", millis)
+                 << " ms\n";
+  }
+}
+
+} // end anonymous namespace
@@ -0,0 +1,123 @@
+//===- LowerAffineTest.cpp - Affine lowering unit tests -------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Dominance.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/Passes.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+
+/// Affine loops and conditionals, nested within each other and within a loop
+/// of the CFG.
+const char *const kModuleStr = R"mlir(
+#set = (d0) : (d0 - 10 >= 0)
+func @nested(%m : memref<20xf32>, %c : f32, %n : index, %cond : i1) {
+  br ^bb1
+^bb1:
+  affine.for %i = 0 to 20 {
+    affine.if #set(%i) {
+      store %c, %m[%i] : memref<20xf32>
+    } else {
+      affine.for %j = 0 to %n {
+        store %c, %m[%j] : memref<20xf32>
+      }
+    }
+  }
+  cond_br %cond, ^bb1, ^bb2
+^bb2:
+  affine.if #set(%n) {
+    store %c, %m[%n] : memref<20xf32>
+  }
+  return
+}
+)mlir";
+
+/// Computes the dominance of all the regions of the function.
+struct ComputeDominancePass : public FunctionPass<ComputeDominancePass> {
+  void runOnFunction() override {
+    auto &domInfo = getAnalysis<DominanceInfo>();
+    auto &postDomInfo = getAnalysis<PostDominanceInfo>();
+    domInfo.getRootNode(&getFunction().getBody());
+    postDomInfo.getRootNode(&getFunction().getBody());
+    getFunction().walk([&](Operation *op) {
+      for (auto &region : op->getRegions()) {
+        if (region.empty())
+          continue;
+        domInfo.getRootNode(&region);
+        postDomInfo.getRootNode(&region);
+      }
+    });
+    markAllAnalysesPreserved();
+  }
+};
+
+/// Checks that the dominance kept by the earlier passes matches the dominance
+/// computed from scratch.
+struct CheckDominancePass : public FunctionPass<CheckDominancePass> {
+  CheckDominancePass(unsigned &numChecked) : numChecked(numChecked) {}
+
+  void runOnFunction() override {
+    auto domInfo = getCachedAnalysis<DominanceInfo>();
+    auto postDomInfo = getCachedAnalysis<PostDominanceInfo>();
+    ASSERT_TRUE(domInfo.hasValue());
+    ASSERT_TRUE(postDomInfo.hasValue());
+
+    DominanceInfo expectedDomInfo(&getFunction());
+    PostDominanceInfo expectedPostDomInfo(&getFunction());
+    for (Block &a : getFunction()) {
+      for (Block &b : getFunction()) {
+        EXPECT_EQ(domInfo->get().properlyDominates(&a, &b),
+                  expectedDomInfo.properlyDominates(&a, &b));
+        EXPECT_EQ(postDomInfo->get().properlyPostDominates(&a, &b),
+                  expectedPostDomInfo.properlyPostDominates(&a, &b));
+      }
+    }
+    ++numChecked;
+    markAllAnalysesPreserved();
+  }
+
+  unsigned &numChecked;
+};
+
+TEST(LowerAffineTest, UpdatesDominance) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(kModuleStr, &context));
+  ASSERT_TRUE(module);
+
+  unsigned numChecked = 0;
+  PassManager pm;
+  pm.addPass(new ComputeDominancePass());
+  pm.addPass(createLowerAffinePass());
+  pm.addPass(new CheckDominancePass(numChecked));
+  ASSERT_TRUE(succeeded(pm.run(module.get())));
+  EXPECT_EQ(numChecked, 1u);
+
+  // The affine constructs were lowered to a CFG.
+  Function &fn = module->getFunctions().front();
+  EXPECT_GT(fn.getBlocks().size(), 10u);
+  fn.walk([](Operation *op) { EXPECT_EQ(op->getNumRegions(), 0u); });
+}
+
+} // end anonymous namespace